@@ -0,0 +1,470 @@
+#include <yaml-cpp/yaml.h>
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_util.h"
+#include "cx/config/config.h"
+
+using namespace cx;
+using namespace cx::bench;
+
+// 配置系统基准测试
+//
+//   yaml_load         不同大小的yaml文件通过Config::LoadFromFile加载的时间,
+//                     相邻两轮的文件数值不同,每个配置项都真正被修改
+//   lookup            1..N个线程通过名称Config::Lookup的吞吐量
+//   handle            1..N个线程通过ConfigHandle读取值的吞吐量
+//   read_value        一个线程不停set_value时,1..N个线程value()的吞吐量
+//   read_cache        同上,通过线程本地的ConfigCache读取
+//   listener_latency  set_value到监听器在投递线程中执行的延迟
+//
+// --stress开启随机压力测试:多个线程随机修改一组配置项(直接set_value,
+// from_string或LoadFromFile批量修改),同时多个线程随机通过value(),snapshot(),
+// ConfigCache与按名称查找读取,检查读到的值是否完整(torn)以及同一线程看到的
+// 版本是否回退,出现任何错误时返回1。
+//
+// 参数:
+//   --sizes=N,N  yaml_load的配置项数量,默认100,1000,10000
+//   --rounds=N   yaml_load每种大小加载的次数,默认10
+//   --threads=N  最多的线程数,从1开始翻倍,默认cpu核心数
+//   --ops=N      吞吐量测试每个线程的操作次数,默认1000000
+//   --events=N   监听器延迟测试的修改次数,默认10000
+//   --stress     开启压力测试
+//   --stress_ms=N 压力测试的时间,默认3000
+//   --seed=N     压力测试的随机数种子,默认为当前时间
+//   --dir=路径   生成文件的目录,默认/tmp/cx_bench_config
+//   --out=文件   JSON输出的文件,默认输出到stdout
+
+static std::vector<size_t> ParseSizes(const std::string& text) {
+  std::vector<size_t> sizes;
+  std::stringstream ss(text);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (!item.empty()) {
+      sizes.push_back(std::stoul(item));
+    }
+  }
+  return sizes;
+}
+
+static std::vector<size_t> ThreadCounts(size_t max_threads) {
+  std::vector<size_t> counts;
+  for (size_t n = 1; n < max_threads; n *= 2) {
+    counts.push_back(n);
+  }
+  counts.push_back(max_threads);
+  return counts;
+}
+
+/**
+ * @brief 同时启动threads个线程执行body(index),返回总耗时
+ */
+template <typename Body>
+static uint64_t RunThreads(size_t threads, Body&& body) {
+  std::atomic<size_t> ready{0};
+  std::atomic<bool> go{false};
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < threads; ++i) {
+    workers.emplace_back([&, i]() {
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      body(i);
+    });
+  }
+  while (ready.load() < threads) {
+    std::this_thread::yield();
+  }
+  uint64_t start = NowNs();
+  go.store(true, std::memory_order_release);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  return NowNs() - start;
+}
+
+/**
+ * @brief 生成prefix下keys个配置项的yaml文件,每100项一个分组
+ */
+static void Generate(const std::string& path, const std::string& prefix,
+                     size_t keys, size_t variant) {
+  YAML::Emitter out;
+  out << YAML::BeginMap << YAML::Key << prefix << YAML::Value
+      << YAML::BeginMap;
+  for (size_t i = 0; i < keys; ++i) {
+    if (i % 100 == 0) {
+      if (i > 0) out << YAML::EndMap;
+      out << YAML::Key << "sec" + std::to_string(i / 100) << YAML::Value
+          << YAML::BeginMap;
+    }
+    size_t v = i + variant;
+    out << YAML::Key << "k" + std::to_string(i % 100) << YAML::Value;
+    switch (i % 3) {
+      case 0:
+        out << (int)v;
+        break;
+      case 1:
+        out << "value_" + std::to_string(v);
+        break;
+      default:
+        out << YAML::Flow << YAML::BeginSeq << (int)v << (int)(v + 1)
+            << YAML::EndSeq;
+        break;
+    }
+  }
+  if (keys > 0) out << YAML::EndMap;
+  out << YAML::EndMap << YAML::EndMap;
+  std::ofstream(path) << out.c_str();
+}
+
+static std::string KeyName(const std::string& prefix, size_t i) {
+  return prefix + ".sec" + std::to_string(i / 100) + ".k" +
+         std::to_string(i % 100);
+}
+
+static void BenchLoad(const std::vector<size_t>& sizes, size_t rounds,
+                      const std::string& dir, Report& report) {
+  for (size_t keys : sizes) {
+    std::string prefix = "load" + std::to_string(keys);
+    for (size_t i = 0; i < keys; ++i) {
+      std::string name = KeyName(prefix, i);
+      if (i % 3 == 0) {
+        Config::Lookup<int>(name, 0);
+      } else if (i % 3 == 1) {
+        Config::Lookup<std::string>(name, std::string());
+      } else {
+        Config::Lookup<std::vector<int>>(name, {});
+      }
+    }
+
+    std::string files[2] = {dir + "/" + prefix + "_a.yml",
+                            dir + "/" + prefix + "_b.yml"};
+    for (size_t v = 0; v < 2; ++v) {
+      Generate(files[v], prefix, keys, v + 1);
+    }
+    // 两份文件交替复制到同一路径,加载器把它们当作同一个文件的修改
+    std::string path = dir + "/" + prefix + ".yml";
+    Histogram hist;
+    for (size_t r = 0; r < rounds; ++r) {
+      std::filesystem::copy_file(
+          files[r % 2], path, std::filesystem::copy_options::overwrite_existing);
+      uint64_t start = NowNs();
+      Config::LoadFromFile(path);
+      hist.add(NowNs() - start);
+    }
+    report.add(Result("yaml_load")
+                   .set("keys", keys)
+                   .set("file_kb", std::filesystem::file_size(path) / 1024.0)
+                   .set("rounds", rounds)
+                   .set_latency(hist));
+    for (auto& file : files) {
+      std::filesystem::remove(file);
+    }
+    std::filesystem::remove(path);
+  }
+}
+
+static void BenchLookup(size_t max_threads, uint64_t ops, Report& report) {
+  const size_t keys = 1000;
+  std::vector<std::string> names;
+  std::vector<ConfigHandle<int>> handles;
+  for (size_t i = 0; i < keys; ++i) {
+    names.push_back(KeyName("lookup", i));
+    handles.push_back(Config::Handle<int>(names.back(), (int)i));
+  }
+
+  for (size_t threads : ThreadCounts(max_threads)) {
+    std::atomic<uint64_t> sink{0};
+    uint64_t ns = RunThreads(threads, [&](size_t index) {
+      uint64_t sum = 0;
+      for (uint64_t i = 0; i < ops; ++i) {
+        sum += Config::Lookup<int>(names[(i + index * 7) % keys])->version();
+      }
+      sink += sum;
+    });
+    report.add(Result("lookup")
+                   .set("threads", threads)
+                   .set("mops", threads * ops / (ns / 1e3)));
+
+    ns = RunThreads(threads, [&](size_t index) {
+      uint64_t sum = 0;
+      for (uint64_t i = 0; i < ops; ++i) {
+        sum += handles[(i + index * 7) % keys].value();
+      }
+      sink += sum;
+    });
+    report.add(Result("handle")
+                   .set("threads", threads)
+                   .set("mops", threads * ops / (ns / 1e3)));
+  }
+}
+
+static void BenchRead(size_t max_threads, uint64_t ops, Report& report) {
+  auto var = Config::Lookup<std::string>("read.value", std::string(64, 'a'));
+
+  for (bool cached : {false, true}) {
+    for (size_t threads : ThreadCounts(max_threads)) {
+      std::atomic<bool> stop{false};
+      std::atomic<uint64_t> writes{0};
+      std::thread writer([&]() {
+        uint64_t n = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+          var->set_value(std::string(64, (char)('a' + n++ % 26)));
+          writes.store(n, std::memory_order_relaxed);
+        }
+      });
+
+      // 写入速度只统计读线程运行期间(含线程的创建与回收)的写入次数
+      std::atomic<uint64_t> sink{0};
+      uint64_t window = NowNs();
+      uint64_t written = writes.load(std::memory_order_relaxed);
+      uint64_t ns = RunThreads(threads, [&](size_t) {
+        uint64_t sum = 0;
+        if (cached) {
+          auto cache = var->cache();
+          for (uint64_t i = 0; i < ops; ++i) {
+            sum += cache->size();
+          }
+        } else {
+          for (uint64_t i = 0; i < ops; ++i) {
+            sum += var->value().size();
+          }
+        }
+        sink += sum;
+      });
+      written = writes.load(std::memory_order_relaxed) - written;
+      window = NowNs() - window;
+      stop = true;
+      writer.join();
+      report.add(Result(cached ? "read_cache" : "read_value")
+                     .set("threads", threads)
+                     .set("mops", threads * ops / (ns / 1e3))
+                     .set("writes_per_sec", written / (window / 1e9)));
+    }
+  }
+  ConfigDispatcher::Self()->flush();
+}
+
+static void BenchListener(uint64_t events, Report& report) {
+  auto var = Config::Lookup<int64_t>("listener.stamp", 0);
+  Histogram hist;
+  hist.reserve(events);
+  var->add_listener([&hist](const int64_t&, const int64_t& stamp) {
+    hist.add(NowNs() - (uint64_t)stamp);
+  });
+  for (uint64_t i = 0; i < events; ++i) {
+    var->set_value((int64_t)NowNs());
+    // 等待投递完再修改,否则多次修改合并为一次通知
+    ConfigDispatcher::Self()->flush();
+  }
+  var->clear_listener();
+  report.add(
+      Result("listener_latency").set("events", hist.count()).set_latency(hist));
+}
+
+/**
+ * @brief 压力测试的值:长度与内容都由seed决定,读到任何不一致的组合即为torn
+ */
+static std::vector<int64_t> MakeValue(uint64_t seed) {
+  std::vector<int64_t> value(1 + seed % 16);
+  for (size_t i = 0; i < value.size(); ++i) {
+    value[i] = (int64_t)(seed * (i + 1));
+  }
+  return value;
+}
+
+static bool CheckValue(const std::vector<int64_t>& value) {
+  if (value.empty()) {
+    return false;
+  }
+  uint64_t seed = (uint64_t)value[0];
+  if (value.size() != 1 + seed % 16) {
+    return false;
+  }
+  for (size_t i = 0; i < value.size(); ++i) {
+    if (value[i] != (int64_t)(seed * (i + 1))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static std::string ValueYaml(const std::vector<int64_t>& value) {
+  YAML::Emitter out;
+  out << YAML::Flow << value;
+  return out.c_str();
+}
+
+static bool Stress(size_t threads, uint64_t duration_ms, uint64_t seed,
+                   const std::string& dir, Report& report) {
+  typedef ConfigVar<std::vector<int64_t>> var_t;
+  const size_t vars = 64;
+  std::vector<var_t::ptr> items;
+  for (size_t i = 0; i < vars; ++i) {
+    items.push_back(Config::Lookup<std::vector<int64_t>>(
+        "stress.v" + std::to_string(i), MakeValue(i + 1)));
+  }
+
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> reads{0}, writes{0}, torn{0}, regressions{0},
+      missing{0}, notified{0};
+  for (auto& item : items) {
+    item->add_listener(
+        [&](const std::vector<int64_t>& old_val,
+            const std::vector<int64_t>& new_val) {
+          if (!CheckValue(old_val) || !CheckValue(new_val)) {
+            torn.fetch_add(1);
+          }
+          notified.fetch_add(1, std::memory_order_relaxed);
+        });
+  }
+
+  size_t writers = std::max<size_t>(1, threads / 2);
+  size_t readers = std::max<size_t>(1, threads - writers);
+  std::vector<std::thread> workers;
+  for (size_t w = 0; w < writers; ++w) {
+    workers.emplace_back([&, w]() {
+      std::mt19937_64 rng(seed + w);
+      std::string path = dir + "/stress" + std::to_string(w) + ".yml";
+      uint64_t n = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        size_t index = rng() % vars;
+        std::vector<int64_t> value = MakeValue(rng() % 1000000 + 1);
+        switch (rng() % 8) {
+          case 0:
+            items[index]->from_string(ValueYaml(value));
+            break;
+          case 1: {
+            // 一个文件批量修改几个配置项
+            std::ofstream(path)
+                << "stress:\n  v" << index << ": " << ValueYaml(value)
+                << "\n  v" << (index + 1) % vars << ": "
+                << ValueYaml(MakeValue(rng() % 1000000 + 1)) << "\n";
+            Config::LoadFromFile(path);
+            break;
+          }
+          default:
+            items[index]->set_value(value);
+            break;
+        }
+        ++n;
+      }
+      writes += n;
+    });
+  }
+  for (size_t r = 0; r < readers; ++r) {
+    workers.emplace_back([&, r]() {
+      std::mt19937_64 rng(seed + 1000 + r);
+      std::vector<uint64_t> last_version(vars, 0);
+      std::vector<ConfigCache<var_t>> caches;
+      for (auto& item : items) {
+        caches.push_back(item->cache());
+      }
+      uint64_t n = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        size_t index = rng() % vars;
+        switch (rng() % 4) {
+          case 0: {
+            var_t::snapshot_t snapshot = items[index]->snapshot();
+            if (!CheckValue(snapshot->value)) {
+              torn.fetch_add(1);
+            }
+            // 同一线程看到的版本不能回退
+            if (snapshot->version < last_version[index]) {
+              regressions.fetch_add(1);
+            }
+            last_version[index] = snapshot->version;
+            break;
+          }
+          case 1:
+            if (!CheckValue(*caches[index])) {
+              torn.fetch_add(1);
+            }
+            break;
+          case 2: {
+            auto var = Config::Lookup<std::vector<int64_t>>(
+                "stress.v" + std::to_string(index));
+            if (!var) {
+              missing.fetch_add(1);
+            } else if (!CheckValue(var->value())) {
+              torn.fetch_add(1);
+            }
+            break;
+          }
+          default:
+            if (!CheckValue(items[index]->value())) {
+              torn.fetch_add(1);
+            }
+            break;
+        }
+        ++n;
+      }
+      reads += n;
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+  stop = true;
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  ConfigDispatcher::Self()->flush();
+  for (auto& item : items) {
+    item->clear_listener();
+  }
+  for (size_t w = 0; w < writers; ++w) {
+    std::filesystem::remove(dir + "/stress" + std::to_string(w) + ".yml");
+  }
+
+  report.add(Result("stress")
+                 .set("seed", seed)
+                 .set("writers", writers)
+                 .set("readers", readers)
+                 .set("reads", reads.load())
+                 .set("writes", writes.load())
+                 .set("notified", notified.load())
+                 .set("torn", torn.load())
+                 .set("version_regressions", regressions.load())
+                 .set("missing", missing.load()));
+  return torn == 0 && regressions == 0 && missing == 0;
+}
+
+int main(int argc, char const* argv[]) {
+  Args args(argc, argv);
+  std::vector<size_t> sizes = ParseSizes(args.get("sizes", "100,1000,10000"));
+  size_t rounds = std::max<int64_t>(1, args.get_int("rounds", 10));
+  size_t max_threads = args.get_int("threads", 0);
+  if (max_threads == 0) {
+    max_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  uint64_t ops = args.get_int("ops", 1000000);
+  uint64_t events = args.get_int("events", 10000);
+  std::string dir = args.get("dir", "/tmp/cx_bench_config");
+  std::filesystem::create_directories(dir);
+
+  Report report("config", args);
+  BenchLoad(sizes, rounds, dir, report);
+  BenchLookup(max_threads, ops, report);
+  BenchRead(max_threads, ops, report);
+  BenchListener(events, report);
+
+  bool ok = true;
+  if (args.has("stress")) {
+    uint64_t seed = args.get_int("seed", (int64_t)NowNs());
+    // 压力测试至少用4个线程,单核上也能交错执行
+    ok = Stress(std::max<size_t>(4, max_threads),
+                args.get_int("stress_ms", 3000), seed, dir, report);
+  }
+
+  ConfigDispatcher::Self()->flush();
+  report.write();
+  return ok ? 0 : 1;
+}
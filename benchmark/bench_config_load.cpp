@@ -0,0 +1,344 @@
+#include <sys/wait.h>
+#include <unistd.h>
+#include <yaml-cpp/yaml.h>
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_util.h"
+#include "cx/config/compiled_config.h"
+#include "cx/config/config.h"
+
+using namespace cx;
+using namespace cx::bench;
+
+// 配置加载基准测试
+//
+// 生成一个包含N个配置项的yaml文件(每100项一个分组,类型依次为整数、浮点数、
+// 字符串、布尔、整数数组、字符串到整数的映射),比较三种加载方式:
+//   string  旧的方式:展开后非标量重新输出为yaml文本,再经from_string解析
+//   typed   展开后直接从yaml节点转换(from_node)
+//   loader  Config::LoadFromFile,包括与上次加载的差异比较与批量修改
+// 每次加载使用数值不同的文件,保证每个配置项都真正被修改。string与typed解析
+// yaml文件的时间相同,结果中parse_ms单独列出,load_ms减去它即转换的时间。先校验
+// string与typed两种方式得到的值一致。
+//
+// 冷启动:把同样的配置项拆成多个文件放在一个目录下,每轮fork一个新进程注册
+// 配置项后调用Config::LoadFromDirectory,分别测量串行与并发解析yaml(cold_yaml,
+// threads为解析线程数)以及从Config::Compile生成的快照加载(cold_snapshot)的
+// 时间,并校验各种方式得到的值一致。文件都在页缓存中,测量的是进程冷启动而
+// 不是磁盘冷启动。另外分别从快照与yaml加载时只先注册一半的配置项,加载后再
+// 注册其余的,校验后注册的配置项同样取得文件中的值(late_match)。
+//
+// 参数:
+//   --keys=N    配置项数量,默认10000
+//   --files=N   冷启动时的文件数量,默认100
+//   --threads=N 并发解析的线程数,默认0即cpu核心数
+//   --rounds=N  每种方式加载的次数,默认5
+//   --dir=路径  生成文件的目录,默认/tmp/cx_bench_config
+//   --out=文件  JSON输出的文件,默认输出到stdout
+
+enum class Kind { eInt, eDouble, eString, eBool, eVector, eMap, eCount };
+
+static std::string KeyName(size_t i) {
+  return "sec" + std::to_string(i / 100) + ".k" + std::to_string(i % 100);
+}
+
+/**
+ * @brief 生成第variant份配置文件,包含[begin, end)的配置项,begin为100的倍数
+ */
+static void Generate(const std::string& path, size_t begin, size_t end,
+                     size_t variant) {
+  YAML::Emitter out;
+  out << YAML::BeginMap;
+  for (size_t i = begin; i < end; ++i) {
+    if (i % 100 == 0) {
+      if (i > begin) out << YAML::EndMap;
+      out << YAML::Key << "sec" + std::to_string(i / 100) << YAML::Value
+          << YAML::BeginMap;
+    }
+    size_t v = i + variant * 7;
+    out << YAML::Key << "k" + std::to_string(i % 100) << YAML::Value;
+    switch ((Kind)(i % (size_t)Kind::eCount)) {
+      case Kind::eInt:
+        out << (int)v;
+        break;
+      case Kind::eDouble:
+        out << v / 8.0;
+        break;
+      case Kind::eString:
+        out << "value_" + std::to_string(v);
+        break;
+      case Kind::eBool:
+        out << (variant % 2 == 0);
+        break;
+      case Kind::eVector:
+        out << YAML::Flow << YAML::BeginSeq;
+        for (size_t j = 0; j < 8; ++j) out << (int)(v + j);
+        out << YAML::EndSeq;
+        break;
+      default:
+        out << YAML::Flow << YAML::BeginMap;
+        for (size_t j = 0; j < 4; ++j)
+          out << YAML::Key << "m" + std::to_string(j) << YAML::Value
+              << (int)(v * j);
+        out << YAML::EndMap;
+        break;
+    }
+  }
+  if (end > begin) out << YAML::EndMap;
+  out << YAML::EndMap;
+  std::ofstream(path) << out.c_str();
+}
+
+static void Register(size_t begin, size_t end) {
+  for (size_t i = begin; i < end; ++i) {
+    std::string name = KeyName(i);
+    switch ((Kind)(i % (size_t)Kind::eCount)) {
+      case Kind::eInt:
+        Config::Lookup<int>(name, 0);
+        break;
+      case Kind::eDouble:
+        Config::Lookup<double>(name, 0.0);
+        break;
+      case Kind::eString:
+        Config::Lookup<std::string>(name, std::string());
+        break;
+      case Kind::eBool:
+        Config::Lookup<bool>(name, false);
+        break;
+      case Kind::eVector:
+        Config::Lookup<std::vector<int>>(name, {});
+        break;
+      default:
+        Config::Lookup<std::map<std::string, int>>(name, {});
+        break;
+    }
+  }
+}
+
+/**
+ * @brief 展开yaml树,与加载器相同包括中间的分组
+ */
+static void Flatten(const std::string& prefix, const YAML::Node& node,
+                    std::vector<std::pair<std::string, YAML::Node>>& out) {
+  if (!prefix.empty()) {
+    out.emplace_back(prefix, node);
+  }
+  if (node.IsMap()) {
+    for (auto it : node) {
+      std::string key = it.first.Scalar();
+      Flatten(prefix.empty() ? key : prefix + "." + key, it.second, out);
+    }
+  }
+}
+
+static void ConvertString(const YAML::Node& root) {
+  std::vector<std::pair<std::string, YAML::Node>> nodes;
+  Flatten("", root, nodes);
+  for (auto& [key, node] : nodes) {
+    ConfigVarBase::ptr var = Config::LookupBase(key);
+    if (!var) continue;
+    if (node.IsScalar()) {
+      var->from_string(node.Scalar());
+    } else {
+      YAML::Emitter out;
+      out << node;
+      var->from_string(out.c_str());
+    }
+  }
+}
+
+static void ConvertTyped(const YAML::Node& root) {
+  std::vector<std::pair<std::string, YAML::Node>> nodes;
+  Flatten("", root, nodes);
+  for (auto& [key, node] : nodes) {
+    ConfigVarBase::ptr var = Config::LookupBase(key);
+    if (var) {
+      var->from_node(node);
+    }
+  }
+}
+
+static size_t Checksum(size_t keys) {
+  std::string all;
+  for (size_t i = 0; i < keys; ++i) {
+    all += Config::LookupBase(KeyName(i))->to_string();
+    all += '\n';
+  }
+  return std::hash<std::string>()(all);
+}
+
+struct ColdResult {
+  uint64_t load_ns;
+  size_t checksum;
+};
+
+/**
+ * @brief 在新进程中加载目录,父进程还没有使用过Config,fork是安全的
+ */
+static bool ColdStart(const std::string& dir, size_t keys, size_t threads,
+                      bool late, ColdResult& result) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return false;
+  }
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    Config::SetLoadThreads(threads);
+    size_t early = late ? keys / 2 : keys;
+    Register(0, early);
+    ColdResult child;
+    uint64_t start = NowNs();
+    Config::LoadFromDirectory(dir);
+    child.load_ns = NowNs() - start;
+    Register(early, keys);
+    child.checksum = Checksum(keys);
+    bool ok = write(fds[1], &child, sizeof(child)) == sizeof(child);
+    _exit(ok ? 0 : 1);
+  }
+  close(fds[1]);
+  bool ok = pid > 0 && read(fds[0], &result, sizeof(result)) == sizeof(result);
+  close(fds[0]);
+  if (pid > 0) {
+    waitpid(pid, nullptr, 0);
+  }
+  return ok;
+}
+
+int main(int argc, char const* argv[]) {
+  Args args(argc, argv);
+  size_t keys = args.get_int("keys", 10000);
+  size_t file_count = std::max<int64_t>(1, args.get_int("files", 100));
+  size_t threads = args.get_int("threads", 0);
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  size_t rounds = std::max<int64_t>(1, args.get_int("rounds", 5));
+  std::string dir = args.get("dir", "/tmp/cx_bench_config");
+
+  std::filesystem::create_directories(dir);
+  // 每种方式每轮一份文件,另外两份用于校验
+  size_t variants = rounds * 3 + 2;
+  std::vector<std::string> files;
+  for (size_t v = 0; v < variants; ++v) {
+    files.push_back(dir + "/variant" + std::to_string(v) + ".yml");
+    Generate(files.back(), 0, keys, v);
+  }
+
+  std::string tree = dir + "/tree";
+  std::filesystem::remove_all(tree);
+  std::filesystem::create_directories(tree);
+  size_t per_file = (keys / file_count + 99) / 100 * 100;
+  for (size_t begin = 0; begin < keys; begin += per_file) {
+    Generate(tree + "/part" + std::to_string(begin / per_file) + ".yml",
+             begin, std::min(keys, begin + per_file), 0);
+  }
+
+  Report report("config_load", args);
+
+  // 冷启动必须在本进程使用Config之前,之后配置通知线程已经启动
+  bool cold_match = true;
+  size_t cold_checksum = 0;
+  std::pair<bool, size_t> modes[] = {{false, 1}, {false, threads}, {true, 1}};
+  for (auto [compiled, load_threads] : modes) {
+    if (compiled && !Config::Compile(tree)) {
+      cold_match = false;
+      break;
+    }
+    Histogram cold;
+    for (size_t r = 0; r < rounds; ++r) {
+      ColdResult result;
+      if (!ColdStart(tree, keys, load_threads, false, result)) {
+        cold_match = false;
+        break;
+      }
+      // 每轮以及各种方式得到的值都应相同
+      if (cold_checksum != 0 && result.checksum != cold_checksum) {
+        cold_match = false;
+      }
+      cold_checksum = result.checksum;
+      cold.add(result.load_ns);
+    }
+    Result cold_result(compiled ? "cold_snapshot" : "cold_yaml");
+    cold_result.set("keys", keys)
+        .set("files", file_count)
+        .set("threads", load_threads)
+        .set("rounds", rounds)
+        .set("load_ms", cold.percentile(50) / 1e6);
+    if (compiled) {
+      cold_result.set(
+          "snapshot_kb",
+          std::filesystem::file_size(tree + "/" + CompiledConfig::FILE_NAME) /
+              1024.0);
+    }
+    report.add(cold_result);
+  }
+
+  // 快照此时还有效,先从快照加载,删除快照后再从yaml加载
+  bool late_match = true;
+  for (int i = 0; i < 2; ++i) {
+    ColdResult result;
+    if (!ColdStart(tree, keys, 1, true, result) ||
+        result.checksum != cold_checksum) {
+      late_match = false;
+    }
+    std::filesystem::remove(tree + "/" + CompiledConfig::FILE_NAME);
+  }
+  std::filesystem::remove_all(tree);
+
+  Register(0, keys);
+
+  ConvertString(YAML::LoadFile(files[0]));
+  size_t expect = Checksum(keys);
+  ConvertString(YAML::LoadFile(files[1]));
+  ConvertTyped(YAML::LoadFile(files[0]));
+  bool match = Checksum(keys) == expect;
+  report.add(Result("verify")
+                 .set("keys", keys)
+                 .set("match", match ? 1 : 0)
+                 .set("cold_match", cold_match ? 1 : 0)
+                 .set("late_match", late_match ? 1 : 0));
+
+  // 解析yaml文件的时间两种方式相同,分开统计
+  size_t next = 2;
+  for (auto convert : {ConvertString, ConvertTyped}) {
+    Histogram parse, total;
+    for (size_t r = 0; r < rounds; ++r) {
+      uint64_t start = NowNs();
+      YAML::Node root = YAML::LoadFile(files[next++]);
+      uint64_t parsed = NowNs();
+      convert(root);
+      parse.add(parsed - start);
+      total.add(NowNs() - start);
+    }
+    report.add(Result(convert == ConvertString ? "string" : "typed")
+                   .set("keys", keys)
+                   .set("rounds", rounds)
+                   .set("parse_ms", parse.percentile(50) / 1e6)
+                   .set("load_ms", total.percentile(50) / 1e6));
+  }
+
+  Histogram loader;
+  for (size_t r = 0; r < rounds; ++r) {
+    uint64_t start = NowNs();
+    Config::LoadFromFile(files[next++]);
+    loader.add(NowNs() - start);
+  }
+  report.add(Result("loader")
+                 .set("keys", keys)
+                 .set("rounds", rounds)
+                 .set("load_ms", loader.percentile(50) / 1e6));
+
+  ConfigDispatcher::Self()->flush();
+  report.write();
+  for (auto& file : files) {
+    std::filesystem::remove(file);
+  }
+  return match && cold_match && late_match ? 0 : 1;
+}
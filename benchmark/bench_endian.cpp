@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_util.h"
+#include "cx/net/endian.h"
+
+using namespace cx::bench;
+
+// 批量字节序转换基准测试
+//
+// 先对所有宽度、长度0~300与不同的对齐偏移,把byteswap_n的结果与逐个元素的
+// 标量实现比较;再分别测量逐个元素转换与批量转换在不同数据量下的吞吐。
+//
+// 参数:
+//   --bytes=N     在256B/4KB/64KB/16MB之外额外测试的数据量,默认不测试
+//   --total-mb=N  每个数据量累计转换的数据量(MB),默认1024
+//   --seed=N      随机种子,默认1
+//   --out=文件    JSON输出的文件,默认输出到stdout
+
+/**
+ * @brief 逐个元素的参考实现
+ */
+template <class T>
+static void SwapReference(char* dst, const char* src, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    T v;
+    memcpy(&v, src + i * sizeof(T), sizeof(T));
+    v = byteswap(v);
+    memcpy(dst + i * sizeof(T), &v, sizeof(T));
+  }
+}
+
+static void Reference(char* dst, const char* src, size_t count, size_t width) {
+  switch (width) {
+    case 2:
+      SwapReference<uint16_t>(dst, src, count);
+      break;
+    case 4:
+      SwapReference<uint32_t>(dst, src, count);
+      break;
+    default:
+      SwapReference<uint64_t>(dst, src, count);
+      break;
+  }
+}
+
+/**
+ * @return 与参考实现不一致的情况数量
+ */
+static uint64_t Verify(std::mt19937& rng) {
+  static_assert(byteswap((uint16_t)0x1122) == 0x2211, "");
+  static_assert(byteswap((uint32_t)0x11223344) == 0x44332211, "");
+  static_assert(byteswap((uint64_t)0x1122334455667788) == 0x8877665544332211,
+                "");
+  static_assert(byteswap((int32_t)-2) == (int32_t)0xfeffffff, "");
+
+  uint64_t mismatches = 0;
+  std::vector<char> src(4096 + 64), expect(src.size()), actual(src.size());
+  for (auto& c : src) {
+    c = (char)rng();
+  }
+  for (size_t width : {2, 4, 8}) {
+    for (size_t count = 0; count <= 300; ++count) {
+      for (size_t offset = 0; offset < 8; ++offset) {
+        size_t bytes = count * width;
+        Reference(expect.data(), src.data() + offset, count, width);
+        memset(actual.data(), 0, actual.size());
+        byteswap_n(actual.data() + offset, src.data() + offset, count, width);
+        if (memcmp(expect.data(), actual.data() + offset, bytes) != 0 ||
+            actual[offset + bytes] != 0) {
+          ++mismatches;
+        }
+
+        // 原地转换
+        memcpy(actual.data(), src.data() + offset, bytes);
+        byteswap_n(actual.data(), actual.data(), count, width);
+        if (memcmp(expect.data(), actual.data(), bytes) != 0) {
+          ++mismatches;
+        }
+      }
+    }
+  }
+
+  // 浮点数往返
+  std::vector<double> values(1000), wire(1000), back(1000);
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = (double)rng() / 7.0;
+  }
+  to_be_n(wire.data(), values.data(), values.size());
+  from_be_n(back.data(), wire.data(), values.size());
+  if (memcmp(values.data(), back.data(), values.size() * sizeof(double)) != 0) {
+    ++mismatches;
+  }
+  return mismatches;
+}
+
+int main(int argc, char const* argv[]) {
+  Args args(argc, argv);
+  uint64_t total = (uint64_t)args.get_int("total-mb", 1024) << 20;
+  std::mt19937 rng((uint32_t)args.get_int("seed", 1));
+
+  Report report("endian", args);
+
+  uint64_t mismatches = Verify(rng);
+  report.add(Result("verify").set("mismatches", mismatches));
+
+  std::vector<size_t> sizes = {256, 4096, 64 * 1024, 16 * 1024 * 1024};
+  if (args.get_int("bytes", 0) > 0) {
+    sizes.push_back(args.get_int("bytes", 0));
+  }
+
+  for (size_t bytes : sizes) {
+    std::vector<char> src(bytes), dst(bytes);
+    for (auto& c : src) {
+      c = (char)rng();
+    }
+    uint64_t rounds = std::max<uint64_t>(1, total / bytes);
+
+    for (size_t width : {2, 4, 8}) {
+      size_t count = bytes / width;
+
+      uint64_t start = NowNs();
+      for (uint64_t r = 0; r < rounds; ++r) {
+        Reference(dst.data(), src.data(), count, width);
+        // 阻止编译器把多轮合并
+        src[r % bytes] ^= dst[(r * 7) % bytes];
+      }
+      double scalar = (NowNs() - start) / 1e9;
+
+      start = NowNs();
+      for (uint64_t r = 0; r < rounds; ++r) {
+        byteswap_n(dst.data(), src.data(), count, width);
+        src[r % bytes] ^= dst[(r * 7) % bytes];
+      }
+      double bulk = (NowNs() - start) / 1e9;
+
+      double gb = (double)rounds * count * width / 1e9;
+      report.add(Result("swap" + std::to_string(width * 8) + "_" +
+                        std::to_string(bytes))
+                     .set("bytes", bytes)
+                     .set("width", width)
+                     .set("scalar_gb_per_sec", gb / scalar)
+                     .set("bulk_gb_per_sec", gb / bulk)
+                     .set("speedup", scalar / bulk));
+    }
+  }
+
+  report.write();
+  return mismatches == 0 ? 0 : 1;
+}
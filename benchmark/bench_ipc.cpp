@@ -0,0 +1,269 @@
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "bench_util.h"
+#include "cx/net/shm_channel.h"
+#include "cx/net/sock_addr.h"
+#include "cx/net/socket.h"
+
+using namespace cx::net;
+using namespace cx::bench;
+
+// 同机进程间通信基准测试
+//
+// 服务端运行在fork出的子进程中,对比共享内存通道ShmChannel与Unix域流式socket:
+//   pingpong  一问一答的往返延迟
+//   stream    单向连续发送的吞吐
+//
+// 参数:
+//   --duration=毫秒   每项测试的时长,默认2000
+//   --capacity=字节   共享内存环形缓冲大小,默认1MB
+//   --spin-us=微秒    ShmChannel阻塞前的自旋时间,默认20
+//   --filter=名称     只运行名称包含该字符串的测试
+//   --out=文件        JSON输出的文件,默认输出到stdout
+
+static const size_t MESSAGE_SIZES[] = {64, 4096};
+
+enum class Mode { eEcho, eSink };
+
+static std::string SocketPath(const char* name) {
+  return "/tmp/cx_bench_ipc_" + std::string(name) + "_" +
+         std::to_string(getpid());
+}
+
+/**
+ * @brief 子进程中的共享内存服务端;sink模式收到空消息时回复收到的消息数量
+ */
+static void ShmServer(ShmAcceptor& acceptor, Mode mode) {
+  ShmChannel::ptr channel = acceptor.accept();
+  if (!channel) {
+    return;
+  }
+  uint64_t received = 0;
+  bool done = false;
+  while (!done && channel->wait()) {
+    channel->receive([&](const char* data, size_t len) {
+      if (mode == Mode::eEcho) {
+        channel->send(data, len, -1);
+      } else if (len == 0) {
+        channel->send(&received, sizeof(received), -1);
+        done = true;
+      } else {
+        ++received;
+      }
+    });
+  }
+}
+
+/**
+ * @brief 子进程中的socket服务端;sink模式读到EOF时回复收到的字节数
+ */
+static void SocketServer(Socket::ptr listener, Mode mode, size_t size) {
+  Socket::ptr sock = listener->accept();
+  if (!sock) {
+    return;
+  }
+  std::vector<char> buf(std::max(size, (size_t)64 * 1024));
+  if (mode == Mode::eEcho) {
+    while (RecvAll(sock, buf.data(), size) && SendAll(sock, buf.data(), size)) {
+    }
+    return;
+  }
+
+  uint64_t received = 0;
+  int n;
+  while ((n = sock->recv(buf.data(), buf.size())) > 0) {
+    received += n;
+  }
+  SendAll(sock, (const char*)&received, sizeof(received));
+}
+
+/**
+ * @brief 测试的一端,封装两种传输方式
+ */
+struct Endpoint {
+  std::string transport;
+  std::string path;
+  ShmChannel::Options options;
+  pid_t child = -1;
+
+  ShmChannel::ptr channel;
+  Socket::ptr sock;
+
+  /**
+   * @brief 启动子进程服务端并连接
+   */
+  bool start(Mode mode, size_t size) {
+    if (transport == "shm") {
+      ShmAcceptor acceptor(options);
+      if (!acceptor.bind(path)) {
+        return false;
+      }
+      child = fork();
+      if (child == 0) {
+        ShmServer(acceptor, mode);
+        _exit(0);
+      }
+      channel = ShmChannel::Connect(path, options);
+      return channel != nullptr;
+    }
+
+    unlink(path.c_str());
+    Socket::ptr listener = Socket::GenerateUnixTCPSocket();
+    if (!listener->bind(SockAddr::Unix(path)) || !listener->listen()) {
+      return false;
+    }
+    child = fork();
+    if (child == 0) {
+      SocketServer(listener, mode, size);
+      _exit(0);
+    }
+    listener->close();
+    sock = Socket::GenerateUnixTCPSocket();
+    return sock->connect(SockAddr::Unix(path));
+  }
+
+  void stop() {
+    if (channel) {
+      channel->close();
+      channel.reset();
+    }
+    if (sock) {
+      sock->close();
+      sock.reset();
+    }
+    if (child > 0) {
+      waitpid(child, nullptr, 0);
+      child = -1;
+    }
+    unlink(path.c_str());
+  }
+};
+
+/**
+ * @brief 一问一答的往返延迟
+ */
+void bench_pingpong(Report& report, Endpoint& endpoint, size_t size,
+                    int64_t duration_ms) {
+  if (!endpoint.start(Mode::eEcho, size)) {
+    std::cerr << "pingpong: start " << endpoint.transport << " failed"
+              << std::endl;
+    endpoint.stop();
+    return;
+  }
+
+  std::vector<char> msg(size, 'p');
+  std::vector<char> buf(size);
+  std::string reply;
+  Histogram hist;
+  hist.reserve(1 << 20);
+  uint64_t end = NowNs() + duration_ms * 1000000;
+  while (NowNs() < end) {
+    uint64_t start = NowNs();
+    if (endpoint.channel) {
+      if (!endpoint.channel->send(msg.data(), size, -1) ||
+          !endpoint.channel->recv(reply)) {
+        break;
+      }
+    } else if (!SendAll(endpoint.sock, msg.data(), size) ||
+               !RecvAll(endpoint.sock, buf.data(), size)) {
+      break;
+    }
+    hist.add(NowNs() - start);
+  }
+
+  uint64_t wakeups = endpoint.channel ? endpoint.channel->wakeups() : 0;
+  endpoint.stop();
+  report.add(Result("pingpong")
+                 .set("transport", endpoint.transport)
+                 .set("message_bytes", size)
+                 .set("round_trips_per_sec", hist.count() * 1000.0 / duration_ms)
+                 .set("client_wakeups", wakeups)
+                 .set_latency(hist));
+}
+
+/**
+ * @brief 单向连续发送的吞吐,以服务端实际收到的数据计算
+ */
+void bench_stream(Report& report, Endpoint& endpoint, size_t size,
+                  int64_t duration_ms) {
+  if (!endpoint.start(Mode::eSink, size)) {
+    std::cerr << "stream: start " << endpoint.transport << " failed"
+              << std::endl;
+    endpoint.stop();
+    return;
+  }
+
+  std::vector<char> msg(size, 's');
+  uint64_t start = NowNs();
+  uint64_t end = start + duration_ms * 1000000;
+  uint64_t received = 0;
+  if (endpoint.channel) {
+    while (NowNs() < end) {
+      for (int i = 0; i < 64; ++i) {
+        endpoint.channel->send(msg.data(), size, -1);
+      }
+    }
+    std::string reply;
+    endpoint.channel->send(msg.data(), 0, -1);
+    if (endpoint.channel->recv(reply) && reply.size() == sizeof(received)) {
+      memcpy(&received, reply.data(), sizeof(received));
+    }
+  } else {
+    while (NowNs() < end) {
+      for (int i = 0; i < 64; ++i) {
+        SendAll(endpoint.sock, msg.data(), size);
+      }
+    }
+    ::shutdown(endpoint.sock->socket(), SHUT_WR);
+    uint64_t bytes = 0;
+    if (RecvAll(endpoint.sock, (char*)&bytes, sizeof(bytes))) {
+      received = bytes / size;
+    }
+  }
+  double seconds = (NowNs() - start) / 1e9;
+
+  uint64_t wakeups = endpoint.channel ? endpoint.channel->wakeups() : 0;
+  endpoint.stop();
+  report.add(Result("stream")
+                 .set("transport", endpoint.transport)
+                 .set("message_bytes", size)
+                 .set("messages_per_sec", received / seconds)
+                 .set("mb_per_sec", received * size / seconds / (1024 * 1024))
+                 .set("client_wakeups", wakeups));
+}
+
+int main(int argc, char const* argv[]) {
+  Args args(argc, argv);
+  int64_t duration_ms = args.get_int("duration", 2000);
+  std::string filter = args.get("filter");
+  auto enabled = [&](const std::string& name) {
+    return filter.empty() || name.find(filter) != std::string::npos;
+  };
+
+  ShmChannel::Options options;
+  options.capacity = (size_t)args.get_int("capacity", options.capacity);
+  options.spin_us = (uint32_t)args.get_int("spin-us", options.spin_us);
+
+  Report report("ipc", args);
+  for (const char* transport : {"shm", "unix"}) {
+    Endpoint endpoint;
+    endpoint.transport = transport;
+    endpoint.path = SocketPath(transport);
+    endpoint.options = options;
+    for (size_t size : MESSAGE_SIZES) {
+      if (enabled("pingpong")) {
+        bench_pingpong(report, endpoint, size, duration_ms);
+      }
+      if (enabled("stream")) {
+        bench_stream(report, endpoint, size, duration_ms);
+      }
+    }
+  }
+  report.write();
+  return 0;
+}
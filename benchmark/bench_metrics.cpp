@@ -0,0 +1,198 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_util.h"
+#include "cx/net/metrics_server.h"
+
+using namespace cx;
+using namespace cx::net;
+using namespace cx::bench;
+
+// 指标服务基准测试
+//
+// 模拟帧循环每帧更新指标,同时由另一个线程通过HTTP持续抓取,比较有无抓取时
+// 更新的开销,并测量序列化与抓取的速度。
+//
+// 参数:
+//   --metrics=N    额外注册的指标数量,默认1000
+//   --frames=N     模拟的帧数,默认200000
+//   --updates=N    每帧更新的指标数量,默认16
+//   --scrapes=N    单独测量抓取时的请求数量,默认2000
+//   --out=文件     JSON输出的文件,默认输出到stdout
+
+/**
+ * @brief 保持连接的简单HTTP客户端,读取一个完整的响应
+ */
+class Scraper {
+ public:
+  Scraper(Address::ptr address) : m_sock(Socket::GenerateTCP(address)) {
+    m_connected = m_sock->connect(address);
+  }
+
+  bool connected() const { return m_connected; }
+
+  /**
+   * @return 响应体的长度,失败时返回0
+   */
+  size_t get(const std::string& path) {
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: bench\r\n\r\n";
+    if (m_sock->send(request.data(), request.size()) != (int)request.size()) {
+      return 0;
+    }
+
+    m_buffer.clear();
+    size_t header_end = std::string::npos;
+    size_t length = 0;
+    char buf[16384];
+    for (;;) {
+      if (header_end != std::string::npos &&
+          m_buffer.size() >= header_end + length) {
+        return length;
+      }
+      int n = m_sock->recv(buf, sizeof(buf));
+      if (n <= 0) {
+        return 0;
+      }
+      m_buffer.append(buf, n);
+      if (header_end == std::string::npos) {
+        size_t pos = m_buffer.find("\r\n\r\n");
+        if (pos == std::string::npos) {
+          continue;
+        }
+        header_end = pos + 4;
+        size_t cl = m_buffer.find("Content-Length: ");
+        if (cl == std::string::npos || cl > pos) {
+          return 0;
+        }
+        length = std::stoul(m_buffer.substr(cl + 16));
+      }
+    }
+  }
+
+ private:
+  Socket::ptr m_sock;
+  bool m_connected;
+  std::string m_buffer;
+};
+
+/**
+ * @brief 模拟帧循环更新指标
+ *
+ * @return 每次更新的平均纳秒数
+ */
+static double RunFrames(uint64_t frames, size_t updates,
+                        std::vector<metrics::Counter::ptr>& counters,
+                        std::vector<metrics::Gauge::ptr>& gauges,
+                        Histogram& frame_cost) {
+  uint64_t start = NowNs();
+  for (uint64_t frame = 0; frame < frames; ++frame) {
+    uint64_t frame_start = NowNs();
+    for (size_t i = 0; i < updates; ++i) {
+      size_t index = (frame + i) % counters.size();
+      counters[index]->inc();
+      gauges[index]->set((double)frame);
+    }
+    frame_cost.add(NowNs() - frame_start);
+  }
+  return (double)(NowNs() - start) / (frames * updates * 2);
+}
+
+int main(int argc, char const* argv[]) {
+  Args args(argc, argv);
+  size_t metric_count = args.get_int("metrics", 1000);
+  uint64_t frames = args.get_int("frames", 200000);
+  size_t updates = args.get_int("updates", 16);
+  uint64_t scrapes = args.get_int("scrapes", 2000);
+
+  auto registry = metrics::Registry::Self();
+  std::vector<metrics::Counter::ptr> counters;
+  std::vector<metrics::Gauge::ptr> gauges;
+  for (size_t i = 0; i < metric_count / 2; ++i) {
+    std::string id = std::to_string(i);
+    counters.push_back(
+        registry->counter("bench_events_total", "Bench counter", {{"id", id}}));
+    gauges.push_back(
+        registry->gauge("bench_value", "Bench gauge", {{"id", id}}));
+  }
+
+  MetricsServer server;
+  if (!server.bind(Address::LookupAny("127.0.0.1:0")) || !server.start()) {
+    return 1;
+  }
+  Address::ptr address = server.http().listen_addresses()[0];
+
+  Report report("metrics", args);
+
+  // 序列化本身的开销
+  {
+    std::string out;
+    Histogram hist;
+    for (int i = 0; i < 200; ++i) {
+      out.clear();
+      uint64_t start = NowNs();
+      registry->write_prometheus(out);
+      hist.add(NowNs() - start);
+    }
+    report.add(Result("serialize_prometheus")
+                   .set("metrics", registry->size())
+                   .set("bytes", out.size())
+                   .set_latency(hist));
+  }
+
+  // 单独抓取
+  {
+    Scraper scraper(address);
+    Histogram hist;
+    hist.reserve(scrapes);
+    size_t bytes = 0;
+    uint64_t start = NowNs();
+    for (uint64_t i = 0; i < scrapes && scraper.connected(); ++i) {
+      uint64_t request_start = NowNs();
+      bytes = scraper.get("/metrics");
+      hist.add(NowNs() - request_start);
+    }
+    double seconds = (NowNs() - start) / 1e9;
+    report.add(Result("scrape_http")
+                   .set("requests", hist.count())
+                   .set("requests_per_sec", hist.count() / seconds)
+                   .set("bytes", bytes)
+                   .set_latency(hist));
+  }
+
+  // 帧循环的更新开销:不抓取与持续抓取
+  for (int scraping = 0; scraping < 2; ++scraping) {
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> scraped(0);
+    std::thread thread;
+    if (scraping) {
+      thread = std::thread([&]() {
+        Scraper scraper(address);
+        while (!stop && scraper.connected() && scraper.get("/metrics") > 0) {
+          ++scraped;
+        }
+      });
+    }
+
+    Histogram frame_cost;
+    frame_cost.reserve(frames);
+    double ns = RunFrames(frames, updates, counters, gauges, frame_cost);
+    stop = true;
+    if (thread.joinable()) {
+      thread.join();
+    }
+
+    report.add(Result(scraping ? "update_while_scraping" : "update_idle")
+                   .set("frames", frames)
+                   .set("updates_per_frame", updates * 2)
+                   .set("ns_per_update", ns)
+                   .set("scrapes", scraped.load())
+                   .set("frame_p99_ns", frame_cost.percentile(99))
+                   .set("frame_max_ns", frame_cost.max()));
+  }
+
+  server.stop();
+  report.write();
+  return 0;
+}
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <typeindex>
+#include <utility>
+#include <vector>
+
+#include "bench_util.h"
+#include "cx/engine/module_scheduler.h"
+
+using namespace cx;
+using namespace cx::bench;
+
+// 模块并行更新基准测试
+//
+// 生成分层的模块:每个模块写入自己的资源,除第一层外读取上一层中随机的几个
+// 模块的资源,每次更新忙等固定的时间。比较不同工作线程数量下一个阶段的耗时,
+// 理想情况下趋近于关键路径(层数乘以单个模块的耗时),同时检查每个模块更新时
+// 它读取的模块在本帧都已经更新完。
+//
+// 参数:
+//   --modules=N    模块数量,默认64,最多256
+//   --layers=N     层数,默认4
+//   --fanin=N      每个模块读取上一层的模块数量,默认2
+//   --work_us=N    每个模块更新的耗时,默认100
+//   --frames=N     每种线程数量执行的帧数,默认200
+//   --threads=N    最多的工作线程数量,默认cpu核心数减一
+//   --out=文件     JSON输出的文件,默认输出到stdout
+
+static const size_t MAX_MODULES = 256;
+
+template <size_t N>
+struct Resource {};
+
+template <size_t... I>
+static std::vector<std::type_index> MakeResources(std::index_sequence<I...>) {
+  return {typeid(Resource<I>)...};
+}
+
+class BusyModule : public Module {
+ public:
+  BusyModule(uint64_t work_ns, const std::vector<BusyModule*>& inputs,
+             const uint64_t& frame, std::atomic<uint64_t>& errors)
+      : m_work_ns(work_ns),
+        m_inputs(inputs),
+        m_frame(frame),
+        m_errors(errors) {}
+
+  void update() override {
+    for (auto input : m_inputs) {
+      if (input->updated() != m_frame) m_errors.fetch_add(1);
+    }
+    uint64_t end = NowNs() + m_work_ns;
+    while (NowNs() < end) {
+    }
+    m_updated.store(m_frame, std::memory_order_release);
+  }
+
+  uint64_t updated() const { return m_updated.load(std::memory_order_acquire); }
+
+ private:
+  uint64_t m_work_ns;
+  std::vector<BusyModule*> m_inputs;
+  const uint64_t& m_frame;
+  std::atomic<uint64_t>& m_errors;
+  std::atomic<uint64_t> m_updated{0};
+};
+
+int main(int argc, char const* argv[]) {
+  Args args(argc, argv);
+  size_t modules = std::clamp<int64_t>(args.get_int("modules", 64), 1,
+                                       (int64_t)MAX_MODULES);
+  size_t layers = std::clamp<int64_t>(args.get_int("layers", 4), 1,
+                                      (int64_t)modules);
+  size_t fanin = std::max<int64_t>(0, args.get_int("fanin", 2));
+  uint64_t work_ns = args.get_int("work_us", 100) * 1000;
+  size_t frames = std::max<int64_t>(1, args.get_int("frames", 200));
+  size_t cores = std::max(1u, std::thread::hardware_concurrency());
+  size_t max_threads = args.get_int("threads", cores - 1);
+
+  auto resources = MakeResources(std::make_index_sequence<MAX_MODULES>());
+
+  // 第i层的模块为[layer_begin[i], layer_begin[i + 1])
+  std::vector<size_t> layer_begin;
+  for (size_t i = 0; i <= layers; ++i) {
+    layer_begin.push_back(i * modules / layers);
+  }
+
+  uint64_t frame = 0;
+  std::atomic<uint64_t> errors{0};
+  std::mt19937 rng(42);
+  std::vector<std::unique_ptr<BusyModule>> instances;
+  std::vector<Module::TypeAttr> attrs(modules);
+  for (size_t layer = 0; layer < layers; ++layer) {
+    for (size_t i = layer_begin[layer]; i < layer_begin[layer + 1]; ++i) {
+      std::vector<BusyModule*> inputs;
+      auto& attr = attrs[i];
+      attr.concurrent = true;
+      attr.writes.push_back(resources[i]);
+      if (layer > 0) {
+        size_t begin = layer_begin[layer - 1], end = layer_begin[layer];
+        for (size_t k = 0; k < std::min(fanin, end - begin); ++k) {
+          size_t input = begin + rng() % (end - begin);
+          inputs.push_back(instances[input].get());
+          attr.reads.push_back(resources[input]);
+        }
+      }
+      instances.emplace_back(
+          std::make_unique<BusyModule>(work_ns, inputs, frame, errors));
+    }
+  }
+
+  // 0为只在调用线程中更新,其余为1,2,4...直到max_threads
+  std::vector<size_t> thread_counts{0};
+  for (size_t n = 1; n < max_threads; n *= 2) {
+    thread_counts.push_back(n);
+  }
+  if (max_threads > 0) thread_counts.push_back(max_threads);
+
+  Report report("modules", args);
+  uint64_t serial_ns = 0;
+  for (size_t threads : thread_counts) {
+    // 冲突的模块按加入顺序更新,逐层加入保证读取的模块先更新
+    ModuleScheduler scheduler(threads);
+    for (size_t i = 0; i < modules; ++i) {
+      scheduler.add(Module::Stage::eNormal, instances[i].get(), attrs[i]);
+    }
+
+    Histogram hist;
+    hist.reserve(frames);
+    for (size_t f = 0; f < frames; ++f) {
+      ++frame;
+      uint64_t start = NowNs();
+      scheduler.run(Module::Stage::eNormal);
+      hist.add(NowNs() - start);
+    }
+
+    auto stats = scheduler.stats(Module::Stage::eNormal);
+    uint64_t p50 = hist.percentile(50);
+    if (threads == 0) serial_ns = p50;
+    report.add(Result("stage")
+                   .set("threads", threads)
+                   .set("modules", modules)
+                   .set("depth", stats.depth)
+                   .set("critical_path_ms", stats.depth * work_ns / 1e6)
+                   .set("speedup", (double)serial_ns / p50)
+                   .set_latency(hist));
+  }
+
+  report.add(Result("order").set("errors", errors.load()));
+  report.write();
+  return errors.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,506 @@
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bench_util.h"
+#include "cx/net/event_loop.h"
+#include "cx/net/socket.h"
+#include "cx/net/tcp_server.h"
+
+using namespace cx::net;
+using namespace cx::bench;
+
+// 回环网络基准测试
+//
+// 服务端分别使用阻塞的Socket(每个连接一个线程)与事件驱动的TcpServer/EventLoop,
+// 客户端统一使用阻塞的Socket,传输层为TCP回环与Unix域socket
+//
+// 参数:
+//   --duration=毫秒   每项测试的时长,默认2000
+//   --max-conns=N     echo测试的最大连接数,默认64
+//   --filter=名称     只运行名称包含该字符串的测试
+//   --out=文件        JSON输出的文件,默认输出到stdout
+
+static const size_t ECHO_SIZE = 64;
+static const size_t DATAGRAM_SIZE = 64;
+static const size_t CHUNK_SIZE = 1024 * 1024;
+
+enum class Mode { eEcho, eSink, eClose };
+
+static const char* PathName(bool event) { return event ? "event" : "blocking"; }
+
+/**
+ * @brief 测试的服务端
+ */
+class Server {
+ public:
+  virtual ~Server() {}
+
+  /**
+   * @brief 启动服务端
+   *
+   * @return 实际监听的地址,失败返回nullptr
+   */
+  virtual Address::ptr start(Address::ptr address) = 0;
+  virtual void stop() = 0;
+
+  uint64_t received() const { return m_received; }
+
+ protected:
+  Mode m_mode = Mode::eEcho;
+  std::atomic<uint64_t> m_received{0};
+};
+
+/**
+ * @brief 阻塞的服务端,每个连接一个线程
+ */
+class BlockingServer : public Server {
+ public:
+  explicit BlockingServer(Mode mode) { m_mode = mode; }
+
+  ~BlockingServer() { stop(); }
+
+  Address::ptr start(Address::ptr address) override {
+    m_listener = Socket::GenerateTCP(address);
+    if (!m_listener->bind(address) || !m_listener->listen()) {
+      return nullptr;
+    }
+    m_running = true;
+    m_accept_thread = std::thread([this]() { accept_loop(); });
+    return m_listener->local_address();
+  }
+
+  void stop() override {
+    if (!m_running.exchange(false)) {
+      return;
+    }
+    // shutdown会唤醒阻塞在accept中的线程
+    ::shutdown(m_listener->socket(), SHUT_RDWR);
+    m_accept_thread.join();
+    m_listener->close();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& sock : m_connections) {
+      ::shutdown(sock->socket(), SHUT_RDWR);
+    }
+    for (auto& thread : m_threads) {
+      thread.join();
+    }
+    m_threads.clear();
+    m_connections.clear();
+  }
+
+ private:
+  void accept_loop() {
+    while (m_running) {
+      Socket::ptr sock = m_listener->accept();
+      if (!sock) {
+        if (errno == EINTR || errno == ECONNABORTED) {
+          continue;
+        }
+        break;
+      }
+      if (m_mode == Mode::eClose) {
+        sock->close();
+        continue;
+      }
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_connections.push_back(sock);
+      m_threads.emplace_back([this, sock]() { serve(sock); });
+    }
+  }
+
+  void serve(Socket::ptr sock) {
+    std::vector<char> buf(CHUNK_SIZE);
+    while (true) {
+      int n = sock->recv(buf.data(), buf.size());
+      if (n <= 0) {
+        break;
+      }
+      m_received += n;
+      if (m_mode == Mode::eEcho && sock->send(buf.data(), n) != n) {
+        break;
+      }
+    }
+  }
+
+ private:
+  std::atomic<bool> m_running{false};
+  Socket::ptr m_listener;
+  std::thread m_accept_thread;
+  std::mutex m_mutex;
+  std::vector<Socket::ptr> m_connections;
+  std::vector<std::thread> m_threads;
+};
+
+/**
+ * @brief 事件驱动的服务端
+ */
+class EventServer : public Server {
+ public:
+  EventServer(Mode mode, uint32_t threads) : m_threads(threads) {
+    m_mode = mode;
+  }
+
+  ~EventServer() { stop(); }
+
+  Address::ptr start(Address::ptr address) override {
+    TcpServer::Options options;
+    options.name = "bench";
+    options.threads = m_threads;
+    // Unix域socket不能多次绑定同一个路径
+    options.reuse_port = address->family() != AddressFamily::eUnix;
+    options.drain_timeout = cx::time::TimePoint::Seconds(1);
+    m_server.reset(new TcpServer(options));
+
+    if (m_mode == Mode::eClose) {
+      m_server->set_connection_callback([](const TcpConnection::ptr& conn) {
+        if (conn->connected()) {
+          conn->force_close();
+        }
+      });
+    }
+    m_server->set_message_callback(
+        [this](const TcpConnection::ptr& conn, ByteArray& buf) {
+          m_received += buf.read_size();
+          if (m_mode == Mode::eEcho) {
+            conn->send(buf);
+          } else {
+            buf.set_position(buf.size());
+          }
+        });
+
+    if (!m_server->bind(address) || !m_server->start()) {
+      return nullptr;
+    }
+    return m_server->listen_addresses()[0];
+  }
+
+  void stop() override {
+    if (m_server) {
+      m_server->stop();
+      m_server.reset();
+    }
+  }
+
+ private:
+  uint32_t m_threads;
+  TcpServer::ptr m_server;
+};
+
+/**
+ * @brief 测试环境:传输层与服务端的实现
+ */
+struct Target {
+  std::string transport;
+  bool event;
+
+  Address::ptr address() const {
+    if (transport == "unix") {
+      std::string path = "/tmp/cx_bench_" + std::to_string(getpid()) + ".sock";
+      ::unlink(path.c_str());
+      return Address::ptr(new UnixAddress(path));
+    }
+    return IPAddress::LookupAny("127.0.0.1:0");
+  }
+
+  std::unique_ptr<Server> server(Mode mode, uint32_t threads = 0) const {
+    if (event) {
+      return std::unique_ptr<Server>(new EventServer(mode, threads));
+    }
+    return std::unique_ptr<Server>(new BlockingServer(mode));
+  }
+
+  void cleanup(Address::ptr address) const {
+    if (transport == "unix") {
+      ::unlink(address->to_string().c_str());
+    }
+  }
+};
+
+/**
+ * @brief echo的吞吐与延迟,每个连接一个客户端线程,一问一答
+ */
+void bench_echo(Report& report, const Target& target, size_t conns,
+                int64_t duration_ms) {
+  std::unique_ptr<Server> server = target.server(Mode::eEcho);
+  Address::ptr address = server->start(target.address());
+  if (!address) {
+    std::cerr << "echo: start server failed" << std::endl;
+    return;
+  }
+
+  std::atomic<bool> running{true};
+  std::vector<Histogram> hists(conns);
+  std::vector<std::thread> clients;
+  for (size_t i = 0; i < conns; ++i) {
+    clients.emplace_back([&, i]() {
+      Socket::ptr sock = Socket::GenerateTCP(address);
+      if (!sock->connect(address)) {
+        return;
+      }
+      char msg[ECHO_SIZE];
+      char buf[ECHO_SIZE];
+      memset(msg, 'e', sizeof(msg));
+      hists[i].reserve(1 << 16);
+      while (running) {
+        uint64_t start = NowNs();
+        if (!SendAll(sock, msg, sizeof(msg)) ||
+            !RecvAll(sock, buf, sizeof(buf))) {
+          break;
+        }
+        hists[i].add(NowNs() - start);
+      }
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+  running = false;
+  for (auto& client : clients) {
+    client.join();
+  }
+  server->stop();
+  target.cleanup(address);
+
+  Histogram total;
+  for (auto& hist : hists) {
+    total.merge(hist);
+  }
+  report.add(Result("echo")
+                 .set("transport", target.transport)
+                 .set("path", PathName(target.event))
+                 .set("connections", conns)
+                 .set("message_bytes", ECHO_SIZE)
+                 .set("ops_per_sec", total.count() * 1000.0 / duration_ms)
+                 .set_latency(total));
+}
+
+/**
+ * @brief 连接建立的速率,客户端连接后立即以RST关闭,避免TIME_WAIT堆积
+ */
+void bench_connect(Report& report, const Target& target, size_t threads,
+                   int64_t duration_ms) {
+  std::unique_ptr<Server> server = target.server(Mode::eClose);
+  Address::ptr address = server->start(target.address());
+  if (!address) {
+    std::cerr << "connect: start server failed" << std::endl;
+    return;
+  }
+
+  std::atomic<bool> running{true};
+  std::atomic<uint64_t> connected{0};
+  std::vector<Histogram> hists(threads);
+  std::vector<std::thread> clients;
+  for (size_t i = 0; i < threads; ++i) {
+    clients.emplace_back([&, i]() {
+      while (running) {
+        Socket::ptr sock = Socket::GenerateTCP(address);
+        uint64_t start = NowNs();
+        if (!sock->connect(address)) {
+          continue;
+        }
+        hists[i].add(NowNs() - start);
+        ++connected;
+        linger lg{1, 0};
+        sock->set_option(SOL_SOCKET, SO_LINGER, lg);
+      }
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+  running = false;
+  for (auto& client : clients) {
+    client.join();
+  }
+  server->stop();
+  target.cleanup(address);
+
+  Histogram total;
+  for (auto& hist : hists) {
+    total.merge(hist);
+  }
+  report.add(Result("connect")
+                 .set("transport", target.transport)
+                 .set("path", PathName(target.event))
+                 .set("client_threads", threads)
+                 .set("connects_per_sec", connected * 1000.0 / duration_ms)
+                 .set_latency(total));
+}
+
+/**
+ * @brief 单连接大块数据的带宽
+ */
+void bench_bandwidth(Report& report, const Target& target,
+                     int64_t duration_ms) {
+  std::unique_ptr<Server> server = target.server(Mode::eSink, 1);
+  Address::ptr address = server->start(target.address());
+  if (!address) {
+    std::cerr << "bandwidth: start server failed" << std::endl;
+    return;
+  }
+
+  Socket::ptr sock = Socket::GenerateTCP(address);
+  if (!sock->connect(address)) {
+    server->stop();
+    return;
+  }
+
+  std::vector<char> chunk(CHUNK_SIZE, 'b');
+  uint64_t sent = 0;
+  uint64_t start = NowNs();
+  uint64_t deadline = start + duration_ms * 1000000ull;
+  while (NowNs() < deadline && SendAll(sock, chunk.data(), chunk.size())) {
+    sent += chunk.size();
+  }
+  // 等待服务端读完
+  while (server->received() < sent && NowNs() < deadline + 1000000000ull) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  double seconds = (NowNs() - start) / 1e9;
+  sock->close();
+  server->stop();
+  target.cleanup(address);
+
+  report.add(Result("bandwidth")
+                 .set("transport", target.transport)
+                 .set("path", PathName(target.event))
+                 .set("chunk_bytes", CHUNK_SIZE)
+                 .set("mb_per_sec", server->received() / seconds / (1 << 20)));
+}
+
+/**
+ * @brief 数据报的收包速率,发送端尽可能快地发送
+ */
+void bench_datagram(Report& report, const Target& target, size_t senders,
+                    int64_t duration_ms) {
+  Address::ptr bind_address;
+  if (target.transport == "unix") {
+    bind_address = target.address();
+  } else {
+    bind_address = IPAddress::LookupAny("127.0.0.1:0");
+  }
+
+  Socket::ptr receiver = Socket::GenerateUDP(bind_address);
+  if (!receiver->bind(bind_address)) {
+    std::cerr << "datagram: bind failed" << std::endl;
+    return;
+  }
+  int rcvbuf = 8 * 1024 * 1024;
+  receiver->set_option(SOL_SOCKET, SO_RCVBUF, rcvbuf);
+  SockAddr to = receiver->local_sockaddr();
+
+  std::atomic<bool> running{true};
+  std::atomic<uint64_t> received{0};
+  std::thread receive_thread;
+  std::unique_ptr<EventLoopThread> loop_thread;
+
+  if (target.event) {
+    receiver->set_non_blocking(true);
+    loop_thread.reset(new EventLoopThread("bench_udp"));
+    EventLoop* loop = loop_thread->start();
+    loop->run_in_loop([&, loop]() {
+      loop->update_event(receiver->socket(), EventLoop::eRead,
+                         [&](uint32_t) {
+                           char buf[DATAGRAM_SIZE];
+                           SockAddr from;
+                           while (receiver->recv_from(buf, sizeof(buf), from) > 0) {
+                             ++received;
+                           }
+                         });
+    });
+  } else {
+    receiver->set_recv_timeout(100);
+    receive_thread = std::thread([&]() {
+      char buf[DATAGRAM_SIZE];
+      SockAddr from;
+      while (running) {
+        if (receiver->recv_from(buf, sizeof(buf), from) > 0) {
+          ++received;
+        }
+      }
+    });
+  }
+
+  std::atomic<uint64_t> sent{0};
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < senders; ++i) {
+    threads.emplace_back([&]() {
+      Socket::ptr sock(new Socket(to.family(), SocketType::eUdp));
+      char msg[DATAGRAM_SIZE];
+      memset(msg, 'u', sizeof(msg));
+      uint64_t count = 0;
+      while (running) {
+        if (sock->send_to(msg, sizeof(msg), to) > 0) {
+          ++count;
+        }
+      }
+      sent += count;
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+  running = false;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  if (loop_thread) {
+    loop_thread->loop()->run_in_loop(
+        [&]() { loop_thread->loop()->remove_event(receiver->socket()); });
+    loop_thread->stop();
+  } else {
+    receive_thread.join();
+  }
+  receiver->close();
+  target.cleanup(bind_address);
+
+  report.add(Result("datagram")
+                 .set("transport", target.transport == "unix" ? "unix" : "udp")
+                 .set("path", PathName(target.event))
+                 .set("senders", senders)
+                 .set("datagram_bytes", DATAGRAM_SIZE)
+                 .set("sent_per_sec", sent * 1000.0 / duration_ms)
+                 .set("received_per_sec", received * 1000.0 / duration_ms)
+                 .set("loss_ratio",
+                      sent ? 1.0 - (double)received / (double)sent : 0.0));
+}
+
+int main(int argc, char const* argv[]) {
+  Args args(argc, argv);
+  int64_t duration_ms = args.get_int("duration", 2000);
+  size_t max_conns = (size_t)args.get_int("max-conns", 64);
+  std::string filter = args.get("filter");
+  auto enabled = [&](const std::string& name) {
+    return filter.empty() || name.find(filter) != std::string::npos;
+  };
+
+  Report report("net", args);
+  for (const char* transport : {"tcp", "unix"}) {
+    for (bool event : {false, true}) {
+      Target target{transport, event};
+      if (enabled("echo")) {
+        for (size_t conns = 1; conns <= max_conns; conns *= 4) {
+          bench_echo(report, target, conns, duration_ms);
+        }
+      }
+      if (enabled("connect")) {
+        bench_connect(report, target, 4, duration_ms);
+      }
+      if (enabled("bandwidth")) {
+        bench_bandwidth(report, target, duration_ms);
+      }
+      if (enabled("datagram")) {
+        bench_datagram(report, target, 1, duration_ms);
+      }
+    }
+  }
+  report.write();
+
+  return 0;
+}
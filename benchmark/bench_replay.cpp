@@ -0,0 +1,373 @@
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_util.h"
+#include "cx/net/event_loop.h"
+#include "cx/net/tcp_connection.h"
+#include "cx/net/traffic_capture.h"
+
+using namespace cx;
+using namespace cx::net;
+using namespace cx::bench;
+using cx::time::TimePoint;
+
+// 流量回放负载生成器
+//
+// 读取TrafficCapture录制的文件,把每个TCP连接还原为一串"请求-响应"交换:
+// 请求是录制时一个方向的数据,响应是随后另一个方向的字节数。回放时为每个录制的
+// 连接建立一个(或--clones个)连接,按录制的时间(或加速、或尽快)发送请求,
+// 收到同样字节数的响应即完成一次交换,记录延迟。同一连接上的交换依次进行,
+// 按时间回放的精度受事件循环定时器的精度限制。
+//
+// 参数:
+//   --file=路径       录制文件,必须指定
+//   --address=地址    回放的目标地址,必须指定,例如127.0.0.1:8080
+//   --requests=方向   recv表示录制于服务端(默认),send表示录制于客户端
+//   --port=N          只回放服务端口为N的连接:recv时匹配本地端口,send时匹配
+//                     对端端口;默认回放全部TCP连接
+//   --speed=N         回放速度倍数,1为原速(默认),0为不等待尽快发送
+//   --clones=N        每个录制的连接回放的份数,默认1
+//   --threads=N       事件循环线程数,默认2
+//   --timeout=N       单次交换的超时(毫秒),超时后关闭该连接,默认5000
+//   --out=文件        JSON输出的文件,默认输出到stdout
+
+/**
+ * @brief 一次交换:发送请求后等待固定字节数的响应
+ */
+struct Exchange {
+  uint64_t time_ns;  // 请求在录制中的时间
+  std::string request;
+  uint64_t response;
+};
+
+struct Session {
+  uint64_t open_ns;
+  std::vector<Exchange> exchanges;
+};
+
+/**
+ * @brief 一个事件循环线程内所有连接的统计,只在该线程中修改
+ */
+struct Stats {
+  Histogram latency;
+  Histogram lag;  // 实际发送时间晚于计划的时间
+  uint64_t exchanges = 0;
+  uint64_t errors = 0;
+  uint64_t timeouts = 0;
+  uint64_t bytes_sent = 0;
+  uint64_t bytes_received = 0;
+  uint64_t extra_bytes = 0;  // 多于录制的响应字节
+};
+
+struct Settings {
+  Address::ptr address;
+  double speed;
+  TimePoint timeout;
+  uint64_t start_ns;  // 回放开始的单调时钟
+};
+
+/**
+ * @brief 回放一个连接,所有方法都在所属的事件循环线程中执行
+ */
+class Replayer {
+ public:
+  Replayer(EventLoop* loop, const Session& session, const Settings& settings,
+           Stats& stats, std::atomic<size_t>& remaining)
+      : m_loop(loop),
+        m_session(session),
+        m_settings(settings),
+        m_stats(stats),
+        m_remaining(remaining),
+        m_index(0),
+        m_pending(0),
+        m_sent_at(0),
+        m_waiting(false),
+        m_finished(false),
+        m_timer(0) {}
+
+  void start() {
+    m_loop->run_in_loop([this]() { at(m_session.open_ns, [this]() { open(); }); });
+  }
+
+ private:
+  /**
+   * @brief 按回放速度在录制时间对应的时刻执行
+   */
+  void at(uint64_t time_ns, std::function<void()> cb) {
+    uint64_t now = NowNs();
+    uint64_t due = due_ns(time_ns);
+    if (due <= now) {
+      cb();
+    } else {
+      m_loop->run_after(TimePoint::Microseconds((due - now) / 1000), cb);
+    }
+  }
+
+  uint64_t due_ns(uint64_t time_ns) const {
+    if (m_settings.speed <= 0) {
+      return 0;
+    }
+    return m_settings.start_ns + (uint64_t)(time_ns / m_settings.speed);
+  }
+
+  void open() {
+    Socket::ptr sock = Socket::GenerateTCP(m_settings.address);
+    if (!sock->connect(m_settings.address)) {
+      ++m_stats.errors;
+      finish();
+      return;
+    }
+    m_conn.reset(new TcpConnection(m_loop, sock, 0));
+    m_conn->set_message_callback(
+        [this](const TcpConnection::ptr&, ByteArray& in) { on_data(in); });
+    m_conn->set_close_callback([this](const TcpConnection::ptr&) {
+      if (!m_finished) {
+        ++m_stats.errors;
+        finish();
+      }
+    });
+    m_conn->establish();
+    next();
+  }
+
+  void next() {
+    if (m_index == m_session.exchanges.size()) {
+      finish();
+      return;
+    }
+    at(m_session.exchanges[m_index].time_ns, [this]() { send(); });
+  }
+
+  void send() {
+    const Exchange& exchange = m_session.exchanges[m_index];
+    uint64_t now = NowNs();
+    if (m_settings.speed > 0) {
+      uint64_t due = due_ns(exchange.time_ns);
+      m_stats.lag.add(now > due ? now - due : 0);
+    }
+
+    if (!exchange.request.empty()) {
+      m_conn->send(exchange.request);
+      m_stats.bytes_sent += exchange.request.size();
+    }
+    m_sent_at = now;
+    m_pending = exchange.response;
+    if (m_pending == 0) {
+      complete();
+      return;
+    }
+    m_waiting = true;
+    m_timer = m_loop->run_after(m_settings.timeout, [this]() {
+      m_timer = 0;
+      ++m_stats.timeouts;
+      ++m_stats.errors;
+      finish();
+    });
+  }
+
+  void on_data(ByteArray& in) {
+    uint64_t n = in.read_size();
+    in.set_position(in.size());
+    m_stats.bytes_received += n;
+    if (!m_waiting) {
+      m_stats.extra_bytes += n;
+      return;
+    }
+    if (n < m_pending) {
+      m_pending -= n;
+      return;
+    }
+    m_stats.extra_bytes += n - m_pending;
+    m_pending = 0;
+    m_waiting = false;
+    m_loop->cancel(m_timer);
+    m_timer = 0;
+    m_stats.latency.add(NowNs() - m_sent_at);
+    complete();
+  }
+
+  void complete() {
+    ++m_stats.exchanges;
+    ++m_index;
+    next();
+  }
+
+  void finish() {
+    if (m_finished) {
+      return;
+    }
+    m_finished = true;
+    if (m_timer) {
+      m_loop->cancel(m_timer);
+    }
+    if (m_conn) {
+      m_conn->force_close();
+    }
+    --m_remaining;
+  }
+
+ private:
+  EventLoop* m_loop;
+  const Session& m_session;
+  const Settings& m_settings;
+  Stats& m_stats;
+  std::atomic<size_t>& m_remaining;
+  TcpConnection::ptr m_conn;
+  size_t m_index;
+  uint64_t m_pending;
+  uint64_t m_sent_at;
+  bool m_waiting;
+  bool m_finished;
+  uint64_t m_timer;
+};
+
+/**
+ * @brief 读取录制文件并还原为会话
+ */
+static bool Load(const Args& args, std::vector<Session>& sessions) {
+  TrafficReader reader;
+  if (!reader.open(args.get("file"))) {
+    std::cerr << "open capture failed: " << args.get("file") << std::endl;
+    return false;
+  }
+  TrafficCapture::Kind request_kind = args.get("requests", "recv") == "send"
+                                          ? TrafficCapture::Kind::eSend
+                                          : TrafficCapture::Kind::eRecv;
+  uint16_t port = (uint16_t)args.get_int("port", 0);
+
+  std::map<uint64_t, Session> open;
+  TrafficReader::Record record;
+  while (reader.next(record)) {
+    if (record.kind == TrafficCapture::Kind::eOpen) {
+      uint16_t service = request_kind == TrafficCapture::Kind::eRecv
+                             ? record.local_port
+                             : record.remote_port;
+      if (record.type == (uint8_t)SocketType::eTcp &&
+          (port == 0 || service == port)) {
+        open[record.connection].open_ns = record.time_ns;
+      }
+      continue;
+    }
+
+    auto it = open.find(record.connection);
+    if (it == open.end()) {
+      continue;
+    }
+    std::vector<Exchange>& exchanges = it->second.exchanges;
+    if (record.kind == TrafficCapture::Kind::eClose) {
+      if (!exchanges.empty()) {
+        sessions.push_back(std::move(it->second));
+      }
+      open.erase(it);
+    } else if (record.kind == request_kind) {
+      // 连续的请求数据合并为一次交换
+      if (exchanges.empty() || exchanges.back().response > 0) {
+        exchanges.push_back(Exchange{record.time_ns, "", 0});
+      }
+      exchanges.back().request += record.data;
+    } else {
+      // 没有请求就先收到的数据(例如服务端的欢迎消息)作为空请求的响应
+      if (exchanges.empty()) {
+        exchanges.push_back(Exchange{record.time_ns, "", 0});
+      }
+      exchanges.back().response += record.data.size();
+    }
+  }
+  if (reader.error()) {
+    std::cerr << "capture is truncated or corrupted" << std::endl;
+  }
+  for (auto& [id, session] : open) {
+    if (!session.exchanges.empty()) {
+      sessions.push_back(std::move(session));
+    }
+  }
+  return true;
+}
+
+int main(int argc, char const* argv[]) {
+  Args args(argc, argv);
+  if (!args.has("file") || !args.has("address")) {
+    std::cerr << "usage: bench_replay --file=capture --address=host:port"
+              << std::endl;
+    return 1;
+  }
+
+  std::vector<Session> sessions;
+  if (!Load(args, sessions)) {
+    return 1;
+  }
+
+  Settings settings;
+  settings.address = Address::LookupAny(args.get("address"));
+  if (!settings.address) {
+    std::cerr << "invalid address: " << args.get("address") << std::endl;
+    return 1;
+  }
+  settings.speed = std::stod(args.get("speed", "1"));
+  settings.timeout = TimePoint::Milliseconds(args.get_int("timeout", 5000));
+
+  size_t clones = std::max<int64_t>(1, args.get_int("clones", 1));
+  size_t thread_count = std::max<int64_t>(1, args.get_int("threads", 2));
+  std::vector<EventLoopThread::ptr> threads;
+  std::vector<EventLoop*> loops;
+  for (size_t i = 0; i < thread_count; ++i) {
+    threads.emplace_back(new EventLoopThread("replay_" + std::to_string(i)));
+    loops.push_back(threads.back()->start());
+  }
+
+  std::vector<Stats> stats(thread_count);
+  std::atomic<size_t> remaining(sessions.size() * clones);
+  std::vector<std::unique_ptr<Replayer>> replayers;
+  settings.start_ns = NowNs();
+  for (size_t c = 0; c < clones; ++c) {
+    for (size_t i = 0; i < sessions.size(); ++i) {
+      size_t index = replayers.size() % thread_count;
+      replayers.emplace_back(new Replayer(loops[index], sessions[i], settings,
+                                          stats[index], remaining));
+      replayers.back()->start();
+    }
+  }
+
+  while (remaining > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  double seconds = (NowNs() - settings.start_ns) / 1e9;
+  for (auto& thread : threads) {
+    thread->stop();
+  }
+
+  Stats total;
+  for (auto& s : stats) {
+    total.latency.merge(s.latency);
+    total.lag.merge(s.lag);
+    total.exchanges += s.exchanges;
+    total.errors += s.errors;
+    total.timeouts += s.timeouts;
+    total.bytes_sent += s.bytes_sent;
+    total.bytes_received += s.bytes_received;
+    total.extra_bytes += s.extra_bytes;
+  }
+
+  Report report("replay", args);
+  report.add(Result("replay")
+                 .set("connections", replayers.size())
+                 .set("exchanges", total.exchanges)
+                 .set("errors", total.errors)
+                 .set("timeouts", total.timeouts)
+                 .set("seconds", seconds)
+                 .set("exchanges_per_sec", total.exchanges / seconds)
+                 .set("sent_mb_per_sec", total.bytes_sent / seconds / 1e6)
+                 .set("received_mb_per_sec",
+                      total.bytes_received / seconds / 1e6)
+                 .set("extra_bytes", total.extra_bytes)
+                 .set_latency(total.latency));
+  if (settings.speed > 0) {
+    report.add(Result("schedule_lag").set_latency(total.lag));
+  }
+  report.write();
+  return total.errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,229 @@
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_util.h"
+#include "cx/rpc/rpc_client.h"
+#include "cx/rpc/rpc_server.h"
+
+using namespace cx;
+using namespace cx::net;
+using namespace cx::rpc;
+using namespace cx::bench;
+
+// RPC框架回环基准测试
+//
+// 一个连接上保持固定数量的未完成请求(窗口),测量不同窗口下的调用吞吐与
+// 延迟分布;窗口为1时等价于逐个同步调用。开始前先检查分帧:同一次发送中
+// 依次是参数不完整、参数后有多余数据和正常的请求,前两个必须返回
+// eBadRequest,且不影响后面的请求。
+//
+// 参数:
+//   --calls=N      每个窗口的调用次数,默认200000
+//   --size=N       请求字符串的长度,默认64
+//   --windows=列表 逗号分隔的窗口大小,默认1,8,64,256
+//   --executor=N   服务端线程池的线程数,默认0即在IO线程中处理
+//   --out=文件     JSON输出的文件,默认输出到stdout
+
+struct Bench {
+  CX_RPC_SERVICE(Bench);
+  CX_RPC_METHOD(echo, std::string(const std::string&));
+};
+
+/**
+ * @brief 保持窗口内请求数量的驱动器,回调中发起下一个请求
+ */
+class Driver {
+ public:
+  Driver(RpcClient& client, const std::string& payload, uint64_t calls)
+      : m_client(client),
+        m_payload(payload),
+        m_calls(calls),
+        m_issued(0),
+        m_completed(0),
+        m_errors(0) {
+    m_hist.reserve(calls);
+  }
+
+  void run(size_t window) {
+    std::future<void> finished = m_done.get_future();
+    for (size_t i = 0; i < window; ++i) {
+      issue();
+    }
+    finished.wait();
+  }
+
+  Histogram& hist() { return m_hist; }
+  uint64_t errors() const { return m_errors; }
+
+ private:
+  void issue() {
+    if (m_issued++ >= m_calls) {
+      return;
+    }
+    uint64_t start = NowNs();
+    m_client.async_call(Bench::echo,
+                        [this, start](Status status, std::string&&) {
+                          m_hist.add(NowNs() - start);
+                          if (status != Status::eOk) {
+                            ++m_errors;
+                          }
+                          if (++m_completed == m_calls) {
+                            m_done.set_value();
+                            return;
+                          }
+                          issue();
+                        },
+                        m_payload);
+  }
+
+ private:
+  RpcClient& m_client;
+  const std::string& m_payload;
+  uint64_t m_calls;
+  std::atomic<uint64_t> m_issued;
+  std::atomic<uint64_t> m_completed;
+  std::atomic<uint64_t> m_errors;
+  Histogram m_hist;  // 只在客户端的事件循环线程中写入
+  std::promise<void> m_done;
+};
+
+static std::vector<size_t> ParseList(const std::string& list) {
+  std::vector<size_t> values;
+  size_t begin = 0;
+  while (begin < list.size()) {
+    size_t end = list.find(',', begin);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    if (end > begin) {
+      values.push_back(std::stoul(list.substr(begin, end - begin)));
+    }
+    begin = end + 1;
+  }
+  return values;
+}
+
+static Protocol::Frame ReadResponse(const Socket::ptr& sock,
+                                   std::string& value) {
+  Protocol::Frame frame{};
+  frame.status = Status::eInternal;
+  char prefix[4];
+  if (!RecvAll(sock, prefix, sizeof(prefix))) {
+    return frame;
+  }
+  size_t len = ((uint32_t)(uint8_t)prefix[0] << 24) |
+               ((uint32_t)(uint8_t)prefix[1] << 16) |
+               ((uint32_t)(uint8_t)prefix[2] << 8) | (uint8_t)prefix[3];
+  std::string body(len, 0);
+  if (!RecvAll(sock, &body[0], len)) {
+    return frame;
+  }
+  ByteArray in;
+  in.write(prefix, sizeof(prefix));
+  in.write(body.data(), body.size());
+  if (Protocol::Decode(in, frame, 4 + len) != 1 ||
+      (frame.status == Status::eOk &&
+       (!Decode(in, value) || in.read_size() != 0))) {
+    frame.status = Status::eInternal;
+  }
+  return frame;
+}
+
+/**
+ * @brief 在一次发送中流水线发出三个请求,检查服务端按帧边界解码参数
+ */
+static bool CheckFraming(const Address::ptr& addr) {
+  Socket::ptr sock = Socket::GenerateTCP(addr);
+  if (!sock->connect(addr)) {
+    return false;
+  }
+
+  std::string text(128, 'x');
+  ByteArray truncated;  // 声明100字节的字符串只带了3字节
+  truncated.write_fuint32(100);
+  truncated.write("abc", 3);
+  ByteArray trailing;
+  Serializer<std::string>::Write(trailing, text);
+  trailing.write_fuint8(0);
+  ByteArray valid;
+  Serializer<std::string>::Write(valid, text);
+
+  std::string data;
+  data += *Protocol::EncodeRequest(1, Bench::echo.id, 0, truncated);
+  data += *Protocol::EncodeRequest(2, Bench::echo.id, 0, trailing);
+  data += *Protocol::EncodeRequest(3, Bench::echo.id, 0, valid);
+  if (!SendAll(sock, data.data(), data.size())) {
+    return false;
+  }
+
+  // 有线程池时响应的顺序不确定,按id检查
+  Status expected[] = {Status::eBadRequest, Status::eBadRequest, Status::eOk};
+  for (int i = 0; i < 3; ++i) {
+    std::string value;
+    Protocol::Frame frame = ReadResponse(sock, value);
+    if (frame.id < 1 || frame.id > 3 ||
+        frame.status != expected[frame.id - 1] ||
+        (frame.id == 3 && value != text)) {
+      std::cerr << "framing check failed: request " << frame.id
+                << " status " << (int)frame.status << std::endl;
+      return false;
+    }
+  }
+  sock->close();
+  return true;
+}
+
+int main(int argc, char const* argv[]) {
+  Args args(argc, argv);
+  uint64_t calls = args.get_int("calls", 200000);
+  size_t size = args.get_int("size", 64);
+  std::vector<size_t> windows = ParseList(args.get("windows", "1,8,64,256"));
+  size_t executor = args.get_int("executor", 0);
+
+  RpcServer::Options options;
+  options.tcp.threads = 1;
+  if (executor > 0) {
+    options.executor.reset(new thread::ThreadPool("rpc_exec", executor));
+    options.executor->start();
+  }
+  RpcServer server(options);
+  server.handle(Bench::echo, [](const std::string& s) { return s; });
+  if (!server.bind(Address::LookupAny("127.0.0.1:0")) || !server.start()) {
+    return 1;
+  }
+
+  if (!CheckFraming(server.tcp().listen_addresses()[0])) {
+    return 1;
+  }
+
+  RpcClient client;
+  if (!client.connect(server.tcp().listen_addresses()[0])) {
+    return 1;
+  }
+
+  std::string payload(size, 'x');
+  Report report("rpc", args);
+  for (size_t window : windows) {
+    Driver driver(client, payload, calls);
+    uint64_t start = NowNs();
+    driver.run(window);
+    double seconds = (NowNs() - start) / 1e9;
+    report.add(Result("echo_window_" + std::to_string(window))
+                   .set("window", window)
+                   .set("calls", calls)
+                   .set("errors", driver.errors())
+                   .set("calls_per_sec", calls / seconds)
+                   .set_latency(driver.hist()));
+  }
+  report.write();
+
+  client.close();
+  if (options.executor) {
+    options.executor->stop();
+  }
+  server.stop();
+  return 0;
+}
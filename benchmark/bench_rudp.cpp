@@ -0,0 +1,333 @@
+#include <cstring>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_util.h"
+#include "cx/net/reliable_udp.h"
+
+using namespace cx::net;
+using namespace cx::bench;
+using cx::time::TimePoint;
+
+// 可靠UDP在模拟丢包链路上的基准测试
+//
+// 两个ReliableUdp端点通过内存中的模拟链路相连,链路有固定的单向延迟,抖动与
+// 随机丢包;时间是虚拟的,每次运行在相同的种子下结果完全一致。
+//   realtime  按固定频率发送小消息,统计从发送到交付的延迟;开启拥塞控制时
+//             丢包会使拥塞窗口降到1,快速重传无法触发,尾延迟明显变大
+//   bulk      发送大量数据,统计完成时间与重传开销
+//   flow      接收方周期性地停止交付,检查缓存的段不超过接收窗口
+//
+// 参数:
+//   --duration=毫秒   realtime测试的虚拟时长,默认30000
+//   --delay=毫秒      单向延迟,默认20
+//   --jitter=毫秒     单向延迟的随机抖动,默认5
+//   --rate=N          realtime每秒发送的消息数,默认60
+//   --bulk-kb=N       bulk发送的数据量,默认4096
+//   --seed=N          随机种子,默认1
+//   --filter=名称     只运行名称包含该字符串的测试
+//   --out=文件        JSON输出的文件,默认输出到stdout
+
+static const double LOSS_RATES[] = {0.0, 0.01, 0.05, 0.1, 0.2};
+static const size_t REALTIME_SIZE = 64;
+
+/**
+ * @brief 模拟的双向链路,每个方向独立丢包
+ */
+class LossyLink {
+ public:
+  LossyLink(int64_t delay_us, int64_t jitter_us, double loss, uint32_t seed)
+      : m_delay(delay_us), m_jitter(jitter_us), m_loss(loss), m_rng(seed) {}
+
+  /**
+   * @brief 发送数据报
+   *
+   * @param[in] to  目标端点,0或1
+   * @param[in] now 当前虚拟时间,微秒
+   */
+  void send(int to, const char* data, size_t len, int64_t now) {
+    ++m_sent;
+    if (std::uniform_real_distribution<double>(0, 1)(m_rng) < m_loss) {
+      ++m_dropped;
+      return;
+    }
+    int64_t jitter =
+        m_jitter ? std::uniform_int_distribution<int64_t>(0, m_jitter)(m_rng)
+                 : 0;
+    m_queue.push(Packet{now + m_delay + jitter, m_seq++, to,
+                        std::string(data, len)});
+  }
+
+  /**
+   * @brief 交付到期的数据报
+   */
+  template <class Callback>
+  void poll(int64_t now, Callback callback) {
+    while (!m_queue.empty() && m_queue.top().deliver_at <= now) {
+      Packet packet = m_queue.top();
+      m_queue.pop();
+      callback(packet.to, packet.data);
+    }
+  }
+
+  uint64_t sent() const { return m_sent; }
+  uint64_t dropped() const { return m_dropped; }
+
+ private:
+  struct Packet {
+    int64_t deliver_at;
+    uint64_t seq;
+    int to;
+    std::string data;
+
+    bool operator>(const Packet& rhs) const {
+      return deliver_at != rhs.deliver_at ? deliver_at > rhs.deliver_at
+                                          : seq > rhs.seq;
+    }
+  };
+
+  int64_t m_delay;
+  int64_t m_jitter;
+  double m_loss;
+  std::mt19937 m_rng;
+  uint64_t m_seq = 0;
+  uint64_t m_sent = 0;
+  uint64_t m_dropped = 0;
+  std::priority_queue<Packet, std::vector<Packet>, std::greater<Packet>>
+      m_queue;
+};
+
+/**
+ * @brief 测试的协议配置
+ */
+struct Profile {
+  const char* name;
+  uint32_t fast_resend;
+  bool congestion;
+};
+
+static const Profile PROFILES[] = {
+    {"default", 2, true},
+    {"no_fast_resend", 0, true},
+    {"no_congestion", 2, false},
+};
+
+/**
+ * @brief 一对通过模拟链路相连的端点
+ */
+struct Pair {
+  LossyLink link;
+  ReliableUdp a;
+  ReliableUdp b;
+  int64_t now = 0;
+
+  Pair(const Profile& profile, const Args& args, double loss)
+      : link(args.get_int("delay", 20) * 1000, args.get_int("jitter", 5) * 1000,
+             loss, (uint32_t)args.get_int("seed", 1)),
+        a([this](const char* data, size_t len) { link.send(1, data, len, now); },
+          options(profile)),
+        b([this](const char* data, size_t len) { link.send(0, data, len, now); },
+          options(profile)) {}
+
+  static ReliableUdp::Options options(const Profile& profile) {
+    ReliableUdp::Options options;
+    options.conv = 0x1234;
+    options.fast_resend = profile.fast_resend;
+    options.congestion = profile.congestion;
+    options.max_retransmits = 1000;
+    return options;
+  }
+
+  /**
+   * @brief 推进1毫秒的虚拟时间
+   */
+  void tick() {
+    now += 1000;
+    TimePoint time = TimePoint::Microseconds(now);
+    link.poll(now, [&](int to, const std::string& data) {
+      (to == 0 ? a : b).input(data.data(), data.size(), time);
+    });
+    a.update(time);
+    b.update(time);
+  }
+};
+
+/**
+ * @brief 固定频率的小消息,可靠通道与不可靠通道各发一份
+ */
+void bench_realtime(Report& report, const Args& args, const Profile& profile,
+                    double loss) {
+  Pair pair(profile, args, loss);
+  int64_t duration_us = args.get_int("duration", 30000) * 1000;
+  int64_t period_us = 1000000 / std::max<int64_t>(1, args.get_int("rate", 60));
+
+  std::vector<int64_t> sent_at;
+  Histogram reliable;
+  Histogram unreliable;
+  uint32_t expected = 0;
+  bool in_order = true;
+  pair.b.set_message_callback(
+      [&](ReliableUdp::Channel channel, const char* data, size_t) {
+        uint32_t id;
+        memcpy(&id, data, sizeof(id));
+        uint64_t latency = (pair.now - sent_at[id]) * 1000;
+        if (channel == ReliableUdp::Channel::eReliable) {
+          in_order = in_order && id == expected++;
+          reliable.add(latency);
+        } else {
+          unreliable.add(latency);
+        }
+      });
+
+  char msg[REALTIME_SIZE];
+  memset(msg, 'r', sizeof(msg));
+  int64_t next_send = 0;
+  while (pair.now < duration_us) {
+    if (pair.now >= next_send) {
+      uint32_t id = (uint32_t)sent_at.size();
+      sent_at.push_back(pair.now);
+      memcpy(msg, &id, sizeof(id));
+      pair.a.send(msg, sizeof(msg));
+      pair.a.send(msg, sizeof(msg), ReliableUdp::Channel::eUnreliable);
+      pair.a.flush(TimePoint::Microseconds(pair.now));
+      next_send += period_us;
+    }
+    pair.tick();
+  }
+  // 等待剩余的可靠消息交付
+  for (int i = 0; i < 10000 && pair.a.pending() > 0; ++i) {
+    pair.tick();
+  }
+
+  const ReliableUdp::Stats& stats = pair.a.stats();
+  report.add(Result("realtime")
+                 .set("profile", profile.name)
+                 .set("loss", loss)
+                 .set("messages", sent_at.size())
+                 .set("in_order", in_order && expected == sent_at.size())
+                 .set("unreliable_delivered",
+                      sent_at.empty() ? 0.0
+                                      : (double)unreliable.count() / sent_at.size())
+                 .set("retransmits", stats.retransmits)
+                 .set("fast_retransmits", stats.fast_retransmits)
+                 .set("packets_sent", stats.packets_sent)
+                 .set("unreliable_p99_us", unreliable.percentile(99) / 1000.0)
+                 .set("final_cwnd", pair.a.cwnd())
+                 .set_latency(reliable));
+}
+
+/**
+ * @brief 发送大量数据,统计完成时间
+ */
+void bench_bulk(Report& report, const Args& args, const Profile& profile,
+                double loss) {
+  Pair pair(profile, args, loss);
+  size_t total = args.get_int("bulk-kb", 4096) * 1024;
+  size_t chunk = pair.a.max_message_size() / 4;
+
+  size_t received = 0;
+  pair.b.set_message_callback(
+      [&](ReliableUdp::Channel, const char*, size_t len) { received += len; });
+
+  std::string data(chunk, 'b');
+  size_t queued = 0;
+  while (received < total && pair.now < 3600 * 1000000ll) {
+    // 保持发送队列中有数据,但不一次性全部排队
+    while (queued < total && pair.a.pending() < 1024) {
+      size_t len = std::min(chunk, total - queued);
+      pair.a.send(data.data(), len);
+      queued += len;
+    }
+    pair.tick();
+  }
+
+  double seconds = pair.now / 1e6;
+  const ReliableUdp::Stats& stats = pair.a.stats();
+  report.add(Result("bulk")
+                 .set("profile", profile.name)
+                 .set("loss", loss)
+                 .set("bytes", total)
+                 .set("completed", received >= total)
+                 .set("virtual_seconds", seconds)
+                 .set("kb_per_sec", received / 1024.0 / seconds)
+                 .set("segments_sent", stats.segments_sent)
+                 .set("retransmits", stats.retransmits)
+                 .set("fast_retransmits", stats.fast_retransmits)
+                 .set("wire_overhead", (double)stats.bytes_sent / total)
+                 .set("final_cwnd", pair.a.cwnd())
+                 .set("srtt_ms", pair.a.srtt().AsMicroseconds() / 1000.0));
+}
+
+/**
+ * @brief 接收方交付100毫秒,停止100毫秒交替进行,发送方持续发送
+ */
+void bench_flow(Report& report, const Args& args, const Profile& profile,
+                double loss) {
+  Pair pair(profile, args, loss);
+  size_t total = args.get_int("bulk-kb", 4096) * 1024;
+  size_t chunk = pair.a.max_message_size() / 4;
+
+  size_t received = 0;
+  pair.b.set_message_callback(
+      [&](ReliableUdp::Channel, const char*, size_t len) { received += len; });
+
+  std::string data(chunk, 'f');
+  size_t queued = 0;
+  uint32_t max_queued = 0;
+  int64_t paused_us = 0;
+  while (received < total && pair.now < 3600 * 1000000ll) {
+    while (queued < total && pair.a.pending() < 1024) {
+      size_t len = std::min(chunk, total - queued);
+      pair.a.send(data.data(), len);
+      queued += len;
+    }
+    bool reading = pair.now / 100000 % 2 == 0;
+    if (!reading) {
+      paused_us += 1000;
+    }
+    pair.b.set_reading(reading);
+    pair.tick();
+    max_queued = std::max(max_queued, pair.b.queued());
+  }
+  pair.b.set_reading(true);
+
+  double seconds = pair.now / 1e6;
+  report.add(Result("flow")
+                 .set("profile", profile.name)
+                 .set("loss", loss)
+                 .set("bytes", total)
+                 .set("completed", received >= total)
+                 .set("virtual_seconds", seconds)
+                 .set("paused_seconds", paused_us / 1e6)
+                 .set("kb_per_sec", received / 1024.0 / seconds)
+                 .set("max_queued_segments", max_queued)
+                 .set("recv_window", pair.b.options().recv_window)
+                 .set("segments_sent", pair.a.stats().segments_sent));
+}
+
+int main(int argc, char const* argv[]) {
+  Args args(argc, argv);
+  std::string filter = args.get("filter");
+  auto enabled = [&](const std::string& name) {
+    return filter.empty() || name.find(filter) != std::string::npos;
+  };
+
+  Report report("rudp", args);
+  for (const Profile& profile : PROFILES) {
+    for (double loss : LOSS_RATES) {
+      if (enabled("realtime")) {
+        bench_realtime(report, args, profile, loss);
+      }
+      if (enabled("bulk")) {
+        bench_bulk(report, args, profile, loss);
+      }
+      if (enabled("flow")) {
+        bench_flow(report, args, profile, loss);
+      }
+    }
+  }
+  report.write();
+  return 0;
+}
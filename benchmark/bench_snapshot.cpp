@@ -0,0 +1,207 @@
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_util.h"
+#include "cx/net/snapshot.h"
+
+using namespace cx;
+using namespace cx::net;
+using namespace cx::bench;
+
+// 快照增量编码基准测试
+//
+// 模拟一个有大量移动实体的世界,每帧为所有客户端编码快照。客户端的确认有随机
+// 延迟与丢失,快照本身也会丢失,因此客户端的基准各不相同;部分客户端真正解码,
+// 并与服务端的快照逐个比较以验证正确性。
+//
+// 参数:
+//   --entities=N        实体数量,默认10000
+//   --clients=N         客户端数量,默认100
+//   --ticks=N           模拟的帧数,默认300
+//   --move-ratio=N      每帧移动的实体百分比,默认30
+//   --loss=N            快照与确认的丢失百分比,默认2
+//   --verify-clients=N  解码并验证的客户端数量,默认4
+//   --seed=N            随机种子,默认1
+//   --out=文件          JSON输出的文件,默认输出到stdout
+
+/**
+ * @brief 服务端模拟的实体
+ */
+struct Entity {
+  uint32_t id;
+  float x, y;
+  float vx, vy;
+  float rotation;
+  uint32_t health;
+  uint32_t state;
+};
+
+/**
+ * @brief 模拟的客户端
+ */
+struct Client {
+  uint32_t id;
+  uint32_t latency;  // 确认到达服务端需要的帧数
+  std::deque<std::pair<uint32_t, uint32_t>> acks;  // (到达的帧, 确认的帧)
+  std::unique_ptr<SnapshotDecoder> decoder;
+};
+
+int main(int argc, char const* argv[]) {
+  Args args(argc, argv);
+  size_t entity_count = args.get_int("entities", 10000);
+  size_t client_count = args.get_int("clients", 100);
+  uint32_t ticks = (uint32_t)args.get_int("ticks", 300);
+  double move_ratio = args.get_int("move-ratio", 30) / 100.0;
+  double loss = args.get_int("loss", 2) / 100.0;
+  size_t verify_clients = args.get_int("verify-clients", 4);
+  std::mt19937 rng((uint32_t)args.get_int("seed", 1));
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+  SnapshotSchema::ptr schema(new SnapshotSchema);
+  uint32_t position = schema->add_vector2("position", Vector2f(-2048.0f),
+                                          Vector2f(2048.0f), 1.0f / 64);
+  uint32_t rotation = schema->add_float("rotation", 0.0f, 6.2832f, 0.01f);
+  uint32_t health = schema->add_integer("health", 8);
+  uint32_t state = schema->add_integer("state", 4);
+
+  std::vector<Entity> entities;
+  uint32_t next_id = 0;
+  auto spawn = [&]() {
+    Entity e;
+    e.id = next_id++;
+    e.x = unit(rng) * 4000 - 2000;
+    e.y = unit(rng) * 4000 - 2000;
+    e.vx = unit(rng) * 0.5f - 0.25f;
+    e.vy = unit(rng) * 0.5f - 0.25f;
+    e.rotation = unit(rng) * 6.28f;
+    e.health = 100;
+    e.state = 0;
+    entities.push_back(e);
+  };
+  for (size_t i = 0; i < entity_count; ++i) {
+    spawn();
+  }
+
+  SnapshotReplicator replicator(schema);
+  std::vector<Client> clients(client_count);
+  for (size_t i = 0; i < client_count; ++i) {
+    clients[i].id = replicator.add_client();
+    clients[i].latency = 1 + rng() % 6;
+    if (i < verify_clients) {
+      clients[i].decoder.reset(new SnapshotDecoder(schema));
+    }
+  }
+
+  uint64_t encode_ns = 0;
+  uint64_t decode_ns = 0;
+  uint64_t decoded = 0;
+  uint64_t mismatches = 0;
+  uint64_t bytes = 0;
+  uint64_t full_bytes = 0;
+  Histogram tick_encode;
+
+  for (uint32_t tick = 1; tick <= ticks; ++tick) {
+    // 更新世界:移动,旋转,受伤,少量实体消失与出现
+    for (auto& e : entities) {
+      if (unit(rng) < move_ratio) {
+        e.x += e.vx;
+        e.y += e.vy;
+      }
+      if (unit(rng) < 0.1f) {
+        e.rotation = std::fmod(e.rotation + 0.05f, 6.28f);
+      }
+      if (unit(rng) < 0.01f) {
+        e.health = e.health > 0 ? e.health - 1 : 100;
+        e.state = (e.state + 1) & 0xf;
+      }
+    }
+    size_t despawn = entities.size() / 200;
+    for (size_t i = 0; i < despawn; ++i) {
+      entities.erase(entities.begin() + rng() % entities.size());
+    }
+    for (size_t i = 0; i < despawn; ++i) {
+      spawn();
+    }
+
+    Snapshot::ptr snapshot(new Snapshot(schema, tick));
+    snapshot->reserve(entities.size());
+    for (auto& e : entities) {
+      size_t index = snapshot->add(e.id);
+      snapshot->set_vector2(index, position, Vector2f(e.x, e.y));
+      snapshot->set_float(index, rotation, e.rotation);
+      snapshot->set_integer(index, health, e.health);
+      snapshot->set_integer(index, state, e.state);
+    }
+
+    if (tick == 1) {
+      ByteArray full;
+      SnapshotCodec::Encode(*snapshot, nullptr, full);
+      full_bytes = full.size();
+    }
+
+    // 到达的确认
+    for (auto& client : clients) {
+      while (!client.acks.empty() && client.acks.front().first <= tick) {
+        replicator.ack(client.id, client.acks.front().second);
+        client.acks.pop_front();
+      }
+    }
+
+    uint64_t start = NowNs();
+    replicator.push(snapshot);
+    std::vector<WriteQueue::buffer_t> buffers(clients.size());
+    for (size_t i = 0; i < clients.size(); ++i) {
+      buffers[i] = replicator.encode(clients[i].id);
+    }
+    uint64_t elapsed = NowNs() - start;
+    encode_ns += elapsed;
+    tick_encode.add(elapsed);
+
+    for (size_t i = 0; i < clients.size(); ++i) {
+      Client& client = clients[i];
+      bytes += buffers[i]->size();
+      if (unit(rng) < loss) {
+        continue;
+      }
+      if (client.decoder) {
+        uint64_t decode_start = NowNs();
+        Snapshot::ptr result =
+            client.decoder->decode(buffers[i]->data(), buffers[i]->size());
+        decode_ns += NowNs() - decode_start;
+        ++decoded;
+        if (!result || !result->same_state(*snapshot)) {
+          ++mismatches;
+          continue;
+        }
+      }
+      if (unit(rng) >= loss) {
+        client.acks.emplace_back(tick + client.latency, tick);
+      }
+    }
+  }
+
+  const SnapshotReplicator::Stats& stats = replicator.stats();
+  double samples = (double)ticks * clients.size();
+  Report report("snapshot", args);
+  report.add(Result("snapshot_delta")
+                 .set("entities", entity_count)
+                 .set("clients", clients.size())
+                 .set("ticks", ticks)
+                 .set("raw_bytes", entity_count * (sizeof(uint32_t) * 6))
+                 .set("full_bytes", full_bytes)
+                 .set("bytes_per_client_tick", bytes / samples)
+                 .set("compression_vs_full", full_bytes / (bytes / samples))
+                 .set("encode_ns_per_client", encode_ns / samples)
+                 .set("encodes_per_tick",
+                      (double)(stats.full_encodes + stats.delta_encodes) / ticks)
+                 .set("full_encodes", stats.full_encodes)
+                 .set("decode_us", decoded ? decode_ns / 1000.0 / decoded : 0.0)
+                 .set("verified", decoded)
+                 .set("mismatches", mismatches)
+                 .set("tick_encode_p50_us", tick_encode.percentile(50) / 1000.0)
+                 .set("tick_encode_p99_us", tick_encode.percentile(99) / 1000.0));
+  report.write();
+  return mismatches == 0 ? 0 : 1;
+}
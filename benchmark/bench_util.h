@@ -0,0 +1,243 @@
+/**
+ * @file bench_util.h
+ * @brief 基准测试的公共工具:参数解析,延迟统计,JSON输出与阻塞收发
+ */
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cx::bench {
+
+/**
+ * @brief 单调时钟,纳秒
+ */
+inline uint64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/**
+ * @brief 在阻塞socket上发送全部数据
+ *
+ * @tparam Sock 有send(data, len)的socket指针,如Socket::ptr
+ * @return 对端关闭或出错时返回false
+ */
+template <typename Sock>
+bool SendAll(const Sock& sock, const char* data, size_t len) {
+  while (len > 0) {
+    int n = sock->send(data, len);
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+/**
+ * @brief 在阻塞socket上接收恰好len字节
+ *
+ * @tparam Sock 有recv(data, len)的socket指针,如Socket::ptr
+ * @return 对端关闭或出错时返回false
+ */
+template <typename Sock>
+bool RecvAll(const Sock& sock, char* data, size_t len) {
+  while (len > 0) {
+    int n = sock->recv(data, len);
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+/**
+ * @brief 命令行参数,格式为 --key=value
+ */
+class Args {
+ public:
+  Args(int argc, char const* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      if (arg.compare(0, 2, "--") != 0) {
+        continue;
+      }
+      size_t eq = arg.find('=');
+      if (eq == std::string::npos) {
+        m_values[arg.substr(2)] = "1";
+      } else {
+        m_values[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+      }
+    }
+  }
+
+  std::string get(const std::string& key, const std::string& def = "") const {
+    auto it = m_values.find(key);
+    return it == m_values.end() ? def : it->second;
+  }
+
+  int64_t get_int(const std::string& key, int64_t def) const {
+    auto it = m_values.find(key);
+    return it == m_values.end() ? def : std::stoll(it->second);
+  }
+
+  bool has(const std::string& key) const { return m_values.count(key) > 0; }
+
+ private:
+  std::map<std::string, std::string> m_values;
+};
+
+/**
+ * @brief 延迟样本,计算百分位
+ */
+class Histogram {
+ public:
+  void reserve(size_t n) { m_samples.reserve(n); }
+
+  void add(uint64_t ns) { m_samples.push_back(ns); }
+
+  void merge(const Histogram& other) {
+    m_samples.insert(m_samples.end(), other.m_samples.begin(),
+                     other.m_samples.end());
+    m_sorted = false;
+  }
+
+  size_t count() const { return m_samples.size(); }
+
+  /**
+   * @brief 百分位,单位纳秒
+   *
+   * @param[in] p 0~100
+   */
+  uint64_t percentile(double p) {
+    if (m_samples.empty()) {
+      return 0;
+    }
+    if (!m_sorted) {
+      std::sort(m_samples.begin(), m_samples.end());
+      m_sorted = true;
+    }
+    size_t index = (size_t)(p / 100.0 * (m_samples.size() - 1) + 0.5);
+    return m_samples[std::min(index, m_samples.size() - 1)];
+  }
+
+  uint64_t max() { return percentile(100); }
+
+ private:
+  std::vector<uint64_t> m_samples;
+  bool m_sorted = false;
+};
+
+/**
+ * @brief 一条基准测试结果,输出为JSON对象
+ */
+class Result {
+ public:
+  explicit Result(const std::string& name) { set("name", name); }
+
+  Result& set(const std::string& key, const std::string& value) {
+    std::stringstream ss;
+    ss << "\"";
+    for (char c : value) {
+      if (c == '"' || c == '\\') {
+        ss << '\\';
+      }
+      ss << c;
+    }
+    ss << "\"";
+    m_fields.emplace_back(key, ss.str());
+    return *this;
+  }
+
+  Result& set(const std::string& key, const char* value) {
+    return set(key, std::string(value));
+  }
+
+  template <typename T>
+  Result& set(const std::string& key, T value) {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2) << value;
+    m_fields.emplace_back(key, ss.str());
+    return *this;
+  }
+
+  /**
+   * @brief 写入延迟的百分位,单位微秒
+   */
+  Result& set_latency(Histogram& hist) {
+    set("p50_us", hist.percentile(50) / 1000.0);
+    set("p90_us", hist.percentile(90) / 1000.0);
+    set("p99_us", hist.percentile(99) / 1000.0);
+    set("p999_us", hist.percentile(99.9) / 1000.0);
+    set("max_us", hist.max() / 1000.0);
+    return *this;
+  }
+
+  std::string to_json() const {
+    std::stringstream ss;
+    ss << "{";
+    for (size_t i = 0; i < m_fields.size(); ++i) {
+      ss << (i ? ", " : "") << "\"" << m_fields[i].first
+         << "\": " << m_fields[i].second;
+    }
+    ss << "}";
+    return ss.str();
+  }
+
+ private:
+  std::vector<std::pair<std::string, std::string>> m_fields;
+};
+
+/**
+ * @brief 收集结果,结束时输出JSON
+ *
+ * 进度输出到stderr,JSON输出到stdout或--out指定的文件
+ */
+class Report {
+ public:
+  Report(const std::string& suite, const Args& args)
+      : m_suite(suite), m_out(args.get("out")) {}
+
+  void add(const Result& result) {
+    std::cerr << result.to_json() << std::endl;
+    m_results.push_back(result);
+  }
+
+  void write() const {
+    std::stringstream ss;
+    ss << "{\"suite\": \"" << m_suite << "\", \"results\": [\n";
+    for (size_t i = 0; i < m_results.size(); ++i) {
+      ss << "  " << m_results[i].to_json()
+         << (i + 1 < m_results.size() ? ",\n" : "\n");
+    }
+    ss << "]}\n";
+
+    if (m_out.empty()) {
+      std::cout << ss.str();
+    } else {
+      std::ofstream ofs(m_out);
+      ofs << ss.str();
+    }
+  }
+
+ private:
+  std::string m_suite;
+  std::string m_out;
+  std::vector<Result> m_results;
+};
+
+}  // namespace cx::bench
@@ -0,0 +1,51 @@
+set_targetdir("$(buildir)/bin/benchmark")
+set_group("benchmark")
+set_optimize("fastest")
+
+add_deps("cx")
+add_includedirs(".")
+
+target("bench_net")
+  add_files("bench_net.cpp")
+  add_links("pthread")
+
+target("bench_ipc")
+  add_files("bench_ipc.cpp")
+  add_links("pthread")
+
+target("bench_rudp")
+  add_files("bench_rudp.cpp")
+
+target("bench_snapshot")
+  add_files("bench_snapshot.cpp")
+
+target("bench_metrics")
+  add_files("bench_metrics.cpp")
+  add_links("pthread")
+
+target("bench_rpc")
+  add_files("bench_rpc.cpp")
+  add_links("pthread")
+
+target("bench_endian")
+  add_files("bench_endian.cpp")
+
+target("bench_replay")
+  add_files("bench_replay.cpp")
+  add_links("pthread")
+
+target("bench_config_load")
+  add_files("bench_config_load.cpp")
+  add_includedirs("../src/cx/vendor/include")
+  add_linkdirs("../src/cx/vendor/lib")
+  add_links("yaml-cpp", "pthread")
+
+target("bench_config")
+  add_files("bench_config.cpp")
+  add_includedirs("../src/cx/vendor/include")
+  add_linkdirs("../src/cx/vendor/lib")
+  add_links("yaml-cpp", "pthread")
+
+target("bench_modules")
+  add_files("bench_modules.cpp")
+  add_links("pthread")
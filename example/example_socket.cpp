@@ -1,67 +1,18 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
 #include "cx/common/logger.h"
+#include "cx/net/resolver.h"
 #include "cx/net/socket.h"
+#include "cx/net/tcp_server.h"
 
 using namespace cx::net;
 using namespace cx::log;
 
-class TcpServer {
- public:
-  typedef std::shared_ptr<TcpServer> ptr;
-
-  TcpServer() = default;
-  ~TcpServer() { m_sock->close(); }
-
-  bool bind(Address::ptr address) {
-    m_sock = Socket::GenerateTCP(address);
-    if (!m_sock->bind(address)) {
-      LOG_ERROR(Loggers::engine) << "bind failed: " << address->to_string();
-      return false;
-    }
-
-    if (!m_sock->listen()) {
-      LOG_ERROR(Loggers::engine) << "listen failed: " << address->to_string();
-      return false;
-    }
-
-    LOG_INFO(Loggers::engine)
-        << "bind successful, address: " << address->to_string();
-
-    return true;
-  }
-
-  bool start() {
-    LOG_INFO(Loggers::engine) << "server started";
-    if (!m_is_running || !m_sock) {
-      return false;
-    }
-
-    m_sock->listen();
-    while (m_is_running) {
-      Socket::ptr client = m_sock->accept();
-      LOG_INFO(Loggers::engine)
-          << "new client connect:" << client->local_address()->to_string();
-      std::string buf;
-      buf.resize(64);
-      int ret = client->recv(buf.data(), buf.size());
-      LOG_INFO(Loggers::engine)
-          << "recv msgm len:" << ret << ", content:" << buf;
-      if (ret) {
-        client->send(buf.data(), buf.size());
-      }
-    }
-  }
-  bool stop() {
-    if (m_is_running) {
-      m_is_running = false;
-    }
-  }
-
- private:
-  Socket::ptr m_client;
-  Socket::ptr m_sock;
-  bool m_is_running = true;
-};
-
 IPAddress::ptr test_address() {
   IPAddress::ptr address = Address::LookupAnyIPAddress("lzc365.top");
   address->set_port(80);
@@ -99,26 +50,140 @@ void test_http() {
   LOG_INFO(Loggers::engine) << "recv response msg:" << http_resp;
 }
 
+TcpServer::ptr echo_server(uint32_t threads, bool reuse_port) {
+  TcpServer::Options options;
+  options.name = "echo";
+  options.threads = threads;
+  options.reuse_port = reuse_port;
+  options.pin_cpu = true;
+  options.idle_timeout = cx::time::TimePoint::Seconds(30);
+
+  TcpServer::ptr server(new TcpServer(options));
+  server->set_message_callback(
+      [](const TcpConnection::ptr& conn, ByteArray& buf) { conn->send(buf); });
+  return server;
+}
+
 void test_server() {
-  TcpServer::ptr server(new TcpServer, [](TcpServer* pserver) {
-    delete pserver;
-    LOG_INFO(Loggers::engine) << "server stop";
+  TcpServer::ptr server = echo_server(0, true);
+  server->set_connection_callback([](const TcpConnection::ptr& conn) {
+    LOG_INFO(Loggers::engine)
+        << "client " << conn->remote_address()->to_string()
+        << (conn->connected() ? " connected" : " disconnected");
   });
 
-  Address::ptr address = IPAddress::LookupAny("127.0.0.1:9999");
+  if (!server->bind(IPAddress::LookupAny("127.0.0.1:9999")) ||
+      !server->start()) {
+    return;
+  }
+
+  std::this_thread::sleep_for(std::chrono::seconds(60));
+  server->stop();
+}
+
+// 回环压测: 客户端不断 connect -> send -> recv -> close,统计每秒完成的连接数
+double load_test(uint32_t server_threads, uint32_t client_threads,
+                 int seconds) {
+  TcpServer::ptr server = echo_server(server_threads, true);
+  if (!server->bind(IPAddress::LookupAny("127.0.0.1:0")) || !server->start()) {
+    return 0;
+  }
+  Address::ptr address = server->listen_addresses()[0];
+
+  std::atomic<bool> running(true);
+  std::atomic<uint64_t> finished(0);
+  std::vector<std::thread> clients;
+  for (uint32_t i = 0; i < client_threads; ++i) {
+    clients.emplace_back([&]() {
+      const char msg[] = "ping";
+      char buf[sizeof(msg)];
+      while (running) {
+        Socket::ptr sock = Socket::GenerateTCP(address);
+        if (!sock->connect(address)) {
+          continue;
+        }
+        sock->send(msg, sizeof(msg));
+        if (sock->recv(buf, sizeof(buf)) == sizeof(msg)) {
+          ++finished;
+        }
+        // 使用RST关闭,避免客户端堆积TIME_WAIT
+        linger lg{1, 0};
+        sock->set_option(SOL_SOCKET, SO_LINGER, lg);
+      }
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  running = false;
+  for (auto& client : clients) {
+    client.join();
+  }
+  server->stop();
 
-  server->bind(address);
+  return (double)finished / seconds;
+}
 
-  server->start();
+void test_load() {
+  uint32_t cores = std::max(1u, std::thread::hardware_concurrency());
+  // 客户端与服务端共享cpu,服务端线程最多使用一半的核心
+  for (uint32_t threads = 1; threads <= std::max(1u, cores / 2);
+       threads *= 2) {
+    double rate = load_test(threads, threads * 2, 3);
+    LOG_INFO(Loggers::engine)
+        << "server threads: " << threads << ", connections/sec: " << rate;
+  }
+}
+
+void test_resolver() {
+  Resolver::ptr resolver = Resolver::Self();
+  resolver->resolve("localhost:80", [](bool ok,
+                                       const std::vector<Address::ptr>& result) {
+    if (!ok) {
+      LOG_WARN(Loggers::engine) << "async resolve failed";
+      return;
+    }
+    for (auto& address : result) {
+      LOG_INFO(Loggers::engine) << "async resolve: " << address->to_string();
+    }
+  });
+
+  const int count = 10000;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < count; ++i) {
+    Address::LookupAny("localhost:80");
+  }
+  auto blocking = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < count; ++i) {
+    resolver->lookup_any("localhost:80");
+  }
+  auto cached = std::chrono::steady_clock::now() - start;
+
+  LOG_INFO(Loggers::engine)
+      << "getaddrinfo: "
+      << std::chrono::duration_cast<std::chrono::nanoseconds>(blocking).count() /
+             count
+      << "ns/op, cached: "
+      << std::chrono::duration_cast<std::chrono::nanoseconds>(cached).count() /
+             count
+      << "ns/op";
 }
 
 int main(int argc, char const* argv[]) {
   Loggers::engine->addAppender(StdOutLogAppender::Create());
 
-  // test_address();
-  test_http();
-
-  // test_server();
+  std::string mode = argc > 1 ? argv[1] : "http";
+  if (mode == "server") {
+    test_server();
+  } else if (mode == "load") {
+    test_load();
+  } else if (mode == "resolve") {
+    test_resolver();
+  } else {
+    // test_address();
+    test_http();
+  }
 
   return 0;
 }
@@ -0,0 +1,106 @@
+#include <cx/utils/time/timing_wheel.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace cx::time;
+
+static const size_t TIMER_COUNT = 1000000;
+// 定时器分布在10分钟内,模拟连接的空闲超时与心跳
+static const int64_t MAX_DELAY_MS = 600000;
+
+template <typename F>
+double measure(F&& func) {
+  auto start = std::chrono::steady_clock::now();
+  func();
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+void report(const char* name, const char* op, double ns, size_t count) {
+  std::cout << name << " " << op << ": " << ns / count << " ns/op"
+            << std::endl;
+}
+
+void bench_wheel(const std::vector<int64_t>& delays) {
+  TimingWheel wheel(TimePoint::Milliseconds(1), TimePoint());
+  std::vector<uint64_t> ids(delays.size());
+  size_t fired = 0;
+
+  double ns = measure([&]() {
+    for (size_t i = 0; i < delays.size(); ++i) {
+      ids[i] = wheel.add(TimePoint::Milliseconds(delays[i]), [&]() { ++fired; });
+    }
+  });
+  report("timing_wheel", "add", ns, delays.size());
+
+  ns = measure([&]() {
+    for (size_t i = 0; i < ids.size(); i += 2) {
+      wheel.cancel(ids[i]);
+    }
+  });
+  report("timing_wheel", "cancel", ns, ids.size() / 2);
+
+  // 以1ms的步长推进,与事件循环每轮推进一次的情况一致
+  ns = measure([&]() {
+    for (int64_t ms = 1; ms <= MAX_DELAY_MS; ++ms) {
+      wheel.advance(TimePoint::Milliseconds(ms));
+    }
+  });
+  report("timing_wheel", "expire", ns, fired);
+  std::cout << "timing_wheel fired: " << fired << ", left: " << wheel.size()
+            << std::endl;
+}
+
+void bench_map(const std::vector<int64_t>& delays) {
+  typedef std::multimap<int64_t, std::function<void()>> timer_map_t;
+  timer_map_t timers;
+  std::vector<timer_map_t::iterator> ids(delays.size());
+  size_t fired = 0;
+
+  double ns = measure([&]() {
+    for (size_t i = 0; i < delays.size(); ++i) {
+      ids[i] = timers.emplace(delays[i], [&]() { ++fired; });
+    }
+  });
+  report("multimap", "add", ns, delays.size());
+
+  ns = measure([&]() {
+    for (size_t i = 0; i < ids.size(); i += 2) {
+      timers.erase(ids[i]);
+    }
+  });
+  report("multimap", "cancel", ns, ids.size() / 2);
+
+  ns = measure([&]() {
+    for (int64_t ms = 1; ms <= MAX_DELAY_MS; ++ms) {
+      while (!timers.empty() && timers.begin()->first <= ms) {
+        timers.begin()->second();
+        timers.erase(timers.begin());
+      }
+    }
+  });
+  report("multimap", "expire", ns, fired);
+  std::cout << "multimap fired: " << fired << ", left: " << timers.size()
+            << std::endl;
+}
+
+int main() {
+  std::mt19937_64 rng(20220614);
+  std::uniform_int_distribution<int64_t> dist(1, MAX_DELAY_MS);
+  std::vector<int64_t> delays(TIMER_COUNT);
+  for (auto& delay : delays) {
+    delay = dist(rng);
+  }
+
+  std::cout << "timers: " << TIMER_COUNT << std::endl;
+  bench_wheel(delays);
+  bench_map(delays);
+
+  return 0;
+}
@@ -7,6 +7,9 @@ target("example_defer")
 
 target("example_config")
   add_files("example_config.cpp")
+  add_includedirs("../src/cx/vendor/include")
+  add_linkdirs("../src/cx/vendor/lib")
+  add_links("yaml-cpp", "pthread")
 
 target("example_logger")
   add_files("example_logger.cpp")
@@ -19,4 +22,7 @@ target("example_window")
   add_files("example_window.cpp")
 
   target("example_socket")
-  add_files("example_socket.cpp")
\ No newline at end of file
+  add_files("example_socket.cpp")
+
+target("example_timing_wheel")
+  add_files("example_timing_wheel.cpp")
@@ -317,25 +317,31 @@ bool FileLogAppender::reopen() {
   return !!m_filestream;
 }
 
-Logger::Logger(std::string name) : m_name(name), m_level(Level()) {
+Logger::Logger(std::string name)
+    : m_name(name), m_level(Level()), m_events(0), m_pending(0) {
   m_formatter.reset(new LogFormatter(
       "[%d{%Y-%m-%d %H:%M:%S}]%T%t%%T[%p]%T[%c]%T[%f:%l:%w]%T%m%n"));
 }
 
 void Logger::log(Level level, LogEvent::ptr event) {
   if (level >= m_level) {
-    lock_guard lock(m_mutex);
-    if (!m_appenders.empty())
-      for (auto& appender : m_appenders) appender->log(level, event);
-    else if (m_root != nullptr)
-      m_root->log(level, event);
-    else {
-      std::cerr << "[FATAL]"
-                << "\t"
-                << "[" << m_name << "]"
-                << "\tRuntime Error : log appender is empty"
-                << "\t" << __FILE__ << "\t" << __LINE__ << "\n";
+    m_events.fetch_add(1, std::memory_order_relaxed);
+    m_pending.fetch_add(1, std::memory_order_relaxed);
+    {
+      lock_guard lock(m_mutex);
+      if (!m_appenders.empty())
+        for (auto& appender : m_appenders) appender->log(level, event);
+      else if (m_root != nullptr)
+        m_root->log(level, event);
+      else {
+        std::cerr << "[FATAL]"
+                  << "\t"
+                  << "[" << m_name << "]"
+                  << "\tRuntime Error : log appender is empty"
+                  << "\t" << __FILE__ << "\t" << __LINE__ << "\n";
+      }
     }
+    m_pending.fetch_sub(1, std::memory_order_relaxed);
   }
 }
 
@@ -12,6 +12,7 @@
 #include <cx/common/singleton.h>
 #include <cx/utils/sync/spink_lock.h>
 
+#include <atomic>
 #include <chrono>
 #include <forward_list>
 #include <fstream>
@@ -501,6 +502,27 @@ class Logger {
    */
   std::string getName() const { return m_name; }
 
+  /**
+   * @brief 获取已输出的日志数量
+   *
+   * @return 达到日志等级的日志数量
+   */
+  uint64_t getEventCount() const {
+    return m_events.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief 获取正在输出或等待输出的日志数量
+   *
+   * 日志在调用线程中同步输出,该值即等待日志器锁的线程数,持续大于0说明
+   * 输出地过慢
+   *
+   * @return 日志数量
+   */
+  uint32_t getPendingCount() const {
+    return m_pending.load(std::memory_order_relaxed);
+  }
+
  private:
   std::string m_name;                               // 日志器名
   Level m_level;                                    // 日志等级
@@ -508,6 +530,8 @@ class Logger {
   LogFormatter::ptr m_formatter;                    // 日志格式器
   Logger::ptr m_root;                               // 主日志器
   lock_t m_mutex;                                   // 互斥量
+  std::atomic<uint64_t> m_events;                   // 已输出的日志数量
+  std::atomic<uint32_t> m_pending;                  // 正在输出的日志数量
 };
 
 namespace details {
@@ -591,6 +615,18 @@ class LoggerManager : public SingletonPtr<LoggerManager> {
    */
   Logger::ptr getRoot() const { return m_root; }
 
+  /**
+   * @brief 获取所有日志器
+   *
+   * @return 日志器列表
+   */
+  std::vector<Logger::ptr> getLoggers() {
+    lock_guard lock(m_mutex);
+    std::vector<Logger::ptr> loggers;
+    for (auto& [name, logger] : m_loggers) loggers.push_back(logger);
+    return loggers;
+  }
+
   static void SetLogDir(const std::string& dir) { m_log_dir = dir; }
 
   static void EnableEngineLogger() {
@@ -12,6 +12,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <typeindex>
 #include <vector>
 
 #include "cx/common/common.h"
@@ -31,6 +32,10 @@ class ModuleFactory {
     std::function<std::unique_ptr<Base>()> generator;
     typename Base::Stage Stage;
     std::vector<TypeID> require;
+    // 是否声明了读写的资源,声明过的模块可以在工作线程中与其他模块并行更新
+    bool concurrent = false;
+    std::vector<std::type_index> reads;
+    std::vector<std::type_index> writes;
   };
 
   template <typename... Args>
@@ -44,6 +49,32 @@ class ModuleFactory {
     }
   };
 
+  /**
+   * @brief 声明模块更新时读取的资源,资源可以是模块或任意类型
+   *
+   * @tparam Args 资源类型
+   */
+  template <typename... Args>
+  struct Reads {
+    void Declare(TypeAttr& attr) const {
+      attr.concurrent = true;
+      (attr.reads.emplace_back(typeid(Args)), ...);
+    }
+  };
+
+  /**
+   * @brief 声明模块更新时写入的资源,资源可以是模块或任意类型
+   *
+   * @tparam Args 资源类型
+   */
+  template <typename... Args>
+  struct Writes {
+    void Declare(TypeAttr& attr) const {
+      attr.concurrent = true;
+      (attr.writes.emplace_back(typeid(Args)), ...);
+    }
+  };
+
   /**
    * @brief 类型注册管理类
    *
@@ -67,25 +98,49 @@ class ModuleFactory {
     /**
      * @brief 类型注册
      *
+     * @param stage 该类型所在阶段
+     */
+    static bool Register(typename Base::Stage stage) {
+      return Register(stage, Requires<>());
+    }
+
+    /**
+     * @brief 类型注册
+     *
+     * 可以在依赖之后通过Reads<...>与Writes<...>声明更新时访问的资源,模块自身
+     * 总是视为被它写入,依赖的模块视为被它读取。声明过资源的模块在同一阶段内
+     * 只与访问冲突的模块按注册顺序先后更新,其余的并行更新,update可能在工作
+     * 线程中调用;未声明的模块在主线程中独占地更新
+     *
+     *   Register(Stage::eNormal, Requires<Window>(), Reads<Input>(),
+     *            Writes<Physics>());
+     *
      * @tparam Args 变参类型，可传入多个类型
      * @param stage 该类型所在阶段
-     * @param require
+     * @param require 依赖的模块,先于该模块创建
+     * @param access 读写的资源
      */
-    template <typename... Args>
+    template <typename... Args, typename... Access>
     static bool Register(typename Base::Stage stage,
-                         Requires<Args...>&& require = {}) {
+                         Requires<Args...>&& require, Access&&... access) {
       // 获取注册器实例
       auto& registry = ModuleFactory::Registry();
       // 获取类型id
       TypeID id = TypeMeta<Base>::template ID<T>();
 
       // 类型注册，k: TypeID, v: TypeVal
-      // TypeVal [generator, stage, require]
-      registry[id] = {[]() {
-                        s_module_instance = new T();
-                        return std::unique_ptr<Base>(s_module_instance);
-                      },
-                      stage, require.Get()};
+      // TypeVal [generator, stage, require, concurrent, reads, writes]
+      TypeAttr attr;
+      attr.generator = []() {
+        s_module_instance = new T();
+        return std::unique_ptr<Base>(s_module_instance);
+      };
+      attr.Stage = stage;
+      attr.require = require.Get();
+      attr.writes.emplace_back(typeid(T));
+      (attr.reads.emplace_back(typeid(Args)), ...);
+      (access.Declare(attr), ...);
+      registry[id] = std::move(attr);
       return true;
     }
 
@@ -0,0 +1,557 @@
+#include "compiled_config.h"
+
+#include <cx/common/logger.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+
+#if defined(CX_PLATFORM_LINUX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cx {
+
+static const char SNAPSHOT_MAGIC[8] = {'C', 'X', 'C', 'F', 'G', 'S', 'N', 0};
+static const uint32_t SNAPSHOT_VERSION = 1;
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// 各段按8字节对齐
+static size_t Align(size_t size) { return (size + 7) & ~(size_t)7; }
+
+static int64_t ModifyTime(const std::filesystem::path& path,
+                          std::error_code& ec) {
+  return std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+}
+
+// FileOp::read不检查打开与读取是否成功,这里需要区分失败与空文件
+static bool ReadFile(const std::filesystem::path& path, std::string& content) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  content.assign(std::istreambuf_iterator<char>(in),
+                 std::istreambuf_iterator<char>());
+  return !in.bad();
+}
+
+/**
+ * @brief 确定标量的类型,只识别与yaml-cpp转换结果完全一致的写法,其余按字符串
+ * 保存,转换时再按文本处理
+ *
+ */
+static conv::Scalar::Kind Classify(const std::string& text, int64_t& integer,
+                                   double& real) {
+  if (text == "true" || text == "True" || text == "TRUE") {
+    integer = 1;
+    return conv::Scalar::Kind::eBool;
+  }
+  if (text == "false" || text == "False" || text == "FALSE") {
+    integer = 0;
+    return conv::Scalar::Kind::eBool;
+  }
+
+  // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][-+]?[0-9]+)?
+  size_t i = text.size() > 0 && text[0] == '-' ? 1 : 0;
+  size_t digits = i;
+  while (i < text.size() && isdigit((unsigned char)text[i])) {
+    ++i;
+  }
+  if (i == digits || (text[digits] == '0' && i - digits > 1)) {
+    return conv::Scalar::Kind::eString;
+  }
+  bool fraction = false;
+  if (i < text.size() && text[i] == '.') {
+    size_t start = ++i;
+    while (i < text.size() && isdigit((unsigned char)text[i])) {
+      ++i;
+    }
+    if (i == start) {
+      return conv::Scalar::Kind::eString;
+    }
+    fraction = true;
+  }
+  if (i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+    ++i;
+    if (i < text.size() && (text[i] == '-' || text[i] == '+')) {
+      ++i;
+    }
+    size_t start = i;
+    while (i < text.size() && isdigit((unsigned char)text[i])) {
+      ++i;
+    }
+    if (i == start) {
+      return conv::Scalar::Kind::eString;
+    }
+    fraction = true;
+  }
+  if (i != text.size()) {
+    return conv::Scalar::Kind::eString;
+  }
+
+  errno = 0;
+  if (!fraction) {
+    integer = strtoll(text.c_str(), nullptr, 10);
+    return errno == 0 ? conv::Scalar::Kind::eInt : conv::Scalar::Kind::eString;
+  }
+  real = strtod(text.c_str(), nullptr);
+  return errno == 0 ? conv::Scalar::Kind::eDouble
+                    : conv::Scalar::Kind::eString;
+}
+
+/**
+ * @brief 快照的构造,相同内容的字符串与子树只保存一份
+ *
+ */
+class CompiledConfig::Builder {
+ public:
+  StringRef add_string(const std::string& str) {
+    auto it = m_string_ids.find(str);
+    if (it != m_string_ids.end()) {
+      return {it->second, (uint32_t)str.size()};
+    }
+    uint32_t offset = (uint32_t)strings.size();
+    strings.append(str);
+    m_string_ids.emplace(str, offset);
+    return {offset, (uint32_t)str.size()};
+  }
+
+  /**
+   * @brief 添加节点,子节点先于父节点添加,序号总是小于父节点
+   *
+   */
+  node_t add_node(const YAML::Node& node) {
+    Node record;
+    memset(&record, 0, sizeof(record));
+    std::string key;
+    std::vector<node_t> items;
+
+    switch (node.Type()) {
+      case YAML::NodeType::Scalar: {
+        record.type = (uint8_t)NodeType::eScalar;
+        record.kind = (uint8_t)Classify(node.Scalar(), record.integer,
+                                        record.real);
+        StringRef ref = add_string(node.Scalar());
+        record.first = ref.offset;
+        record.count = ref.length;
+        key = "S" + node.Scalar();
+        break;
+      }
+      case YAML::NodeType::Sequence:
+        record.type = (uint8_t)NodeType::eSequence;
+        for (auto it : node) {
+          items.push_back(add_node(it));
+        }
+        record.count = (uint32_t)items.size();
+        key = "Q";
+        break;
+      case YAML::NodeType::Map:
+        record.type = (uint8_t)NodeType::eMap;
+        for (auto it : node) {
+          items.push_back(add_node(it.first));
+          items.push_back(add_node(it.second));
+        }
+        record.count = (uint32_t)items.size() / 2;
+        key = "M";
+        break;
+      default:
+        record.type = (uint8_t)NodeType::eNull;
+        key = "N";
+        break;
+    }
+    key.append((const char*)items.data(), items.size() * sizeof(node_t));
+
+    auto it = m_node_ids.find(key);
+    if (it != m_node_ids.end()) {
+      return it->second;
+    }
+    if (!items.empty()) {
+      record.first = (uint32_t)children.size();
+      children.insert(children.end(), items.begin(), items.end());
+    }
+    node_t id = (node_t)nodes.size();
+    nodes.push_back(record);
+    m_node_ids.emplace(std::move(key), id);
+    return id;
+  }
+
+ public:
+  std::vector<Node> nodes;
+  std::vector<node_t> children;
+  std::string strings;
+
+ private:
+  std::unordered_map<std::string, uint32_t> m_string_ids;
+  std::unordered_map<std::string, node_t> m_node_ids;  // 节点内容 -> 序号
+};
+
+bool CompiledConfig::SourceHash(
+    const std::filesystem::path& dir,
+    const std::vector<std::filesystem::path>& sources, uint64_t& hash) {
+  hash = FNV_OFFSET_BASIS;
+  std::string content;
+  for (auto& source : sources) {
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(source, ec)) {
+      return false;
+    }
+    std::string relative = source.lexically_relative(dir).generic_string();
+    if (!ReadFile(source, content)) {
+      return false;
+    }
+    uint64_t size = content.size();
+    hash = Fnv1a(relative.c_str(), relative.size() + 1, hash);
+    hash = Fnv1a((const char*)&size, sizeof(size), hash);
+    hash = Fnv1a(content.data(), content.size(), hash);
+  }
+  return true;
+}
+
+bool CompiledConfig::Write(const std::filesystem::path& output,
+                           const std::filesystem::path& dir,
+                           const std::vector<std::filesystem::path>& sources,
+                           const values_t& values) {
+  Builder builder;
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.version = SNAPSHOT_VERSION;
+  header.byte_order = BYTE_ORDER_MARK;
+  if (!SourceHash(dir, sources, header.source_hash)) {
+    LOG_ERROR(log::Loggers::engine)
+        << "config compile " << dir << " failed, source changed";
+    return false;
+  }
+
+  std::vector<Source> source_table;
+  for (auto& source : sources) {
+    std::error_code ec;
+    Source record;
+    record.path =
+        builder.add_string(source.lexically_relative(dir).generic_string());
+    record.size = std::filesystem::file_size(source, ec);
+    record.mtime = ModifyTime(source, ec);
+    if (ec) {
+      LOG_ERROR(log::Loggers::engine)
+          << "config compile stat " << source << " failed: " << ec.message();
+      return false;
+    }
+    source_table.push_back(record);
+  }
+
+  // values按名称排序,配置项表也按名称排序
+  std::vector<Entry> entries;
+  for (auto& [key, value] : values) {
+    Entry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.key = builder.add_string(key);
+    entry.node = builder.add_node(value);
+    entry.hash = ConfigKey(key).hash;
+    entries.push_back(entry);
+  }
+
+  // 装载因子不超过3/4
+  uint32_t index_size = 1;
+  while (index_size * 3 < entries.size() * 4 + 1) {
+    index_size <<= 1;
+  }
+  std::vector<uint32_t> index(index_size, 0);
+  for (uint32_t i = 0; i < entries.size(); ++i) {
+    uint32_t slot = (uint32_t)entries[i].hash & (index_size - 1);
+    while (index[slot] != 0) {
+      slot = (slot + 1) & (index_size - 1);
+    }
+    index[slot] = i + 1;
+  }
+
+  header.source_count = (uint32_t)source_table.size();
+  header.node_count = (uint32_t)builder.nodes.size();
+  header.child_count = (uint32_t)builder.children.size();
+  header.entry_count = (uint32_t)entries.size();
+  header.index_size = index_size;
+  header.string_size = (uint32_t)builder.strings.size();
+
+  std::string data(sizeof(Header), '\0');
+  auto append = [&data](const void* ptr, size_t len) {
+    data.append((const char*)ptr, len);
+    data.resize(Align(data.size()), '\0');
+  };
+  append(source_table.data(), source_table.size() * sizeof(Source));
+  append(builder.nodes.data(), builder.nodes.size() * sizeof(Node));
+  append(builder.children.data(), builder.children.size() * sizeof(node_t));
+  append(entries.data(), entries.size() * sizeof(Entry));
+  append(index.data(), index.size() * sizeof(uint32_t));
+  append(builder.strings.data(), builder.strings.size());
+  header.body_hash =
+      Fnv1a(data.data() + sizeof(Header), data.size() - sizeof(Header));
+  memcpy(&data[0], &header, sizeof(header));
+
+  // 先写临时文件再替换,正在读取旧快照的进程不受影响
+  std::filesystem::path temp = output;
+  temp += ".tmp";
+  {
+    std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), (std::streamsize)data.size());
+    if (!out) {
+      LOG_ERROR(log::Loggers::engine)
+          << "config compile write " << temp << " failed";
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(temp, output, ec);
+  if (ec) {
+    LOG_ERROR(log::Loggers::engine)
+        << "config compile rename " << output << " failed: " << ec.message();
+    std::filesystem::remove(temp, ec);
+    return false;
+  }
+  return true;
+}
+
+CompiledConfig::ptr CompiledConfig::Open(const std::filesystem::path& path) {
+  std::error_code ec;
+  if (!std::filesystem::is_regular_file(path, ec)) {
+    return nullptr;
+  }
+
+  ptr config(new CompiledConfig());
+#if defined(CX_PLATFORM_LINUX)
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    LOG_ERROR(log::Loggers::engine)
+        << "config snapshot open " << path << " failed, errno: " << errno;
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void* memory =
+        mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (memory != MAP_FAILED) {
+      config->m_data = (const char*)memory;
+      config->m_size = (size_t)st.st_size;
+      config->m_mapped = true;
+    }
+  }
+  ::close(fd);
+  if (!config->m_mapped) {
+    LOG_ERROR(log::Loggers::engine)
+        << "config snapshot mmap " << path << " failed, errno: " << errno;
+    return nullptr;
+  }
+#else
+  if (!ReadFile(path, config->m_buffer)) {
+    LOG_ERROR(log::Loggers::engine)
+        << "config snapshot read " << path << " failed";
+    return nullptr;
+  }
+  config->m_data = config->m_buffer.data();
+  config->m_size = config->m_buffer.size();
+#endif
+
+  if (!config->init()) {
+    LOG_WARN(log::Loggers::engine) << "config snapshot " << path << " invalid";
+    return nullptr;
+  }
+  return config;
+}
+
+CompiledConfig::~CompiledConfig() {
+#if defined(CX_PLATFORM_LINUX)
+  if (m_mapped) {
+    munmap((void*)m_data, m_size);
+  }
+#endif
+}
+
+bool CompiledConfig::init() {
+  if (m_size < sizeof(Header)) {
+    return false;
+  }
+  const Header* header = (const Header*)m_data;
+  if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+      header->version != SNAPSHOT_VERSION ||
+      header->byte_order != BYTE_ORDER_MARK || header->index_size == 0 ||
+      (header->index_size & (header->index_size - 1)) != 0) {
+    return false;
+  }
+
+  // 各段的位置由数量决定,总长度必须与文件一致
+  uint64_t offset = sizeof(Header);
+  uint64_t sections[6] = {
+      (uint64_t)header->source_count * sizeof(Source),
+      (uint64_t)header->node_count * sizeof(Node),
+      (uint64_t)header->child_count * sizeof(node_t),
+      (uint64_t)header->entry_count * sizeof(Entry),
+      (uint64_t)header->index_size * sizeof(uint32_t),
+      (uint64_t)header->string_size};
+  const char* starts[6];
+  for (int i = 0; i < 6; ++i) {
+    starts[i] = m_data + offset;
+    offset = Align(offset + sections[i]);
+  }
+  if (offset != m_size ||
+      Fnv1a(m_data + sizeof(Header), m_size - sizeof(Header)) !=
+          header->body_hash) {
+    return false;
+  }
+
+  m_header = header;
+  m_sources = (const Source*)starts[0];
+  m_nodes = (const Node*)starts[1];
+  m_children = (const node_t*)starts[2];
+  m_entries = (const Entry*)starts[3];
+  m_index = (const uint32_t*)starts[4];
+  m_strings = starts[5];
+
+  // 校验所有引用,之后的访问不再检查范围
+  auto valid_string = [header](const StringRef& ref) {
+    return (uint64_t)ref.offset + ref.length <= header->string_size;
+  };
+  for (uint32_t i = 0; i < header->source_count; ++i) {
+    if (!valid_string(m_sources[i].path)) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < header->node_count; ++i) {
+    const Node& node = m_nodes[i];
+    switch ((NodeType)node.type) {
+      case NodeType::eNull:
+        break;
+      case NodeType::eScalar:
+        if (node.kind > (uint8_t)conv::Scalar::Kind::eBool ||
+            !valid_string({node.first, node.count})) {
+          return false;
+        }
+        break;
+      case NodeType::eSequence:
+      case NodeType::eMap: {
+        uint64_t count = (uint64_t)node.count *
+                         (node.type == (uint8_t)NodeType::eMap ? 2 : 1);
+        if (node.first + count > header->child_count) {
+          return false;
+        }
+        // 子节点的序号小于父节点,重新构造时不会出现环
+        for (uint64_t j = 0; j < count; ++j) {
+          if (m_children[node.first + j] >= i) {
+            return false;
+          }
+        }
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  for (uint32_t i = 0; i < header->entry_count; ++i) {
+    if (!valid_string(m_entries[i].key) ||
+        m_entries[i].node >= header->node_count) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < header->index_size; ++i) {
+    if (m_index[i] > header->entry_count) {
+      return false;
+    }
+  }
+  return header->entry_count < header->index_size;
+}
+
+bool CompiledConfig::up_to_date(
+    const std::filesystem::path& dir,
+    const std::vector<std::filesystem::path>& sources) const {
+  if (sources.size() != m_header->source_count) {
+    return false;
+  }
+
+  bool touched = false;
+  for (size_t i = 0; i < sources.size(); ++i) {
+    const Source& source = m_sources[i];
+    if (sources[i].lexically_relative(dir).generic_string() !=
+        string(source.path)) {
+      return false;
+    }
+    std::error_code ec;
+    uint64_t size = std::filesystem::file_size(sources[i], ec);
+    int64_t mtime = ModifyTime(sources[i], ec);
+    if (ec || size != source.size) {
+      return false;
+    }
+    touched = touched || mtime != source.mtime;
+  }
+  if (!touched) {
+    return true;
+  }
+
+  uint64_t hash;
+  return SourceHash(dir, sources, hash) && hash == m_header->source_hash;
+}
+
+bool CompiledConfig::find(const ConfigKey& key, node_t& node) const {
+  uint32_t mask = m_header->index_size - 1;
+  for (uint32_t slot = (uint32_t)key.hash & mask; m_index[slot] != 0;
+       slot = (slot + 1) & mask) {
+    const Entry& entry = m_entries[m_index[slot] - 1];
+    if (entry.hash == key.hash && string(entry.key) == key.name) {
+      node = entry.node;
+      return true;
+    }
+  }
+  return false;
+}
+
+conv::Scalar CompiledConfig::scalar(node_t node) const {
+  const Node& record = m_nodes[node];
+  conv::Scalar scalar;
+  scalar.kind = (conv::Scalar::Kind)record.kind;
+  scalar.text = string({record.first, record.count});
+  switch (scalar.kind) {
+    case conv::Scalar::Kind::eInt:
+      scalar.integer = record.integer;
+      break;
+    case conv::Scalar::Kind::eDouble:
+      scalar.real = record.real;
+      break;
+    case conv::Scalar::Kind::eBool:
+      scalar.boolean = record.integer != 0;
+      break;
+    default:
+      break;
+  }
+  return scalar;
+}
+
+YAML::Node CompiledConfig::node(node_t node) const {
+  const Node& record = m_nodes[node];
+  switch ((NodeType)record.type) {
+    case NodeType::eScalar:
+      return YAML::Node(std::string(string({record.first, record.count})));
+    case NodeType::eSequence: {
+      YAML::Node output(YAML::NodeType::Sequence);
+      for (uint32_t i = 0; i < record.count; ++i) {
+        output.push_back(this->node(m_children[record.first + i]));
+      }
+      return output;
+    }
+    case NodeType::eMap: {
+      YAML::Node output(YAML::NodeType::Map);
+      const node_t* items = m_children + record.first;
+      for (uint32_t i = 0; i < record.count; ++i) {
+        // 键已经按原文件的顺序,不需要逐个查找
+        output.force_insert(this->node(items[i * 2]),
+                            this->node(items[i * 2 + 1]));
+      }
+      return output;
+    }
+    default:
+      return YAML::Node(YAML::NodeType::Null);
+  }
+}
+
+}  // namespace cx
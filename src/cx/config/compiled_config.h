@@ -0,0 +1,215 @@
+/**
+ * @file compiled_config.h
+ * @brief 编译后的二进制配置快照
+ */
+#pragma once
+
+#include <cx/common/internal.h>
+#include <cx/common/noncopyable.h>
+#include <cx/config/config_key.h>
+#include <cx/config/convert.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cx {
+
+/**
+ * @brief 配置目录合并后的结果编译成的二进制快照
+ *
+ * 文件由字符串表,节点表(标量在编译时确定为整数,浮点数,布尔或字符串),展开
+ * 后的配置项表与配置项名称的开放寻址哈希索引组成,启动时直接映射到内存,不需要
+ * 解析yaml。快照记录了编译时每个源文件的大小,修改时间与所有源文件内容的哈希,
+ * 源文件的集合变化或内容改变时快照失效
+ *
+ * 相同内容的子树只保存一份,展开时中间的分组与其中的配置项共享节点
+ *
+ */
+class CompiledConfig : public Noncopyable {
+ public:
+  typedef std::shared_ptr<CompiledConfig> ptr;
+  typedef std::map<std::string, YAML::Node> values_t;
+
+  /**
+   * @brief 节点在快照中的序号
+   *
+   */
+  typedef uint32_t node_t;
+
+  /**
+   * @brief 快照保存在配置目录下的文件名
+   *
+   */
+  CX_STATIC_CONSTEXPR const char* FILE_NAME = ".config.cxsnap";
+
+  /**
+   * @brief 编译快照
+   *
+   * @param[in] output  快照文件路径,先写入临时文件再替换
+   * @param[in] dir     配置目录
+   * @param[in] sources 目录下的yaml文件,按路径排序
+   * @param[in] values  所有文件合并展开后的配置项
+   * @return bool 是否成功
+   */
+  CX_STATIC bool Write(const std::filesystem::path& output,
+                       const std::filesystem::path& dir,
+                       const std::vector<std::filesystem::path>& sources,
+                       const values_t& values);
+
+  /**
+   * @brief 打开快照,校验文件头,各段的范围与内容的校验和
+   *
+   * @param[in] path 快照文件路径
+   * @return ptr 快照,文件不存在或无效时返回nullptr
+   */
+  CX_STATIC ptr Open(const std::filesystem::path& path);
+
+  ~CompiledConfig();
+
+  /**
+   * @brief 快照是否与配置目录一致
+   *
+   * 源文件的集合必须相同;大小与修改时间都没变时直接认为一致,否则重新计算
+   * 源文件内容的哈希比较,只是被touch过的文件不会使快照失效
+   *
+   * @param[in] dir     配置目录
+   * @param[in] sources 目录下的yaml文件,按路径排序
+   */
+  bool up_to_date(const std::filesystem::path& dir,
+                  const std::vector<std::filesystem::path>& sources) const;
+
+  /**
+   * @brief 配置项数量,包括中间的分组
+   *
+   */
+  size_t size() const { return m_header->entry_count; }
+
+  /**
+   * @brief 通过哈希索引查找配置项
+   *
+   * @param[in] key   配置项名称
+   * @param[out] node 配置项的值
+   * @return bool 是否存在
+   */
+  bool find(const ConfigKey& key, node_t& node) const;
+
+  /**
+   * @brief 按名称顺序遍历配置项
+   *
+   */
+  template <typename Callback>
+  void visit(Callback&& callback) const {
+    for (uint32_t i = 0; i < m_header->entry_count; ++i) {
+      callback(string(m_entries[i].key), m_entries[i].node);
+    }
+  }
+
+  bool is_scalar(node_t node) const {
+    return m_nodes[node].type == (uint8_t)NodeType::eScalar;
+  }
+
+  /**
+   * @brief 标量节点的值,文本指向映射的内存,快照关闭前有效
+   *
+   */
+  conv::Scalar scalar(node_t node) const;
+
+  /**
+   * @brief 重新构造yaml节点
+   *
+   */
+  YAML::Node node(node_t node) const;
+
+ private:
+  enum class NodeType : uint8_t { eNull, eScalar, eSequence, eMap };
+
+  struct StringRef {
+    uint32_t offset;
+    uint32_t length;
+  };
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t source_hash;  // 所有源文件路径与内容的哈希
+    uint64_t body_hash;    // 文件头之后所有内容的校验和
+    uint32_t source_count;
+    uint32_t node_count;
+    uint32_t child_count;
+    uint32_t entry_count;
+    uint32_t index_size;  // 2的幂
+    uint32_t string_size;
+  };
+
+  struct Source {
+    StringRef path;  // 相对配置目录
+    uint64_t size;
+    int64_t mtime;
+  };
+
+  /**
+   * @brief 节点:标量的文本与类型化的值,序列与映射的子节点在子节点表中连续
+   * 存放,映射每项依次是键与值两个节点
+   *
+   */
+  struct Node {
+    uint8_t type;
+    uint8_t kind;  // 标量的conv::Scalar::Kind
+    uint16_t reserved;
+    uint32_t first;  // 标量为字符串偏移,否则为第一个子节点
+    uint32_t count;  // 标量为字符串长度,否则为子节点数量
+    uint32_t reserved2;
+    union {
+      int64_t integer;
+      double real;
+    };
+  };
+
+  struct Entry {
+    StringRef key;
+    node_t node;
+    uint32_t reserved;
+    uint64_t hash;  // 名称的FNV-1a哈希
+  };
+
+  class Builder;
+
+  CompiledConfig() = default;
+
+  bool init();
+
+  std::string_view string(const StringRef& ref) const {
+    return std::string_view(m_strings + ref.offset, ref.length);
+  }
+
+  /**
+   * @brief 计算源文件路径与内容的哈希
+   *
+   * @return bool 有文件无法读取时返回false
+   */
+  CX_STATIC bool SourceHash(const std::filesystem::path& dir,
+                            const std::vector<std::filesystem::path>& sources,
+                            uint64_t& hash);
+
+ private:
+  const char* m_data = nullptr;
+  size_t m_size = 0;
+  bool m_mapped = false;  // 是否通过mmap映射,否则m_data由m_buffer持有
+  std::string m_buffer;
+
+  const Header* m_header = nullptr;
+  const Source* m_sources = nullptr;
+  const Node* m_nodes = nullptr;
+  const node_t* m_children = nullptr;
+  const Entry* m_entries = nullptr;
+  const uint32_t* m_index = nullptr;  // 配置项序号+1,0为空
+  const char* m_strings = nullptr;
+};
+
+}  // namespace cx
@@ -1,361 +1,710 @@
 #include "config.h"
 
+#include <cx/common/logger.h>
+#include <cx/config/compiled_config.h>
+#include <cx/common/noncopyable.h>
 #include <cx/utils/fileop/file.h>
+#include <cx/utils/thread/thread_pool.h>
 #include <yaml-cpp/yaml.h>
 
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
-#include <iostream>
-#include <list>
+#include <optional>
 #include <set>
-#include <sstream>
 #include <thread>
-#include <unordered_map>
-#include <unordered_set>
 #include <vector>
 
-namespace YAML {
-class Node;
-}
+#if defined(CX_PLATFORM_LINUX)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace cx {
+
+/**
+ * @brief 已加载的文件与目录,所有加载串行执行
+ *
+ */
+struct LoadState {
+  typedef std::map<std::string, YAML::Node> values_t;
+
+  std::mutex mutex;
+  std::map<std::filesystem::path, values_t> files;  // 按路径排序
+  values_t merged;  // 所有文件按路径顺序合并后的结果
+  // 从快照加载,还没有解析过的目录,保留快照供之后注册的配置项查找
+  std::map<std::filesystem::path, CompiledConfig::ptr> compiled;
+};
 
-namespace cx::conv {
+static LoadState& GetLoadState() {
+  static LoadState s_state;
+  return s_state;
+}
 
-template <typename F>
-class Convert<F, std::string> {
- public:
-  static_assert(std::is_arithmetic_v<F>,
-                "src type must be suitable std::to_string arg`s type.");
-  std::string operator()(const F& val) { return std::to_string(val); }
-};
+static bool IsYamlFile(const std::filesystem::path& path) {
+  std::string subfix = path.extension().string();
+  return subfix == ".yml" || subfix == ".yaml";
+}
 
-template <typename T>
-class Convert<std::string, T> {
- public:
-  T operator()(const std::string& str) {
-    std::stringstream ss;
-    ss << str;
+/**
+ * @brief 目录下的所有yaml文件,按路径排序
+ *
+ */
+static std::vector<std::filesystem::path> ListYamlFiles(
+    const std::filesystem::path& dir) {
+  std::vector<std::filesystem::path> files;
+  FileOp::each_files(dir, [&files](const std::filesystem::path& file_path) {
+    if (IsYamlFile(file_path) && std::filesystem::is_regular_file(file_path)) {
+      files.push_back(file_path);
+    }
+  });
+  std::sort(files.begin(), files.end());
+  return files;
+}
 
-    T result;
-    ss >> result;
-    return result;
+/**
+ * @brief 把yaml树展开为"a.b.c" -> 节点,名称转为小写
+ *
+ */
+static void ListAllMember(const std::string& prefix, const YAML::Node& node,
+                          LoadState::values_t& output) {
+  if (!prefix.empty()) {
+    output.emplace(prefix, node);
   }
-};
 
-template <>
-class Convert<std::string, std::string> {
- public:
-  std::string operator()(const std::string& str) { return str; }
-};
+  if (node.IsMap())
+    for (auto it : node) {
+      std::string key = it.first.Scalar();
+      std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+      ListAllMember(prefix.empty() ? key : (prefix + "." + key), it.second,
+                    output);
+    }
+}
 
-template <>
-class Convert<char*, std::string> {
- public:
-  std::string operator()(char* str) { return std::string(str); }
+/**
+ * @brief 一个文件的解析结果
+ *
+ */
+struct ParsedFile {
+  bool exists = false;
+  std::optional<LoadState::values_t> values;  // 解析失败时为空
+  std::string error;
 };
 
-// vector
-template <typename T>
-class Convert<std::string, std::vector<T>> {
- public:
-  std::vector<T>&& operator()(const std::string& str) {
-    typename std::vector<T> result;
+static std::atomic<size_t> s_load_threads{0};
 
-    YAML::Node node = YAML::Load(str);
-    std::stringstream ss;
+static void ParseFile(const std::filesystem::path& path, ParsedFile& result) {
+  std::error_code ec;
+  result.exists = std::filesystem::is_regular_file(path, ec);
+  if (!result.exists) {
+    return;
+  }
+  try {
+    LoadState::values_t values;
+    ListAllMember("", YAML::LoadFile(path.string()), values);
+    result.values = std::move(values);
+  } catch (const std::exception& e) {
+    result.error = e.what();
+  }
+}
 
-    for (T& val : node) {
-      ss.str("");
-      ss << *val;
-      result.push_back(Convert<std::string, T>()(ss.str()));
+/**
+ * @brief 解析并展开一组文件,多个文件时在线程池中并发解析
+ *
+ * 结果与输入的位置一一对应,合并由调用者在解析全部完成后按路径顺序进行,与
+ * 串行解析的结果完全相同。调用线程也参与解析
+ *
+ */
+static std::vector<ParsedFile> ParseFiles(
+    const std::vector<std::filesystem::path>& paths) {
+  std::vector<ParsedFile> results(paths.size());
+  size_t threads = s_load_threads.load(std::memory_order_relaxed);
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threads = std::min(threads, paths.size());
+  if (threads <= 1) {
+    for (size_t i = 0; i < paths.size(); ++i) {
+      ParseFile(paths[i], results[i]);
     }
-
-    return std::move(result);
+    return results;
   }
-};
 
-template <typename T>
-class Convert<std::vector<T>, std::string> {
- public:
-  std::string operator()(const std::vector<T>& vec) {
-    YAML::Node node(YAML::NodeType::Sequence);
-    for (T& val : vec) {
-      node.push_back(Convert<T, std::string>()(val));
+  // 文件大小不一,每个线程依次领取下一个文件
+  std::atomic<size_t> next{0};
+  auto worker = [&paths, &results, &next]() {
+    for (size_t i; (i = next.fetch_add(1)) < paths.size();) {
+      ParseFile(paths[i], results[i]);
     }
-
-    std::stringstream ss;
-    ss << node;
-
-    return ss.str();
+  };
+  thread::ThreadPool pool("config_load", threads - 1);
+  pool.start();
+  for (size_t i = 0; i + 1 < threads; ++i) {
+    pool.submit(worker);
   }
-};
-
-// list
-template <typename T>
-class Convert<std::string, std::list<T>> {
- public:
-  std::list<T>&& operator()(const std::string& str) {
-    typename std::list<T> result;
-
-    YAML::Node node = YAML::Load(str);
-    std::stringstream ss;
+  worker();
+  pool.stop();
+  return results;
+}
 
-    for (T& val : node) {
-      ss.str("");
-      ss << *val;
-      result.push_back(Convert<std::string, T>()(ss.str()));
+/**
+ * @brief 合并一个文件的配置项,覆盖已有的同名配置项
+ *
+ */
+static void Merge(LoadState::values_t& merged,
+                  const LoadState::values_t& values) {
+  for (auto& [key, value] : values) {
+    // Node的赋值会修改被覆盖的节点本身,这里只替换引用
+    auto result = merged.emplace(key, value);
+    if (!result.second) {
+      result.first->second.reset(value);
     }
-
-    return std::move(result);
   }
-};
+}
 
-template <typename T>
-class Convert<std::list<T>, std::string> {
- public:
-  std::string operator()(const std::list<T>& list) {
-    YAML::Node node(YAML::NodeType::Sequence);
-    for (T& val : list) {
-      node.push_back(Convert<T, std::string>()(val));
+/**
+ * @brief 发布一批新值,全部发布后再通知监听器
+ *
+ */
+static void Publish(const std::vector<ConfigVarBase::Update::ptr>& updates) {
+  std::vector<ConfigVarBase::Update*> changed;
+  for (auto& update : updates) {
+    if (update->publish()) {
+      changed.push_back(update.get());
     }
+  }
+  for (auto* update : changed) {
+    update->notify();
+  }
+}
 
-    std::stringstream ss;
-    ss << node;
-
-    return ss.str();
+/**
+ * @brief 比较两个节点的内容,映射按顺序比较,顺序不同视为改变
+ *
+ */
+static bool NodeEqual(const YAML::Node& lhs, const YAML::Node& rhs) {
+  if (lhs.Type() != rhs.Type() || lhs.size() != rhs.size()) {
+    return false;
   }
-};
+  switch (lhs.Type()) {
+    case YAML::NodeType::Scalar:
+      return lhs.Scalar() == rhs.Scalar();
+    case YAML::NodeType::Sequence:
+      for (size_t i = 0; i < lhs.size(); ++i) {
+        if (!NodeEqual(lhs[i], rhs[i])) {
+          return false;
+        }
+      }
+      return true;
+    case YAML::NodeType::Map:
+      for (auto l = lhs.begin(), r = rhs.begin(); l != lhs.end(); ++l, ++r) {
+        if (!NodeEqual(l->first, r->first) ||
+            !NodeEqual(l->second, r->second)) {
+          return false;
+        }
+      }
+      return true;
+    default:
+      return true;
+  }
+}
 
-// set
-template <typename T>
-class Convert<std::string, std::set<T>> {
+#if defined(CX_PLATFORM_LINUX)
+/**
+ * @brief 通过inotify监视配置目录的后台线程
+ *
+ */
+class ConfigWatcher : public Noncopyable {
  public:
-  std::set<T>&& operator()(const std::string& str) {
-    typename std::set<T> result;
-
-    YAML::Node node = YAML::Load(str);
-    std::stringstream ss;
-
-    for (T& val : node) {
-      ss.str("");
-      ss << *val;
-      result.push_back(Convert<std::string, T>()(ss.str()));
+  explicit ConfigWatcher(uint32_t debounce_ms)
+      : m_inotify(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+        m_wakeup(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+        m_debounce_ms(debounce_ms) {}
+
+  ~ConfigWatcher() {
+    if (m_thread.joinable()) {
+      uint64_t one = 1;
+      ::write(m_wakeup, &one, sizeof(one));
+      m_thread.join();
+    }
+    if (m_inotify != -1) {
+      ::close(m_inotify);
+    }
+    if (m_wakeup != -1) {
+      ::close(m_wakeup);
     }
-
-    return std::move(result);
   }
-};
 
-template <typename T>
-class Convert<std::set<T>, std::string> {
- public:
-  std::string operator()(const std::set<T>& set) {
-    YAML::Node node(YAML::NodeType::Sequence);
-    for (T& val : set) {
-      node.push_back(Convert<T, std::string>()(val));
+  bool start() {
+    if (m_inotify == -1 || m_wakeup == -1) {
+      LOG_ERROR(log::Loggers::engine)
+          << "config watcher init failed, errno: " << errno;
+      return false;
     }
+    m_thread = std::thread(&ConfigWatcher::run, this);
+    return true;
+  }
 
-    std::stringstream ss;
-    ss << node;
+  /**
+   * @brief 递归监视目录,可以在任意线程调用
+   *
+   * @param[in] dir     目录
+   * @param[out] files  目录中已有的yaml文件,可以为nullptr
+   */
+  void add_directory(const std::filesystem::path& dir,
+                     std::vector<std::filesystem::path>* files = nullptr) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(dir, ec)) {
+      return;
+    }
+    add_watch(dir);
+    for (std::filesystem::recursive_directory_iterator it(dir, ec), end;
+         !ec && it != end; it.increment(ec)) {
+      if (it->is_directory(ec)) {
+        add_watch(it->path());
+      } else if (files && IsYamlFile(it->path())) {
+        files->push_back(it->path());
+      }
+    }
+  }
 
-    return ss.str();
+ private:
+  void add_watch(const std::filesystem::path& dir) {
+    int wd = inotify_add_watch(m_inotify, dir.c_str(),
+                               IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+                                   IN_CREATE | IN_DELETE | IN_ONLYDIR);
+    if (wd < 0) {
+      LOG_WARN(log::Loggers::engine)
+          << "config watch " << dir << " failed, errno: " << errno;
+      return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_watches[wd] = dir;
   }
-};
 
-// unorderd_set
-template <typename T>
-class Convert<std::string, std::unordered_set<T>> {
- public:
-  std::unordered_set<T>&& operator()(const std::string& str) {
-    typename std::unordered_set<T> result;
+  void run() {
+    typedef std::chrono::steady_clock clock;
+    std::set<std::filesystem::path> pending;
+    clock::time_point deadline;
+
+    while (true) {
+      int timeout = -1;
+      if (!pending.empty()) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - clock::now());
+        timeout = std::max<int>(0, (int)left.count());
+      }
 
-    YAML::Node node = YAML::Load(str);
-    std::stringstream ss;
+      pollfd fds[2] = {{m_inotify, POLLIN, 0}, {m_wakeup, POLLIN, 0}};
+      int rt = ::poll(fds, 2, timeout);
+      if (rt < 0 && errno != EINTR) {
+        LOG_ERROR(log::Loggers::engine)
+            << "config watcher poll failed, errno: " << errno;
+        return;
+      }
+      if (fds[1].revents & POLLIN) {
+        return;
+      }
 
-    for (T& val : node) {
-      ss.str("");
-      ss << *val;
-      result.push_back(Convert<std::string, T>()(ss.str()));
+      if (fds[0].revents & POLLIN && read_events(pending)) {
+        // 每次改动都推迟重新加载,直到连续debounce_ms没有改动
+        deadline = clock::now() + std::chrono::milliseconds(m_debounce_ms);
+      } else if (!pending.empty() && clock::now() >= deadline) {
+        Config::Reload(std::vector<std::filesystem::path>(pending.begin(),
+                                                          pending.end()));
+        pending.clear();
+      }
     }
-
-    return std::move(result);
   }
-};
 
-template <typename T>
-class Convert<std::unordered_set<T>, std::string> {
- public:
-  std::string operator()(const std::unordered_set<T>& set) {
-    YAML::Node node(YAML::NodeType::Sequence);
-    for (T& val : set) {
-      node.push_back(Convert<T, std::string>()(val));
+  /**
+   * @brief 读取所有inotify事件
+   *
+   * @return bool 是否有yaml文件改动
+   */
+  bool read_events(std::set<std::filesystem::path>& pending) {
+    alignas(inotify_event) char buf[4096];
+    bool changed = false;
+    ssize_t len;
+    while ((len = ::read(m_inotify, buf, sizeof(buf))) > 0) {
+      for (char* p = buf; p < buf + len;) {
+        inotify_event* event = (inotify_event*)p;
+        p += sizeof(inotify_event) + event->len;
+
+        std::filesystem::path dir;
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          auto it = m_watches.find(event->wd);
+          if (it == m_watches.end()) {
+            continue;
+          }
+          if (event->mask & IN_IGNORED) {
+            m_watches.erase(it);
+            continue;
+          }
+          dir = it->second;
+        }
+        if (event->len == 0) {
+          continue;
+        }
+
+        std::filesystem::path path = dir / event->name;
+        if (event->mask & IN_ISDIR) {
+          if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+            // 新目录中可能已经有文件,inotify不会再报告它们
+            std::vector<std::filesystem::path> files;
+            add_directory(path, &files);
+            pending.insert(files.begin(), files.end());
+            changed = changed || !files.empty();
+          }
+        } else if (!(event->mask & IN_CREATE) && IsYamlFile(path)) {
+          // 新建的文件在写完关闭时才加载
+          pending.insert(path);
+          changed = true;
+        }
+      }
     }
+    return changed;
+  }
 
-    std::stringstream ss;
-    ss << node;
+ private:
+  int m_inotify;
+  int m_wakeup;
+  uint32_t m_debounce_ms;
+  std::thread m_thread;
+  std::mutex m_mutex;  // 保护m_watches
+  std::map<int, std::filesystem::path> m_watches;
+};
+#else
+class ConfigWatcher : public Noncopyable {
+ public:
+  explicit ConfigWatcher(uint32_t debounce_ms) {}
 
-    return ss.str();
+  bool start() {
+    LOG_WARN(log::Loggers::engine)
+        << "config watch is not supported on this platform";
+    return false;
   }
+
+  void add_directory(const std::filesystem::path& dir) {}
 };
+#endif
 
-// map
-template <typename T>
-class Convert<std::string, std::map<std::string, T>> {
- public:
-  std::map<std::string, T>&& operator()(const std::string& str) {
-    typename std::map<std::string, T> result;
+static std::mutex s_watcher_mutex;  // 保护s_watcher与s_directories
+static std::unique_ptr<ConfigWatcher> s_watcher;
+static std::set<std::string> s_directories;
 
-    YAML::Node node = YAML::Load(str);
-    std::stringstream ss;
+ConfigRegistry* ConfigRegistry::Self() {
+  static ConfigRegistry s_registry;
+  return &s_registry;
+}
+
+ConfigRegistry::ConfigRegistry() {
+  m_tables.emplace_back(new Table(64));
+  m_table.store(m_tables.back().get(), std::memory_order_release);
+}
 
-    for (T& val : node) {
-      ss.str("");
-      ss << val.second;
-      result.push_back(val.first.Scalar(), Convert<std::string, T>()(ss.str()));
+ConfigVarBase* ConfigRegistry::find(const ConfigKey& key) const {
+  const Table* table = m_table.load(std::memory_order_acquire);
+  for (size_t i = key.hash & table->mask;; i = (i + 1) & table->mask) {
+    const Slot& slot = table->slots[i];
+    ConfigVarBase* var = slot.var.load(std::memory_order_acquire);
+    if (!var) {
+      return nullptr;
     }
+    if (slot.hash == key.hash && var->name() == key.name) {
+      return var;
+    }
+  }
+}
 
-    return std::move(result);
+void ConfigRegistry::add(ConfigVarBase* var) {
+  Table* table = m_table.load(std::memory_order_relaxed);
+  size_t capacity = table->mask + 1;
+  if (m_vars.size() * 4 <= capacity * 3) {
+    Place(*table, var);
+    return;
   }
-};
 
-template <typename T>
-class Convert<std::map<std::string, T>, std::string> {
- public:
-  std::string operator()(const std::map<std::string, T>& map) {
-    YAML::Node node(YAML::NodeType::Map);
-    for (T& val : map) {
-      node[val.first] = YAML::Load(Convert<T, std::string>()(val.second));
-    }
+  // 新表填好之后才发布,正在查找旧表的线程不受影响
+  m_tables.emplace_back(new Table(capacity * 2));
+  for (auto& item : m_vars) {
+    Place(*m_tables.back(), item.get());
+  }
+  m_table.store(m_tables.back().get(), std::memory_order_release);
+}
 
-    std::stringstream ss;
-    ss << node;
+void ConfigRegistry::Place(Table& table, ConfigVarBase* var) {
+  size_t i = var->hash() & table.mask;
+  while (table.slots[i].var.load(std::memory_order_relaxed)) {
+    i = (i + 1) & table.mask;
+  }
+  table.slots[i].hash = var->hash();
+  table.slots[i].var.store(var, std::memory_order_release);
+}
 
-    return ss.str();
+void ConfigRegistry::visit(
+    const std::function<void(ConfigVarBase::ptr)>& callback) {
+  std::vector<ConfigVarBase::ptr> vars;
+  {
+    std::lock_guard<sync::SpinkLock> lock(m_mutex);
+    vars = m_vars;
   }
-};
-// unordered_map
-template <typename T>
-class Convert<std::string, std::unordered_map<std::string, T>> {
- public:
-  std::unordered_map<std::string, T>&& operator()(const std::string& str) {
-    typename std::unordered_map<std::string, T> result;
+  for (auto& var : vars) {
+    callback(var);
+  }
+}
 
-    YAML::Node node = YAML::Load(str);
-    std::stringstream ss;
+ConfigVarBase::ptr Config::LookupBase(const ConfigKey& key) {
+  ConfigVarBase* var = ConfigRegistry::Self()->find(key);
+  return var ? var->shared_from_this() : nullptr;
+}
 
-    for (T& val : node) {
-      ss.str("");
-      ss << val.second;
-      result.push_back(val.first.Scalar(), Convert<std::string, T>()(ss.str()));
+bool Config::Apply(const std::map<std::string, YAML::Node>& changes) {
+  std::vector<ConfigVarBase::Update::ptr> updates;
+  for (auto& [key, value] : changes) {
+    ConfigVarBase::ptr var = LookupBase(key);
+    if (!var) {
+      continue;
     }
-
-    return std::move(result);
-  }
-};
-
-template <typename T>
-class Convert<std::unordered_map<std::string, T>, std::string> {
- public:
-  std::string operator()(const std::map<std::string, T>& map) {
-    YAML::Node node(YAML::NodeType::Map);
-    for (T& val : map) {
-      node[val.first] = YAML::Load(Convert<T, std::string>()(val.second));
+    ConfigVarBase::Update::ptr update = var->parse(value);
+    if (!update) {
+      LOG_ERROR(log::Loggers::engine)
+          << "config " << key << " invalid value: " << YAML::Dump(value);
+      return false;
     }
+    updates.push_back(std::move(update));
+  }
 
-    std::stringstream ss;
-    ss << node;
+  Publish(updates);
+  return true;
+}
 
-    return ss.str();
+/**
+ * @brief 从快照中转换配置项的值
+ *
+ * @return 快照中没有该配置项时found为false,转换失败时返回nullptr
+ */
+static ConfigVarBase::Update::ptr ParseCompiled(
+    const CompiledConfig& compiled, ConfigVarBase& var, bool& found) {
+  CompiledConfig::node_t node;
+  found = compiled.find(var.name(), node);
+  if (!found) {
+    return nullptr;
   }
-};
-}  // namespace cx::conv
+  return compiled.is_scalar(node) ? var.parse(compiled.scalar(node))
+                                  : var.parse(compiled.node(node));
+}
 
-std::string cx::Config::s_config_dir = "config/";
-bool cx::Config::s_watch = true;
-cx::Config::file_mapper_t cx::Config::s_file_modified;
+/**
+ * @brief 从目录下的快照加载,只在还没有加载过任何文件时使用,不需要考虑与其他
+ * 文件的覆盖顺序
+ *
+ * @return bool 快照不存在,已失效或转换失败时返回false,由调用者解析yaml
+ */
+static bool LoadCompiled(const std::filesystem::path& dir,
+                         const std::vector<std::filesystem::path>& files) {
+  LoadState& state = GetLoadState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (!state.files.empty() || !state.compiled.empty()) {
+    return false;
+  }
+  CompiledConfig::ptr compiled =
+      CompiledConfig::Open(dir / CompiledConfig::FILE_NAME);
+  if (!compiled || !compiled->up_to_date(dir, files)) {
+    return false;
+  }
 
-void ListAllMember(
-    const std::string& prefix, const YAML::Node& node,
-    std::list<std::pair<std::string, const YAML::Node>>& output) {
-  if (!prefix.empty()) {
-    output.push_back(std::make_pair(prefix, node));
+  // 只查找已注册的配置项,快照中其余的配置项不需要构造
+  std::vector<ConfigVarBase::ptr> vars;
+  Config::Visit([&vars](ConfigVarBase::ptr var) { vars.push_back(var); });
+  std::vector<ConfigVarBase::Update::ptr> updates;
+  for (auto& var : vars) {
+    bool found = false;
+    ConfigVarBase::Update::ptr update = ParseCompiled(*compiled, *var, found);
+    if (!found) {
+      continue;
+    }
+    if (!update) {
+      LOG_WARN(log::Loggers::engine)
+          << "config " << var->name() << " invalid value in snapshot of "
+          << dir << ", load yaml instead";
+      return false;
+    }
+    updates.push_back(std::move(update));
   }
 
-  if (node.IsMap())
-    for (auto it : node) {
-      ListAllMember((prefix.empty() ? it.first.Scalar()
-                                    : (prefix + "." + it.first.Scalar())),
-                    it.second, output);
+  Publish(updates);
+  state.compiled.emplace(dir, std::move(compiled));
+  return true;
+}
+
+void Config::ApplyLoaded(ConfigVarBase& var) {
+  LoadState& state = GetLoadState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+
+  // 重新加载只修改值有变化的配置项,之后注册的配置项需要在这里取得已加载的值
+  bool found = false;
+  ConfigVarBase::Update::ptr update;
+  auto it = state.merged.find(var.name());
+  if (it != state.merged.end()) {
+    found = true;
+    update = var.parse(it->second);
+  } else {
+    for (auto& [dir, compiled] : state.compiled) {
+      update = ParseCompiled(*compiled, var, found);
+      if (found) {
+        break;
+      }
     }
+  }
+  if (!found) {
+    return;
+  }
+  if (!update) {
+    LOG_ERROR(log::Loggers::engine)
+        << "config " << var.name() << " invalid loaded value, keep default";
+    return;
+  }
+  std::vector<ConfigVarBase::Update::ptr> updates;
+  updates.push_back(std::move(update));
+  Publish(updates);
 }
 
-void cx::Config::LoadFileFromNode(YAML::Node* root) {
-  std::list<std::pair<std::string, const YAML::Node>> all_nodes;
-  ListAllMember("", *root, all_nodes);
+void Config::Reload(const std::vector<std::filesystem::path>& paths) {
+  LoadState& state = GetLoadState();
+  std::lock_guard<std::mutex> lock(state.mutex);
 
-  for (auto& i : all_nodes) {
-    std::string key = i.first;
-    if (key.empty()) {
-      continue;
+  // 从快照加载的目录没有各文件的内容,第一次重新加载时完整解析
+  std::vector<std::filesystem::path> all(paths);
+  for (auto& [dir, compiled] : state.compiled) {
+    std::vector<std::filesystem::path> files = ListYamlFiles(dir);
+    all.insert(all.end(), files.begin(), files.end());
+  }
+  std::sort(all.begin(), all.end());
+  all.erase(std::unique(all.begin(), all.end()), all.end());
+
+  // 本次加载后各文件的内容,nullopt表示文件已删除
+  std::vector<ParsedFile> parsed = ParseFiles(all);
+  std::map<std::filesystem::path, std::optional<LoadState::values_t>> loaded;
+  for (size_t i = 0; i < all.size(); ++i) {
+    if (!parsed[i].exists) {
+      loaded[all[i]] = std::nullopt;
+    } else if (parsed[i].values) {
+      loaded[all[i]] = std::move(parsed[i].values);
+    } else {
+      // 保留该文件上次的内容
+      LOG_ERROR(log::Loggers::engine)
+          << "config load " << all[i] << " failed: " << parsed[i].error;
     }
+  }
 
-    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+  // 按路径顺序合并所有文件,后面的文件覆盖前面的
+  std::map<std::filesystem::path, const LoadState::values_t*> ordered;
+  for (auto& [path, values] : state.files) {
+    ordered[path] = &values;
+  }
+  for (auto& [path, values] : loaded) {
+    if (values) {
+      ordered[path] = &*values;
+    } else {
+      ordered.erase(path);
+    }
+  }
+  LoadState::values_t merged;
+  for (auto& [path, values] : ordered) {
+    Merge(merged, *values);
+  }
 
-    ConfigVarBase::ptr var = LookupBase(key);
+  LoadState::values_t changes;
+  for (auto& [key, value] : merged) {
+    auto it = state.merged.find(key);
+    if (it == state.merged.end() || !NodeEqual(it->second, value)) {
+      changes.emplace(key, value);
+    }
+  }
+  if (!Apply(changes)) {
+    return;
+  }
 
-    if (var) {
-      if (i.second.IsScalar()) {
-        var->from_string(i.second.Scalar());
-      } else {
-        std::stringstream ss;
-        ss << i.second;
-        var->from_string(ss.str());
-      }
+  for (auto& [path, values] : loaded) {
+    if (values) {
+      state.files[path] = std::move(*values);
+    } else {
+      state.files.erase(path);
     }
   }
+  state.merged.swap(merged);
+  state.compiled.clear();
 }
 
-cx::ConfigVarBase::ptr cx::Config::LookupBase(const std::string& name) {
-  lock_guard(GetMutex());
-  var_mapper_t::iterator it = GetMapper().find(name);
-  return it != GetMapper().end() ? it->second : nullptr;
+void Config::LoadFromFile(const std::string& path) {
+  std::filesystem::path file_path(path);
+  if (IsYamlFile(file_path)) {
+    Reload({file_path});
+  }
 }
 
-void cx::Config::LoadFromFile(const std::filesystem::path& path) {
-  if (!std::filesystem::is_regular_file(path)) {
-    return;
+void Config::LoadFromDirectory(const std::string& path) {
+  std::vector<std::filesystem::path> files = ListYamlFiles(path);
+  if (!LoadCompiled(path, files)) {
+    Reload(files);
   }
-  std::string subfix = path.extension();
-  if (subfix == ".yml" || subfix == ".yaml") {
-    if (s_watch) {
-      std::size_t file_hash = std::filesystem::hash_value(path);
-      auto ftime = std::filesystem::last_write_time(path);
-      std::time_t ctime = decltype(ftime)::clock::to_time_t(ftime);
 
-      if (s_file_modified[file_hash] == ctime) {
-        return;
-      }
-      s_file_modified[file_hash] = ctime;
-    }
-    YAML::Node node = YAML::LoadFile(path.native());
-    LoadFileFromNode(&node);
+  std::lock_guard<std::mutex> lock(s_watcher_mutex);
+  s_directories.insert(path);
+  if (s_watcher) {
+    s_watcher->add_directory(path);
   }
 }
 
-void cx::Config::LoadFromFile(const std::string& path) {
-  std::filesystem::path file_path(path);
-  LoadFromFile(file_path);
+bool Config::Compile(const std::string& path) {
+  std::vector<std::filesystem::path> files = ListYamlFiles(path);
+  std::vector<ParsedFile> parsed = ParseFiles(files);
+  LoadState::values_t merged;
+  for (size_t i = 0; i < files.size(); ++i) {
+    if (!parsed[i].values) {
+      LOG_ERROR(log::Loggers::engine)
+          << "config compile " << files[i] << " failed: "
+          << (parsed[i].exists ? parsed[i].error : "file removed");
+      return false;
+    }
+    Merge(merged, *parsed[i].values);
+  }
+  return CompiledConfig::Write(
+      std::filesystem::path(path) / CompiledConfig::FILE_NAME, path, files,
+      merged);
 }
 
-void cx::Config::LoadFromDirectory(const std::string& path) {
-  FileOp::each_files(path, [](const std::filesystem::path& file_path) {
-    LoadFromFile(file_path);
-  });
+void Config::SetLoadThreads(size_t threads) {
+  s_load_threads.store(threads, std::memory_order_relaxed);
 }
-void cx::Config::Visit(
-    const std::function<void(ConfigVarBase::ptr)>& callback) {
-  lock_guard lock(GetMutex());
 
-  var_mapper_t& mapper = GetMapper();
-  for (auto& var : mapper) {
-    callback(var.second);
+bool Config::Watch(bool enable, uint32_t debounce_ms) {
+  std::unique_ptr<ConfigWatcher> watcher;
+  {
+    std::lock_guard<std::mutex> lock(s_watcher_mutex);
+    if (!enable) {
+      watcher.swap(s_watcher);
+    } else if (!s_watcher) {
+      watcher.reset(new ConfigWatcher(debounce_ms));
+      if (!watcher->start()) {
+        return false;
+      }
+      for (auto& dir : s_directories) {
+        watcher->add_directory(dir);
+      }
+      s_watcher.swap(watcher);
+    }
   }
+  // 在锁外等待后台线程退出,它可能正在重新加载
+  return true;
+}
+
+void Config::Visit(const std::function<void(ConfigVarBase::ptr)>& callback) {
+  ConfigRegistry::Self()->visit(callback);
 }
+
+}  // namespace cx
@@ -10,41 +10,63 @@
  */
 #pragma once
 
+#include <cx/common/internal.h>
+#include <cx/common/noncopyable.h>
+#include <cx/config/config_dispatcher.h>
+#include <cx/config/config_key.h>
+#include <cx/config/convert.h>
 #include <cx/utils/sync/spink_lock.h>
 
+#include <atomic>
 #include <filesystem>
 #include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <type_traits>
-
-namespace YAML {
-class Node;
-}
+#include <vector>
 
 namespace cx {
 
-namespace conv {
-template <typename F, typename T>
-class Convert {
- public:
-  static_assert(std::is_convertible_v<F, T>,
-                "src type must be convert to dst type.");
-  T operator()(const F& val) { return F(); }
-};
-
-}  // namespace conv
-
 /**
  * @brief 配置项基类
  *
  */
-class ConfigVarBase {
+class ConfigVarBase : public std::enable_shared_from_this<ConfigVarBase> {
  public:
   typedef std::shared_ptr<ConfigVarBase> ptr;
-  ConfigVarBase(const std::string& name, const std::string& descripti)
-      : m_name(name), m_descript(descripti) {}
+
+  /**
+   * @brief 已解析但尚未发布的新值,用于批量修改多个配置项
+   *
+   */
+  class Update {
+   public:
+    typedef std::unique_ptr<Update> ptr;
+
+    virtual ~Update() {}
+
+    /**
+     * @brief 发布新值
+     *
+     * @return bool 值是否改变
+     */
+    virtual bool publish() = 0;
+
+    /**
+     * @brief 通知监听器,在同一批的所有值发布之后调用
+     *
+     */
+    virtual void notify() = 0;
+  };
+
+  ConfigVarBase(const std::string& name, const std::string& descripti,
+                const void* type = nullptr)
+      : m_name(name),
+        m_descript(descripti),
+        m_hash(ConfigKey(name).hash),
+        m_type(type) {}
 
   virtual ~ConfigVarBase() {}
 
@@ -62,66 +84,281 @@ class ConfigVarBase {
    */
   const std::string& desc() const { return m_descript; }
 
+  /**
+   * @brief 名称的FNV-1a哈希,与ConfigKey相同
+   *
+   * @return uint64_t 哈希
+   */
+  uint64_t hash() const { return m_hash; }
+
+  /**
+   * @brief 具体配置项类型的标识,用于不依赖RTTI的类型检查
+   *
+   * @return const void* 标识,见ConfigVar::TypeId
+   */
+  const void* type() const { return m_type; }
+
   virtual std::string to_string() = 0;
 
   virtual bool from_string(const std::string& str) = 0;
 
+  /**
+   * @brief 直接从yaml节点读取值,不经过字符串
+   *
+   * @param[in] node 节点
+   * @return bool 是否成功
+   */
+  virtual bool from_node(const YAML::Node& node) = 0;
+
+  /**
+   * @brief 解析字符串得到新值,不修改配置项
+   *
+   * @param[in] str 字符串
+   * @return Update::ptr 新值,解析失败时返回nullptr
+   */
+  virtual Update::ptr parse(const std::string& str) = 0;
+
+  /**
+   * @brief 从yaml节点得到新值,不修改配置项
+   *
+   * @param[in] node 节点
+   * @return Update::ptr 新值,转换失败时返回nullptr
+   */
+  virtual Update::ptr parse(const YAML::Node& node) = 0;
+
+  /**
+   * @brief 从编译后快照中的标量得到新值,不修改配置项
+   *
+   * @param[in] scalar 标量
+   * @return Update::ptr 新值,转换失败时返回nullptr
+   */
+  virtual Update::ptr parse(const conv::Scalar& scalar) = 0;
+
+  /**
+   * @brief 全局配置纪元,任意配置项的值改变后递增
+   *
+   * 线程本地的ConfigCache只在纪元变化时重新读取配置项
+   *
+   * @return uint64_t 纪元
+   */
+  CX_STATIC uint64_t Epoch() { return s_epoch.load(std::memory_order_acquire); }
+
+ protected:
+  friend class ConfigDispatcher;
+
+  /**
+   * @brief 新的值发布之后调用,release保证看到新纪元的线程也能看到新的值
+   */
+  CX_STATIC void AdvanceEpoch() {
+    s_epoch.fetch_add(1, std::memory_order_release);
+  }
+
+  /**
+   * @brief 分配监听器id,所有配置项共用,从1开始
+   */
+  CX_STATIC uint64_t NextListenerId() {
+    return s_listener_id.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+  /**
+   * @brief 把修改通知交给投递器,不由shared_ptr管理的配置项直接通知
+   */
+  void post() {
+    ptr self = weak_from_this().lock();
+    if (self) {
+      ConfigDispatcher::Self()->post(std::move(self));
+    } else {
+      notify();
+    }
+  }
+
+  /**
+   * @brief 通知监听器上次通知之后的修改,由投递器调用
+   */
+  virtual void notify() = 0;
+
  protected:
   std::string m_name;
   std::string m_descript;
+  uint64_t m_hash;
+  const void* m_type;
+
+ private:
+  CX_INLINE static std::atomic<uint64_t> s_epoch{0};
+  CX_INLINE static std::atomic<uint64_t> s_listener_id{0};
 };
 
+/**
+ * @brief 配置项某一时刻的值,发布后不再修改
+ *
+ */
+template <typename T>
+struct ConfigSnapshot {
+  typedef std::shared_ptr<const ConfigSnapshot> ptr;
+
+  ConfigSnapshot(const T& val, uint64_t ver) : value(val), version(ver) {}
+
+  const T value;
+  const uint64_t version;  // 配置项的版本,从0开始每次修改加1
+};
+
+template <typename Var>
+class ConfigCache;
+
+/**
+ * @brief 配置项
+ *
+ * FromStr/ToStr用于字符串,FromNode用于加载yaml文件,默认都基于
+ * YAML::convert<T>,见convert.h。值保存在不可变的快照中,修改时构造新的
+ * 快照并原子地替换,读取只需一次原子加载,不需要加锁;读到的快照在持有
+ * 期间不会被修改或释放。写入之间通过自旋锁串行化
+ *
+ */
 template <typename T, class FromStr = conv::Convert<std::string, T>,
-          class ToStr = conv::Convert<T, std::string>>
+          class ToStr = conv::Convert<T, std::string>,
+          class FromNode = conv::Convert<YAML::Node, T>>
 class ConfigVar : public ConfigVarBase {
  public:
+  typedef std::shared_ptr<ConfigVar> ptr;
+  typedef T value_type;
+  typedef typename ConfigSnapshot<T>::ptr snapshot_t;
   typedef std::function<void(const T& oldVal, const T& newVal)> callback_t;
   typedef sync::SpinkLock lock_t;
   typedef std::lock_guard<lock_t> lock_guard;
 
   ConfigVar(const std::string& name, const T& default_val,
             const std::string& descript = "")
-      : ConfigVarBase(name, descript), m_val(default_val) {}
+      : ConfigVarBase(name, descript, TypeId()),
+        m_snapshot(std::make_shared<const ConfigSnapshot<T>>(default_val, 0)),
+        m_notified(m_snapshot) {}
+
+  /**
+   * @brief 类型标识,每种ConfigVar各不相同
+   *
+   * @return const void* 标识
+   */
+  CX_STATIC const void* TypeId() { return &s_type; }
 
   std::string to_string() {
     try {
       return ToStr()(value());
     } catch (const std::exception& e) {
     }
+
+    return "";
   }
 
   bool from_string(const std::string& str) {
     try {
-      m_val = FromStr()(str);
+      set_value(FromStr()(str));
+      return true;
     } catch (const std::exception& e) {
     }
 
     return false;
   }
 
-  const T& value() const {
-    lock_guard lock(m_mutex);
-    return m_val;
+  bool from_node(const YAML::Node& node) {
+    try {
+      set_value(FromNode()(node));
+      return true;
+    } catch (const std::exception& e) {
+    }
+
+    return false;
   }
 
-  void set_value(const T& val) {
-    {
-      lock_guard lock(m_mutex);
-      if (val == m_val) return;
+  Update::ptr parse(const std::string& str) {
+    try {
+      return Update::ptr(new ValueUpdate(
+          std::static_pointer_cast<ConfigVar>(shared_from_this()),
+          FromStr()(str)));
+    } catch (const std::exception& e) {
+    }
+
+    return nullptr;
+  }
+
+  Update::ptr parse(const YAML::Node& node) {
+    try {
+      return Update::ptr(new ValueUpdate(
+          std::static_pointer_cast<ConfigVar>(shared_from_this()),
+          FromNode()(node)));
+    } catch (const std::exception& e) {
+    }
 
-      for (auto& it : m_callback_mapper) {
-        it.second(m_val, val);
+    return nullptr;
+  }
+
+  Update::ptr parse(const conv::Scalar& scalar) {
+    // 自定义了FromNode时按文本构造节点,保持与加载yaml相同的结果
+    if constexpr (!std::is_same_v<FromNode, conv::Convert<YAML::Node, T>>) {
+      return parse(YAML::Node(std::string(scalar.text)));
+    } else {
+      try {
+        return Update::ptr(new ValueUpdate(
+            std::static_pointer_cast<ConfigVar>(shared_from_this()),
+            conv::Convert<conv::Scalar, T>()(scalar)));
+      } catch (const std::exception& e) {
       }
+
+      return nullptr;
     }
-    lock_guard lock(m_mutex);
-    m_val = val;
   }
 
+  /**
+   * @brief 当前值的快照
+   *
+   * @return snapshot_t 快照,持有期间其中的值保持不变
+   */
+  snapshot_t snapshot() const { return std::atomic_load(&m_snapshot); }
+
+  /**
+   * @brief 当前值的拷贝,频繁读取的路径应使用ConfigCache
+   *
+   * @return T 值
+   */
+  T value() const { return snapshot()->value; }
+
+  /**
+   * @brief 当前值的版本
+   *
+   * @return uint64_t 版本
+   */
+  uint64_t version() const { return snapshot()->version; }
+
+  /**
+   * @brief 线程本地的缓存句柄
+   *
+   * @return ConfigCache<ConfigVar> 句柄
+   */
+  ConfigCache<ConfigVar> cache() {
+    return ConfigCache<ConfigVar>(
+        std::static_pointer_cast<ConfigVar>(shared_from_this()));
+  }
+
+  /**
+   * @brief 修改值,监听器由ConfigDispatcher异步通知
+   *
+   * @param[in] val 新值
+   */
+  void set_value(const T& val) {
+    if (publish(val)) {
+      post();
+    }
+  }
+
+  /**
+   * @brief 添加监听器,在ConfigDispatcher中执行
+   *
+   * @param[in] callback 监听器
+   * @return uint64_t 监听器id,用于删除
+   */
   uint64_t add_listener(callback_t callback) {
-    static uint64_t s_cb_id = 0;
+    uint64_t id = NextListenerId();
     lock_guard lock(m_mutex);
-    m_callback_mapper[s_cb_id] = callback;
-    return (++s_cb_id);
+    m_callback_mapper[id] = std::move(callback);
+    return id;
   }
 
   void delete_listener(uint64_t id) {
@@ -133,7 +370,7 @@ class ConfigVar : public ConfigVarBase {
     lock_guard lock(m_mutex);
     typename callback_mapper_t::iterator it = m_callback_mapper.find(id);
     if (it != m_callback_mapper.end()) {
-      return it;
+      return it->second;
     }
 
     return nullptr;
@@ -147,9 +384,223 @@ class ConfigVar : public ConfigVarBase {
  private:
   typedef std::map<uint64_t, callback_t> callback_mapper_t;
 
-  T m_val;
-  lock_t m_mutex;
+  class ValueUpdate : public Update {
+   public:
+    ValueUpdate(std::shared_ptr<ConfigVar> var, T&& val)
+        : m_var(std::move(var)), m_val(std::move(val)) {}
+
+    bool publish() { return m_var->publish(m_val); }
+
+    void notify() { m_var->post(); }
+
+   private:
+    std::shared_ptr<ConfigVar> m_var;
+    T m_val;
+  };
+
+  /**
+   * @brief 发布新值,值没有变化时什么也不做
+   *
+   * @param[in] val 新值
+   * @return bool 值是否改变
+   */
+  bool publish(const T& val) {
+    {
+      lock_guard lock(m_mutex);
+      if (val == m_snapshot->value) return false;
+
+      std::atomic_store(&m_snapshot,
+                        std::make_shared<const ConfigSnapshot<T>>(
+                            val, m_snapshot->version + 1));
+    }
+    AdvanceEpoch();
+    return true;
+  }
+
+  void notify() {
+    snapshot_t old_snapshot;
+    snapshot_t new_snapshot;
+    callback_mapper_t callbacks;
+    {
+      lock_guard lock(m_mutex);
+      old_snapshot = m_notified;
+      new_snapshot = m_snapshot;
+      m_notified = m_snapshot;
+      if (old_snapshot->value == new_snapshot->value) return;
+      callbacks = m_callback_mapper;
+    }
+
+    for (auto& it : callbacks) {
+      it.second(old_snapshot->value, new_snapshot->value);
+    }
+  }
+
+ private:
+  snapshot_t m_snapshot;  // 读取只通过std::atomic_load
+  snapshot_t m_notified;  // 监听器最后一次收到的值
+  lock_t m_mutex;         // 串行化写入与保护监听器
   callback_mapper_t m_callback_mapper;
+
+  CX_INLINE static const char s_type = 0;
+};
+
+/**
+ * @brief 配置项的线程本地缓存句柄
+ *
+ * 持有配置项的一份快照,每次读取只比较一次全局配置纪元,纪元变化时才重新加载
+ * 快照。句柄本身不是线程安全的,每个线程各自持有,通常声明为thread_local:
+ *
+ *   thread_local auto fps = Config::Lookup<int>("engine.fps")->cache();
+ *   int limit = *fps;
+ *
+ */
+template <typename Var>
+class ConfigCache {
+ public:
+  typedef typename Var::value_type value_type;
+
+  explicit ConfigCache(typename Var::ptr var)
+      // 先读纪元再读快照,之后的修改一定会让纪元不同
+      : m_var(std::move(var)),
+        m_epoch(ConfigVarBase::Epoch()),
+        m_snapshot(m_var->snapshot()) {}
+
+  /**
+   * @brief 读取缓存的值,返回的引用在下一次读取前有效
+   *
+   * @return const value_type& 值
+   */
+  const value_type& get() {
+    uint64_t epoch = ConfigVarBase::Epoch();
+    if (CX_UNLICKLY(epoch != m_epoch)) {
+      m_epoch = epoch;
+      m_snapshot = m_var->snapshot();
+    }
+    return m_snapshot->value;
+  }
+
+  const value_type& operator*() { return get(); }
+
+  const value_type* operator->() { return &get(); }
+
+  const typename Var::ptr& var() const { return m_var; }
+
+ private:
+  typename Var::ptr m_var;
+  uint64_t m_epoch;
+  typename Var::snapshot_t m_snapshot;
+};
+
+/**
+ * @brief 配置项的类型化句柄
+ *
+ * 注册或查找时得到一次,之后访问配置项不再查找注册表也不做类型检查,只有一次
+ * 指针加载。配置项注册后直到程序退出都不会释放,句柄可以在任意线程复制与使用。
+ * 频繁读取值时再配合ConfigCache:
+ *
+ *   static const auto fps = Config::Handle<int>("engine.fps", 60);
+ *   thread_local auto cache = fps.cache();
+ *   int limit = *cache;
+ *
+ */
+template <typename T>
+class ConfigHandle {
+ public:
+  typedef ConfigVar<T> var_t;
+
+  ConfigHandle() = default;
+
+  explicit ConfigHandle(var_t* var) : m_var(var) {}
+
+  var_t* get() const { return m_var; }
+
+  var_t* operator->() const { return m_var; }
+
+  var_t& operator*() const { return *m_var; }
+
+  explicit operator bool() const { return m_var != nullptr; }
+
+  T value() const { return m_var->value(); }
+
+  ConfigCache<var_t> cache() const { return m_var->cache(); }
+
+ private:
+  var_t* m_var = nullptr;
+};
+
+/**
+ * @brief 配置项注册表
+ *
+ * 以名称的FNV-1a哈希为键的开放寻址哈希表,线性探测。注册在锁内进行,装载因子
+ * 超过3/4时构造两倍大小的新表再原子地替换;查找不加锁,只读取当前的表。配置项
+ * 只增不减,槽位写入后不再修改,旧表保留到程序退出,所有表的总大小不超过最终表
+ * 的两倍
+ *
+ */
+class ConfigRegistry : public Noncopyable {
+ public:
+  CX_STATIC ConfigRegistry* Self();
+
+  /**
+   * @brief 查找配置项,不加锁
+   *
+   * @param[in] key 名称
+   * @return ConfigVarBase* 配置项,不存在时返回nullptr
+   */
+  ConfigVarBase* find(const ConfigKey& key) const;
+
+  /**
+   * @brief 注册配置项,同名的配置项已存在时返回它
+   *
+   * @param[in] key     名称
+   * @param[in] factory 构造配置项,只在不存在时在锁内调用
+   * @return ConfigVarBase* 配置项
+   */
+  template <typename Factory>
+  ConfigVarBase* insert(const ConfigKey& key, Factory&& factory) {
+    std::lock_guard<sync::SpinkLock> lock(m_mutex);
+    if (ConfigVarBase* var = find(key)) {
+      return var;
+    }
+    m_vars.push_back(factory());
+    add(m_vars.back().get());
+    return m_vars.back().get();
+  }
+
+  /**
+   * @brief 按注册顺序遍历,回调在锁外执行,其中可以注册新的配置项
+   *
+   */
+  void visit(const std::function<void(ConfigVarBase::ptr)>& callback);
+
+ private:
+  struct Slot {
+    uint64_t hash;
+    std::atomic<ConfigVarBase*> var{nullptr};  // 写入hash之后发布
+  };
+
+  struct Table {
+    explicit Table(size_t capacity)
+        : mask(capacity - 1), slots(new Slot[capacity]) {}
+
+    size_t mask;
+    std::unique_ptr<Slot[]> slots;
+  };
+
+  ConfigRegistry();
+
+  /**
+   * @brief 把已加入m_vars的配置项放入当前表,需要时先扩容,在锁内调用
+   */
+  void add(ConfigVarBase* var);
+
+  CX_STATIC void Place(Table& table, ConfigVarBase* var);
+
+ private:
+  std::atomic<Table*> m_table;
+  sync::SpinkLock m_mutex;                     // 串行化注册
+  std::vector<std::unique_ptr<Table>> m_tables;  // 分配过的所有表
+  std::vector<ConfigVarBase::ptr> m_vars;        // 按注册顺序,持有配置项
 };
 
 /**
@@ -158,81 +609,161 @@ class ConfigVar : public ConfigVarBase {
  */
 class Config {
  public:
-  typedef std::map<std::string, ConfigVarBase::ptr> var_mapper_t;
-  typedef sync::SpinkLock lock_t;
-  typedef std::lock_guard<lock_t> lock_guard;
-
+  /**
+   * @brief 注册配置项,已存在时返回已有的配置项
+   *
+   * @param[in] key         名称
+   * @param[in] default_val 默认值
+   * @param[in] descript    描述
+   * @return ConfigVar<T>::ptr 配置项,同名配置项的类型不同时返回nullptr
+   */
   template <typename T>
-  static typename ConfigVar<T>::ptr Lookup(const std::string& name,
+  static typename ConfigVar<T>::ptr Lookup(const ConfigKey& key,
                                            const T& default_val,
                                            const std::string& descript = "") {
-    lock_guard lock(GetMutex());
+    ConfigHandle<T> handle = Handle<T>(key, default_val, descript);
+    return handle ? std::static_pointer_cast<ConfigVar<T>>(
+                        handle->shared_from_this())
+                  : nullptr;
+  }
 
-    // 注册
-    return check_item(name, default_val, descript);
+  template <typename T>
+  static typename ConfigVar<T>::ptr Lookup(const ConfigKey& key) {
+    ConfigHandle<T> handle = Handle<T>(key);
+    return handle ? std::static_pointer_cast<ConfigVar<T>>(
+                        handle->shared_from_this())
+                  : nullptr;
   }
 
+  /**
+   * @brief 注册配置项并返回句柄,热路径上保存句柄,不要反复查找
+   *
+   * 在加载配置文件之后注册时,新的配置项立即取得已加载的值
+   *
+   * @return ConfigHandle<T> 句柄,同名配置项的类型不同时为空
+   */
   template <typename T>
-  static typename ConfigVar<T>::ptr Lookup(const std::string& name) {
-    lock_guard lock(GetMutex());
-    var_mapper_t& mapper = GetMapper();
-    typename var_mapper_t::iterator it = mapper.find(name);
-    if (it == mapper.end()) {
-      return nullptr;
+  static ConfigHandle<T> Handle(const ConfigKey& key, const T& default_val,
+                                const std::string& descript = "") {
+    bool created = false;
+    ConfigVarBase* var = ConfigRegistry::Self()->insert(key, [&]() {
+      created = true;
+      return std::make_shared<ConfigVar<T>>(std::string(key.name),
+                                            default_val, descript);
+    });
+    if (created) {
+      ApplyLoaded(*var);
     }
+    return Cast<T>(var);
+  }
 
-    return std::dynamic_pointer_cast<ConfigVar<T>>(it->second);
+  /**
+   * @brief 查找已注册的配置项,不加锁
+   *
+   * @return ConfigHandle<T> 句柄,不存在或类型不同时为空
+   */
+  template <typename T>
+  static ConfigHandle<T> Handle(const ConfigKey& key) {
+    return Cast<T>(ConfigRegistry::Self()->find(key));
   }
 
-  static ConfigVarBase::ptr LookupBase(const std::string& name);
+  static ConfigVarBase::ptr LookupBase(const ConfigKey& key);
 
+  /**
+   * @brief 加载yaml文件,只修改与上次加载相比值有变化的配置项
+   *
+   * @param[in] path 文件路径
+   */
   static void LoadFromFile(const std::string& path);
 
+  /**
+   * @brief 递归加载目录下的所有yaml文件,开启监视时同时监视该目录
+   *
+   * 先遍历目录找出所有文件,再在线程池中并发解析,全部解析完后按路径顺序合并,
+   * 结果与串行解析相同。多个文件中的同名配置项按完整路径逐级比较的顺序,后面的
+   * 文件覆盖前面的:同一目录下"00-base.yml"被"10-overlay.yml"覆盖,子目录按
+   * 目录名参与排序。
+   *
+   * 还没有加载过任何文件时,如果目录下有Compile生成且与源文件一致的快照,直接
+   * 从快照加载,不解析yaml;之后第一次重新加载时再完整解析该目录
+   *
+   * @param[in] path 目录路径
+   */
   static void LoadFromDirectory(const std::string& path);
 
-  static void Watch(bool enable) { s_watch = enable; }
-
-  static void Visit(const std::function<void(ConfigVarBase::ptr)>& callback);
+  /**
+   * @brief 把目录下所有yaml文件合并后的结果编译为二进制快照,保存在该目录下
+   *
+   * 源文件改变后快照自动失效,LoadFromDirectory回到解析yaml
+   *
+   * @param[in] path 目录路径
+   * @return bool 有文件解析失败或写入失败时返回false
+   */
+  static bool Compile(const std::string& path);
 
- private:
-  static void LoadFromFile(const std::filesystem::path& path);
+  /**
+   * @brief 设置并发解析文件的线程数,包括调用线程
+   *
+   * @param[in] threads 线程数,0为cpu核心数(默认),1为在调用线程串行解析
+   */
+  static void SetLoadThreads(size_t threads);
 
-  static void LoadFileFromNode(YAML::Node* root);
+  /**
+   * @brief 开启或关闭对已加载目录的监视
+   *
+   * 开启后后台线程通过inotify监视LoadFromDirectory加载过的目录,文件在
+   * debounce_ms内没有新的改动后才重新加载,编辑器保存时的多次写入只加载一次。
+   * 重新加载只解析改动的文件,找出值变化的配置项作为一批修改:任意一项解析失败
+   * 时整批放弃,否则先发布全部新值再通知监听器,监听器看到的其他配置项都已是
+   * 新值
+   *
+   * @param[in] enable      是否开启
+   * @param[in] debounce_ms 合并改动的时间窗口
+   * @return bool 开启失败或平台不支持时返回false
+   */
+  static bool Watch(bool enable, uint32_t debounce_ms = 100);
 
-  template <typename T>
-  static typename ConfigVar<T>::ptr check_item(const std::string& name,
-                                               const T& default_val,
-                                               const std::string& descript) {
-    var_mapper_t& mapper = GetMapper();
-    typename var_mapper_t::iterator it = mapper.find(name);
-    if (it != mapper.end()) {
-      ConfigVarBase::ptr tmp =
-          std::dynamic_pointer_cast<ConfigVar<T>>(it->second);
+  /**
+   * @brief 按注册顺序遍历所有配置项
+   *
+   * @param[in] callback 回调,不持有注册表的锁
+   */
+  static void Visit(const std::function<void(ConfigVarBase::ptr)>& callback);
 
-      return tmp ? tmp : nullptr;
-    }
-    typename ConfigVar<T>::ptr conf_var(
-        std::make_shared<ConfigVar<T>>(name, default_val, descript));
+ private:
+  friend class ConfigWatcher;
 
-    GetMapper().insert({name, conf_var});
+  /**
+   * @brief 重新加载一组文件,已不存在的文件视为删除,其中的配置项保持当前值
+   *
+   * @param[in] paths 文件路径
+   */
+  static void Reload(const std::vector<std::filesystem::path>& paths);
 
-    return conf_var;
-  }
+  /**
+   * @brief 批量修改配置项
+   *
+   * @param[in] changes 配置项名称与新值
+   * @return bool 有配置项转换失败时返回false,此时不修改任何配置项
+   */
+  static bool Apply(const std::map<std::string, YAML::Node>& changes);
 
-  static lock_t& GetMutex() {
-    static lock_t s_mutex;
-    return s_mutex;
-  }
+  /**
+   * @brief 新注册的配置项取得已加载的文件或快照中的值
+   *
+   * @param[in] var 配置项
+   */
+  static void ApplyLoaded(ConfigVarBase& var);
 
-  static var_mapper_t& GetMapper() {
-    static var_mapper_t s_datas;
-    return s_datas;
+  /**
+   * @brief 通过类型标识检查配置项的类型,代替dynamic_pointer_cast
+   */
+  template <typename T>
+  static ConfigHandle<T> Cast(ConfigVarBase* var) {
+    if (var && var->type() == ConfigVar<T>::TypeId()) {
+      return ConfigHandle<T>(static_cast<ConfigVar<T>*>(var));
+    }
+    return ConfigHandle<T>();
   }
-
-  typedef std::map<std::size_t, time_t> file_mapper_t;
-  static std::string s_config_dir;
-
-  static file_mapper_t s_file_modified;
-  static bool s_watch;
 };
 }  // namespace cx
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "config_dispatcher.h"
+
+#include <cx/common/logger.h>
+
+#include "config.h"
+
+namespace cx {
+
+ConfigDispatcher* ConfigDispatcher::Self() {
+  static ConfigDispatcher s_dispatcher;
+  return &s_dispatcher;
+}
+
+ConfigDispatcher::ConfigDispatcher()
+    : m_mode(Mode::eThread), m_stop(false), m_delivering(false) {
+  m_thread = std::thread(&ConfigDispatcher::run, this);
+}
+
+ConfigDispatcher::~ConfigDispatcher() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_cond.notify_all();
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+}
+
+void ConfigDispatcher::set_mode(Mode mode) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_mode = mode;
+  }
+  m_cond.notify_all();
+}
+
+ConfigDispatcher::Mode ConfigDispatcher::mode() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_mode;
+}
+
+void ConfigDispatcher::post(std::shared_ptr<ConfigVarBase> var) {
+  bool wakeup = false;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_queued.insert(var.get()).second) {
+      // 已经在队列中,投递时读取最新的值
+      return;
+    }
+    m_queue.push_back(std::move(var));
+    wakeup = m_mode == Mode::eThread && m_queue.size() == 1;
+  }
+  if (wakeup) {
+    m_cond.notify_one();
+  }
+}
+
+size_t ConfigDispatcher::dispatch() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (in_listener()) {
+    return 0;
+  }
+  // 同一时刻只有一个线程投递,保证同一配置项的通知有序
+  m_idle_cond.wait(lock, [this]() { return !m_delivering; });
+  return deliver(lock);
+}
+
+void ConfigDispatcher::flush() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  // 在监听器中等待自己所在的这一批执行完会死锁,剩余的通知在监听器返回后
+  // 由同一个线程继续执行
+  if (in_listener()) {
+    return;
+  }
+  if (m_mode == Mode::eManual) {
+    m_idle_cond.wait(lock, [this]() { return !m_delivering; });
+    deliver(lock);
+    return;
+  }
+  m_idle_cond.wait(lock,
+                   [this]() { return m_queue.empty() && !m_delivering; });
+}
+
+size_t ConfigDispatcher::deliver(std::unique_lock<std::mutex>& lock) {
+  std::vector<std::shared_ptr<ConfigVarBase>> batch;
+  batch.swap(m_queue);
+  m_queued.clear();
+  m_delivering = true;
+  m_delivering_thread = std::this_thread::get_id();
+  lock.unlock();
+
+  for (auto& var : batch) {
+    try {
+      var->notify();
+    } catch (const std::exception& e) {
+      LOG_ERROR(log::Loggers::engine)
+          << "config " << var->name() << " listener throws: " << e.what();
+    }
+  }
+
+  lock.lock();
+  m_delivering = false;
+  m_delivering_thread = std::thread::id();
+  m_idle_cond.notify_all();
+  if (!m_queue.empty()) {
+    m_cond.notify_one();
+  }
+  return batch.size();
+}
+
+void ConfigDispatcher::run() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_cond.wait(lock, [this]() {
+      return m_stop ||
+             (m_mode == Mode::eThread && !m_queue.empty() && !m_delivering);
+    });
+    if (m_stop) {
+      break;
+    }
+    deliver(lock);
+  }
+}
+
+}  // namespace cx
@@ -0,0 +1,115 @@
+/**
+ * @file config_dispatcher.h
+ * @brief 配置项修改通知的异步投递
+ */
+#pragma once
+
+#include <cx/common/internal.h>
+#include <cx/common/noncopyable.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace cx {
+
+class ConfigVarBase;
+
+/**
+ * @brief 配置项修改通知的投递器
+ *
+ * 配置项修改后只把它放入队列,监听器在投递器中执行,不持有任何配置项的锁,
+ * 监听器中可以读写其他配置项。同一配置项尚未投递的多次修改合并为一次通知,
+ * 参数是监听器上次收到的值与投递时的最新值,最终没有变化时不通知。不同配置项
+ * 的通知按第一次修改的顺序投递,同一时刻只有一个线程在投递
+ *
+ */
+class ConfigDispatcher : public Noncopyable {
+ public:
+  /**
+   * @brief 投递方式
+   *
+   */
+  enum class Mode : uint8_t {
+    eThread,  // 后台线程投递(默认)
+    eManual,  // 由dispatch()在调用线程投递,例如在引擎的某个阶段
+  };
+
+  /**
+   * @brief 全局投递器
+   *
+   * @return ConfigDispatcher* 投递器
+   */
+  CX_STATIC ConfigDispatcher* Self();
+
+  ~ConfigDispatcher();
+
+  /**
+   * @brief 切换投递方式,切换为eManual时已经排队的通知留给dispatch()
+   *
+   * @param[in] mode 投递方式
+   */
+  void set_mode(Mode mode);
+
+  Mode mode();
+
+  /**
+   * @brief 投递配置项的修改通知,由ConfigVar调用
+   *
+   * @param[in] var 配置项
+   */
+  void post(std::shared_ptr<ConfigVarBase> var);
+
+  /**
+   * @brief 在调用线程执行排队的通知,eManual时由使用者定期调用
+   *
+   * 在监听器中调用时直接返回0,排队的通知在当前这一批之后执行
+   *
+   * @return size_t 执行的通知数量
+   */
+  size_t dispatch();
+
+  /**
+   * @brief 等待调用之前排队的通知全部执行完,eManual时直接在调用线程执行
+   *
+   * 在监听器中调用时不等待直接返回,否则要等待的正是监听器所在的这一批,
+   * 会死锁;此时其余的通知在监听器返回后由同一个线程继续执行
+   *
+   */
+  void flush();
+
+ private:
+  ConfigDispatcher();
+
+  void run();
+
+  /**
+   * @brief 取出并执行一批通知,调用时持有lock,执行期间释放
+   */
+  size_t deliver(std::unique_lock<std::mutex>& lock);
+
+  /**
+   * @brief 是否在正在投递的线程中,即在监听器中调用,调用时持有m_mutex
+   */
+  bool in_listener() const {
+    return m_delivering && m_delivering_thread == std::this_thread::get_id();
+  }
+
+ private:
+  std::mutex m_mutex;
+  std::condition_variable m_cond;       // 有新的通知或需要退出
+  std::condition_variable m_idle_cond;  // 一批通知执行完
+  Mode m_mode;
+  bool m_stop;
+  bool m_delivering;
+  std::thread::id m_delivering_thread;  // 正在投递的线程
+  std::vector<std::shared_ptr<ConfigVarBase>> m_queue;  // 按第一次修改的顺序
+  std::unordered_set<ConfigVarBase*> m_queued;          // 已经在队列中的配置项
+  std::thread m_thread;
+};
+
+}  // namespace cx
@@ -0,0 +1,59 @@
+/**
+ * @file config_key.h
+ * @brief 编译期计算哈希的配置项名称
+ */
+#pragma once
+
+#include <cx/common/internal.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace cx {
+
+CX_STATIC_CONSTEXPR uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+CX_STATIC_CONSTEXPR uint64_t FNV_PRIME = 0x100000001b3ull;
+
+/**
+ * @brief 64位FNV-1a哈希,可以在编译期计算
+ *
+ * @param[in] data 数据
+ * @param[in] len  长度
+ * @param[in] hash 上一段数据的哈希,用于分段计算
+ * @return uint64_t 哈希
+ */
+CX_CONSTEXPR uint64_t Fnv1a(const char* data, size_t len,
+                            uint64_t hash = FNV_OFFSET_BASIS) {
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= (uint8_t)data[i];
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+/**
+ * @brief 配置项名称与它的哈希
+ *
+ * 由字符串字面量构造时哈希在编译期计算,可以声明为constexpr常量;由运行时的
+ * 字符串构造时只引用该字符串,不能比它活得更久
+ *
+ *   constexpr ConfigKey kFps("engine.fps");
+ *   static auto fps = Config::Handle<int>(kFps, 60);
+ *
+ */
+struct ConfigKey {
+  CX_CONSTEXPR ConfigKey(const char* str)
+      : ConfigKey(std::string_view(str)) {}
+
+  CX_CONSTEXPR ConfigKey(std::string_view str)
+      : name(str), hash(Fnv1a(str.data(), str.size())) {}
+
+  ConfigKey(const std::string& str) : ConfigKey(std::string_view(str)) {}
+
+  std::string_view name;
+  uint64_t hash;
+};
+
+}  // namespace cx
@@ -0,0 +1,34 @@
+/**
+ * @file config_module.h
+ * @brief 在引擎的帧循环中投递配置修改通知
+ */
+#pragma once
+
+#include "cx/common/module.h"
+#include "cx/config/config_dispatcher.h"
+
+namespace cx {
+
+/**
+ * @brief 配置通知模块
+ *
+ * 包含该头文件即注册模块:引擎创建模块后ConfigDispatcher切换为eManual,配置
+ * 监听器在主线程的ePre阶段执行,与其他模块的update之间不需要同步
+ *
+ */
+class ConfigModule : public Module::Registrar<ConfigModule> {
+  CX_INLINE CX_STATIC const bool Registered = Register(Stage::ePre);
+
+ public:
+  ConfigModule() {
+    ConfigDispatcher::Self()->set_mode(ConfigDispatcher::Mode::eManual);
+  }
+
+  ~ConfigModule() {
+    ConfigDispatcher::Self()->set_mode(ConfigDispatcher::Mode::eThread);
+  }
+
+  void update() override { ConfigDispatcher::Self()->dispatch(); }
+};
+
+}  // namespace cx
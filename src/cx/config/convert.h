@@ -0,0 +1,166 @@
+/**
+ * @file convert.h
+ * @brief 配置项的类型转换
+ */
+#pragma once
+
+#include <yaml-cpp/yaml.h>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace cx::conv {
+
+/**
+ * @brief 类型转换,F转换为T
+ *
+ * 字符串与yaml节点的转换都基于YAML::convert<T>:数值,字符串与yaml-cpp支持
+ * 的容器(vector,list,map,pair,array等)可以直接使用,自定义类型特化
+ * YAML::convert<T>即可,不需要特化Convert。转换失败时抛出异常
+ *
+ */
+template <typename F, typename T>
+class Convert {
+ public:
+  static_assert(std::is_convertible_v<F, T>,
+                "src type must be convert to dst type.");
+  T operator()(const F& val) { return T(val); }
+};
+
+/**
+ * @brief yaml节点转换为值,不经过字符串
+ *
+ */
+template <typename T>
+class Convert<YAML::Node, T> {
+ public:
+  T operator()(const YAML::Node& node) { return node.as<T>(); }
+};
+
+/**
+ * @brief 字符串转换为值,标量直接转换,其他类型先按yaml解析
+ *
+ */
+template <typename T>
+class Convert<std::string, T> {
+ public:
+  T operator()(const std::string& str) {
+    if constexpr (std::is_arithmetic_v<T>) {
+      return YAML::Node(str).as<T>();
+    } else {
+      return YAML::Load(str).as<T>();
+    }
+  }
+};
+
+/**
+ * @brief 值转换为字符串,标量输出本身,其他类型输出yaml文本
+ *
+ */
+template <typename F>
+class Convert<F, std::string> {
+ public:
+  std::string operator()(const F& val) {
+    YAML::Node node(val);
+    if (node.IsScalar()) {
+      return node.Scalar();
+    }
+    YAML::Emitter out;
+    out << node;
+    return out.c_str();
+  }
+};
+
+/**
+ * @brief 已经确定类型的yaml标量,编译后的配置快照使用,避免再次解析文本
+ *
+ */
+struct Scalar {
+  enum class Kind : uint8_t { eString, eInt, eDouble, eBool };
+
+  Kind kind = Kind::eString;
+  std::string_view text;  // 原始文本
+  int64_t integer = 0;
+  double real = 0.0;
+  bool boolean = false;
+};
+
+/**
+ * @brief 标量转换为值
+ *
+ * 类型匹配的数值与布尔直接取用,其他情况按文本构造标量节点转换,结果与从yaml
+ * 节点转换相同
+ *
+ */
+template <typename T>
+class Convert<Scalar, T> {
+ public:
+  T operator()(const Scalar& scalar) {
+    if constexpr (std::is_same_v<T, bool>) {
+      if (scalar.kind == Scalar::Kind::eBool) {
+        return scalar.boolean;
+      }
+    } else if constexpr (std::is_integral_v<T>) {
+      if (scalar.kind == Scalar::Kind::eInt && InRange(scalar.integer)) {
+        return (T)scalar.integer;
+      }
+    } else if constexpr (std::is_floating_point_v<T>) {
+      if (scalar.kind == Scalar::Kind::eInt) {
+        return (T)scalar.integer;
+      }
+      // float由文本直接舍入,经double再舍入一次可能不同
+      if (scalar.kind == Scalar::Kind::eDouble &&
+          sizeof(T) == sizeof(double)) {
+        return (T)scalar.real;
+      }
+    }
+    return Convert<YAML::Node, T>()(YAML::Node(std::string(scalar.text)));
+  }
+
+ private:
+  static bool InRange(int64_t value) {
+    if constexpr (std::is_unsigned_v<T>) {
+      return value >= 0 &&
+             (uint64_t)value <= (uint64_t)std::numeric_limits<T>::max();
+    } else {
+      return value >= (int64_t)std::numeric_limits<T>::min() &&
+             value <= (int64_t)std::numeric_limits<T>::max();
+    }
+  }
+};
+
+template <>
+class Convert<Scalar, std::string> {
+ public:
+  std::string operator()(const Scalar& scalar) {
+    return std::string(scalar.text);
+  }
+};
+
+template <>
+class Convert<std::string, std::string> {
+ public:
+  std::string operator()(const std::string& str) { return str; }
+};
+
+/**
+ * @brief 非标量节点保存为yaml文本,与from_string的结果一致
+ *
+ */
+template <>
+class Convert<YAML::Node, std::string> {
+ public:
+  std::string operator()(const YAML::Node& node) {
+    if (node.IsScalar()) {
+      return node.Scalar();
+    }
+    YAML::Emitter out;
+    out << node;
+    return out.c_str();
+  }
+};
+
+}  // namespace cx::conv
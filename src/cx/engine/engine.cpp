@@ -11,13 +11,17 @@ using namespace time;
 Engine::Engine()
     : m_app(nullptr),
       m_version{1, 0, 0},
+      m_scheduler(std::thread::hardware_concurrency() > 1
+                      ? std::thread::hardware_concurrency() - 1
+                      : 0),
       m_running(true),
       m_fps_limit(-1.0f),
-      m_elapse_update(std::chrono::milliseconds(15)),
-      m_elapse_render(std::chrono::seconds(-1)) {
+      m_pacer(TimePoint::Milliseconds(15)),
+      m_timers(TimePoint::Milliseconds(1)) {
   // 开启日志
   log::LogManager::EnableEngineLogger();
   init_module();
+  init_metrics();
 }
 
 Engine::~Engine() {
@@ -60,6 +64,51 @@ void Engine::init_module() {
     }
     if (!postponed) break;
   }
+
+  // 按阶段与模块id的顺序交给调度器,同一阶段内冲突的模块按这个顺序更新
+  for (auto &[stage_idx, module] : m_modules) {
+    m_scheduler.add(stage_idx.first, module.get(),
+                    Module::Registry().at(stage_idx.second));
+  }
+}
+
+void Engine::init_metrics() {
+  auto registry = metrics::Registry::Self();
+  m_metrics.frames =
+      registry->counter("cx_engine_frames_total", "Frame loop iterations");
+  m_metrics.ups = registry->gauge("cx_engine_ups", "Updates per second");
+  m_metrics.fps = registry->gauge("cx_engine_fps", "Frames rendered per second");
+  m_metrics.frame_seconds = registry->gauge(
+      "cx_engine_frame_seconds", "Duration of the last frame loop iteration");
+  m_metrics.timers =
+      registry->gauge("cx_engine_timers", "Pending frame loop timers");
+  m_metrics.jitter = registry->gauge(
+      "cx_engine_frame_jitter_seconds",
+      "Moving average of the render interval deviation from its target");
+  m_metrics.jitter_max = registry->gauge(
+      "cx_engine_frame_jitter_max_seconds",
+      "Largest render interval deviation in the last full second");
+  m_metrics.dropped_steps = registry->counter(
+      "cx_engine_dropped_steps_total",
+      "Fixed update steps dropped beyond the catch-up limit");
+}
+
+void Engine::publish_metrics(const TimePoint &now) {
+  m_metrics.frames->inc();
+  m_metrics.ups->set(m_ups.m_value);
+  m_metrics.fps->set(m_fps.m_value);
+  if (m_last_frame.AsMicroseconds() > 0) {
+    m_metrics.frame_seconds->set((now - m_last_frame).AsMicroseconds() / 1e6);
+  }
+  m_metrics.timers->set((double)m_timers.size());
+  const auto &stats = m_pacer.stats();
+  m_metrics.jitter->set(stats.mean_jitter.AsMicroseconds() / 1e6);
+  m_metrics.jitter_max->set(stats.max_jitter.AsMicroseconds() / 1e6);
+  if (stats.dropped_steps != m_dropped_steps) {
+    m_metrics.dropped_steps->inc(stats.dropped_steps - m_dropped_steps);
+    m_dropped_steps = stats.dropped_steps;
+  }
+  m_last_frame = now;
 }
 
 void Engine::load(App *app) {
@@ -76,8 +125,16 @@ void Engine::load(App *app) {
   m_app = app;
 }
 
+void Engine::set_fps_limit(float fps_limit) {
+  m_fps_limit = fps_limit;
+  m_pacer.set_render_interval(fps_limit > 0
+                                  ? TimePoint::Seconds(1.0f / fps_limit)
+                                  : TimePoint::Seconds(-1));
+}
+
 void Engine::run() {
   Window::ptr window = Window::Get();
+  m_pacer.reset(TimePoint::Now());
   while (m_running) {
     // 如果窗口关闭 则退出
     if (window->closed()) {
@@ -85,6 +142,10 @@ void Engine::run() {
       continue;
     }
 
+    TimePoint now = TimePoint::Now();
+    m_timers.advance(now);
+    publish_metrics(now);
+
     if (m_app) {
       if (!m_app->is_running()) {
         m_app->run();
@@ -92,35 +153,32 @@ void Engine::run() {
       m_app->update();
     }
 
-    window->update();
-  }
-
-  m_elapse_render.set_interval(TimePoint::Seconds(1.0f / m_fps_limit));
+    stage_verdict(Module::Stage::eInvariably);
 
-  stage_verdict(Module::Stage::eInvariably);
-  if (m_elapse_update.elpased() != 0) {
-    m_ups.update(TimePoint::Now());
+    // 按固定步长推进模拟,落后时一帧内连续执行多步
+    uint32_t steps = m_pacer.advance(now);
+    for (uint32_t i = 0; i < steps; ++i) {
+      m_ups.update(TimePoint::Now());
 
-    stage_verdict(Module::Stage::ePre);
-    stage_verdict(Module::Stage::eNormal);
-    stage_verdict(Module::Stage::ePost);
+      stage_verdict(Module::Stage::ePre);
+      stage_verdict(Module::Stage::eNormal);
+      stage_verdict(Module::Stage::ePost);
+    }
 
-    m_delat_update.update();
-  }
+    if (m_pacer.render(TimePoint::Now(), steps > 0)) {
+      m_fps.update(TimePoint::Now());
+      stage_verdict(Module::Stage::eRender);
+      m_delat_render.update();
+    }
 
-  if (m_elapse_render.elpased() != 0) {
-    m_fps.update(TimePoint::Now());
-    stage_verdict(Module::Stage::eRender);
-    m_delat_render.update();
+    window->update();
+    // 睡眠到下一次模拟或渲染的期限,不空转占满一个核
+    m_pacer.wait();
   }
 }
 
 void Engine::stop() { m_running = false; }
 
-void Engine::stage_verdict(Module::Stage stage) {
-  for (auto &[stage_idx, module] : m_modules) {
-    if (stage_idx.first == stage) module->update();
-  }
-}
+void Engine::stage_verdict(Module::Stage stage) { m_scheduler.run(stage); }
 
 }  // namespace cx
\ No newline at end of file
@@ -16,9 +16,12 @@
 #include "cx/common/noncopyable.h"
 #include "cx/common/singleton.h"
 #include "cx/engine/application.h"
+#include "cx/engine/module_scheduler.h"
 #include "cx/engine/version.h"
+#include "cx/utils/metrics/metrics.h"
 #include "cx/utils/time/delta.h"
-#include "cx/utils/time/elapsed_time.h"
+#include "cx/utils/time/frame_pacer.h"
+#include "cx/utils/time/timing_wheel.h"
 
 namespace cx {
 
@@ -50,9 +53,33 @@ class Engine : public Noncopyable, public SingletonPtr<Engine> {
   const Version& version() const { return m_version; }
 
   float fps_limit() const { return m_fps_limit; }
-  void set_fps_limit(float fps_limit) { m_fps_limit = fps_limit; }
 
-  const time::TimePoint delta() const { return m_delat_update.m_change; }
+  /**
+   * @brief 设置渲染帧率的上限
+   *
+   * @param fps_limit 帧率,不大于0时不单独限制,每次模拟推进后渲染一次
+   */
+  void set_fps_limit(float fps_limit);
+
+  /**
+   * @brief 模拟的固定步长,ePre,eNormal,ePost阶段的模块每步更新一次
+   *
+   */
+  const time::TimePoint& fixed_step() const { return m_pacer.step(); }
+  void set_fixed_step(const time::TimePoint& step) { m_pacer.set_step(step); }
+
+  /**
+   * @brief 一帧最多追赶的模拟步数,卡顿后超出的步数被丢弃
+   *
+   */
+  uint32_t max_catch_up() const { return m_pacer.max_steps(); }
+  void set_max_catch_up(uint32_t steps) { m_pacer.set_max_steps(steps); }
+
+  /**
+   * @brief 模拟更新的时间间隔,即固定步长
+   *
+   */
+  const time::TimePoint delta() const { return m_pacer.step(); }
 
   const time::TimePoint delta_render() const { return m_delat_render.m_change; }
 
@@ -60,9 +87,39 @@ class Engine : public Noncopyable, public SingletonPtr<Engine> {
 
   uint32_t fps() const { return m_fps.m_value; }
 
+  /**
+   * @brief 渲染时在上一次与下一次模拟状态之间插值的比例
+   *
+   * @return float 0~1
+   */
+  float alpha() const { return m_pacer.alpha(); }
+
+  /**
+   * @brief 帧时间的抖动与丢弃的模拟步数
+   *
+   */
+  const time::FramePacer::Stats& frame_stats() const { return m_pacer.stats(); }
+
+  /**
+   * @brief 并行更新模块的工作线程数量,默认为cpu核心数减一
+   *
+   * @param threads 线程数量,0为所有模块都在主线程中更新
+   */
+  void set_module_threads(size_t threads) { m_scheduler.set_threads(threads); }
+  size_t module_threads() const { return m_scheduler.threads(); }
+
+  /**
+   * @brief 帧循环的定时器,每帧推进一次,只能在主线程中使用
+   *
+   * @return 时间轮
+   */
+  time::TimingWheel& timers() { return m_timers; }
+
  private:
   Engine();
   void init_module();
+  void init_metrics();
+  void publish_metrics(const time::TimePoint& now);
   void stage_verdict(Module::Stage stage);
 
  private:
@@ -72,16 +129,34 @@ class Engine : public Noncopyable, public SingletonPtr<Engine> {
   Version m_version;
 
   std::multimap<StageInfo, std::unique_ptr<Module>> m_modules;
+  ModuleScheduler m_scheduler;
   bool m_running;
 
   float m_fps_limit;
 
-  time::Delta m_delat_update;
   time::Delta m_delat_render;
-  time::ElapsedTime m_elapse_update;
-  time::ElapsedTime m_elapse_render;
+  time::FramePacer m_pacer;
   time::ChangePerSecond m_ups;
   time::ChangePerSecond m_fps;
+  time::TimingWheel m_timers;
+
+  /**
+   * @brief 帧循环的指标,每帧只做几次原子写入,由指标服务在其他线程中读取
+   */
+  struct Metrics {
+    metrics::Counter::ptr frames;
+    metrics::Gauge::ptr ups;
+    metrics::Gauge::ptr fps;
+    metrics::Gauge::ptr frame_seconds;
+    metrics::Gauge::ptr timers;
+    metrics::Gauge::ptr jitter;
+    metrics::Gauge::ptr jitter_max;
+    metrics::Counter::ptr dropped_steps;
+  };
+
+  Metrics m_metrics;
+  time::TimePoint m_last_frame;
+  uint64_t m_dropped_steps = 0;  // 已经计入指标的丢弃步数
 };
 
 }  // namespace cx
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "module_scheduler.h"
+
+#include <algorithm>
+
+namespace cx {
+
+static bool Intersect(const std::vector<std::type_index>& lhs,
+                      const std::vector<std::type_index>& rhs) {
+  for (const auto& type : lhs) {
+    if (std::find(rhs.begin(), rhs.end(), type) != rhs.end()) return true;
+  }
+  return false;
+}
+
+ModuleScheduler::ModuleScheduler(size_t threads) { set_threads(threads); }
+
+ModuleScheduler::~ModuleScheduler() {
+  if (m_pool) m_pool->stop();
+}
+
+void ModuleScheduler::set_threads(size_t threads) {
+  if (m_pool) {
+    m_pool->stop();
+    m_pool.reset();
+  }
+  if (threads == 0) return;
+  m_pool = std::make_unique<thread::ThreadPool>("module", threads);
+  m_pool->start();
+}
+
+bool ModuleScheduler::Conflict(const Node& before, const Node& after) {
+  return Intersect(before.writes, after.reads) ||
+         Intersect(before.writes, after.writes) ||
+         Intersect(before.reads, after.writes);
+}
+
+void ModuleScheduler::add(Module::Stage stage, Module* module,
+                          const Module::TypeAttr& attr) {
+  Graph& graph = m_graphs[(size_t)stage];
+  uint32_t index = (uint32_t)graph.nodes.size();
+  graph.nodes.emplace_back();
+  Node& node = graph.nodes.back();
+  node.module = module;
+  node.reads = attr.reads;
+  node.writes = attr.writes;
+
+  if (!attr.concurrent) {
+    graph.batches.emplace_back(index, index + 1, false, 1);
+    return;
+  }
+  if (graph.batches.empty() || !graph.batches.back().concurrent) {
+    graph.batches.emplace_back(index, index, true, 0);
+  }
+
+  Batch& batch = graph.batches.back();
+  for (uint32_t i = batch.begin; i < index; ++i) {
+    Node& before = graph.nodes[i];
+    if (!Conflict(before, node)) continue;
+    before.next.push_back(index);
+    ++node.deps;
+    node.depth = std::max(node.depth, before.depth + 1);
+  }
+  batch.end = index + 1;
+  batch.depth = std::max(batch.depth, node.depth);
+}
+
+void ModuleScheduler::run(Module::Stage stage) {
+  Graph& graph = m_graphs[(size_t)stage];
+  for (const auto& batch : graph.batches) {
+    // 串行的批,或者依赖链与模块数量一样长时没有可以并行的模块
+    if (!m_pool || !batch.concurrent ||
+        batch.depth == batch.end - batch.begin) {
+      for (uint32_t i = batch.begin; i < batch.end; ++i) {
+        graph.nodes[i].module->update();
+      }
+      continue;
+    }
+    run_batch(graph, batch);
+  }
+}
+
+ModuleScheduler::Stats ModuleScheduler::stats(Module::Stage stage) const {
+  const Graph& graph = m_graphs[(size_t)stage];
+  Stats stats;
+  stats.modules = graph.nodes.size();
+  stats.batches = graph.batches.size();
+  for (const auto& batch : graph.batches) {
+    stats.depth += batch.depth;
+  }
+  return stats;
+}
+
+void ModuleScheduler::run_batch(Graph& graph, const Batch& batch) {
+  Execution& exec = m_execution;
+  size_t helpers = std::min<size_t>(m_pool->threads(),
+                                    batch.end - batch.begin - 1);
+  {
+    std::lock_guard<std::mutex> lock(exec.mutex);
+    exec.graph = &graph;
+    exec.remaining.resize(graph.nodes.size());
+    exec.ready.clear();
+    // 逆序放入,先取出加入较早的模块
+    for (uint32_t i = batch.end; i-- > batch.begin;) {
+      exec.remaining[i] = graph.nodes[i].deps;
+      if (graph.nodes[i].deps == 0) exec.ready.push_back(i);
+    }
+    exec.done = 0;
+    exec.total = batch.end - batch.begin;
+    exec.helpers = helpers;
+    exec.error = nullptr;
+  }
+
+  for (size_t i = 0; i < helpers; ++i) {
+    bool submitted = m_pool->submit([this]() {
+      drain();
+      std::lock_guard<std::mutex> lock(m_execution.mutex);
+      if (--m_execution.helpers == 0) m_execution.cond.notify_all();
+    });
+    if (!submitted) {
+      std::lock_guard<std::mutex> lock(exec.mutex);
+      --exec.helpers;
+    }
+  }
+
+  drain();
+
+  // 工作线程的任务退出后才能开始下一批或抛出异常
+  std::unique_lock<std::mutex> lock(exec.mutex);
+  exec.cond.wait(lock, [&exec]() { return exec.helpers == 0; });
+  if (exec.error) {
+    std::exception_ptr error;
+    error.swap(exec.error);
+    lock.unlock();
+    std::rethrow_exception(error);
+  }
+}
+
+void ModuleScheduler::drain() {
+  Execution& exec = m_execution;
+  std::unique_lock<std::mutex> lock(exec.mutex);
+  for (;;) {
+    exec.cond.wait(lock, [&exec]() {
+      return !exec.ready.empty() || exec.done == exec.total || exec.error;
+    });
+    if (exec.done == exec.total || exec.error) return;
+
+    uint32_t index = exec.ready.back();
+    exec.ready.pop_back();
+    Node& node = exec.graph->nodes[index];
+
+    lock.unlock();
+    try {
+      node.module->update();
+    } catch (...) {
+      // 工作线程中的异常会终止进程,保存下来由run_batch在调用线程中抛出
+      lock.lock();
+      if (!exec.error) exec.error = std::current_exception();
+      exec.cond.notify_all();
+      return;
+    }
+    lock.lock();
+
+    ++exec.done;
+    size_t released = 0;
+    for (uint32_t next : node.next) {
+      if (--exec.remaining[next] == 0) {
+        exec.ready.push_back(next);
+        ++released;
+      }
+    }
+    // 唤醒等待新任务或等待完成的线程,自己会继续取一个
+    if (exec.done == exec.total || released > 1) {
+      exec.cond.notify_all();
+    }
+  }
+}
+
+}  // namespace cx
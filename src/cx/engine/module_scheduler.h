@@ -0,0 +1,138 @@
+/**
+ * @file module_scheduler.h
+ * @brief 按读写依赖并行更新模块
+ */
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "cx/common/internal.h"
+#include "cx/common/module.h"
+#include "cx/common/noncopyable.h"
+#include "cx/utils/thread/thread_pool.h"
+
+namespace cx {
+
+/**
+ * @brief 模块调度器
+ *
+ * 每个阶段的模块按加入的顺序分成若干批:未声明资源的模块单独成批,在调用run的
+ * 线程中更新;相邻的声明过资源的模块组成一批,批内访问冲突(一方写入另一方读取
+ * 或写入的资源)的模块按加入顺序连边,构成有向无环图,由工作线程与调用线程一起
+ * 按拓扑顺序并行更新。批与批之间,阶段与阶段之间仍然串行,一个阶段的耗时趋近于
+ * 各批关键路径之和
+ *
+ * 只能在一个线程中加入模块与调用run
+ *
+ */
+class ModuleScheduler : public Noncopyable {
+ public:
+  /**
+   * @brief 一个阶段的调度信息
+   *
+   */
+  struct Stats {
+    size_t modules = 0;  // 模块数量
+    size_t batches = 0;  // 串行执行的批数
+    size_t depth = 0;    // 各批最长依赖链的长度之和
+  };
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] threads 工作线程数量,0为只在调用线程中串行更新
+   */
+  explicit ModuleScheduler(size_t threads = 0);
+  ~ModuleScheduler();
+
+  /**
+   * @brief 设置工作线程数量,不能在run的过程中调用
+   *
+   * @param[in] threads 工作线程数量,0为只在调用线程中串行更新
+   */
+  void set_threads(size_t threads);
+  size_t threads() const { return m_pool ? m_pool->threads() : 0; }
+
+  /**
+   * @brief 加入模块,同一阶段内先加入的模块在冲突时先更新
+   *
+   * @param[in] stage  模块所在阶段
+   * @param[in] module 模块
+   * @param[in] attr   模块注册时的信息
+   */
+  void add(Module::Stage stage, Module* module, const Module::TypeAttr& attr);
+
+  /**
+   * @brief 更新一个阶段的所有模块,全部完成后返回
+   *
+   * 模块抛出异常时,并行的批不再开始新的模块,等正在更新的模块结束后在调用
+   * 线程中重新抛出,后面的批不再执行
+   *
+   */
+  void run(Module::Stage stage);
+
+  Stats stats(Module::Stage stage) const;
+
+ private:
+  struct Node {
+    Module* module = nullptr;
+    std::vector<std::type_index> reads;
+    std::vector<std::type_index> writes;
+    std::vector<uint32_t> next;  // 必须在该模块之后更新的模块
+    uint32_t deps = 0;           // 必须在该模块之前更新的模块数量
+    uint32_t depth = 1;          // 批内以该模块结尾的最长依赖链
+  };
+
+  /**
+   * @brief 连续的一批模块[begin, end)
+   *
+   */
+  struct Batch {
+    Batch(uint32_t begin, uint32_t end, bool concurrent, uint32_t depth)
+        : begin(begin), end(end), concurrent(concurrent), depth(depth) {}
+
+    uint32_t begin;
+    uint32_t end;
+    bool concurrent;
+    uint32_t depth;
+  };
+
+  struct Graph {
+    std::vector<Node> nodes;
+    std::vector<Batch> batches;
+  };
+
+  /**
+   * @brief 正在并行执行的一批的状态
+   *
+   */
+  struct Execution {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<uint32_t> ready;
+    std::vector<uint32_t> remaining;
+    size_t done = 0;
+    size_t total = 0;
+    size_t helpers = 0;  // 尚未退出的工作线程任务
+    Graph* graph = nullptr;
+    std::exception_ptr error;  // 批内第一个抛出的异常
+  };
+
+  CX_STATIC_CONSTEXPR size_t STAGE_COUNT = (size_t)Module::Stage::eRender + 1;
+
+  CX_STATIC bool Conflict(const Node& before, const Node& after);
+
+  void run_batch(Graph& graph, const Batch& batch);
+  void drain();
+
+ private:
+  Graph m_graphs[STAGE_COUNT];
+  std::unique_ptr<thread::ThreadPool> m_pool;
+  Execution m_execution;
+};
+
+}  // namespace cx
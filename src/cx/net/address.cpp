@@ -42,6 +42,13 @@ Address::ptr Address::Generate(const sockaddr* address, socklen_t addrlen) {
     case AF_INET6:
       result.reset(new IPv6Address(*(const sockaddr_in6*)address));
       break;
+    case AF_UNIX: {
+      UnixAddress::ptr addr(new UnixAddress);
+      memcpy(const_cast<sockaddr*>(addr->address()), address,
+             std::min(addrlen, (socklen_t)sizeof(sockaddr_un)));
+      addr->set_address_len(addrlen);
+      result = addr;
+    } break;
     default:
       result.reset(new UnkonwAddress(*address));
       break;
@@ -428,7 +435,7 @@ UnixAddress::UnixAddress(const std::string& path) {
     --m_len;
   }
 
-  if (m_len <= sizeof(m_addr.sun_path)) {
+  if (m_len > sizeof(m_addr.sun_path)) {
     throw std::logic_error("path too long");
   }
   memcpy(&m_addr.sun_path, path.c_str(), m_len);
@@ -0,0 +1,50 @@
+#include "bit_stream.h"
+
+namespace cx::net {
+
+static const uint32_t VARINT_BITS[4] = {4, 8, 16, 32};
+
+void BitWriter::write_varint(uint32_t value) {
+  uint32_t selector = value < (1u << 4) ? 0 : value < (1u << 8) ? 1
+                      : value < (1u << 16) ? 2 : 3;
+  write(selector, 2);
+  write(value, VARINT_BITS[selector]);
+}
+
+void BitWriter::flush() {
+  while (m_bits >= 8) {
+    m_bits -= 8;
+    m_out.write_fuint8((uint8_t)(m_scratch >> m_bits));
+  }
+  if (m_bits > 0) {
+    m_out.write_fuint8((uint8_t)(m_scratch << (8 - m_bits)));
+    m_total += 8 - m_bits;
+  }
+  m_scratch = 0;
+  m_bits = 0;
+}
+
+uint32_t BitReader::read_varint() {
+  return read(VARINT_BITS[read(2)]);
+}
+
+bool BitReader::refill(uint32_t bits) {
+  // 缓存中的位不超过31,补充一个字后不会溢出
+  while (m_bits < bits) {
+    if (m_remain >= 4) {
+      m_scratch = (m_scratch << 32) | m_in.read_fuint32();
+      m_bits += 32;
+      m_remain -= 4;
+    } else if (m_remain > 0) {
+      m_scratch = (m_scratch << 8) | m_in.read_fuint8();
+      m_bits += 8;
+      m_remain -= 1;
+    } else {
+      m_error = true;
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace cx::net
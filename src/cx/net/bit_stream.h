@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+
+#include "cx/common/internal.h"
+#include "cx/net/byte_array.h"
+
+namespace cx::net {
+
+/**
+ * @brief 按位写入ByteArray,高位在前
+ *
+ * 位先累积在64位的缓存中,满32位时写出一个字;写完后必须调用flush写出
+ * 剩余的位。输出是高位在前的字节流,ByteArray需要使用默认的网络字节序
+ */
+class BitWriter {
+ public:
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] out 输出,数据追加到末尾
+   */
+  BitWriter(ByteArray& out) : m_out(out), m_scratch(0), m_bits(0), m_total(0) {}
+
+  /**
+   * @brief 写入value的低bits位
+   *
+   * @param[in] value 值,高于bits的位必须为0
+   * @param[in] bits  位数,0到32
+   */
+  CX_INLINE void write(uint32_t value, uint32_t bits) {
+    m_scratch = (m_scratch << bits) | value;
+    m_bits += bits;
+    m_total += bits;
+    if (m_bits >= 32) {
+      m_bits -= 32;
+      m_out.write_fuint32((uint32_t)(m_scratch >> m_bits));
+      m_scratch &= (1ull << m_bits) - 1;
+    }
+  }
+
+  CX_INLINE void write_bool(bool value) { write(value ? 1 : 0, 1); }
+
+  /**
+   * @brief 写入变长整数:2位选择4/8/16/32位宽,适合大多数很小的值
+   */
+  void write_varint(uint32_t value);
+
+  /**
+   * @brief 写出缓存中剩余的位,不足一个字节的部分补0
+   */
+  void flush();
+
+  /**
+   * @brief 已写入的位数
+   */
+  uint64_t bits() const { return m_total; }
+
+ private:
+  ByteArray& m_out;
+  uint64_t m_scratch;
+  uint32_t m_bits;
+  uint64_t m_total;
+};
+
+/**
+ * @brief 按位读取BitWriter写出的数据
+ *
+ * 数据不足时返回0并设置错误标志,不抛出异常
+ */
+class BitReader {
+ public:
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] in    输入,从读位置开始
+   * @param[in] bytes 最多读取的字节数
+   */
+  BitReader(ByteArray& in, size_t bytes)
+      : m_in(in), m_remain(bytes), m_scratch(0), m_bits(0), m_error(false) {}
+
+  /**
+   * @brief 读取bits位
+   *
+   * @param[in] bits 位数,0到32
+   */
+  CX_INLINE uint32_t read(uint32_t bits) {
+    if (m_bits < bits && !refill(bits)) {
+      return 0;
+    }
+    m_bits -= bits;
+    return (uint32_t)(m_scratch >> m_bits) & (uint32_t)((1ull << bits) - 1);
+  }
+
+  CX_INLINE bool read_bool() { return read(1) != 0; }
+
+  uint32_t read_varint();
+
+  /**
+   * @brief 是否读取过超出数据末尾的位
+   */
+  bool error() const { return m_error; }
+
+ private:
+  bool refill(uint32_t bits);
+
+ private:
+  ByteArray& m_in;
+  size_t m_remain;
+  uint64_t m_scratch;
+  uint32_t m_bits;
+  bool m_error;
+};
+
+}  // namespace cx::net
@@ -0,0 +1,581 @@
+#include "byte_array.h"
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace cx::net {
+
+namespace {
+
+// 每个线程、每种块大小最多缓存的空闲内存块数量
+static const size_t MAX_FREE_NODES = 256;
+
+/**
+ * @brief 线程局部的内存块空闲链表,按块大小分组
+ */
+struct NodeFreeList {
+  ~NodeFreeList() {
+    for (auto& [size, nodes] : lists) {
+      for (auto node : nodes) {
+        delete[](char*) node;
+      }
+    }
+  }
+
+  std::unordered_map<size_t, std::vector<ByteArray::Node*>> lists;
+};
+
+static thread_local NodeFreeList t_free_list;
+
+}  // namespace
+
+ByteArray::Node* ByteArray::Node::Alloc(size_t size) {
+  auto& nodes = t_free_list.lists[size];
+  if (!nodes.empty()) {
+    Node* node = nodes.back();
+    nodes.pop_back();
+    node->next = nullptr;
+    return node;
+  }
+
+  char* mem = new char[sizeof(Node) + size];
+  Node* node = (Node*)mem;
+  node->ptr = mem + sizeof(Node);
+  node->next = nullptr;
+  node->size = size;
+  return node;
+}
+
+void ByteArray::Node::Free(Node* node) {
+  auto& nodes = t_free_list.lists[node->size];
+  if (nodes.size() < MAX_FREE_NODES) {
+    nodes.push_back(node);
+    return;
+  }
+  delete[](char*) node;
+}
+
+ByteArray::ByteArray(size_t base_size)
+    : m_base_size(base_size),
+      m_position(0),
+      m_capacity(base_size),
+      m_size(0),
+      m_endian(CX_BIG_ENDIAN),
+      m_root(Node::Alloc(base_size)),
+      m_tail(m_root),
+      m_read(m_root),
+      m_write(m_root) {}
+
+ByteArray::~ByteArray() {
+  Node* node = m_root;
+  while (node) {
+    Node* next = node->next;
+    Node::Free(node);
+    node = next;
+  }
+}
+
+void ByteArray::write_fint8(int8_t value) { write(&value, sizeof(value)); }
+
+void ByteArray::write_fuint8(uint8_t value) { write(&value, sizeof(value)); }
+
+void ByteArray::write_fint16(int16_t value) { write_fuint16(value); }
+
+void ByteArray::write_fuint16(uint16_t value) {
+  value = swap_order(value);
+  write(&value, sizeof(value));
+}
+
+void ByteArray::write_fint32(int32_t value) { write_fuint32(value); }
+
+void ByteArray::write_fuint32(uint32_t value) {
+  value = swap_order(value);
+  write(&value, sizeof(value));
+}
+
+void ByteArray::write_fint64(int64_t value) { write_fuint64(value); }
+
+void ByteArray::write_fuint64(uint64_t value) {
+  value = swap_order(value);
+  write(&value, sizeof(value));
+}
+
+static uint32_t EncodeZigzag32(int32_t v) {
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static uint64_t EncodeZigzag64(int64_t v) {
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int32_t DecodeZigzag32(uint32_t v) {
+  return (int32_t)((v >> 1) ^ (~(v & 1) + 1));
+}
+
+static int64_t DecodeZigzag64(uint64_t v) {
+  return (int64_t)((v >> 1) ^ (~(v & 1) + 1));
+}
+
+void ByteArray::write_int32(int32_t value) {
+  write_uint32(EncodeZigzag32(value));
+}
+
+void ByteArray::write_uint32(uint32_t value) {
+  uint8_t tmp[5];
+  uint8_t i = 0;
+  while (value >= 0x80) {
+    tmp[i++] = (value & 0x7f) | 0x80;
+    value >>= 7;
+  }
+  tmp[i++] = value;
+  write(tmp, i);
+}
+
+void ByteArray::write_int64(int64_t value) {
+  write_uint64(EncodeZigzag64(value));
+}
+
+void ByteArray::write_uint64(uint64_t value) {
+  uint8_t tmp[10];
+  uint8_t i = 0;
+  while (value >= 0x80) {
+    tmp[i++] = (value & 0x7f) | 0x80;
+    value >>= 7;
+  }
+  tmp[i++] = value;
+  write(tmp, i);
+}
+
+void ByteArray::write_float(float value) {
+  uint32_t v;
+  memcpy(&v, &value, sizeof(value));
+  write_fuint32(v);
+}
+
+void ByteArray::write_double(double value) {
+  uint64_t v;
+  memcpy(&v, &value, sizeof(value));
+  write_fuint64(v);
+}
+
+void ByteArray::write_string_f16(const std::string& value) {
+  write_fuint16(value.size());
+  write(value.c_str(), value.size());
+}
+
+void ByteArray::write_string_f32(const std::string& value) {
+  write_fuint32(value.size());
+  write(value.c_str(), value.size());
+}
+
+void ByteArray::write_string_f64(const std::string& value) {
+  write_fuint64(value.size());
+  write(value.c_str(), value.size());
+}
+
+void ByteArray::write_string_vint(const std::string& value) {
+  write_uint64(value.size());
+  write(value.c_str(), value.size());
+}
+
+void ByteArray::write_string_without_length(const std::string& value) {
+  write(value.c_str(), value.size());
+}
+
+int8_t ByteArray::read_fint8() {
+  int8_t v;
+  read(&v, sizeof(v));
+  return v;
+}
+
+uint8_t ByteArray::read_fuint8() {
+  uint8_t v;
+  read(&v, sizeof(v));
+  return v;
+}
+
+int16_t ByteArray::read_fint16() { return (int16_t)read_fuint16(); }
+
+uint16_t ByteArray::read_fuint16() {
+  uint16_t v;
+  read(&v, sizeof(v));
+  return swap_order(v);
+}
+
+int32_t ByteArray::read_fint32() { return (int32_t)read_fuint32(); }
+
+uint32_t ByteArray::read_fuint32() {
+  uint32_t v;
+  read(&v, sizeof(v));
+  return swap_order(v);
+}
+
+int64_t ByteArray::read_fint64() { return (int64_t)read_fuint64(); }
+
+uint64_t ByteArray::read_fuint64() {
+  uint64_t v;
+  read(&v, sizeof(v));
+  return swap_order(v);
+}
+
+int32_t ByteArray::read_int32() { return DecodeZigzag32(read_uint32()); }
+
+uint32_t ByteArray::read_uint32() {
+  uint32_t result = 0;
+  for (int i = 0; i < 32; i += 7) {
+    uint8_t b = read_fuint8();
+    if (b < 0x80) {
+      result |= ((uint32_t)b) << i;
+      break;
+    }
+    result |= (((uint32_t)(b & 0x7f)) << i);
+  }
+  return result;
+}
+
+int64_t ByteArray::read_int64() { return DecodeZigzag64(read_uint64()); }
+
+uint64_t ByteArray::read_uint64() {
+  uint64_t result = 0;
+  for (int i = 0; i < 64; i += 7) {
+    uint8_t b = read_fuint8();
+    if (b < 0x80) {
+      result |= ((uint64_t)b) << i;
+      break;
+    }
+    result |= (((uint64_t)(b & 0x7f)) << i);
+  }
+  return result;
+}
+
+float ByteArray::read_float() {
+  uint32_t v = read_fuint32();
+  float value;
+  memcpy(&value, &v, sizeof(v));
+  return value;
+}
+
+double ByteArray::read_double() {
+  uint64_t v = read_fuint64();
+  double value;
+  memcpy(&value, &v, sizeof(v));
+  return value;
+}
+
+/**
+ * @brief 读取长度为len的字符串,长度来自对端,分配之前先检查可读数据是否足够
+ */
+static std::string ReadString(ByteArray& ba, uint64_t len) {
+  if (len > ba.read_size()) {
+    throw std::out_of_range("not enough len");
+  }
+  std::string buf;
+  buf.resize(len);
+  ba.read(&buf[0], len);
+  return buf;
+}
+
+std::string ByteArray::read_string_f16() {
+  return ReadString(*this, read_fuint16());
+}
+
+std::string ByteArray::read_string_f32() {
+  return ReadString(*this, read_fuint32());
+}
+
+std::string ByteArray::read_string_f64() {
+  return ReadString(*this, read_fuint64());
+}
+
+std::string ByteArray::read_string_vint() {
+  return ReadString(*this, read_uint64());
+}
+
+void ByteArray::clear() {
+  m_position = m_size = 0;
+  m_capacity = m_base_size;
+
+  Node* node = m_root->next;
+  while (node) {
+    Node* next = node->next;
+    Node::Free(node);
+    node = next;
+  }
+  m_root->next = nullptr;
+  m_tail = m_read = m_write = m_root;
+}
+
+void ByteArray::write(const void* buf, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  add_capacity(size);
+
+  size_t npos = m_size % m_base_size;
+  size_t bpos = 0;
+  while (size > 0) {
+    size_t ncap = m_write->size - npos;
+    size_t len = std::min(ncap, size);
+    memcpy(m_write->ptr + npos, (const char*)buf + bpos, len);
+    m_size += len;
+    bpos += len;
+    size -= len;
+    if (len == ncap) {
+      m_write = m_write->next;
+    }
+    npos = 0;
+  }
+}
+
+void ByteArray::read(void* buf, size_t size) {
+  if (size > read_size()) {
+    throw std::out_of_range("not enough len");
+  }
+
+  size_t npos = m_position % m_base_size;
+  size_t bpos = 0;
+  while (size > 0) {
+    size_t ncap = m_read->size - npos;
+    size_t len = std::min(ncap, size);
+    memcpy((char*)buf + bpos, m_read->ptr + npos, len);
+    m_position += len;
+    bpos += len;
+    size -= len;
+    if (len == ncap) {
+      m_read = m_read->next;
+    }
+    npos = 0;
+  }
+}
+
+void ByteArray::read(void* buf, size_t size, size_t position) const {
+  if (position > m_size || size > m_size - position) {
+    throw std::out_of_range("not enough len");
+  }
+
+  size_t npos = 0;
+  Node* cur = locate(position, npos);
+  size_t bpos = 0;
+  while (size > 0) {
+    size_t len = std::min(cur->size - npos, size);
+    memcpy((char*)buf + bpos, cur->ptr + npos, len);
+    bpos += len;
+    size -= len;
+    cur = cur->next;
+    npos = 0;
+  }
+}
+
+void ByteArray::set_position(size_t position) {
+  if (position > m_size) {
+    throw std::out_of_range("set_position out of range");
+  }
+  size_t offset = 0;
+  m_position = position;
+  m_read = locate(position, offset);
+}
+
+void ByteArray::compact() {
+  if (m_position == m_size) {
+    clear();
+    return;
+  }
+
+  size_t count = m_position / m_base_size;
+  for (size_t i = 0; i < count; ++i) {
+    Node* next = m_root->next;
+    Node::Free(m_root);
+    m_root = next;
+  }
+
+  size_t len = count * m_base_size;
+  m_position -= len;
+  m_size -= len;
+  m_capacity -= len;
+}
+
+bool ByteArray::write_to_file(const std::string& name) const {
+  std::ofstream ofs;
+  ofs.open(name, std::ios::trunc | std::ios::binary);
+  if (!ofs) {
+    return false;
+  }
+
+  std::vector<iovec> buffers;
+  get_read_iovecs(buffers);
+  for (auto& buf : buffers) {
+    ofs.write((const char*)buf.iov_base, buf.iov_len);
+  }
+  return (bool)ofs;
+}
+
+bool ByteArray::read_from_file(const std::string& name) {
+  std::ifstream ifs;
+  ifs.open(name, std::ios::binary);
+  if (!ifs) {
+    return false;
+  }
+
+  std::vector<iovec> buffers;
+  while (!ifs.eof()) {
+    buffers.clear();
+    get_write_iovecs(buffers, m_base_size);
+    size_t total = 0;
+    for (auto& buf : buffers) {
+      ifs.read((char*)buf.iov_base, buf.iov_len);
+      total += ifs.gcount();
+      if (!ifs) {
+        break;
+      }
+    }
+    commit_write(total);
+  }
+  return true;
+}
+
+void ByteArray::set_is_little_endian(bool val) {
+  m_endian = val ? CX_LITTLE_ENDIAN : CX_BIG_ENDIAN;
+}
+
+std::string ByteArray::to_string() const {
+  std::string str;
+  str.resize(read_size());
+  if (str.empty()) {
+    return str;
+  }
+  read(&str[0], str.size(), m_position);
+  return str;
+}
+
+std::string ByteArray::to_hex_string() const {
+  std::string str = to_string();
+  std::stringstream ss;
+
+  for (size_t i = 0; i < str.size(); ++i) {
+    if (i > 0 && i % 32 == 0) {
+      ss << std::endl;
+    }
+    ss << std::setw(2) << std::setfill('0') << std::hex << (int)(uint8_t)str[i]
+       << " ";
+  }
+
+  return ss.str();
+}
+
+uint64_t ByteArray::get_read_iovecs(std::vector<iovec>& buffers,
+                                    uint64_t len) const {
+  return get_read_iovecs(buffers, len, m_position);
+}
+
+uint64_t ByteArray::get_read_iovecs(std::vector<iovec>& buffers, uint64_t len,
+                                    uint64_t position) const {
+  if (position > m_size) {
+    return 0;
+  }
+  len = std::min<uint64_t>(len, m_size - position);
+  if (len == 0) {
+    return 0;
+  }
+
+  uint64_t size = len;
+  size_t npos = 0;
+  Node* cur = locate(position, npos);
+  while (len > 0) {
+    iovec iov;
+    size_t ncap = cur->size - npos;
+    iov.iov_base = cur->ptr + npos;
+    iov.iov_len = std::min<uint64_t>(ncap, len);
+    len -= iov.iov_len;
+    buffers.push_back(iov);
+    cur = cur->next;
+    npos = 0;
+  }
+  return size;
+}
+
+uint64_t ByteArray::get_write_iovecs(std::vector<iovec>& buffers,
+                                     uint64_t len) {
+  if (len == 0) {
+    return 0;
+  }
+  add_capacity(len);
+
+  uint64_t size = len;
+  size_t npos = m_size % m_base_size;
+  Node* cur = m_write;
+  while (len > 0) {
+    iovec iov;
+    size_t ncap = cur->size - npos;
+    iov.iov_base = cur->ptr + npos;
+    iov.iov_len = std::min<uint64_t>(ncap, len);
+    len -= iov.iov_len;
+    buffers.push_back(iov);
+    cur = cur->next;
+    npos = 0;
+  }
+  return size;
+}
+
+void ByteArray::commit_write(size_t len) {
+  if (len > capacity()) {
+    throw std::out_of_range("commit_write out of range");
+  }
+
+  size_t npos = m_size % m_base_size;
+  while (len > 0) {
+    size_t ncap = m_write->size - npos;
+    size_t step = std::min(ncap, len);
+    m_size += step;
+    len -= step;
+    if (step == ncap) {
+      m_write = m_write->next;
+    }
+    npos = 0;
+  }
+}
+
+void ByteArray::add_capacity(size_t size) {
+  size_t old_cap = capacity();
+  if (old_cap >= size) {
+    return;
+  }
+
+  size = size - old_cap;
+  size_t count = size / m_base_size + ((size % m_base_size) ? 1 : 0);
+
+  Node* first = nullptr;
+  for (size_t i = 0; i < count; ++i) {
+    Node* node = Node::Alloc(m_base_size);
+    if (!first) {
+      first = node;
+    }
+    m_tail->next = node;
+    m_tail = node;
+    m_capacity += m_base_size;
+  }
+
+  if (!m_write) {
+    m_write = first;
+  }
+  if (!m_read) {
+    m_read = first;
+  }
+}
+
+ByteArray::Node* ByteArray::locate(size_t position, size_t& offset) const {
+  size_t count = position / m_base_size;
+  offset = position % m_base_size;
+
+  Node* cur = m_root;
+  while (count > 0 && cur) {
+    cur = cur->next;
+    --count;
+  }
+  return cur;
+}
+
+}  // namespace cx::net
@@ -0,0 +1,359 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cx/common/internal.h"
+#include "cx/net/endian.h"
+#include "cx/net/platform.h"
+
+namespace cx::net {
+
+/**
+ * @brief 二进制数组,由固定大小的内存块串联而成,用于协议消息的序列化
+ *
+ * 写操作总是追加到数据末尾,读操作从读位置(position)开始;
+ * 内存块来自线程局部的空闲链表,稳态收发时不再申请内存
+ */
+class ByteArray {
+ public:
+  typedef std::shared_ptr<ByteArray> ptr;
+
+  /**
+   * @brief 内存块
+   */
+  struct Node {
+    /**
+     * @brief 从空闲链表中获取指定大小的内存块
+     *
+     * @param[in] size 内存块大小
+     *
+     * @return 内存块
+     */
+    CX_STATIC Node* Alloc(size_t size);
+
+    /**
+     * @brief 将内存块归还到空闲链表
+     *
+     * @param[in] node 内存块
+     */
+    CX_STATIC void Free(Node* node);
+
+    char* ptr;
+    Node* next;
+    size_t size;
+  };
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] base_size 内存块大小
+   */
+  ByteArray(size_t base_size = 4096);
+
+  /**
+   * @brief 析构函数
+   */
+  ~ByteArray();
+
+  ByteArray(const ByteArray&) = delete;
+  ByteArray& operator=(const ByteArray&) = delete;
+
+  /**
+   * @brief 写入固定长度的数据
+   *
+   * @param[in] value 数据
+   */
+  void write_fint8(int8_t value);
+  void write_fuint8(uint8_t value);
+  void write_fint16(int16_t value);
+  void write_fuint16(uint16_t value);
+  void write_fint32(int32_t value);
+  void write_fuint32(uint32_t value);
+  void write_fint64(int64_t value);
+  void write_fuint64(uint64_t value);
+
+  /**
+   * @brief 写入varint编码的数据,有符号数先进行zigzag编码
+   *
+   * @param[in] value 数据
+   */
+  void write_int32(int32_t value);
+  void write_uint32(uint32_t value);
+  void write_int64(int64_t value);
+  void write_uint64(uint64_t value);
+
+  /**
+   * @brief 写入浮点数(按位写入,遵循字节序)
+   *
+   * @param[in] value 数据
+   */
+  void write_float(float value);
+  void write_double(double value);
+
+  /**
+   * @brief 写入字符串,以uint16/uint32/uint64/varint作为长度前缀
+   *
+   * @param[in] value 字符串
+   */
+  void write_string_f16(const std::string& value);
+  void write_string_f32(const std::string& value);
+  void write_string_f64(const std::string& value);
+  void write_string_vint(const std::string& value);
+
+  /**
+   * @brief 写入字符串,不带长度前缀
+   *
+   * @param[in] value 字符串
+   */
+  void write_string_without_length(const std::string& value);
+
+  /**
+   * @brief 读取固定长度的数据,可读数据不足时抛出std::out_of_range
+   *
+   * @return 数据
+   */
+  int8_t read_fint8();
+  uint8_t read_fuint8();
+  int16_t read_fint16();
+  uint16_t read_fuint16();
+  int32_t read_fint32();
+  uint32_t read_fuint32();
+  int64_t read_fint64();
+  uint64_t read_fuint64();
+
+  /**
+   * @brief 读取varint编码的数据
+   *
+   * @return 数据
+   */
+  int32_t read_int32();
+  uint32_t read_uint32();
+  int64_t read_int64();
+  uint64_t read_uint64();
+
+  /**
+   * @brief 读取浮点数
+   *
+   * @return 数据
+   */
+  float read_float();
+  double read_double();
+
+  /**
+   * @brief 读取带长度前缀的字符串,长度超过可读数据时抛出std::out_of_range,
+   * 不会按长度分配内存
+   *
+   * @return 字符串
+   */
+  std::string read_string_f16();
+  std::string read_string_f32();
+  std::string read_string_f64();
+  std::string read_string_vint();
+
+  /**
+   * @brief 清空数据,仅保留第一个内存块
+   */
+  void clear();
+
+  /**
+   * @brief 追加写入指定长度的数据
+   *
+   * @param[in] buf  数据
+   * @param[in] size 数据长度
+   */
+  void write(const void* buf, size_t size);
+
+  /**
+   * @brief 从读位置读取数据,并前移读位置
+   *
+   * @param[out] buf  缓存
+   * @param[in]  size 读取长度
+   */
+  void read(void* buf, size_t size);
+
+  /**
+   * @brief 从指定位置读取数据,不改变读位置
+   *
+   * @param[out] buf      缓存
+   * @param[in]  size     读取长度
+   * @param[in]  position 读取位置
+   */
+  void read(void* buf, size_t size, size_t position) const;
+
+  /**
+   * @brief 获取读位置
+   *
+   * @return 读位置
+   */
+  size_t position() const { return m_position; }
+
+  /**
+   * @brief 设置读位置,范围为[0, size()]
+   *
+   * @param[in] position 读位置
+   */
+  void set_position(size_t position);
+
+  /**
+   * @brief 释放读位置之前已经完整读取的内存块,位置整体前移
+   */
+  void compact();
+
+  /**
+   * @brief 将可读数据写入文件
+   *
+   * @param[in] name 文件名
+   *
+   * @return 是否成功
+   */
+  bool write_to_file(const std::string& name) const;
+
+  /**
+   * @brief 从文件中读取数据并追加
+   *
+   * @param[in] name 文件名
+   *
+   * @return 是否成功
+   */
+  bool read_from_file(const std::string& name);
+
+  /**
+   * @brief 获取内存块大小
+   *
+   * @return 内存块大小
+   */
+  size_t base_size() const { return m_base_size; }
+
+  /**
+   * @brief 获取可读数据的长度
+   *
+   * @return 可读长度
+   */
+  size_t read_size() const { return m_size - m_position; }
+
+  /**
+   * @brief 获取数据总长度
+   *
+   * @return 数据长度
+   */
+  size_t size() const { return m_size; }
+
+  /**
+   * @brief 是否按小端序读写
+   *
+   * @return 是否为小端序
+   */
+  bool is_little_endian() const { return m_endian == CX_LITTLE_ENDIAN; }
+
+  /**
+   * @brief 设置读写字节序,默认为网络字节序(大端)
+   *
+   * @param[in] val 是否为小端序
+   */
+  void set_is_little_endian(bool val);
+
+  /**
+   * @brief 将可读数据转为字符串
+   *
+   * @return 字符串
+   */
+  std::string to_string() const;
+
+  /**
+   * @brief 将可读数据转为十六进制字符串
+   *
+   * @return 十六进制字符串
+   */
+  std::string to_hex_string() const;
+
+  /**
+   * @brief 获取可读数据的iovec,不拷贝也不改变读位置
+   *
+   * @param[out] buffers iovec数组
+   * @param[in]  len     期望长度
+   *
+   * @return 实际长度
+   */
+  uint64_t get_read_iovecs(std::vector<iovec>& buffers,
+                           uint64_t len = ~0ull) const;
+
+  /**
+   * @brief 从指定位置开始获取可读数据的iovec
+   *
+   * @param[out] buffers  iovec数组
+   * @param[in]  len      期望长度
+   * @param[in]  position 起始位置
+   *
+   * @return 实际长度
+   */
+  uint64_t get_read_iovecs(std::vector<iovec>& buffers, uint64_t len,
+                           uint64_t position) const;
+
+  /**
+   * @brief 获取数据末尾之后可写内存的iovec,容量不足时扩容
+   *
+   * 写入完成后需调用commit_write提交实际写入的长度
+   *
+   * @param[out] buffers iovec数组
+   * @param[in]  len     期望长度
+   *
+   * @return 实际长度
+   */
+  uint64_t get_write_iovecs(std::vector<iovec>& buffers, uint64_t len);
+
+  /**
+   * @brief 提交通过get_write_iovecs写入的数据长度
+   *
+   * @param[in] len 写入长度
+   */
+  void commit_write(size_t len);
+
+ private:
+  /**
+   * @brief 扩容,保证末尾至少有size字节的可写空间
+   *
+   * @param[in] size 可写长度
+   */
+  void add_capacity(size_t size);
+
+  /**
+   * @brief 获取末尾可写空间
+   *
+   * @return 可写长度
+   */
+  size_t capacity() const { return m_capacity - m_size; }
+
+  /**
+   * @brief 定位到指定位置所在的内存块
+   *
+   * @param[in]  position 位置
+   * @param[out] offset   位置在内存块中的偏移
+   *
+   * @return 内存块
+   */
+  Node* locate(size_t position, size_t& offset) const;
+
+  /**
+   * @brief 按当前字节序转换
+   */
+  template <class T>
+  T swap_order(T value) const {
+    return m_endian == CX_BYTE_ORDER ? value : byteswap(value);
+  }
+
+ private:
+  size_t m_base_size;  // 内存块大小
+  size_t m_position;   // 读位置
+  size_t m_capacity;   // 总容量
+  size_t m_size;       // 数据长度
+  int8_t m_endian;     // 字节序
+
+  Node* m_root;   // 第一个内存块
+  Node* m_tail;   // 最后一个内存块
+  Node* m_read;   // 读位置所在的内存块
+  Node* m_write;  // 写位置所在的内存块
+};
+
+}  // namespace cx::net
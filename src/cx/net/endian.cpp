@@ -0,0 +1,159 @@
+#include "endian.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define CX_ENDIAN_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief 标量实现,同时用于SIMD处理后剩余的元素
+ */
+template <class T>
+static void SwapScalar(char* dst, const char* src, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    T v;
+    memcpy(&v, src + i * sizeof(T), sizeof(T));
+    v = byteswap(v);
+    memcpy(dst + i * sizeof(T), &v, sizeof(T));
+  }
+}
+
+#if defined(CX_ENDIAN_X86)
+/**
+ * @brief pshufb的重排表,两个128位通道相同,依次对应2、4、8字节宽度
+ */
+struct ShuffleMasks {
+  alignas(32) uint8_t masks[3][32];
+
+  constexpr ShuffleMasks() : masks() {
+    for (size_t k = 0; k < 3; ++k) {
+      size_t width = (size_t)2 << k;
+      for (size_t i = 0; i < 32; ++i) {
+        size_t lane = i % 16;
+        masks[k][i] = (uint8_t)(lane / width * width + width - 1 - lane % width);
+      }
+    }
+  }
+};
+
+static constexpr ShuffleMasks s_shuffle;
+
+typedef size_t (*kernel_t)(char* dst, const char* src, size_t bytes,
+                           const uint8_t* mask);
+
+/**
+ * @return 已处理的字节数,总是16的倍数
+ */
+__attribute__((target("ssse3"))) static size_t SwapSsse3(char* dst,
+                                                         const char* src,
+                                                         size_t bytes,
+                                                         const uint8_t* mask) {
+  const __m128i shuffle = _mm_load_si128((const __m128i*)mask);
+  size_t i = 0;
+  for (; i + 64 <= bytes; i += 64) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(src + i + 16));
+    __m128i c = _mm_loadu_si128((const __m128i*)(src + i + 32));
+    __m128i d = _mm_loadu_si128((const __m128i*)(src + i + 48));
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_shuffle_epi8(a, shuffle));
+    _mm_storeu_si128((__m128i*)(dst + i + 16), _mm_shuffle_epi8(b, shuffle));
+    _mm_storeu_si128((__m128i*)(dst + i + 32), _mm_shuffle_epi8(c, shuffle));
+    _mm_storeu_si128((__m128i*)(dst + i + 48), _mm_shuffle_epi8(d, shuffle));
+  }
+  for (; i + 16 <= bytes; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_shuffle_epi8(a, shuffle));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) static size_t SwapAvx2(char* dst,
+                                                       const char* src,
+                                                       size_t bytes,
+                                                       const uint8_t* mask) {
+  const __m256i shuffle = _mm256_load_si256((const __m256i*)mask);
+  size_t i = 0;
+  for (; i + 128 <= bytes; i += 128) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(src + i + 32));
+    __m256i c = _mm256_loadu_si256((const __m256i*)(src + i + 64));
+    __m256i d = _mm256_loadu_si256((const __m256i*)(src + i + 96));
+    _mm256_storeu_si256((__m256i*)(dst + i), _mm256_shuffle_epi8(a, shuffle));
+    _mm256_storeu_si256((__m256i*)(dst + i + 32),
+                        _mm256_shuffle_epi8(b, shuffle));
+    _mm256_storeu_si256((__m256i*)(dst + i + 64),
+                        _mm256_shuffle_epi8(c, shuffle));
+    _mm256_storeu_si256((__m256i*)(dst + i + 96),
+                        _mm256_shuffle_epi8(d, shuffle));
+  }
+  for (; i + 32 <= bytes; i += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+    _mm256_storeu_si256((__m256i*)(dst + i), _mm256_shuffle_epi8(a, shuffle));
+  }
+  // 不足32字节的部分交给SSSE3,AVX2的CPU一定支持SSSE3
+  if (i + 16 <= bytes) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+    _mm_storeu_si128(
+        (__m128i*)(dst + i),
+        _mm_shuffle_epi8(a, _mm_load_si128((const __m128i*)mask)));
+    i += 16;
+  }
+  return i;
+}
+
+static kernel_t SelectKernel() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return SwapAvx2;
+  }
+  if (__builtin_cpu_supports("ssse3")) {
+    return SwapSsse3;
+  }
+  return nullptr;
+}
+#endif
+
+bool byteswap_n(void* dst, const void* src, size_t count, size_t width) {
+  size_t index;
+  switch (width) {
+    case 2:
+      index = 0;
+      break;
+    case 4:
+      index = 1;
+      break;
+    case 8:
+      index = 2;
+      break;
+    default:
+      return false;
+  }
+
+  char* d = (char*)dst;
+  const char* s = (const char*)src;
+  size_t bytes = count * width;
+  size_t done = 0;
+#if defined(CX_ENDIAN_X86)
+  if (bytes >= 16) {
+    static const kernel_t kernel = SelectKernel();
+    if (kernel) {
+      done = kernel(d, s, bytes, s_shuffle.masks[index]);
+    }
+  }
+#endif
+
+  size_t rest = (bytes - done) / width;
+  switch (index) {
+    case 0:
+      SwapScalar<uint16_t>(d + done, s + done, rest);
+      break;
+    case 1:
+      SwapScalar<uint32_t>(d + done, s + done, rest);
+      break;
+    default:
+      SwapScalar<uint64_t>(d + done, s + done, rest);
+      break;
+  }
+  return true;
+}
@@ -1,58 +1,185 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
-#include <bit>
 #include <type_traits>
 
 #define CX_LITTLE_ENDIAN 1
 #define CX_BIG_ENDIAN 2
 
+#if defined(__GNUC__) || defined(__clang__)
+#define CX_HAS_BUILTIN_BSWAP 1
+#endif
+
+/**
+ * @brief byteswap只接受整数与枚举,浮点数需要先memcpy到同宽度的整数
+ */
+template <class T, size_t N>
+using byteswap_enable_t =
+    typename std::enable_if<(std::is_integral<T>::value ||
+                             std::is_enum<T>::value) &&
+                                sizeof(T) == N,
+                            T>::type;
+
 template <class T>
-typename std::enable_if<sizeof(T) == sizeof(uint64_t), T>::type byteswap(T v) {
-  return (T)(uint64_t)((v >> 56) | ((v & 0x00ff000000000000) >> 40) |
-                       ((v & 0x0000ff0000000000) >> 24) |
-                       ((v & 0x000000ff00000000) >> 8) |
-                       ((v & 0x00000000ff000000) << 8) |
-                       ((v & 0x0000000000ff0000) << 24) |
-                       ((v & 0x000000000000ff00) << 40) | (v << 56));
+constexpr byteswap_enable_t<T, sizeof(uint64_t)> byteswap(T t) {
+  uint64_t v = (uint64_t)t;
+#if defined(CX_HAS_BUILTIN_BSWAP)
+  return (T)__builtin_bswap64(v);
+#else
+  return (T)((v >> 56) | ((v & 0x00ff000000000000) >> 40) |
+             ((v & 0x0000ff0000000000) >> 24) |
+             ((v & 0x000000ff00000000) >> 8) |
+             ((v & 0x00000000ff000000) << 8) |
+             ((v & 0x0000000000ff0000) << 24) |
+             ((v & 0x000000000000ff00) << 40) | (v << 56));
+#endif
 }
 
 template <class T>
-typename std::enable_if<sizeof(T) == sizeof(uint32_t), T>::type byteswap(T v) {
-  return (T)(uint32_t)((v >> 24) | ((v & 0x00ff0000) >> 8) |
-                       ((v & 0x0000ff00) << 8) | (v << 24));
+constexpr byteswap_enable_t<T, sizeof(uint32_t)> byteswap(T t) {
+  uint32_t v = (uint32_t)t;
+#if defined(CX_HAS_BUILTIN_BSWAP)
+  return (T)__builtin_bswap32(v);
+#else
+  return (T)((v >> 24) | ((v & 0x00ff0000) >> 8) | ((v & 0x0000ff00) << 8) |
+             (v << 24));
+#endif
 }
 
 template <class T>
-typename std::enable_if<sizeof(T) == sizeof(uint16_t), T>::type byteswap(T v) {
-  return (T)(uint16_t)(((v & 0xff) << 8) | (v >> 8));
+constexpr byteswap_enable_t<T, sizeof(uint16_t)> byteswap(T t) {
+  uint16_t v = (uint16_t)t;
+  return (T)(uint16_t)((v << 8) | (v >> 8));
 }
 
-#if BYTE_ORDER == BIG_ENDIAN
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__)
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define CX_BYTE_ORDER CX_BIG_ENDIAN
+#else
+#define CX_BYTE_ORDER CX_LITTLE_ENDIAN
+#endif
+#elif defined(BYTE_ORDER) && defined(BIG_ENDIAN) && BYTE_ORDER == BIG_ENDIAN
 #define CX_BYTE_ORDER CX_BIG_ENDIAN
 #else
 #define CX_BYTE_ORDER CX_LITTLE_ENDIAN
 #endif
 
-#if Cx_BYTE_ORDER == CX_BIG_ENDIAN
+#if CX_BYTE_ORDER == CX_BIG_ENDIAN
 template <class T>
-T byteswapOnLittleEndian(T t) {
+constexpr T byteswapOnLittleEndian(T t) {
   return t;
 }
 
 template <class T>
-T byteswapOnBigEndian(T t) {
+constexpr T byteswapOnBigEndian(T t) {
   return byteswap(t);
 }
 #else
 template <class T>
-T byteswapOnLittleEndian(T t) {
+constexpr T byteswapOnLittleEndian(T t) {
   return byteswap(t);
 }
 
 template <class T>
-T byteswapOnBigEndian(T t) {
+constexpr T byteswapOnBigEndian(T t) {
   return t;
 }
 #endif
+
+template <class T>
+struct is_byteswappable
+    : std::integral_constant<bool, std::is_trivially_copyable<T>::value &&
+                                       (sizeof(T) == 2 || sizeof(T) == 4 ||
+                                        sizeof(T) == 8)> {};
+
+/**
+ * @brief 批量交换字节序,元素宽度为2、4或8字节
+ *
+ * x86上按CPU支持依次选择AVX2、SSSE3的字节重排,剩余元素与其他平台使用标量
+ * 实现。dst与src可以相同(原地转换),但不能部分重叠,两者都不要求对齐
+ *
+ * @param[out] dst   目标缓冲
+ * @param[in]  src   源缓冲
+ * @param[in]  count 元素数量
+ * @param[in]  width 元素宽度
+ *
+ * @return 宽度不支持时返回false,不做任何转换
+ */
+bool byteswap_n(void* dst, const void* src, size_t count, size_t width);
+
+/**
+ * @brief 批量交换数组的字节序,T可以是2、4、8字节的整数、浮点数或枚举
+ */
+template <class T>
+void byteswap_n(T* dst, const T* src, size_t count) {
+  static_assert(is_byteswappable<T>::value,
+                "element must be trivially copyable with 2, 4 or 8 bytes");
+  byteswap_n((void*)dst, (const void*)src, count, sizeof(T));
+}
+
+/**
+ * @brief 本机字节序的数组转换为大端序写入dst,dst可以是未对齐的网络缓冲
+ */
+template <class T>
+void to_be_n(void* dst, const T* src, size_t count) {
+  static_assert(is_byteswappable<T>::value,
+                "element must be trivially copyable with 2, 4 or 8 bytes");
+#if CX_BYTE_ORDER == CX_BIG_ENDIAN
+  if (dst != src) {
+    memmove(dst, src, count * sizeof(T));
+  }
+#else
+  byteswap_n(dst, src, count, sizeof(T));
+#endif
+}
+
+/**
+ * @brief 大端序的缓冲转换为本机字节序的数组
+ */
+template <class T>
+void from_be_n(T* dst, const void* src, size_t count) {
+  static_assert(is_byteswappable<T>::value,
+                "element must be trivially copyable with 2, 4 or 8 bytes");
+#if CX_BYTE_ORDER == CX_BIG_ENDIAN
+  if (dst != src) {
+    memmove(dst, src, count * sizeof(T));
+  }
+#else
+  byteswap_n(dst, src, count, sizeof(T));
+#endif
+}
+
+/**
+ * @brief 本机字节序的数组转换为小端序写入dst
+ */
+template <class T>
+void to_le_n(void* dst, const T* src, size_t count) {
+  static_assert(is_byteswappable<T>::value,
+                "element must be trivially copyable with 2, 4 or 8 bytes");
+#if CX_BYTE_ORDER == CX_BIG_ENDIAN
+  byteswap_n(dst, src, count, sizeof(T));
+#else
+  if (dst != src) {
+    memmove(dst, src, count * sizeof(T));
+  }
+#endif
+}
+
+/**
+ * @brief 小端序的缓冲转换为本机字节序的数组
+ */
+template <class T>
+void from_le_n(T* dst, const void* src, size_t count) {
+  static_assert(is_byteswappable<T>::value,
+                "element must be trivially copyable with 2, 4 or 8 bytes");
+#if CX_BYTE_ORDER == CX_BIG_ENDIAN
+  byteswap_n(dst, src, count, sizeof(T));
+#else
+  if (dst != src) {
+    memmove(dst, src, count * sizeof(T));
+  }
+#endif
+}
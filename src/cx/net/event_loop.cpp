@@ -0,0 +1,318 @@
+#include "event_loop.h"
+
+#include <fcntl.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "cx/common/logger.h"
+
+#if defined(CX_PLATFORM_LINUX)
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#else
+#include <poll.h>
+#endif
+
+namespace cx::net {
+
+using namespace time;
+
+static thread_local EventLoop* t_loop = nullptr;
+
+// 每次poll最多处理的事件数量
+static const int MAX_EVENTS = 256;
+
+EventLoop::EventLoop()
+    : m_thread_id(std::this_thread::get_id()),
+      m_quit(false),
+      m_poller(-1),
+      m_wakeup_fd{-1, -1},
+      m_calling_pending(false),
+      m_timers(TimePoint::Milliseconds(1)) {
+  if (t_loop) {
+    LOG_ERROR(log::Loggers::engine)
+        << "another EventLoop exists in this thread";
+  } else {
+    t_loop = this;
+  }
+
+#if defined(CX_PLATFORM_LINUX)
+  m_poller = epoll_create1(EPOLL_CLOEXEC);
+  m_wakeup_fd[0] = m_wakeup_fd[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#else
+  if (pipe(m_wakeup_fd) == 0) {
+    fcntl(m_wakeup_fd[0], F_SETFL, O_NONBLOCK);
+    fcntl(m_wakeup_fd[1], F_SETFL, O_NONBLOCK);
+  }
+#endif
+
+  update_event(m_wakeup_fd[0], eRead, [this](uint32_t) {
+    uint64_t buf[8];
+    while (::read(m_wakeup_fd[0], buf, sizeof(buf)) > 0)
+      ;
+  });
+}
+
+EventLoop::~EventLoop() {
+  remove_event(m_wakeup_fd[0]);
+  ::close(m_wakeup_fd[0]);
+  if (m_wakeup_fd[1] != m_wakeup_fd[0]) {
+    ::close(m_wakeup_fd[1]);
+  }
+  if (m_poller != -1) {
+    ::close(m_poller);
+  }
+  if (t_loop == this) {
+    t_loop = nullptr;
+  }
+}
+
+EventLoop* EventLoop::Current() { return t_loop; }
+
+void EventLoop::loop() {
+  m_thread_id = std::this_thread::get_id();
+  while (!m_quit) {
+    poll(next_timeout());
+    do_expired_timers();
+    do_pending_tasks();
+  }
+  // 退出前执行完剩余的任务,避免资源泄漏
+  do_pending_tasks();
+}
+
+void EventLoop::quit() {
+  m_quit = true;
+  if (!is_in_loop_thread()) {
+    wakeup();
+  }
+}
+
+void EventLoop::run_in_loop(task_t task) {
+  if (is_in_loop_thread()) {
+    task();
+  } else {
+    queue_in_loop(std::move(task));
+  }
+}
+
+void EventLoop::queue_in_loop(task_t task) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending_tasks.push_back(std::move(task));
+  }
+  if (!is_in_loop_thread() || m_calling_pending) {
+    wakeup();
+  }
+}
+
+bool EventLoop::update_event(socket_type fd, uint32_t events,
+                             event_callback_t callback) {
+  auto it = m_channels.find(fd);
+  bool exists = it != m_channels.end();
+
+#if defined(CX_PLATFORM_LINUX)
+  epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.data.fd = fd;
+  ev.events =
+      ((events & eRead) ? (uint32_t)(EPOLLIN | EPOLLRDHUP) : (uint32_t)0) |
+      ((events & eWrite) ? (uint32_t)EPOLLOUT : (uint32_t)0);
+  if (epoll_ctl(m_poller, exists ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev)) {
+    LOG_ERROR(log::Loggers::engine)
+        << "epoll_ctl failed, fd: " << fd << ", errno: " << errno << " "
+        << strerror(errno);
+    return false;
+  }
+#endif
+
+  if (exists) {
+    it->second.events = events;
+    if (callback) {
+      it->second.callback = std::move(callback);
+    }
+  } else {
+    m_channels[fd] = {events, std::move(callback)};
+  }
+  return true;
+}
+
+bool EventLoop::update_event(socket_type fd, uint32_t events) {
+  return update_event(fd, events, nullptr);
+}
+
+void EventLoop::remove_event(socket_type fd) {
+  auto it = m_channels.find(fd);
+  if (it == m_channels.end()) {
+    return;
+  }
+#if defined(CX_PLATFORM_LINUX)
+  epoll_ctl(m_poller, EPOLL_CTL_DEL, fd, nullptr);
+#endif
+  m_channels.erase(it);
+}
+
+uint64_t EventLoop::run_after(const TimePoint& delay, task_t task) {
+  // 时间轮只在每轮循环推进一次,延迟需要加上它落后于当前时间的部分
+  return m_timers.add(delay + (TimePoint::Now() - m_timers.now()),
+                      std::move(task));
+}
+
+uint64_t EventLoop::run_every(const TimePoint& interval, task_t task) {
+  return m_timers.add_every(interval, std::move(task));
+}
+
+void EventLoop::cancel(uint64_t timer_id) { m_timers.cancel(timer_id); }
+
+void EventLoop::poll(int timeout_ms) {
+#if defined(CX_PLATFORM_LINUX)
+  epoll_event events[MAX_EVENTS];
+  int n = epoll_wait(m_poller, events, MAX_EVENTS, timeout_ms);
+  for (int i = 0; i < n; ++i) {
+    uint32_t revents = eNone;
+    if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+      revents |= eRead;
+    }
+    if (events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+      revents |= eWrite;
+    }
+    if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+      revents |= eError;
+    }
+    // 回调中可能移除fd,因此每次都重新查找
+    auto it = m_channels.find(events[i].data.fd);
+    if (it != m_channels.end() && it->second.callback) {
+      event_callback_t callback = it->second.callback;
+      callback(revents & (it->second.events | eError));
+    }
+  }
+#else
+  std::vector<pollfd> fds;
+  fds.reserve(m_channels.size());
+  for (auto& [fd, channel] : m_channels) {
+    pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = ((channel.events & eRead) ? POLLIN : 0) |
+                 ((channel.events & eWrite) ? POLLOUT : 0);
+    pfd.revents = 0;
+    fds.push_back(pfd);
+  }
+  int n = ::poll(fds.data(), fds.size(), timeout_ms);
+  for (size_t i = 0; n > 0 && i < fds.size(); ++i) {
+    if (!fds[i].revents) {
+      continue;
+    }
+    uint32_t revents = eNone;
+    if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+      revents |= eRead;
+    }
+    if (fds[i].revents & (POLLOUT | POLLHUP | POLLERR)) {
+      revents |= eWrite;
+    }
+    if (fds[i].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+      revents |= eError;
+    }
+    auto it = m_channels.find(fds[i].fd);
+    if (it != m_channels.end() && it->second.callback) {
+      event_callback_t callback = it->second.callback;
+      callback(revents & (it->second.events | eError));
+    }
+  }
+#endif
+}
+
+void EventLoop::wakeup() {
+  uint64_t one = 1;
+  ssize_t n = ::write(m_wakeup_fd[1], &one, sizeof(one));
+  (void)n;
+}
+
+void EventLoop::do_pending_tasks() {
+  std::vector<task_t> tasks;
+  m_calling_pending = true;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    tasks.swap(m_pending_tasks);
+  }
+  for (auto& task : tasks) {
+    task();
+  }
+  m_calling_pending = false;
+}
+
+void EventLoop::do_expired_timers() { m_timers.advance(TimePoint::Now()); }
+
+int EventLoop::next_timeout() const {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_pending_tasks.empty()) {
+      return 0;
+    }
+  }
+  TimePoint expiry = m_timers.next_expiry();
+  if (expiry.AsMicroseconds() < 0) {
+    return -1;
+  }
+  int64_t diff = (expiry - TimePoint::Now()).AsMicroseconds();
+  if (diff <= 0) {
+    return 0;
+  }
+  return (int)((diff + 999) / 1000);
+}
+
+EventLoopThread::EventLoopThread(const std::string& name, int cpu)
+    : m_name(name), m_cpu(cpu), m_loop(nullptr) {}
+
+EventLoopThread::~EventLoopThread() { stop(); }
+
+EventLoop* EventLoopThread::start() {
+  m_thread = std::thread(&EventLoopThread::run, this);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cond.wait(lock, [this]() { return m_loop != nullptr; });
+  return m_loop;
+}
+
+void EventLoopThread::stop() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_loop) {
+      m_loop->quit();
+    }
+  }
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+}
+
+void EventLoopThread::run() {
+#if defined(CX_PLATFORM_LINUX)
+  if (!m_name.empty()) {
+    pthread_setname_np(pthread_self(), m_name.substr(0, 15).c_str());
+  }
+  if (m_cpu >= 0) {
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(m_cpu, &cpuset);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset)) {
+      LOG_WARN(log::Loggers::engine)
+          << "bind " << m_name << " to cpu " << m_cpu << " failed";
+    }
+  }
+#endif
+
+  EventLoop loop;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_loop = &loop;
+  }
+  m_cond.notify_one();
+
+  loop.loop();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_loop = nullptr;
+}
+
+}  // namespace cx::net
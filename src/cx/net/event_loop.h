@@ -0,0 +1,243 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cx/common/internal.h"
+#include "cx/common/noncopyable.h"
+#include "cx/net/platform.h"
+#include "cx/utils/time/time.h"
+#include "cx/utils/time/timing_wheel.h"
+
+namespace cx::net {
+
+/**
+ * @brief 事件循环(reactor),一个线程最多拥有一个
+ *
+ * Linux下使用epoll,其他平台使用poll;除run_in_loop/queue_in_loop/quit外,
+ * 其余接口都只能在事件循环所在的线程中调用
+ */
+class EventLoop : public Noncopyable {
+ public:
+  typedef std::function<void()> task_t;
+  typedef std::function<void(uint32_t events)> event_callback_t;
+
+  /**
+   * @brief IO事件
+   */
+  enum Event : uint32_t {
+    eNone = 0x0,
+    eRead = 0x1,
+    eWrite = 0x4,
+    eError = 0x8,
+  };
+
+  /**
+   * @brief 构造函数,事件循环归属于构造它的线程
+   */
+  EventLoop();
+
+  /**
+   * @brief 析构函数
+   */
+  ~EventLoop();
+
+  /**
+   * @brief 运行事件循环,直到调用quit
+   */
+  void loop();
+
+  /**
+   * @brief 退出事件循环,可在任意线程调用
+   */
+  void quit();
+
+  /**
+   * @brief 当前线程是否为事件循环所在的线程
+   */
+  bool is_in_loop_thread() const {
+    return m_thread_id == std::this_thread::get_id();
+  }
+
+  /**
+   * @brief 在事件循环线程中执行任务,若当前就在该线程则立即执行
+   *
+   * @param[in] task 任务
+   */
+  void run_in_loop(task_t task);
+
+  /**
+   * @brief 将任务加入队列,在下一轮循环中执行
+   *
+   * @param[in] task 任务
+   */
+  void queue_in_loop(task_t task);
+
+  /**
+   * @brief 添加或修改fd关注的事件
+   *
+   * @param[in] fd       文件描述符
+   * @param[in] events   关注的事件,eRead|eWrite
+   * @param[in] callback 事件回调
+   *
+   * @return 是否成功
+   */
+  bool update_event(socket_type fd, uint32_t events, event_callback_t callback);
+
+  /**
+   * @brief 修改fd关注的事件,保留原有的回调
+   *
+   * @param[in] fd     文件描述符
+   * @param[in] events 关注的事件
+   *
+   * @return 是否成功
+   */
+  bool update_event(socket_type fd, uint32_t events);
+
+  /**
+   * @brief 移除fd
+   *
+   * @param[in] fd 文件描述符
+   */
+  void remove_event(socket_type fd);
+
+  /**
+   * @brief 在指定延迟后执行一次任务
+   *
+   * @param[in] delay 延迟
+   * @param[in] task  任务
+   *
+   * @return 定时器id
+   */
+  uint64_t run_after(const time::TimePoint& delay, task_t task);
+
+  /**
+   * @brief 按固定间隔重复执行任务
+   *
+   * @param[in] interval 间隔
+   * @param[in] task     任务
+   *
+   * @return 定时器id
+   */
+  uint64_t run_every(const time::TimePoint& interval, task_t task);
+
+  /**
+   * @brief 取消定时器
+   *
+   * @param[in] timer_id 定时器id
+   */
+  void cancel(uint64_t timer_id);
+
+  /**
+   * @brief 获取当前线程的事件循环
+   *
+   * @return 事件循环,当前线程没有时返回nullptr
+   */
+  CX_STATIC EventLoop* Current();
+
+ private:
+  /**
+   * @brief 等待IO事件并分发
+   *
+   * @param[in] timeout_ms 超时时间
+   */
+  void poll(int timeout_ms);
+
+  /**
+   * @brief 唤醒阻塞在poll中的事件循环
+   */
+  void wakeup();
+
+  /**
+   * @brief 执行排队的任务
+   */
+  void do_pending_tasks();
+
+  /**
+   * @brief 执行到期的定时器
+   */
+  void do_expired_timers();
+
+  /**
+   * @brief 计算距离下一个定时器到期的时间
+   *
+   * @return 毫秒,没有定时器时返回-1
+   */
+  int next_timeout() const;
+
+ private:
+  struct Channel {
+    uint32_t events;
+    event_callback_t callback;
+  };
+
+  std::thread::id m_thread_id;
+  std::atomic<bool> m_quit;
+  socket_type m_poller;
+  socket_type m_wakeup_fd[2];
+
+  std::unordered_map<socket_type, Channel> m_channels;
+
+  mutable std::mutex m_mutex;
+  std::vector<task_t> m_pending_tasks;
+  bool m_calling_pending;
+
+  time::TimingWheel m_timers;
+};
+
+/**
+ * @brief 运行事件循环的线程
+ */
+class EventLoopThread : public Noncopyable {
+ public:
+  typedef std::shared_ptr<EventLoopThread> ptr;
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] name 线程名称
+   * @param[in] cpu  绑定的cpu核心,-1为不绑定
+   */
+  EventLoopThread(const std::string& name = "", int cpu = -1);
+
+  /**
+   * @brief 析构函数,退出事件循环并等待线程结束
+   */
+  ~EventLoopThread();
+
+  /**
+   * @brief 启动线程,直到事件循环创建完成才返回
+   *
+   * @return 事件循环
+   */
+  EventLoop* start();
+
+  /**
+   * @brief 退出事件循环并等待线程结束
+   */
+  void stop();
+
+  EventLoop* loop() const { return m_loop; }
+
+  const std::string& name() const { return m_name; }
+
+ private:
+  void run();
+
+ private:
+  std::string m_name;
+  int m_cpu;
+  EventLoop* m_loop;
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+};
+
+}  // namespace cx::net
@@ -0,0 +1,244 @@
+#include "http_parser.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace cx::net {
+
+static bool IsTokenChar(char c) {
+  if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+      (c >= '0' && c <= '9')) {
+    return true;
+  }
+  return c && strchr("!#$%&'*+-.^_`|~", c) != nullptr;
+}
+
+static char ToLower(char c) { return c >= 'A' && c <= 'Z' ? c + 32 : c; }
+
+static bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (ToLower(a[i]) != ToLower(b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief 逗号分隔的列表中是否包含token,如Connection: keep-alive, Upgrade
+ */
+static bool ContainsToken(std::string_view list, std::string_view token) {
+  while (!list.empty()) {
+    size_t comma = list.find(',');
+    std::string_view item = list.substr(0, comma);
+    while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) {
+      item.remove_prefix(1);
+    }
+    while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) {
+      item.remove_suffix(1);
+    }
+    if (EqualsIgnoreCase(item, token)) {
+      return true;
+    }
+    if (comma == std::string_view::npos) {
+      break;
+    }
+    list.remove_prefix(comma + 1);
+  }
+  return false;
+}
+
+HttpRequestParser::HttpRequestParser(size_t max_header_size,
+                                     size_t max_body_size)
+    : m_max_header_size(max_header_size), m_max_body_size(max_body_size) {
+  reset();
+}
+
+void HttpRequestParser::reset() {
+  m_data = nullptr;
+  m_state = State::eRequestLine;
+  m_error_status = 0;
+  m_scan = 0;
+  m_line_begin = 0;
+  m_method = m_target = m_path = m_query = m_body = Span();
+  m_minor_version = 1;
+  m_headers.clear();
+  m_keep_alive = false;
+}
+
+HttpRequestParser::State HttpRequestParser::parse(const char* data,
+                                                  size_t len) {
+  m_data = data;
+  while (m_state == State::eRequestLine || m_state == State::eHeaders) {
+    size_t limit = std::min(len, m_max_header_size);
+    const char* lf = m_scan < limit
+                         ? (const char*)memchr(data + m_scan, '\n',
+                                               limit - m_scan)
+                         : nullptr;
+    if (!lf) {
+      m_scan = (uint32_t)limit;
+      return len >= m_max_header_size ? fail(431) : m_state;
+    }
+
+    uint32_t end = (uint32_t)(lf - data);
+    uint32_t begin = m_line_begin;
+    m_scan = m_line_begin = end + 1;
+    if (end > begin && data[end - 1] == '\r') {
+      --end;
+    }
+
+    if (m_state == State::eRequestLine) {
+      // 忽略请求之前的空行
+      if (end == begin) {
+        continue;
+      }
+      if (!parse_request_line(begin, end)) {
+        return m_state;
+      }
+      m_state = State::eHeaders;
+    } else if (end == begin) {
+      if (!finish_headers()) {
+        return m_state;
+      }
+    } else if (!parse_header(begin, end)) {
+      return m_state;
+    }
+  }
+
+  if (m_state == State::eBody && len >= m_body.offset + m_body.len) {
+    m_state = State::eComplete;
+  }
+  return m_state;
+}
+
+std::string_view HttpRequestParser::header(std::string_view name) const {
+  for (auto& header : m_headers) {
+    if (EqualsIgnoreCase(view(header.name), name)) {
+      return view(header.value);
+    }
+  }
+  return std::string_view();
+}
+
+bool HttpRequestParser::parse_request_line(uint32_t begin, uint32_t end) {
+  std::string_view line(m_data + begin, end - begin);
+
+  size_t sp1 = line.find(' ');
+  if (sp1 == 0 || sp1 == std::string_view::npos) {
+    fail(400);
+    return false;
+  }
+  for (size_t i = 0; i < sp1; ++i) {
+    if (!IsTokenChar(line[i])) {
+      fail(400);
+      return false;
+    }
+  }
+  size_t sp2 = line.find(' ', sp1 + 1);
+  if (sp2 == std::string_view::npos || sp2 == sp1 + 1) {
+    fail(400);
+    return false;
+  }
+
+  std::string_view version = line.substr(sp2 + 1);
+  if (version.size() != 8 || version.substr(0, 7) != "HTTP/1.") {
+    fail(version.substr(0, 5) == "HTTP/" ? 505 : 400);
+    return false;
+  }
+  if (version[7] != '0' && version[7] != '1') {
+    fail(505);
+    return false;
+  }
+  m_minor_version = version[7] - '0';
+  m_keep_alive = m_minor_version == 1;
+
+  m_method = {begin, (uint32_t)sp1};
+  m_target = {begin + (uint32_t)sp1 + 1, (uint32_t)(sp2 - sp1 - 1)};
+  std::string_view target = view(m_target);
+  size_t question = target.find('?');
+  if (question == std::string_view::npos) {
+    m_path = m_target;
+  } else {
+    m_path = {m_target.offset, (uint32_t)question};
+    m_query = {m_target.offset + (uint32_t)question + 1,
+               m_target.len - (uint32_t)question - 1};
+  }
+  return true;
+}
+
+bool HttpRequestParser::parse_header(uint32_t begin, uint32_t end) {
+  // 不支持已废弃的多行头部
+  if (m_data[begin] == ' ' || m_data[begin] == '\t') {
+    fail(400);
+    return false;
+  }
+
+  uint32_t colon = begin;
+  while (colon < end && IsTokenChar(m_data[colon])) {
+    ++colon;
+  }
+  if (colon == begin || colon == end || m_data[colon] != ':') {
+    fail(400);
+    return false;
+  }
+
+  uint32_t value_begin = colon + 1;
+  while (value_begin < end &&
+         (m_data[value_begin] == ' ' || m_data[value_begin] == '\t')) {
+    ++value_begin;
+  }
+  uint32_t value_end = end;
+  while (value_end > value_begin &&
+         (m_data[value_end - 1] == ' ' || m_data[value_end - 1] == '\t')) {
+    --value_end;
+  }
+
+  Header header;
+  header.name = {begin, colon - begin};
+  header.value = {value_begin, value_end - value_begin};
+  m_headers.push_back(header);
+  return true;
+}
+
+bool HttpRequestParser::finish_headers() {
+  if (!header("Transfer-Encoding").empty()) {
+    fail(501);
+    return false;
+  }
+
+  std::string_view connection = header("Connection");
+  if (ContainsToken(connection, "close")) {
+    m_keep_alive = false;
+  } else if (ContainsToken(connection, "keep-alive")) {
+    m_keep_alive = true;
+  }
+
+  uint64_t length = 0;
+  std::string_view content_length = header("Content-Length");
+  for (char c : content_length) {
+    if (c < '0' || c > '9') {
+      fail(400);
+      return false;
+    }
+    length = length * 10 + (c - '0');
+    if (length > m_max_body_size) {
+      fail(413);
+      return false;
+    }
+  }
+
+  m_body = {m_scan, (uint32_t)length};
+  m_state = State::eBody;
+  return true;
+}
+
+HttpRequestParser::State HttpRequestParser::fail(int status) {
+  m_error_status = status;
+  m_state = State::eError;
+  return m_state;
+}
+
+}  // namespace cx::net
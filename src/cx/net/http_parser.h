@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "cx/common/internal.h"
+
+namespace cx::net {
+
+/**
+ * @brief 增量的HTTP/1.x请求解析器
+ *
+ * 解析结果只保存相对于请求开头的偏移,通过string_view引用调用者的缓冲区,
+ * 不复制任何数据。数据不完整时记录已经扫描到的位置,追加数据后再次调用
+ * parse只扫描新的部分;缓冲区可以在两次调用之间扩容或移动,但已有的内容
+ * 不能改变。不支持chunked请求体
+ */
+class HttpRequestParser {
+ public:
+  enum class State : uint8_t { eRequestLine, eHeaders, eBody, eComplete, eError };
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] max_header_size 请求行与头部的最大长度
+   * @param[in] max_body_size   请求体的最大长度
+   */
+  HttpRequestParser(size_t max_header_size = 8 * 1024,
+                    size_t max_body_size = 64 * 1024);
+
+  /**
+   * @brief 解析请求
+   *
+   * @param[in] data 请求的开头,同一个请求的多次调用中已有的内容不能改变
+   * @param[in] len  目前收到的长度
+   *
+   * @return eComplete为请求完整,eError为请求无效,其他为需要更多数据
+   */
+  State parse(const char* data, size_t len);
+
+  /**
+   * @brief 开始解析下一个请求
+   */
+  void reset();
+
+  State state() const { return m_state; }
+
+  bool complete() const { return m_state == State::eComplete; }
+
+  bool error() const { return m_state == State::eError; }
+
+  /**
+   * @brief 出错时应返回的状态码:400/413/431/501/505
+   */
+  int error_status() const { return m_error_status; }
+
+  /**
+   * @brief 完整请求的长度,流水线中下一个请求从这里开始
+   */
+  size_t size() const { return m_body.offset + m_body.len; }
+
+  // 以下接口在请求完整后有效,返回的string_view引用最后一次传给parse的缓冲区
+  std::string_view method() const { return view(m_method); }
+  std::string_view target() const { return view(m_target); }
+
+  /**
+   * @brief 不含查询参数的路径
+   */
+  std::string_view path() const { return view(m_path); }
+
+  /**
+   * @brief ?之后的查询参数,没有时为空
+   */
+  std::string_view query() const { return view(m_query); }
+
+  /**
+   * @brief 次版本号,HTTP/1.0为0,HTTP/1.1为1
+   */
+  int minor_version() const { return m_minor_version; }
+
+  size_t header_count() const { return m_headers.size(); }
+  std::string_view header_name(size_t index) const {
+    return view(m_headers[index].name);
+  }
+  std::string_view header_value(size_t index) const {
+    return view(m_headers[index].value);
+  }
+
+  /**
+   * @brief 按名称查找头部,不区分大小写
+   *
+   * @return 不存在时返回空
+   */
+  std::string_view header(std::string_view name) const;
+
+  std::string_view body() const { return view(m_body); }
+
+  /**
+   * @brief 响应后是否保持连接
+   */
+  bool keep_alive() const { return m_keep_alive; }
+
+ private:
+  struct Span {
+    uint32_t offset = 0;
+    uint32_t len = 0;
+  };
+
+  struct Header {
+    Span name;
+    Span value;
+  };
+
+  std::string_view view(const Span& span) const {
+    return std::string_view(m_data + span.offset, span.len);
+  }
+
+  bool parse_request_line(uint32_t begin, uint32_t end);
+  bool parse_header(uint32_t begin, uint32_t end);
+  bool finish_headers();
+  State fail(int status);
+
+ private:
+  size_t m_max_header_size;
+  size_t m_max_body_size;
+  const char* m_data;
+  State m_state;
+  int m_error_status;
+  uint32_t m_scan;        // 下一次开始查找换行的位置
+  uint32_t m_line_begin;  // 当前行的开头
+  Span m_method;
+  Span m_target;
+  Span m_path;
+  Span m_query;
+  int m_minor_version;
+  std::vector<Header> m_headers;
+  Span m_body;
+  bool m_keep_alive;
+};
+
+}  // namespace cx::net
@@ -0,0 +1,359 @@
+#include "http_server.h"
+
+#include <cerrno>
+
+#include "cx/common/logger.h"
+
+namespace cx::net {
+
+using namespace time;
+
+#if defined(MSG_NOSIGNAL)
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+// 每次读取的长度
+static const size_t READ_SIZE = 4096;
+
+// 每次可读事件最多accept的连接数量
+static const int MAX_ACCEPT_PER_EVENT = 16;
+
+static const char* StatusText(int status) {
+  switch (status) {
+    case 200:
+      return "OK";
+    case 204:
+      return "No Content";
+    case 400:
+      return "Bad Request";
+    case 404:
+      return "Not Found";
+    case 405:
+      return "Method Not Allowed";
+    case 413:
+      return "Payload Too Large";
+    case 431:
+      return "Request Header Fields Too Large";
+    case 500:
+      return "Internal Server Error";
+    case 501:
+      return "Not Implemented";
+    case 503:
+      return "Service Unavailable";
+    case 505:
+      return "HTTP Version Not Supported";
+    default:
+      return "Unknown";
+  }
+}
+
+HttpServer::HttpServer() : HttpServer(Options()) {}
+
+HttpServer::HttpServer(const Options& options)
+    : m_options(options),
+      m_loop(nullptr),
+      m_idle_timer(0),
+      m_running(false),
+      m_connection_count(0),
+      m_request_count(0) {}
+
+HttpServer::~HttpServer() { stop(); }
+
+void HttpServer::handle(const std::string& path, handler_t handler) {
+  if (m_running) {
+    LOG_ERROR(log::Loggers::engine)
+        << m_options.name << " handle after start: " << path;
+    return;
+  }
+  m_handlers[path] = std::move(handler);
+}
+
+bool HttpServer::bind(Address::ptr address) {
+  if (m_running) {
+    LOG_ERROR(log::Loggers::engine)
+        << m_options.name << " bind after start: " << address->to_string();
+    return false;
+  }
+
+  Socket::ptr sock = Socket::GenerateTCP(address);
+  if (!sock->bind(address) || !sock->listen()) {
+    LOG_ERROR(log::Loggers::engine)
+        << m_options.name << " listen failed: " << address->to_string()
+        << ", errno: " << errno;
+    return false;
+  }
+  sock->set_non_blocking(true);
+  m_listeners.push_back(sock);
+  m_addresses.push_back(sock->local_address());
+
+  LOG_INFO(log::Loggers::engine)
+      << m_options.name << " bind successful, address: "
+      << m_addresses.back()->to_string();
+  return true;
+}
+
+bool HttpServer::start() {
+  if (m_running || m_listeners.empty()) {
+    return false;
+  }
+
+  m_running = true;
+  m_thread.reset(new EventLoopThread(m_options.name));
+  m_loop = m_thread->start();
+  m_loop->run_in_loop([this]() {
+    for (auto& listener : m_listeners) {
+      m_loop->update_event(listener->socket(), EventLoop::eRead,
+                           [this, listener](uint32_t) {
+                             handle_accept(listener);
+                           });
+    }
+    if (m_options.idle_timeout.AsMicroseconds() > 0) {
+      TimePoint interval =
+          std::min(m_options.idle_timeout / (int64_t)2, TimePoint::Seconds(1));
+      m_idle_timer = m_loop->run_every(interval, [this]() { check_idle(); });
+    }
+  });
+  return true;
+}
+
+void HttpServer::stop() {
+  if (!m_running.exchange(false)) {
+    return;
+  }
+
+  m_loop->run_in_loop([this]() {
+    if (m_idle_timer) {
+      m_loop->cancel(m_idle_timer);
+      m_idle_timer = 0;
+    }
+    for (auto& listener : m_listeners) {
+      m_loop->remove_event(listener->socket());
+      listener->close();
+    }
+    std::vector<Connection*> connections;
+    for (auto& [fd, conn] : m_connections) {
+      connections.push_back(conn.get());
+    }
+    for (auto conn : connections) {
+      close(conn);
+    }
+  });
+  m_thread->stop();
+  m_thread.reset();
+  m_loop = nullptr;
+  m_listeners.clear();
+  m_addresses.clear();
+
+  LOG_INFO(log::Loggers::engine) << m_options.name << " stopped";
+}
+
+std::vector<Address::ptr> HttpServer::listen_addresses() const {
+  return m_addresses;
+}
+
+void HttpServer::handle_accept(Socket::ptr listener) {
+  for (int i = 0; i < MAX_ACCEPT_PER_EVENT; ++i) {
+    Socket::ptr sock = listener->accept();
+    if (!sock) {
+      break;
+    }
+    if (m_connections.size() >= m_options.max_connections) {
+      LOG_WARN(log::Loggers::engine)
+          << m_options.name << " too many connections, reject "
+          << sock->remote_address()->to_string();
+      sock->close();
+      continue;
+    }
+
+    sock->set_non_blocking(true);
+#if defined(SO_NOSIGPIPE)
+    int val = 1;
+    sock->set_option(SOL_SOCKET, SO_NOSIGPIPE, val);
+#endif
+    socket_type fd = sock->socket();
+    std::unique_ptr<Connection> conn(new Connection(
+        sock, m_options.max_header_size, m_options.max_body_size));
+    conn->last_active = TimePoint::Now();
+    m_connections[fd] = std::move(conn);
+    ++m_connection_count;
+    m_loop->update_event(fd, EventLoop::eRead, [this, fd](uint32_t events) {
+      handle_event(fd, events);
+    });
+  }
+}
+
+void HttpServer::handle_event(socket_type fd, uint32_t events) {
+  auto it = m_connections.find(fd);
+  if (it == m_connections.end()) {
+    return;
+  }
+  Connection* conn = it->second.get();
+  if (events & EventLoop::eWrite) {
+    handle_write(conn);
+    // 连接可能已经关闭
+    if (m_connections.find(fd) == m_connections.end()) {
+      return;
+    }
+  }
+  if (events & (EventLoop::eRead | EventLoop::eError)) {
+    handle_read(conn);
+  }
+}
+
+void HttpServer::handle_read(Connection* conn) {
+  size_t old = conn->input.size();
+  conn->input.resize(old + READ_SIZE);
+  int n = conn->sock->recv(&conn->input[old], READ_SIZE);
+  if (n > 0) {
+    conn->input.resize(old + n);
+    conn->last_active = TimePoint::Now();
+    process(conn);
+  } else if (n == 0) {
+    close(conn);
+  } else {
+    conn->input.resize(old);
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+      close(conn);
+    }
+  }
+}
+
+void HttpServer::process(Connection* conn) {
+  // 流水线中的请求依次处理,响应按顺序追加到输出
+  while (!conn->closing && conn->consumed < conn->input.size()) {
+    HttpRequestParser& parser = conn->parser;
+    HttpRequestParser::State state =
+        parser.parse(conn->input.data() + conn->consumed,
+                     conn->input.size() - conn->consumed);
+    if (state == HttpRequestParser::State::eError) {
+      HttpResponse response;
+      response.status = parser.error_status();
+      response.body = StatusText(response.status);
+      respond(conn, response, false);
+      break;
+    }
+    if (state != HttpRequestParser::State::eComplete) {
+      break;
+    }
+
+    ++m_request_count;
+    HttpResponse response;
+    auto it = m_handlers.find(std::string(parser.path()));
+    if (it == m_handlers.end()) {
+      response.status = 404;
+      response.body = StatusText(404);
+    } else if (parser.method() != "GET" && parser.method() != "HEAD") {
+      response.status = 405;
+      response.headers.emplace_back("Allow", "GET, HEAD");
+      response.body = StatusText(405);
+    } else {
+      it->second(parser, response);
+      if (parser.method() == "HEAD") {
+        response.body.clear();
+      }
+    }
+    respond(conn, response, parser.keep_alive());
+
+    conn->consumed += parser.size();
+    parser.reset();
+  }
+
+  // 丢弃已经处理的请求,未完整的请求移动到缓冲区开头,解析器只记录偏移
+  if (conn->consumed == conn->input.size()) {
+    conn->input.clear();
+    conn->consumed = 0;
+  } else if (conn->consumed > 0) {
+    conn->input.erase(0, conn->consumed);
+    conn->consumed = 0;
+  }
+
+  if (!conn->output.empty()) {
+    handle_write(conn);
+  }
+}
+
+void HttpServer::respond(Connection* conn, const HttpResponse& response,
+                         bool keep_alive) {
+  std::string& out = conn->output;
+  out += "HTTP/1.1 ";
+  out += std::to_string(response.status);
+  out += ' ';
+  out += StatusText(response.status);
+  out += "\r\nContent-Type: ";
+  out += response.content_type;
+  out += "\r\nContent-Length: ";
+  out += std::to_string(response.body.size());
+  out += keep_alive ? "\r\nConnection: keep-alive\r\n"
+                    : "\r\nConnection: close\r\n";
+  for (auto& [name, value] : response.headers) {
+    out += name;
+    out += ": ";
+    out += value;
+    out += "\r\n";
+  }
+  out += "\r\n";
+  out += response.body;
+
+  if (!keep_alive) {
+    conn->closing = true;
+  }
+}
+
+void HttpServer::handle_write(Connection* conn) {
+  while (conn->written < conn->output.size()) {
+    int n = conn->sock->send(conn->output.data() + conn->written,
+                             conn->output.size() - conn->written, SEND_FLAGS);
+    if (n > 0) {
+      conn->written += n;
+      conn->last_active = TimePoint::Now();
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+      if (conn->output.size() - conn->written > m_options.max_output) {
+        LOG_WARN(log::Loggers::engine)
+            << m_options.name << " output overflow, close connection";
+        close(conn);
+        return;
+      }
+      // 等待可写,期间不再读取新的请求
+      m_loop->update_event(conn->sock->socket(), EventLoop::eWrite);
+      return;
+    }
+    close(conn);
+    return;
+  }
+
+  conn->output.clear();
+  conn->written = 0;
+  if (conn->closing) {
+    close(conn);
+    return;
+  }
+  m_loop->update_event(conn->sock->socket(), EventLoop::eRead);
+}
+
+void HttpServer::close(Connection* conn) {
+  socket_type fd = conn->sock->socket();
+  m_loop->remove_event(fd);
+  conn->sock->close();
+  if (m_connections.erase(fd)) {
+    --m_connection_count;
+  }
+}
+
+void HttpServer::check_idle() {
+  TimePoint now = TimePoint::Now();
+  std::vector<Connection*> idle;
+  for (auto& [fd, conn] : m_connections) {
+    if (now - conn->last_active >= m_options.idle_timeout) {
+      idle.push_back(conn.get());
+    }
+  }
+  for (auto conn : idle) {
+    close(conn);
+  }
+}
+
+}  // namespace cx::net
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cx/common/internal.h"
+#include "cx/common/noncopyable.h"
+#include "cx/net/event_loop.h"
+#include "cx/net/http_parser.h"
+#include "cx/net/socket.h"
+#include "cx/utils/time/time.h"
+
+namespace cx::net {
+
+/**
+ * @brief HTTP响应
+ */
+struct HttpResponse {
+  int status = 200;
+  std::string content_type = "text/plain; charset=utf-8";
+  std::vector<std::pair<std::string, std::string>> headers;  // 额外的头部
+  std::string body;
+};
+
+/**
+ * @brief 小型的非阻塞HTTP/1.1服务器,用于调试与监控接口
+ *
+ * 在单独的事件循环线程中运行,不会阻塞调用者的线程。请求直接解析在连接的
+ * 接收缓冲区中,支持keep-alive与流水线;只按路径精确匹配处理函数,
+ * 处理函数在服务器的线程中执行
+ */
+class HttpServer : public Noncopyable {
+ public:
+  typedef std::shared_ptr<HttpServer> ptr;
+  typedef std::function<void(const HttpRequestParser& request,
+                             HttpResponse& response)>
+      handler_t;
+
+  /**
+   * @brief 服务器参数
+   */
+  struct Options {
+    std::string name = "http_server";  // 服务器名称,用作线程名
+    size_t max_connections = 64;        // 最大连接数,超过时直接关闭新连接
+    size_t max_header_size = 8 * 1024;  // 请求行与头部的最大长度
+    size_t max_body_size = 64 * 1024;   // 请求体的最大长度
+    size_t max_output = 16 * 1024 * 1024;  // 未发送的响应上限,超过时关闭连接
+    time::TimePoint idle_timeout = time::TimePoint::Seconds(30);  // 空闲超时,0为不检查
+  };
+
+  /**
+   * @brief 使用默认参数构造
+   */
+  HttpServer();
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] options 服务器参数
+   */
+  HttpServer(const Options& options);
+
+  /**
+   * @brief 析构函数,未停止时会先停止
+   */
+  ~HttpServer();
+
+  /**
+   * @brief 设置路径的处理函数,只能在启动前调用
+   *
+   * @param[in] path    路径,如/metrics
+   * @param[in] handler 处理函数
+   */
+  void handle(const std::string& path, handler_t handler);
+
+  /**
+   * @brief 绑定地址,可多次调用以监听多个地址
+   *
+   * @return 是否成功
+   */
+  bool bind(Address::ptr address);
+
+  /**
+   * @brief 启动服务器线程
+   *
+   * @return 是否成功
+   */
+  bool start();
+
+  /**
+   * @brief 停止服务器并关闭所有连接,不能在服务器线程中调用
+   */
+  void stop();
+
+  bool is_running() const { return m_running; }
+
+  const Options& options() const { return m_options; }
+
+  /**
+   * @brief 获取监听的地址(端口为0时可以获取实际端口)
+   */
+  std::vector<Address::ptr> listen_addresses() const;
+
+  /**
+   * @brief 当前连接数量
+   */
+  size_t connection_count() const { return m_connection_count; }
+
+  /**
+   * @brief 累计处理的请求数量
+   */
+  uint64_t request_count() const { return m_request_count; }
+
+ private:
+  /**
+   * @brief 连接,只在服务器线程中访问
+   */
+  struct Connection {
+    Socket::ptr sock;
+    std::string input;
+    size_t consumed = 0;  // input中已经处理的请求的长度
+    std::string output;
+    size_t written = 0;  // output中已经发送的长度
+    HttpRequestParser parser;
+    time::TimePoint last_active;
+    bool closing = false;  // 发送完响应后关闭
+
+    Connection(Socket::ptr sock, size_t max_header, size_t max_body)
+        : sock(std::move(sock)), parser(max_header, max_body) {}
+  };
+
+  void handle_accept(Socket::ptr listener);
+  void handle_event(socket_type fd, uint32_t events);
+  void handle_read(Connection* conn);
+  void handle_write(Connection* conn);
+  void process(Connection* conn);
+  void respond(Connection* conn, const HttpResponse& response, bool keep_alive);
+  void close(Connection* conn);
+  void check_idle();
+
+ private:
+  Options m_options;
+  std::unordered_map<std::string, handler_t> m_handlers;
+  std::vector<Socket::ptr> m_listeners;
+  std::vector<Address::ptr> m_addresses;
+  std::unordered_map<socket_type, std::unique_ptr<Connection>> m_connections;
+  EventLoopThread::ptr m_thread;
+  EventLoop* m_loop;
+  uint64_t m_idle_timer;
+  std::atomic<bool> m_running;
+  std::atomic<size_t> m_connection_count;
+  std::atomic<uint64_t> m_request_count;
+};
+
+}  // namespace cx::net
@@ -0,0 +1,137 @@
+#include "metrics_server.h"
+
+#include <cstdio>
+
+#include "cx/common/logger.h"
+#include "cx/utils/time/time.h"
+
+#if defined(CX_PLATFORM_LINUX)
+#include <unistd.h>
+#endif
+#include <sys/resource.h>
+
+namespace cx::net {
+
+using namespace time;
+
+/**
+ * @brief 进程的内存占用
+ *
+ * @param[in] resident 为true时返回常驻内存,否则返回虚拟内存
+ *
+ * @return 字节数
+ */
+static double ProcessMemory(bool resident) {
+#if defined(CX_PLATFORM_LINUX)
+  FILE* file = fopen("/proc/self/statm", "r");
+  if (!file) {
+    return 0.0;
+  }
+  unsigned long long size = 0, rss = 0;
+  int n = fscanf(file, "%llu %llu", &size, &rss);
+  fclose(file);
+  if (n != 2) {
+    return 0.0;
+  }
+  return (double)(resident ? rss : size) * sysconf(_SC_PAGESIZE);
+#else
+  if (!resident) {
+    return 0.0;
+  }
+  // 其他平台只能取得峰值常驻内存,macOS的单位是字节
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (double)usage.ru_maxrss;
+#endif
+}
+
+static double ProcessCpuSeconds() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static HttpServer::Options DefaultOptions() {
+  HttpServer::Options options;
+  options.name = "metrics";
+  return options;
+}
+
+MetricsServer::MetricsServer() : MetricsServer(DefaultOptions()) {}
+
+MetricsServer::MetricsServer(const HttpServer::Options& options)
+    : m_server(options), m_last_size(4096) {
+  auto registry = metrics::Registry::Self();
+  m_scrapes = registry->counter("cx_metrics_scrapes_total",
+                                "Number of metrics scrapes");
+  m_scrape_seconds = registry->gauge("cx_metrics_scrape_seconds",
+                                     "Time spent serializing the last scrape");
+
+  m_server.handle("/metrics",
+                  [this](const HttpRequestParser&, HttpResponse& response) {
+                    serve(response, false);
+                  });
+  m_server.handle("/metrics.json",
+                  [this](const HttpRequestParser&, HttpResponse& response) {
+                    serve(response, true);
+                  });
+}
+
+MetricsServer::~MetricsServer() { stop(); }
+
+bool MetricsServer::bind(Address::ptr address) {
+  return m_server.bind(address);
+}
+
+bool MetricsServer::start() {
+  RegisterProcessMetrics();
+  return m_server.start();
+}
+
+void MetricsServer::stop() { m_server.stop(); }
+
+void MetricsServer::RegisterProcessMetrics() {
+  auto registry = metrics::Registry::Self();
+  registry->callback("process_resident_memory_bytes",
+                     "Resident memory size in bytes", metrics::Type::eGauge,
+                     []() { return ProcessMemory(true); });
+  registry->callback("process_virtual_memory_bytes",
+                     "Virtual memory size in bytes", metrics::Type::eGauge,
+                     []() { return ProcessMemory(false); });
+  registry->callback("process_cpu_seconds_total",
+                     "Total user and system CPU time spent in seconds",
+                     metrics::Type::eCounter, ProcessCpuSeconds);
+  SocketRegistry::RegisterMetrics();
+
+  // 日志器不会被销毁,回调中可以直接持有
+  for (auto& logger : log::LogManager::Self()->getLoggers()) {
+    metrics::Registry::labels_t labels = {{"logger", logger->getName()}};
+    registry->callback(
+        "cx_log_events_total", "Log events at or above the logger level",
+        metrics::Type::eCounter,
+        [logger]() { return (double)logger->getEventCount(); }, labels);
+    registry->callback(
+        "cx_log_pending", "Log events being written or waiting for the logger",
+        metrics::Type::eGauge,
+        [logger]() { return (double)logger->getPendingCount(); }, labels);
+  }
+}
+
+void MetricsServer::serve(HttpResponse& response, bool json) {
+  TimePoint start = TimePoint::Now();
+  m_scrapes->inc();
+
+  response.body.reserve(m_last_size + m_last_size / 4);
+  if (json) {
+    response.content_type = "application/json";
+    metrics::Registry::Self()->write_json(response.body);
+  } else {
+    response.content_type = "text/plain; version=0.0.4; charset=utf-8";
+    metrics::Registry::Self()->write_prometheus(response.body);
+  }
+  m_last_size = response.body.size();
+  m_scrape_seconds->set((TimePoint::Now() - start).AsMicroseconds() / 1e6);
+}
+
+}  // namespace cx::net
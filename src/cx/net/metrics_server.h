@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "cx/common/internal.h"
+#include "cx/common/noncopyable.h"
+#include "cx/net/http_server.h"
+#include "cx/utils/metrics/metrics.h"
+
+namespace cx::net {
+
+/**
+ * @brief 通过HTTP提供指标注册表的内容
+ *
+ * GET /metrics 返回Prometheus文本格式,GET /metrics.json 返回JSON。
+ * 服务器在自己的线程中运行,采集只读取原子变量,不会阻塞帧循环;
+ * 启动时同时注册进程的内存,cpu时间以及日志器的指标
+ */
+class MetricsServer : public Noncopyable {
+ public:
+  typedef std::shared_ptr<MetricsServer> ptr;
+
+  /**
+   * @brief 使用默认参数构造
+   */
+  MetricsServer();
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] options HTTP服务器参数
+   */
+  MetricsServer(const HttpServer::Options& options);
+
+  ~MetricsServer();
+
+  /**
+   * @brief 绑定地址,如127.0.0.1:9100
+   *
+   * @return 是否成功
+   */
+  bool bind(Address::ptr address);
+
+  bool start();
+
+  void stop();
+
+  HttpServer& http() { return m_server; }
+
+  /**
+   * @brief 注册进程、socket与日志器的指标,start时自动调用,重复调用是安全的
+   *
+   * 之后创建的日志器不会被注册
+   */
+  CX_STATIC void RegisterProcessMetrics();
+
+ private:
+  void serve(HttpResponse& response, bool json);
+
+ private:
+  HttpServer m_server;
+  metrics::Counter::ptr m_scrapes;
+  metrics::Gauge::ptr m_scrape_seconds;
+  std::atomic<size_t> m_last_size;  // 上一次输出的长度,用于预分配
+};
+
+}  // namespace cx::net
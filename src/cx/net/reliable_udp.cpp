@@ -0,0 +1,521 @@
+#include "reliable_udp.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "cx/net/endian.h"
+
+namespace cx::net {
+
+using namespace time;
+
+/**
+ * @brief 段类型
+ *
+ * 数据报: conv(4) 段...
+ *   ePush:       cmd(1) frg(1) len(2) sn(4) ts(4) 数据
+ *   eUnreliable: cmd(1) len(2) seq(2) 数据
+ *   eAck:        cmd(1) wnd(2) una(4) ts(4) mask(8)
+ * 多字节字段为网络字节序
+ */
+enum SegmentCmd : uint8_t {
+  ePush = 1,
+  eUnreliable = 2,
+  eAck = 3,
+};
+
+static const size_t PACKET_HEADER = 4;
+static const size_t PUSH_HEADER = 12;
+static const size_t UNRELIABLE_HEADER = 5;
+static const size_t ACK_SIZE = 19;
+static const size_t MAX_FRAGMENTS = 256;
+static const uint32_t SACK_BITS = 64;
+
+template <class T>
+static CX_INLINE void Put(std::string& buf, T value) {
+  value = byteswapOnLittleEndian(value);
+  buf.append((const char*)&value, sizeof(value));
+}
+
+static CX_INLINE void Put(std::string& buf, uint8_t value) {
+  buf.push_back((char)value);
+}
+
+template <class T>
+static CX_INLINE T Get(const char* data) {
+  T value;
+  memcpy(&value, data, sizeof(value));
+  return byteswapOnLittleEndian(value);
+}
+
+// 时间戳只用于计算往返时间,截断为32位微秒,差值在回绕时仍然正确
+static CX_INLINE uint32_t Timestamp(int64_t now) { return (uint32_t)now; }
+
+ReliableUdp::ReliableUdp(output_callback_t output)
+    : ReliableUdp(std::move(output), Options()) {}
+
+ReliableUdp::ReliableUdp(output_callback_t output, const Options& options)
+    : m_options(options),
+      m_output(std::move(output)),
+      m_dead(false),
+      m_snd_una(0),
+      m_snd_nxt(0),
+      m_rmt_wnd(options.recv_window),
+      m_unreliable_send_seq(0),
+      m_cwnd(options.congestion ? 2 : options.send_window),
+      m_ssthresh(options.send_window),
+      m_cwnd_acked(0),
+      m_recover(0),
+      m_srtt(0),
+      m_rttvar(0),
+      m_rto(options.initial_rto.AsMicroseconds()),
+      m_rcv_nxt(0),
+      m_ack_pending(false),
+      m_ack_ts(0),
+      m_assemble_segments(0),
+      m_reading(true),
+      m_recv_queued(0),
+      m_unreliable_pending(false),
+      m_unreliable_received(false),
+      m_unreliable_recv_seq(0),
+      m_next_flush(0) {
+  m_options.recv_window = std::max(1u, std::min(m_options.recv_window, 65535u));
+  m_options.send_window = std::max(1u, m_options.send_window);
+  m_recv_buffer.resize(m_options.recv_window);
+  m_packet.reserve(m_options.mtu);
+}
+
+size_t ReliableUdp::max_message_size() const {
+  return (m_options.mtu - PACKET_HEADER - PUSH_HEADER) * MAX_FRAGMENTS;
+}
+
+size_t ReliableUdp::max_unreliable_size() const {
+  return m_options.mtu - PACKET_HEADER - UNRELIABLE_HEADER;
+}
+
+bool ReliableUdp::send(const void* data, size_t len, Channel channel) {
+  if (m_dead) {
+    return false;
+  }
+
+  if (channel == Channel::eUnreliable) {
+    if (len > max_unreliable_size()) {
+      return false;
+    }
+    m_unreliable_queue.emplace_back((const char*)data, len);
+    ++m_stats.messages_sent;
+    return true;
+  }
+
+  if (len > max_message_size()) {
+    return false;
+  }
+  size_t mss = m_options.mtu - PACKET_HEADER - PUSH_HEADER;
+  size_t count = len == 0 ? 1 : (len + mss - 1) / mss;
+  const char* ptr = (const char*)data;
+  for (size_t i = 0; i < count; ++i) {
+    size_t size = std::min(mss, len - i * mss);
+    m_send_queue.emplace_back();
+    Segment& seg = m_send_queue.back();
+    seg.frg = (uint8_t)(count - 1 - i);
+    seg.data.assign(ptr + i * mss, size);
+  }
+  ++m_stats.messages_sent;
+  return true;
+}
+
+bool ReliableUdp::input(const char* data, size_t len,
+                        const TimePoint& now) {
+  if (len < PACKET_HEADER || Get<uint32_t>(data) != m_options.conv) {
+    ++m_stats.invalid_packets;
+    return false;
+  }
+  ++m_stats.packets_received;
+  m_stats.bytes_received += len;
+
+  int64_t now_us = now.AsMicroseconds();
+  const char* ptr = data + PACKET_HEADER;
+  const char* end = data + len;
+  while (ptr < end) {
+    size_t remain = end - ptr;
+    switch ((uint8_t)*ptr) {
+      case ePush: {
+        if (remain < PUSH_HEADER) {
+          ++m_stats.invalid_packets;
+          return false;
+        }
+        uint8_t frg = (uint8_t)ptr[1];
+        uint16_t size = Get<uint16_t>(ptr + 2);
+        uint32_t sn = Get<uint32_t>(ptr + 4);
+        uint32_t ts = Get<uint32_t>(ptr + 8);
+        if (remain < PUSH_HEADER + size) {
+          ++m_stats.invalid_packets;
+          return false;
+        }
+        parse_push(sn, frg, ts, ptr + PUSH_HEADER, size);
+        ptr += PUSH_HEADER + size;
+        break;
+      }
+      case eUnreliable: {
+        if (remain < UNRELIABLE_HEADER) {
+          ++m_stats.invalid_packets;
+          return false;
+        }
+        uint16_t size = Get<uint16_t>(ptr + 1);
+        uint16_t seq = Get<uint16_t>(ptr + 3);
+        if (remain < UNRELIABLE_HEADER + size) {
+          ++m_stats.invalid_packets;
+          return false;
+        }
+        parse_unreliable(seq, ptr + UNRELIABLE_HEADER, size);
+        ptr += UNRELIABLE_HEADER + size;
+        break;
+      }
+      case eAck: {
+        if (remain < ACK_SIZE) {
+          ++m_stats.invalid_packets;
+          return false;
+        }
+        parse_ack(ptr, now_us);
+        ptr += ACK_SIZE;
+        break;
+      }
+      default:
+        ++m_stats.invalid_packets;
+        return false;
+    }
+  }
+  return true;
+}
+
+void ReliableUdp::parse_ack(const char* data, int64_t now) {
+  m_rmt_wnd = Get<uint16_t>(data + 1);
+  uint32_t una = Get<uint32_t>(data + 3);
+  uint32_t ts = Get<uint32_t>(data + 7);
+  uint64_t mask = Get<uint64_t>(data + 11);
+
+  // 被确认的最大序号,序号更小却未被确认的段视为被跳过一次
+  uint32_t highest = mask ? una + SACK_BITS - __builtin_clzll(mask) : una - 1;
+  uint32_t newly = 0;
+  for (Segment& seg : m_flight) {
+    if (seg.acked) {
+      continue;
+    }
+    int32_t diff = (int32_t)(seg.sn - una);
+    if (diff < 0 ||
+        (diff > 0 && diff <= (int32_t)SACK_BITS && (mask >> (diff - 1)) & 1)) {
+      seg.acked = true;
+      ++newly;
+    } else if ((int32_t)(seg.sn - highest) < 0) {
+      ++seg.fastack;
+    }
+  }
+  if (newly == 0) {
+    return;
+  }
+
+  // 时间戳回显的是对端最近收到的段,只在确认了新数据时采样,避免重复的确认
+  int32_t rtt = (int32_t)(Timestamp(now) - ts);
+  if (rtt >= 0) {
+    update_rtt(rtt);
+  }
+
+  uint32_t old_una = m_snd_una;
+  while (!m_flight.empty() && m_flight.front().acked) {
+    m_flight.pop_front();
+  }
+  m_snd_una = m_flight.empty() ? m_snd_nxt : m_flight.front().sn;
+
+  uint32_t advanced = m_snd_una - old_una;
+  if (m_options.congestion && advanced > 0) {
+    if (m_cwnd < m_ssthresh) {
+      m_cwnd += advanced;
+    } else {
+      m_cwnd_acked += advanced;
+      while (m_cwnd_acked >= m_cwnd) {
+        m_cwnd_acked -= m_cwnd;
+        ++m_cwnd;
+      }
+    }
+    m_cwnd = std::min(m_cwnd, m_options.send_window);
+  }
+}
+
+void ReliableUdp::parse_push(uint32_t sn, uint8_t frg, uint32_t ts,
+                             const char* data, size_t len) {
+  // 重复的段也要确认,对端可能没有收到之前的确认
+  m_ack_pending = true;
+  m_ack_ts = ts;
+
+  int32_t diff = (int32_t)(sn - m_rcv_nxt);
+  if (diff < 0 || diff >= (int32_t)recv_free()) {
+    return;
+  }
+
+  uint32_t window = m_options.recv_window;
+  if (diff == 0) {
+    // 按序到达时不经过接收窗口直接交付
+    deliver(frg, data, len);
+    ++m_rcv_nxt;
+  } else {
+    Slot& slot = m_recv_buffer[sn % window];
+    if (slot.used) {
+      return;
+    }
+    slot.used = true;
+    slot.sn = sn;
+    slot.frg = frg;
+    slot.data.assign(data, len);
+    return;
+  }
+
+  while (true) {
+    Slot& slot = m_recv_buffer[m_rcv_nxt % window];
+    if (!slot.used || slot.sn != m_rcv_nxt) {
+      break;
+    }
+    slot.used = false;
+    deliver(slot.frg, slot.data.data(), slot.data.size());
+    slot.data.clear();
+    ++m_rcv_nxt;
+  }
+}
+
+void ReliableUdp::parse_unreliable(uint16_t seq, const char* data,
+                                   size_t len) {
+  if (m_unreliable_received &&
+      (int16_t)(seq - m_unreliable_recv_seq) <= 0) {
+    ++m_stats.unreliable_dropped;
+    return;
+  }
+  m_unreliable_received = true;
+  m_unreliable_recv_seq = seq;
+  ++m_stats.messages_received;
+  if (!m_reading) {
+    if (m_unreliable_pending) {
+      ++m_stats.unreliable_dropped;
+    }
+    m_unreliable_pending = true;
+    m_unreliable_message.assign(data, len);
+    return;
+  }
+  if (m_message_callback) {
+    m_message_callback(Channel::eUnreliable, data, len);
+  }
+}
+
+void ReliableUdp::deliver(uint8_t frg, const char* data, size_t len) {
+  if (frg == 0 && m_assemble.empty()) {
+    deliver_message(data, len, 1);
+    return;
+  }
+
+  m_assemble.append(data, len);
+  ++m_assemble_segments;
+  if (frg == 0) {
+    std::string message;
+    message.swap(m_assemble);
+    uint32_t segments = m_assemble_segments;
+    m_assemble_segments = 0;
+    deliver_message(message.data(), message.size(), segments);
+  }
+}
+
+void ReliableUdp::deliver_message(const char* data, size_t len,
+                                  uint32_t segments) {
+  ++m_stats.messages_received;
+  if (!m_reading) {
+    m_recv_queue.emplace_back(std::string(data, len), segments);
+    m_recv_queued += segments;
+    return;
+  }
+  if (m_message_callback) {
+    m_message_callback(Channel::eReliable, data, len);
+  }
+}
+
+uint32_t ReliableUdp::recv_free() const {
+  return m_options.recv_window - std::min(m_recv_queued, m_options.recv_window);
+}
+
+void ReliableUdp::set_reading(bool enable) {
+  if (m_reading == enable) {
+    return;
+  }
+  m_reading = enable;
+  if (!enable) {
+    return;
+  }
+
+  // 回调中可能再次停止交付
+  while (m_reading && !m_recv_queue.empty()) {
+    std::pair<std::string, uint32_t> message = std::move(m_recv_queue.front());
+    m_recv_queue.pop_front();
+    m_recv_queued -= message.second;
+    if (m_message_callback) {
+      m_message_callback(Channel::eReliable, message.first.data(),
+                         message.first.size());
+    }
+  }
+  if (m_reading && m_unreliable_pending) {
+    m_unreliable_pending = false;
+    if (m_message_callback) {
+      m_message_callback(Channel::eUnreliable, m_unreliable_message.data(),
+                         m_unreliable_message.size());
+    }
+  }
+  // 通告释放出的接收窗口
+  m_ack_pending = true;
+}
+
+void ReliableUdp::update_rtt(int64_t rtt) {
+  // RFC 6298
+  if (m_srtt == 0) {
+    m_srtt = std::max<int64_t>(rtt, 1);
+    m_rttvar = rtt / 2;
+  } else {
+    int64_t delta = rtt > m_srtt ? rtt - m_srtt : m_srtt - rtt;
+    m_rttvar = (3 * m_rttvar + delta) / 4;
+    m_srtt = std::max<int64_t>((7 * m_srtt + rtt) / 8, 1);
+  }
+  int64_t rto = m_srtt + std::max<int64_t>(m_options.interval.AsMicroseconds(),
+                                           4 * m_rttvar);
+  m_rto = std::clamp<int64_t>(rto, m_options.min_rto.AsMicroseconds(),
+                              m_options.max_rto.AsMicroseconds());
+}
+
+void ReliableUdp::update(const TimePoint& now) {
+  int64_t now_us = now.AsMicroseconds();
+  if (now_us < m_next_flush) {
+    return;
+  }
+  flush(now);
+  int64_t interval = m_options.interval.AsMicroseconds();
+  m_next_flush += interval;
+  if (m_next_flush <= now_us) {
+    m_next_flush = now_us + interval;
+  }
+}
+
+TimePoint ReliableUdp::next_update(const TimePoint& now) const {
+  return TimePoint::Microseconds(
+      std::max<int64_t>(m_next_flush, now.AsMicroseconds()));
+}
+
+void ReliableUdp::reserve_packet(size_t len) {
+  if (m_packet.size() + len > m_options.mtu) {
+    output_packet();
+  }
+  if (m_packet.empty()) {
+    Put(m_packet, m_options.conv);
+  }
+}
+
+void ReliableUdp::output_packet() {
+  if (m_packet.size() > PACKET_HEADER) {
+    ++m_stats.packets_sent;
+    m_stats.bytes_sent += m_packet.size();
+    m_output(m_packet.data(), m_packet.size());
+  }
+  m_packet.clear();
+}
+
+void ReliableUdp::flush(const TimePoint& now) {
+  int64_t now_us = now.AsMicroseconds();
+  m_packet.clear();
+
+  if (m_ack_pending) {
+    uint64_t mask = 0;
+    uint32_t window = m_options.recv_window;
+    for (uint32_t i = 0; i < SACK_BITS && i + 1 < window; ++i) {
+      uint32_t sn = m_rcv_nxt + 1 + i;
+      const Slot& slot = m_recv_buffer[sn % window];
+      if (slot.used && slot.sn == sn) {
+        mask |= 1ull << i;
+      }
+    }
+    // 通告接收窗口中还能接收的段数,停止交付时随缓存的消息减小
+    reserve_packet(ACK_SIZE);
+    Put(m_packet, (uint8_t)eAck);
+    Put(m_packet, (uint16_t)recv_free());
+    Put(m_packet, m_rcv_nxt);
+    Put(m_packet, m_ack_ts);
+    Put(m_packet, mask);
+    m_ack_pending = false;
+  }
+
+  // 新数据进入发送窗口
+  uint32_t window = std::min(m_options.send_window, std::max(m_rmt_wnd, 1u));
+  if (m_options.congestion) {
+    window = std::min(window, m_cwnd);
+  }
+  while (!m_send_queue.empty() && m_snd_nxt - m_snd_una < window) {
+    m_flight.push_back(std::move(m_send_queue.front()));
+    m_send_queue.pop_front();
+    Segment& seg = m_flight.back();
+    seg.sn = m_snd_nxt++;
+    seg.rto = m_rto;
+  }
+
+  // 同一个窗口内的多次丢失只减小一次拥塞窗口
+  bool lost = false;
+  bool fast = false;
+  for (Segment& seg : m_flight) {
+    if (seg.acked) {
+      continue;
+    }
+    bool new_loss = (int32_t)(seg.sn - m_recover) >= 0;
+    if (seg.xmit == 0) {
+      // 首次发送
+    } else if (m_options.fast_resend && seg.fastack >= m_options.fast_resend) {
+      fast = fast || new_loss;
+      ++m_stats.fast_retransmits;
+    } else if (now_us >= seg.resend_at) {
+      lost = lost || new_loss;
+      ++m_stats.retransmits;
+      seg.rto = std::min(seg.rto + seg.rto / 2,
+                         (int64_t)m_options.max_rto.AsMicroseconds());
+    } else {
+      continue;
+    }
+
+    if (++seg.xmit > m_options.max_retransmits + 1) {
+      m_dead = true;
+    }
+    seg.fastack = 0;
+    seg.resend_at = now_us + seg.rto;
+    ++m_stats.segments_sent;
+
+    reserve_packet(PUSH_HEADER + seg.data.size());
+    Put(m_packet, (uint8_t)ePush);
+    Put(m_packet, seg.frg);
+    Put(m_packet, (uint16_t)seg.data.size());
+    Put(m_packet, seg.sn);
+    Put(m_packet, Timestamp(now_us));
+    m_packet.append(seg.data);
+  }
+
+  for (auto& message : m_unreliable_queue) {
+    reserve_packet(UNRELIABLE_HEADER + message.size());
+    Put(m_packet, (uint8_t)eUnreliable);
+    Put(m_packet, (uint16_t)message.size());
+    Put(m_packet, ++m_unreliable_send_seq);
+    m_packet.append(message);
+  }
+  m_unreliable_queue.clear();
+
+  output_packet();
+
+  if (m_options.congestion && (fast || lost)) {
+    // RFC 5681: 慢启动阈值取在途数据量的一半
+    uint32_t in_flight = m_snd_nxt - m_snd_una;
+    m_ssthresh = std::max(in_flight / 2, 2u);
+    m_cwnd = lost ? 1
+                  : std::min(m_ssthresh + m_options.fast_resend,
+                             m_options.send_window);
+    m_cwnd_acked = 0;
+    m_recover = m_snd_nxt;
+  }
+}
+
+}  // namespace cx::net
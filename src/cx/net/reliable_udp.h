@@ -0,0 +1,296 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cx/common/internal.h"
+#include "cx/common/noncopyable.h"
+#include "cx/utils/time/time.h"
+
+namespace cx::net {
+
+/**
+ * @brief 基于UDP的可靠有序传输(ARQ)协议层
+ *
+ * 只实现协议本身,不持有socket:数据报通过output回调发出,收到的数据报由调用者
+ * 交给input;所有时间都由调用者传入,因此可以在模拟的丢包链路上确定性地运行。
+ *
+ * 每个数据报由会话号和若干段组成,一次flush把确认,重传,新数据与不可靠消息
+ * 合并到不超过mtu的数据报中。确认包含累计确认与之后64个序号的选择确认位图,
+ * 发送端收到跳过某个段的确认达到fast_resend次后立即重传,否则按rto超时重传。
+ * 不可靠通道的消息不重传,比已经收到的更旧的消息会被丢弃,适合状态同步。
+ *
+ * 拥塞控制把丢包都当作拥塞:超时重传后拥塞窗口降为1,同一个窗口内的多次丢失
+ * 只减小一次。低速率的实时消息在随机丢包的链路上窗口会一直很小,在途只有一个
+ * 段时后面没有段可以触发快速重传,丢包时延迟可达数秒;这类流量的速率由发送
+ * 频率决定,应关闭congestion。
+ *
+ * 不是线程安全的,应在同一个线程(通常是事件循环线程)中使用
+ */
+class ReliableUdp : public Noncopyable {
+ public:
+  typedef std::shared_ptr<ReliableUdp> ptr;
+
+  /**
+   * @brief 消息通道
+   */
+  enum class Channel : uint8_t {
+    eReliable = 0,    // 可靠有序
+    eUnreliable = 1,  // 不可靠,只保留最新
+  };
+
+  typedef std::function<void(const char* data, size_t len)> output_callback_t;
+  typedef std::function<void(Channel channel, const char* data, size_t len)>
+      message_callback_t;
+
+  /**
+   * @brief 协议参数,两端的conv与mtu必须一致
+   */
+  struct Options {
+    uint32_t conv = 0;            // 会话号,不一致的数据报会被丢弃
+    size_t mtu = 1200;            // 数据报的最大长度
+    uint32_t send_window = 256;   // 发送窗口,段数
+    uint32_t recv_window = 256;   // 接收窗口,段数
+    uint32_t fast_resend = 2;     // 被跳过多少次确认后快速重传,0为关闭
+    bool congestion = true;       // 是否启用拥塞控制,低速率的实时同步可以关闭以降低丢包时的尾延迟
+    uint32_t max_retransmits = 32;  // 单个段重传超过该次数时认为连接已断开
+    time::TimePoint interval = time::TimePoint::Milliseconds(10);  // update的flush间隔
+    time::TimePoint initial_rto = time::TimePoint::Milliseconds(200);
+    time::TimePoint min_rto = time::TimePoint::Milliseconds(30);
+    time::TimePoint max_rto = time::TimePoint::Seconds(5);
+  };
+
+  /**
+   * @brief 统计信息
+   */
+  struct Stats {
+    uint64_t packets_sent = 0;
+    uint64_t packets_received = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t bytes_received = 0;
+    uint64_t messages_sent = 0;
+    uint64_t messages_received = 0;
+    uint64_t segments_sent = 0;       // 可靠段的发送次数,包括重传
+    uint64_t retransmits = 0;         // 超时重传次数
+    uint64_t fast_retransmits = 0;    // 快速重传次数
+    uint64_t unreliable_dropped = 0;  // 过期而丢弃的不可靠消息
+    uint64_t invalid_packets = 0;     // 无法解析的数据报
+  };
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] output 发出数据报的回调
+   */
+  ReliableUdp(output_callback_t output);
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] output  发出数据报的回调
+   * @param[in] options 协议参数
+   */
+  ReliableUdp(output_callback_t output, const Options& options);
+
+  /**
+   * @brief 设置收到完整消息时的回调
+   */
+  void set_message_callback(message_callback_t cb) {
+    m_message_callback = std::move(cb);
+  }
+
+  /**
+   * @brief 开始/停止交付消息,用于接收方处理不过来时的流控
+   *
+   * 停止期间完整的可靠消息缓存在接收队列中,通告给对端的接收窗口减去其中的
+   * 段数,窗口用完后对端每次只试探发送一个段;不可靠消息只保留最新的一条。
+   * 恢复时立即交付缓存的消息,并在下一次flush时通告新的窗口
+   *
+   * @param[in] enable 是否交付
+   */
+  void set_reading(bool enable);
+
+  bool reading() const { return m_reading; }
+
+  /**
+   * @brief 停止交付期间缓存的可靠段数量
+   */
+  uint32_t queued() const { return m_recv_queued; }
+
+  /**
+   * @brief 发送消息,在下一次flush时发出
+   *
+   * @param[in] data    数据
+   * @param[in] len     长度;可靠消息不能超过max_message_size,
+   *                    不可靠消息不能超过max_unreliable_size
+   * @param[in] channel 通道
+   *
+   * @return 消息过长或连接已断开时返回false
+   */
+  bool send(const void* data, size_t len, Channel channel = Channel::eReliable);
+
+  /**
+   * @brief 处理收到的数据报,完整的消息通过消息回调交给调用者
+   *
+   * @param[in] data 数据报
+   * @param[in] len  长度
+   * @param[in] now  当前时间
+   *
+   * @return 数据报无效时返回false
+   */
+  bool input(const char* data, size_t len, const time::TimePoint& now);
+
+  /**
+   * @brief 定时调用,到达flush间隔时发送确认,重传与排队的消息
+   *
+   * @param[in] now 当前时间
+   */
+  void update(const time::TimePoint& now);
+
+  /**
+   * @brief 立即发送确认,重传与排队的消息,用于降低延迟
+   *
+   * @param[in] now 当前时间
+   */
+  void flush(const time::TimePoint& now);
+
+  /**
+   * @brief 下一次需要调用update的时间,用于设置定时器
+   *
+   * @param[in] now 当前时间
+   */
+  time::TimePoint next_update(const time::TimePoint& now) const;
+
+  /**
+   * @brief 可靠消息的最大长度
+   */
+  size_t max_message_size() const;
+
+  /**
+   * @brief 不可靠消息的最大长度
+   */
+  size_t max_unreliable_size() const;
+
+  /**
+   * @brief 等待发送与等待确认的可靠段数量
+   */
+  size_t pending() const { return m_send_queue.size() + m_flight.size(); }
+
+  /**
+   * @brief 是否因重传次数过多而断开
+   */
+  bool dead() const { return m_dead; }
+
+  /**
+   * @brief 平滑往返时间
+   */
+  time::TimePoint srtt() const { return time::TimePoint::Microseconds(m_srtt); }
+
+  /**
+   * @brief 当前的重传超时
+   */
+  time::TimePoint rto() const { return time::TimePoint::Microseconds(m_rto); }
+
+  /**
+   * @brief 拥塞窗口,段数
+   */
+  uint32_t cwnd() const { return m_cwnd; }
+
+  const Stats& stats() const { return m_stats; }
+
+  const Options& options() const { return m_options; }
+
+ private:
+  /**
+   * @brief 发送端的可靠段
+   */
+  struct Segment {
+    uint32_t sn = 0;
+    uint8_t frg = 0;  // 消息中剩余的分片数,最后一个分片为0
+    std::string data;
+    int64_t resend_at = 0;
+    int64_t rto = 0;
+    uint32_t xmit = 0;
+    uint32_t fastack = 0;
+    bool acked = false;
+  };
+
+  /**
+   * @brief 接收窗口中的乱序段
+   */
+  struct Slot {
+    bool used = false;
+    uint32_t sn = 0;
+    uint8_t frg = 0;
+    std::string data;
+  };
+
+  void parse_ack(const char* data, int64_t now);
+  void parse_push(uint32_t sn, uint8_t frg, uint32_t ts, const char* data,
+                  size_t len);
+  void parse_unreliable(uint16_t seq, const char* data, size_t len);
+  void deliver(uint8_t frg, const char* data, size_t len);
+  void deliver_message(const char* data, size_t len, uint32_t segments);
+
+  /**
+   * @brief 接收窗口中还能接收的段数
+   */
+  uint32_t recv_free() const;
+  void update_rtt(int64_t rtt);
+
+  /**
+   * @brief 确保数据报中还能放下len字节,否则先发出当前数据报
+   */
+  void reserve_packet(size_t len);
+  void output_packet();
+
+ private:
+  Options m_options;
+  output_callback_t m_output;
+  message_callback_t m_message_callback;
+  Stats m_stats;
+  bool m_dead;
+
+  // 发送
+  std::deque<Segment> m_send_queue;  // 还未分配序号的段
+  std::deque<Segment> m_flight;      // 已发出等待确认的段,按序号排列
+  std::vector<std::string> m_unreliable_queue;
+  uint32_t m_snd_una;
+  uint32_t m_snd_nxt;
+  uint32_t m_rmt_wnd;
+  uint16_t m_unreliable_send_seq;
+
+  // 拥塞控制
+  uint32_t m_cwnd;
+  uint32_t m_ssthresh;
+  uint32_t m_cwnd_acked;
+  uint32_t m_recover;  // 上次减小窗口时的m_snd_nxt,之前的段丢失不再减小
+
+  // 往返时间,微秒
+  int64_t m_srtt;
+  int64_t m_rttvar;
+  int64_t m_rto;
+
+  // 接收
+  std::vector<Slot> m_recv_buffer;  // 以序号对接收窗口取模为下标
+  uint32_t m_rcv_nxt;
+  bool m_ack_pending;
+  uint32_t m_ack_ts;
+  std::string m_assemble;  // 正在组装的多分片消息
+  uint32_t m_assemble_segments;
+  bool m_reading;
+  std::deque<std::pair<std::string, uint32_t>> m_recv_queue;  // 消息与段数
+  uint32_t m_recv_queued;
+  bool m_unreliable_pending;  // 停止交付期间收到的最新不可靠消息
+  std::string m_unreliable_message;
+  bool m_unreliable_received;
+  uint16_t m_unreliable_recv_seq;
+
+  int64_t m_next_flush;
+  std::string m_packet;
+};
+
+}  // namespace cx::net
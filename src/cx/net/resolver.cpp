@@ -0,0 +1,199 @@
+#include "resolver.h"
+
+#include "cx/common/logger.h"
+
+namespace cx::net {
+
+using namespace time;
+
+Resolver::Resolver() : Resolver(Options()) {}
+
+Resolver::Resolver(const Options& options) : m_options(options) {}
+
+Resolver::~Resolver() {
+  if (m_pool) {
+    m_pool->stop();
+  }
+}
+
+void Resolver::resolve(const std::string& host, callback_t callback,
+                       AddressFamily family, SocketType type,
+                       IpProtocol protocol) {
+  Key key{host, family, type, protocol};
+  TimePoint now = TimePoint::Now();
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = m_entries.find(key);
+  if (it != m_entries.end()) {
+    Entry& entry = it->second;
+    if (entry.pending) {
+      // 相同的查询正在进行,等待其结果
+      entry.waiters.push_back(std::move(callback));
+      return;
+    }
+    if (now < entry.expire) {
+      bool ok = entry.ok;
+      std::vector<Address::ptr> result = Copy(entry.addresses);
+      lock.unlock();
+      callback(ok, result);
+      return;
+    }
+  } else if (m_entries.size() >= m_options.max_entries) {
+    evict(now);
+  }
+
+  Entry& entry = m_entries[key];
+  entry.pending = true;
+  entry.waiters.push_back(std::move(callback));
+
+  if (!m_pool) {
+    // 单例在静态初始化阶段构造,线程延迟到第一次解析时再创建
+    m_pool.reset(new thread::ThreadPool("resolver", m_options.threads,
+                                        m_options.max_pending));
+    m_pool->start();
+  }
+  if (m_pool->submit([this, key]() { do_lookup(key); })) {
+    return;
+  }
+
+  LOG_WARN(log::Loggers::engine)
+      << "resolver queue is full, drop lookup: " << host;
+  std::vector<callback_t> waiters;
+  waiters.swap(entry.waiters);
+  m_entries.erase(key);
+  lock.unlock();
+
+  for (auto& cb : waiters) {
+    cb(false, {});
+  }
+}
+
+std::future<std::vector<Address::ptr>> Resolver::resolve(
+    const std::string& host, AddressFamily family, SocketType type,
+    IpProtocol protocol) {
+  auto promise = std::make_shared<std::promise<std::vector<Address::ptr>>>();
+  std::future<std::vector<Address::ptr>> future = promise->get_future();
+  resolve(
+      host,
+      [promise](bool, const std::vector<Address::ptr>& result) {
+        promise->set_value(result);
+      },
+      family, type, protocol);
+  return future;
+}
+
+bool Resolver::lookup(std::vector<Address::ptr>& result,
+                      const std::string& host, AddressFamily family,
+                      SocketType type, IpProtocol protocol) {
+  {
+    // 命中缓存时不需要经过future
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(Key{host, family, type, protocol});
+    if (it != m_entries.end() && !it->second.pending &&
+        TimePoint::Now() < it->second.expire) {
+      std::vector<Address::ptr> addresses = Copy(it->second.addresses);
+      result.insert(result.end(), addresses.begin(), addresses.end());
+      return it->second.ok;
+    }
+  }
+
+  std::vector<Address::ptr> addresses =
+      resolve(host, family, type, protocol).get();
+  result.insert(result.end(), addresses.begin(), addresses.end());
+  return !addresses.empty();
+}
+
+Address::ptr Resolver::lookup_any(const std::string& host,
+                                  AddressFamily family, SocketType type,
+                                  IpProtocol protocol) {
+  std::vector<Address::ptr> result;
+  if (lookup(result, host, family, type, protocol)) {
+    return result[0];
+  }
+  return nullptr;
+}
+
+bool Resolver::lookup_cached(std::vector<Address::ptr>& result,
+                             const std::string& host, AddressFamily family,
+                             SocketType type, IpProtocol protocol) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_entries.find(Key{host, family, type, protocol});
+  if (it == m_entries.end() || it->second.pending || !it->second.ok ||
+      TimePoint::Now() >= it->second.expire) {
+    return false;
+  }
+  std::vector<Address::ptr> addresses = Copy(it->second.addresses);
+  result.insert(result.end(), addresses.begin(), addresses.end());
+  return true;
+}
+
+void Resolver::clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto it = m_entries.begin(); it != m_entries.end();) {
+    if (it->second.pending) {
+      ++it;
+    } else {
+      it = m_entries.erase(it);
+    }
+  }
+}
+
+size_t Resolver::size() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_entries.size();
+}
+
+void Resolver::do_lookup(const Key& key) {
+  std::vector<Address::ptr> addresses;
+  bool ok = Address::Lookup(addresses, key.host, key.family, key.type,
+                            key.protocol);
+  if (!ok) {
+    LOG_DEBUG(log::Loggers::engine) << "resolve failed: " << key.host;
+  }
+
+  std::vector<callback_t> waiters;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry& entry = m_entries[key];
+    entry.ok = ok;
+    entry.pending = false;
+    entry.expire = TimePoint::Now() + (ok ? m_options.ttl : m_options.negative_ttl);
+    entry.addresses = addresses;
+    waiters.swap(entry.waiters);
+  }
+
+  for (auto& cb : waiters) {
+    cb(ok, Copy(addresses));
+  }
+}
+
+void Resolver::evict(const TimePoint& now) {
+  for (auto it = m_entries.begin(); it != m_entries.end();) {
+    if (!it->second.pending && now >= it->second.expire) {
+      it = m_entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  for (auto it = m_entries.begin();
+       it != m_entries.end() && m_entries.size() >= m_options.max_entries;) {
+    if (!it->second.pending) {
+      it = m_entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+std::vector<Address::ptr> Resolver::Copy(
+    const std::vector<Address::ptr>& addresses) {
+  std::vector<Address::ptr> result;
+  result.reserve(addresses.size());
+  for (auto& address : addresses) {
+    result.push_back(
+        Address::Generate(address->address(), address->address_len()));
+  }
+  return result;
+}
+
+}  // namespace cx::net
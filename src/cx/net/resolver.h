@@ -0,0 +1,177 @@
+#pragma once
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cx/common/internal.h"
+#include "cx/common/noncopyable.h"
+#include "cx/common/singleton.h"
+#include "cx/net/address.h"
+#include "cx/utils/thread/thread_pool.h"
+#include "cx/utils/time/time.h"
+
+namespace cx::net {
+
+/**
+ * @brief 带缓存的异步域名解析服务
+ *
+ * 在Address::Lookup之前加一层缓存:解析在有界线程池中执行,成功与失败的结果
+ * 分别按ttl与negative_ttl缓存,相同的查询在解析完成前只会执行一次
+ */
+class Resolver : public Noncopyable, public SingletonPtr<Resolver> {
+  friend SingletonPtr<Resolver>;
+
+ public:
+  typedef std::shared_ptr<Resolver> ptr;
+  typedef std::function<void(bool ok, const std::vector<Address::ptr>& result)>
+      callback_t;
+
+  /**
+   * @brief 解析参数
+   */
+  struct Options {
+    size_t threads = 2;                 // 解析线程数
+    size_t max_pending = 1024;          // 最多排队的解析任务
+    size_t max_entries = 4096;          // 最多缓存的条目
+    time::TimePoint ttl = time::TimePoint::Seconds(60);  // 解析成功的缓存时间
+    time::TimePoint negative_ttl = time::TimePoint::Seconds(5);  // 解析失败的缓存时间
+  };
+
+  /**
+   * @brief 使用默认参数构造
+   */
+  Resolver();
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] options 解析参数
+   */
+  Resolver(const Options& options);
+
+  /**
+   * @brief 析构函数,等待进行中的解析完成
+   */
+  ~Resolver();
+
+  /**
+   * @brief 异步解析,命中缓存时在当前线程立即回调,否则在解析线程中回调
+   *
+   * @param[in] host     域名,服务器名称等,可带端口
+   * @param[in] callback 回调
+   * @param[in] family   协议簇
+   * @param[in] type     socket类型
+   * @param[in] protocol 协议
+   */
+  void resolve(const std::string& host, callback_t callback,
+               AddressFamily family = AddressFamily::eUnSpec,
+               SocketType type = SocketType::eTcp,
+               IpProtocol protocol = IpProtocol::eIp);
+
+  /**
+   * @brief 异步解析,返回future
+   *
+   * @return 解析结果,失败时为空
+   */
+  std::future<std::vector<Address::ptr>> resolve(
+      const std::string& host, AddressFamily family = AddressFamily::eUnSpec,
+      SocketType type = SocketType::eTcp,
+      IpProtocol protocol = IpProtocol::eIp);
+
+  /**
+   * @brief 同步解析,命中缓存时不会阻塞
+   *
+   * @param[in] result 结果集
+   *
+   * @return 是否解析成功
+   */
+  bool lookup(std::vector<Address::ptr>& result, const std::string& host,
+              AddressFamily family = AddressFamily::eUnSpec,
+              SocketType type = SocketType::eTcp,
+              IpProtocol protocol = IpProtocol::eIp);
+
+  /**
+   * @brief 同步解析,返回任意一个地址
+   *
+   * @return 地址,失败返回nullptr
+   */
+  Address::ptr lookup_any(const std::string& host,
+                          AddressFamily family = AddressFamily::eUnSpec,
+                          SocketType type = SocketType::eTcp,
+                          IpProtocol protocol = IpProtocol::eIp);
+
+  /**
+   * @brief 只查询缓存,不发起解析
+   *
+   * @return 缓存中有未过期的成功结果时返回true
+   */
+  bool lookup_cached(std::vector<Address::ptr>& result, const std::string& host,
+                     AddressFamily family = AddressFamily::eUnSpec,
+                     SocketType type = SocketType::eTcp,
+                     IpProtocol protocol = IpProtocol::eIp);
+
+  /**
+   * @brief 清空缓存,不影响进行中的解析
+   */
+  void clear();
+
+  /**
+   * @brief 缓存的条目数量
+   */
+  size_t size() const;
+
+  const Options& options() const { return m_options; }
+
+ private:
+  struct Key {
+    std::string host;
+    AddressFamily family;
+    SocketType type;
+    IpProtocol protocol;
+
+    bool operator==(const Key& rhs) const {
+      return family == rhs.family && type == rhs.type &&
+             protocol == rhs.protocol && host == rhs.host;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      size_t seed = std::hash<std::string>()(key.host);
+      seed ^= ((size_t)key.family << 16 | (size_t)key.type << 8 |
+               (size_t)key.protocol) +
+              0x9e3779b9 + (seed << 6) + (seed >> 2);
+      return seed;
+    }
+  };
+
+  struct Entry {
+    bool ok = false;
+    bool pending = false;
+    time::TimePoint expire;
+    std::vector<Address::ptr> addresses;
+    std::vector<callback_t> waiters;
+  };
+
+  void do_lookup(const Key& key);
+  void evict(const time::TimePoint& now);
+
+  /**
+   * @brief 复制地址,避免调用者修改缓存中的地址(如set_port)
+   */
+  CX_STATIC std::vector<Address::ptr> Copy(
+      const std::vector<Address::ptr>& addresses);
+
+ private:
+  Options m_options;
+  mutable std::mutex m_mutex;
+  std::unordered_map<Key, Entry, KeyHash> m_entries;
+  thread::ThreadPool::ptr m_pool;
+};
+
+}  // namespace cx::net
@@ -0,0 +1,586 @@
+#include "shm_channel.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#include "cx/common/logger.h"
+#include "cx/net/sock_addr.h"
+
+#if defined(CX_PLATFORM_LINUX)
+#include <sys/eventfd.h>
+#endif
+
+namespace cx::net {
+
+static const uint32_t SHM_MAGIC = 0x43585348;  // "CXSH"
+static const uint32_t SHM_VERSION = 1;
+
+// 环形缓冲末尾的连续空间放不下消息时写入的填充标记,读到后跳回开头
+static const uint32_t PADDING = 0xffffffff;
+
+// 消息头: uint32长度,整条消息按8字节对齐
+static const size_t RECORD_HEADER = sizeof(uint32_t);
+
+// 环形缓冲容量的范围,容量总是2的幂
+static const uint64_t MIN_CAPACITY = 4096;
+static const uint64_t MAX_CAPACITY = 1ull << 40;
+
+/**
+ * @brief 握手消息,随共享内存fd一起发送
+ */
+struct ShmHandshake {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t capacity;
+};
+
+/**
+ * @brief 环形缓冲的头部,位于共享内存中
+ *
+ * 生产者与消费者修改的位置分属不同的缓存行;head/tail单调递增,
+ * 与capacity-1按位与得到偏移
+ */
+struct ShmChannel::Ring {
+  alignas(64) std::atomic<uint64_t> head;  // 写位置,只由生产者修改
+  alignas(64) std::atomic<uint64_t> tail;  // 读位置,只由消费者修改
+  alignas(64) std::atomic<uint32_t> reader_waiting;
+  std::atomic<uint32_t> writer_waiting;
+  std::atomic<uint32_t> closed;  // 生产者已关闭
+  uint32_t magic;
+  uint64_t capacity;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                  std::atomic<uint32_t>::is_always_lock_free,
+              "shared memory ring requires lock free atomics");
+
+static CX_INLINE size_t Align8(size_t n) { return (n + 7) & ~(size_t)7; }
+
+static size_t RoundUpPow2(size_t n) {
+  size_t result = MIN_CAPACITY;
+  while (result < n) {
+    result <<= 1;
+  }
+  return result;
+}
+
+static int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/**
+ * @brief 创建共享内存,创建后立即取消名字,只通过fd共享
+ */
+static int CreateSharedMemory(size_t size) {
+#if defined(CX_PLATFORM_LINUX)
+  int fd = memfd_create("cx_shm_channel", MFD_CLOEXEC);
+#else
+  std::string name = "/cx_shm_" + std::to_string(getpid()) + "_" +
+                     std::to_string(NowUs());
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd != -1) {
+    shm_unlink(name.c_str());
+  }
+#endif
+  if (fd == -1) {
+    return -1;
+  }
+  if (ftruncate(fd, size)) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+ShmChannel::ptr ShmChannel::Connect(const std::string& path) {
+  return Connect(path, Options());
+}
+
+ShmChannel::ptr ShmChannel::Connect(const std::string& path,
+                                    const Options& options) {
+  Socket::ptr sock = Socket::GenerateUnixTCPSocket();
+  if (!sock->connect(SockAddr::Unix(path))) {
+    LOG_ERROR(log::Loggers::engine)
+        << "shm channel connect failed: " << path << ", errno: " << errno;
+    return nullptr;
+  }
+
+  ShmHandshake handshake;
+  int fds[3] = {-1, -1, -1};
+  size_t count = 3;
+  int n = sock->recv_fds(fds, count, &handshake, sizeof(handshake));
+  ShmChannel::ptr channel(new ShmChannel(sock, options));
+#if defined(CX_PLATFORM_LINUX)
+  channel->m_notify_fd = count > 1 ? fds[1] : -1;
+  channel->m_peer_notify_fd = count > 2 ? fds[2] : -1;
+  size_t expect = 3;
+#else
+  channel->m_notify_fd = channel->m_peer_notify_fd = sock->socket();
+  size_t expect = 1;
+#endif
+  if (n != (int)sizeof(handshake) || count != expect ||
+      handshake.magic != SHM_MAGIC || handshake.version != SHM_VERSION) {
+    LOG_ERROR(log::Loggers::engine)
+        << "shm channel handshake failed: " << path << ", fds: " << count;
+    if (count > 0) {
+      ::close(fds[0]);
+    }
+    return nullptr;
+  }
+
+  channel->m_options.capacity = handshake.capacity;
+  bool ok = channel->map(fds[0], false);
+  ::close(fds[0]);
+  return ok ? channel : nullptr;
+}
+
+size_t ShmChannel::RingSize(size_t capacity) {
+  return sizeof(Ring) + capacity;
+}
+
+ShmChannel::ShmChannel(Socket::ptr sock, const Options& options)
+    : m_options(options),
+      m_socket(sock),
+      m_memory(nullptr),
+      m_memory_size(0),
+      m_tx(nullptr),
+      m_rx(nullptr),
+      m_tx_data(nullptr),
+      m_rx_data(nullptr),
+      m_notify_fd(-1),
+      m_peer_notify_fd(-1),
+      m_closed(false),
+      m_peer_dead(false),
+      m_wakeups(0) {
+  // 单核时自旋只会占用对端需要的cpu
+  if (std::thread::hardware_concurrency() <= 1) {
+    m_options.spin_us = 0;
+  }
+}
+
+ShmChannel::~ShmChannel() {
+  close();
+  if (m_memory) {
+    munmap(m_memory, m_memory_size);
+  }
+#if defined(CX_PLATFORM_LINUX)
+  if (m_notify_fd != -1) {
+    ::close(m_notify_fd);
+  }
+  if (m_peer_notify_fd != -1) {
+    ::close(m_peer_notify_fd);
+  }
+#endif
+  m_socket->close();
+}
+
+bool ShmChannel::map(int fd, bool server) {
+  size_t capacity = m_options.capacity;
+  size_t ring_size = RingSize(capacity);
+  if (!server) {
+    // 容量来自对端,按位与取偏移要求是2的幂;文件小于映射大小时访问会SIGBUS
+    if (capacity < MIN_CAPACITY || capacity > MAX_CAPACITY ||
+        (capacity & (capacity - 1)) != 0) {
+      LOG_ERROR(log::Loggers::engine)
+          << "shm channel invalid capacity: " << capacity;
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size < (off_t)(ring_size * 2)) {
+      LOG_ERROR(log::Loggers::engine)
+          << "shm channel shared memory too small, capacity: " << capacity
+          << ", errno: " << errno;
+      return false;
+    }
+  }
+  m_memory_size = ring_size * 2;
+  m_memory = mmap(nullptr, m_memory_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                  fd, 0);
+  if (m_memory == MAP_FAILED) {
+    LOG_ERROR(log::Loggers::engine)
+        << "shm channel mmap failed, size: " << m_memory_size
+        << ", errno: " << errno;
+    m_memory = nullptr;
+    return false;
+  }
+
+  char* base = (char*)m_memory;
+  Ring* rings[2] = {(Ring*)base, (Ring*)(base + ring_size)};
+  if (server) {
+    for (Ring* ring : rings) {
+      new (ring) Ring();
+      ring->head.store(0, std::memory_order_relaxed);
+      ring->tail.store(0, std::memory_order_relaxed);
+      ring->reader_waiting.store(0, std::memory_order_relaxed);
+      ring->writer_waiting.store(0, std::memory_order_relaxed);
+      ring->closed.store(0, std::memory_order_relaxed);
+      ring->magic = SHM_MAGIC;
+      ring->capacity = capacity;
+    }
+  } else {
+    for (Ring* ring : rings) {
+      if (ring->magic != SHM_MAGIC || ring->capacity != capacity) {
+        LOG_ERROR(log::Loggers::engine) << "shm channel invalid shared memory";
+        return false;
+      }
+    }
+  }
+
+  // 服务端写第一个环形缓冲,客户端写第二个
+  m_tx = rings[server ? 0 : 1];
+  m_rx = rings[server ? 1 : 0];
+  m_tx_data = (char*)m_tx + sizeof(Ring);
+  m_rx_data = (char*)m_rx + sizeof(Ring);
+  return true;
+}
+
+size_t ShmChannel::max_message_size() const {
+  // 保证在最坏的填充情况下一条消息也能放入空的缓冲区
+  return m_options.capacity / 2 - RECORD_HEADER;
+}
+
+size_t ShmChannel::pending_send() const {
+  return m_tx->head.load(std::memory_order_relaxed) -
+         m_tx->tail.load(std::memory_order_acquire);
+}
+
+bool ShmChannel::has_message() const {
+  return m_rx->head.load(std::memory_order_acquire) !=
+         m_rx->tail.load(std::memory_order_relaxed);
+}
+
+bool ShmChannel::has_space(size_t len) const {
+  uint64_t capacity = m_options.capacity;
+  uint64_t head = m_tx->head.load(std::memory_order_relaxed);
+  uint64_t tail = m_tx->tail.load(std::memory_order_acquire);
+  size_t need = Align8(RECORD_HEADER + len);
+  size_t contiguous = capacity - (head & (capacity - 1));
+  if (contiguous < need) {
+    need += contiguous;
+  }
+  return capacity - (head - tail) >= need;
+}
+
+bool ShmChannel::peer_closed() const {
+  return m_peer_dead || m_rx->closed.load(std::memory_order_acquire);
+}
+
+bool ShmChannel::send(const void* data, size_t len) {
+  if (m_closed || peer_closed()) {
+    return false;
+  }
+  if (len > max_message_size()) {
+    LOG_ERROR(log::Loggers::engine)
+        << "shm channel message too large: " << len
+        << ", max: " << max_message_size();
+    return false;
+  }
+
+  uint64_t capacity = m_options.capacity;
+  uint64_t head = m_tx->head.load(std::memory_order_relaxed);
+  uint64_t tail = m_tx->tail.load(std::memory_order_acquire);
+  size_t need = Align8(RECORD_HEADER + len);
+  size_t offset = head & (capacity - 1);
+  size_t contiguous = capacity - offset;
+  size_t total = contiguous < need ? need + contiguous : need;
+  if (capacity - (head - tail) < total) {
+    return false;
+  }
+
+  if (contiguous < need) {
+    // 消息不拆分,末尾剩余的空间用填充标记跳过
+    *(uint32_t*)(m_tx_data + offset) = PADDING;
+    head += contiguous;
+    offset = 0;
+  }
+  *(uint32_t*)(m_tx_data + offset) = (uint32_t)len;
+  memcpy(m_tx_data + offset + RECORD_HEADER, data, len);
+  m_tx->head.store(head + need, std::memory_order_release);
+
+  // 与prepare_wait中的fence配对:要么对端看到新数据,要么这里看到等待标记
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (m_tx->reader_waiting.load(std::memory_order_relaxed) &&
+      m_tx->reader_waiting.exchange(0, std::memory_order_relaxed)) {
+    notify_peer();
+  }
+  return true;
+}
+
+bool ShmChannel::send(const void* data, size_t len, int timeout_ms) {
+  int64_t start = NowUs();
+  int64_t deadline = timeout_ms < 0 ? -1 : start + (int64_t)timeout_ms * 1000;
+  while (true) {
+    if (send(data, len)) {
+      return true;
+    }
+    if (m_closed || peer_closed() || len > max_message_size()) {
+      return false;
+    }
+
+    int64_t now = NowUs();
+    if (deadline != -1 && now >= deadline) {
+      return false;
+    }
+    if (now - start < m_options.spin_us) {
+      continue;
+    }
+
+    m_tx->writer_waiting.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (has_space(len) || peer_closed()) {
+      m_tx->writer_waiting.store(0, std::memory_order_relaxed);
+      continue;
+    }
+    wait_notify(deadline == -1 ? -1 : (int)((deadline - now + 999) / 1000));
+    m_tx->writer_waiting.store(0, std::memory_order_relaxed);
+  }
+}
+
+size_t ShmChannel::receive(const message_callback_t& callback,
+                           size_t max_messages) {
+  uint64_t capacity = m_options.capacity;
+  uint64_t tail = m_rx->tail.load(std::memory_order_relaxed);
+  uint64_t head = m_rx->head.load(std::memory_order_acquire);
+  size_t count = 0;
+  while (count < max_messages) {
+    if (tail == head) {
+      head = m_rx->head.load(std::memory_order_acquire);
+      if (tail == head) {
+        break;
+      }
+    }
+
+    size_t offset = tail & (capacity - 1);
+    uint32_t len = *(const uint32_t*)(m_rx_data + offset);
+    if (len == PADDING) {
+      tail += capacity - offset;
+      m_rx->tail.store(tail, std::memory_order_release);
+      continue;
+    }
+    callback(m_rx_data + offset + RECORD_HEADER, len);
+    tail += Align8(RECORD_HEADER + len);
+    // 每条消息处理完立即释放空间,生产者不必等整批处理完
+    m_rx->tail.store(tail, std::memory_order_release);
+    ++count;
+  }
+
+  if (count > 0) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_rx->writer_waiting.load(std::memory_order_relaxed) &&
+        m_rx->writer_waiting.exchange(0, std::memory_order_relaxed)) {
+      notify_peer();
+    }
+  }
+  return count;
+}
+
+bool ShmChannel::recv(std::string& message, int timeout_ms) {
+  while (true) {
+    size_t n = receive(
+        [&message](const char* data, size_t len) { message.assign(data, len); },
+        1);
+    if (n > 0) {
+      return true;
+    }
+    if (!wait(timeout_ms)) {
+      return false;
+    }
+  }
+}
+
+bool ShmChannel::wait(int timeout_ms) {
+  if (has_message()) {
+    return true;
+  }
+
+  int64_t start = NowUs();
+  int64_t deadline = timeout_ms < 0 ? -1 : start + (int64_t)timeout_ms * 1000;
+  int64_t now = start;
+  while (now - start < m_options.spin_us) {
+    if (has_message()) {
+      return true;
+    }
+    now = NowUs();
+  }
+
+  while (true) {
+    if (!prepare_wait()) {
+      return has_message();
+    }
+    if (deadline != -1 && now >= deadline) {
+      m_rx->reader_waiting.store(0, std::memory_order_relaxed);
+      return false;
+    }
+    wait_notify(deadline == -1 ? -1 : (int)((deadline - now + 999) / 1000));
+    m_rx->reader_waiting.store(0, std::memory_order_relaxed);
+    if (has_message()) {
+      return true;
+    }
+    now = NowUs();
+  }
+}
+
+bool ShmChannel::prepare_wait() {
+  m_rx->reader_waiting.store(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (has_message() || peer_closed() || m_closed) {
+    m_rx->reader_waiting.store(0, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+void ShmChannel::close() {
+  if (m_closed || !m_tx) {
+    m_closed = true;
+    return;
+  }
+  m_closed = true;
+  m_tx->closed.store(1, std::memory_order_release);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  notify_peer();
+  // 关闭写端,对端进程即使没有在等待共享内存也能感知
+  ::shutdown(m_socket->socket(), SHUT_WR);
+}
+
+void ShmChannel::notify_peer() {
+  ++m_wakeups;
+#if defined(CX_PLATFORM_LINUX)
+  uint64_t one = 1;
+  while (::write(m_peer_notify_fd, &one, sizeof(one)) < 0 && errno == EINTR) {
+  }
+#else
+  char byte = 0;
+  ::send(m_peer_notify_fd, &byte, 1, MSG_DONTWAIT);
+#endif
+}
+
+void ShmChannel::clear_notify() {
+#if defined(CX_PLATFORM_LINUX)
+  uint64_t count;
+  while (::read(m_notify_fd, &count, sizeof(count)) < 0 && errno == EINTR) {
+  }
+  // 对端进程退出时socket可读且读到0
+  char byte;
+  if (::recv(m_socket->socket(), &byte, 1, MSG_DONTWAIT | MSG_PEEK) == 0) {
+    m_peer_dead = true;
+  }
+#else
+  char buffer[64];
+  while (true) {
+    int n = ::recv(m_notify_fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (n == 0) {
+      m_peer_dead = true;
+      break;
+    }
+    if (n < 0 && errno != EINTR) {
+      break;
+    }
+  }
+#endif
+}
+
+bool ShmChannel::wait_notify(int timeout_ms) {
+  pollfd fds[2];
+  fds[0].fd = m_notify_fd;
+  fds[0].events = POLLIN;
+  fds[0].revents = 0;
+  fds[1].fd = m_socket->socket();
+  fds[1].events = POLLIN;
+  fds[1].revents = 0;
+  nfds_t count = m_notify_fd == m_socket->socket() ? 1 : 2;
+
+  int n = ::poll(fds, count, timeout_ms);
+  if (n <= 0) {
+    return false;
+  }
+  clear_notify();
+  return true;
+}
+
+ShmAcceptor::ShmAcceptor() : ShmAcceptor(ShmChannel::Options()) {}
+
+ShmAcceptor::ShmAcceptor(const ShmChannel::Options& options)
+    : m_options(options) {
+  m_options.capacity = RoundUpPow2(m_options.capacity);
+}
+
+ShmAcceptor::~ShmAcceptor() {
+  if (m_socket) {
+    m_socket->close();
+    unlink(m_path.c_str());
+  }
+}
+
+bool ShmAcceptor::bind(const std::string& path) {
+  unlink(path.c_str());
+  m_socket = Socket::GenerateUnixTCPSocket();
+  if (!m_socket->bind(SockAddr::Unix(path)) || !m_socket->listen()) {
+    LOG_ERROR(log::Loggers::engine)
+        << "shm acceptor bind failed: " << path << ", errno: " << errno;
+    m_socket.reset();
+    return false;
+  }
+  m_path = path;
+  return true;
+}
+
+ShmChannel::ptr ShmAcceptor::accept() {
+  if (!m_socket) {
+    return nullptr;
+  }
+  Socket::ptr sock = m_socket->accept();
+  if (!sock) {
+    return nullptr;
+  }
+
+  ShmChannel::ptr channel(new ShmChannel(sock, m_options));
+  int memfd = CreateSharedMemory(ShmChannel::RingSize(m_options.capacity) * 2);
+  if (memfd == -1) {
+    LOG_ERROR(log::Loggers::engine)
+        << "shm acceptor create shared memory failed, errno: " << errno;
+    return nullptr;
+  }
+  if (!channel->map(memfd, true)) {
+    ::close(memfd);
+    return nullptr;
+  }
+
+  ShmHandshake handshake = {SHM_MAGIC, SHM_VERSION, m_options.capacity};
+#if defined(CX_PLATFORM_LINUX)
+  channel->m_notify_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  channel->m_peer_notify_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (channel->m_notify_fd == -1 || channel->m_peer_notify_fd == -1) {
+    LOG_ERROR(log::Loggers::engine)
+        << "shm acceptor create eventfd failed, errno: " << errno;
+    ::close(memfd);
+    return nullptr;
+  }
+  // 客户端被唤醒的fd在前,唤醒服务端的fd在后
+  int fds[3] = {memfd, channel->m_peer_notify_fd, channel->m_notify_fd};
+  int n = sock->send_fds(fds, 3, &handshake, sizeof(handshake));
+#else
+  channel->m_notify_fd = channel->m_peer_notify_fd = sock->socket();
+  int n = sock->send_fds(&memfd, 1, &handshake, sizeof(handshake));
+#endif
+  ::close(memfd);
+  if (n != (int)sizeof(handshake)) {
+    LOG_ERROR(log::Loggers::engine)
+        << "shm acceptor handshake failed, errno: " << errno;
+    return nullptr;
+  }
+  return channel;
+}
+
+}  // namespace cx::net
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "cx/common/internal.h"
+#include "cx/common/noncopyable.h"
+#include "cx/net/socket.h"
+
+namespace cx::net {
+
+/**
+ * @brief 基于共享内存环形缓冲的同机进程间消息通道
+ *
+ * 连接通过Unix域socket建立:服务端创建共享内存(Linux下为memfd),并通过
+ * SCM_RIGHTS把它和唤醒用的eventfd传给客户端。之后每个方向各有一个单生产者
+ * 单消费者的环形缓冲,收发消息不经过内核;只有在对端空闲等待时才写eventfd
+ * 唤醒它。其他平台使用shm_open,唤醒通过Unix域socket发送一个字节完成。
+ *
+ * 每个通道的发送与接收各自只能在一个线程中调用;等待消息与等待发送空间共用
+ * 同一个唤醒fd,阻塞的send与recv/wait应在同一个线程中使用
+ */
+class ShmChannel : public Noncopyable {
+ public:
+  typedef std::shared_ptr<ShmChannel> ptr;
+  typedef std::function<void(const char* data, size_t len)> message_callback_t;
+
+  /**
+   * @brief 通道参数
+   */
+  struct Options {
+    size_t capacity = 1024 * 1024;  // 每个方向的环形缓冲大小,会向上取整为2的幂
+    uint32_t spin_us = 20;          // 阻塞等待前自旋的时间,单核时不自旋
+  };
+
+  /**
+   * @brief 连接到ShmAcceptor监听的路径
+   *
+   * @param[in] path    Unix域socket路径
+   * @param[in] options 通道参数,容量由服务端决定
+   *
+   * @return 失败返回nullptr
+   */
+  CX_STATIC ShmChannel::ptr Connect(const std::string& path,
+                                    const Options& options);
+  CX_STATIC ShmChannel::ptr Connect(const std::string& path);
+
+  ~ShmChannel();
+
+  /**
+   * @brief 发送消息,不阻塞
+   *
+   * @param[in] data 数据
+   * @param[in] len  长度,不能超过max_message_size
+   *
+   * @return 缓冲区已满或通道已关闭时返回false
+   */
+  bool send(const void* data, size_t len);
+
+  /**
+   * @brief 发送消息,缓冲区已满时等待
+   *
+   * @param[in] timeout_ms 超时时间,-1为一直等待
+   *
+   * @return 超时或通道已关闭时返回false
+   */
+  bool send(const void* data, size_t len, int timeout_ms);
+
+  /**
+   * @brief 处理已到达的消息,回调中的数据直接指向共享内存,回调返回后失效
+   *
+   * @param[in] callback     回调
+   * @param[in] max_messages 最多处理的消息数量
+   *
+   * @return 处理的消息数量
+   */
+  size_t receive(const message_callback_t& callback,
+                 size_t max_messages = (size_t)-1);
+
+  /**
+   * @brief 接收一条消息,没有消息时等待
+   *
+   * @param[out] message    消息
+   * @param[in]  timeout_ms 超时时间,-1为一直等待
+   *
+   * @return 超时或通道已关闭时返回false
+   */
+  bool recv(std::string& message, int timeout_ms = -1);
+
+  /**
+   * @brief 等待消息到达,先自旋spin_us再阻塞
+   *
+   * @param[in] timeout_ms 超时时间,-1为一直等待
+   *
+   * @return 有消息时返回true
+   */
+  bool wait(int timeout_ms = -1);
+
+  /**
+   * @brief 用于事件循环的唤醒fd,可读时调用clear_notify后再调用receive
+   */
+  int notify_fd() const { return m_notify_fd; }
+
+  /**
+   * @brief 读取唤醒fd中的计数
+   */
+  void clear_notify();
+
+  /**
+   * @brief 准备进入空闲等待,之后对端发送消息时会唤醒notify_fd
+   *
+   * @return 已经有消息时返回false,此时不应等待
+   */
+  bool prepare_wait();
+
+  /**
+   * @brief 关闭通道,对端的接收在读完剩余消息后返回失败
+   */
+  void close();
+
+  /**
+   * @brief 对端是否已关闭
+   */
+  bool peer_closed() const;
+
+  /**
+   * @brief 单条消息的最大长度
+   */
+  size_t max_message_size() const;
+
+  /**
+   * @brief 等待发送的字节数
+   */
+  size_t pending_send() const;
+
+  /**
+   * @brief 唤醒对端的次数,用于观察唤醒的开销
+   */
+  uint64_t wakeups() const { return m_wakeups; }
+
+ private:
+  friend class ShmAcceptor;
+
+  struct Ring;
+
+  ShmChannel(Socket::ptr sock, const Options& options);
+
+  /**
+   * @brief 一个方向的环形缓冲占用的共享内存大小
+   */
+  CX_STATIC size_t RingSize(size_t capacity);
+
+  /**
+   * @brief 映射共享内存
+   *
+   * @param[in] fd     共享内存fd
+   * @param[in] server 是否为服务端,决定收发使用哪个环形缓冲
+   */
+  bool map(int fd, bool server);
+
+  /**
+   * @brief 通知对端有新数据或新空间
+   */
+  void notify_peer();
+
+  /**
+   * @brief 阻塞在唤醒fd上
+   */
+  bool wait_notify(int timeout_ms);
+
+  bool has_message() const;
+  bool has_space(size_t len) const;
+
+ private:
+  Options m_options;
+  Socket::ptr m_socket;
+  void* m_memory;
+  size_t m_memory_size;
+  Ring* m_tx;
+  Ring* m_rx;
+  char* m_tx_data;
+  char* m_rx_data;
+  int m_notify_fd;       // 自己被唤醒的fd,Linux下为eventfd,其他平台为socket
+  int m_peer_notify_fd;  // 唤醒对端的fd
+  bool m_closed;
+  bool m_peer_dead;
+  uint64_t m_wakeups;
+};
+
+/**
+ * @brief 监听共享内存通道的连接
+ */
+class ShmAcceptor : public Noncopyable {
+ public:
+  typedef std::shared_ptr<ShmAcceptor> ptr;
+
+  ShmAcceptor();
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] options 新通道的参数
+   */
+  ShmAcceptor(const ShmChannel::Options& options);
+
+  ~ShmAcceptor();
+
+  /**
+   * @brief 监听路径,已存在的文件会被删除
+   *
+   * @return 是否成功
+   */
+  bool bind(const std::string& path);
+
+  /**
+   * @brief 接受一个连接并完成共享内存的握手
+   *
+   * @return 失败返回nullptr
+   */
+  ShmChannel::ptr accept();
+
+  Socket::ptr socket() const { return m_socket; }
+
+ private:
+  ShmChannel::Options m_options;
+  Socket::ptr m_socket;
+  std::string m_path;
+};
+
+}  // namespace cx::net
@@ -0,0 +1,509 @@
+#include "snapshot.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "cx/common/logger.h"
+#include "cx/net/bit_stream.h"
+
+namespace cx::net {
+
+// 差值(zigzag)小于2^SMALL_DELTA_BITS时只编码差值
+static const uint32_t SMALL_DELTA_BITS = 6;
+
+/**
+ * @brief 实体操作,2位
+ */
+enum EntityOp : uint32_t {
+  eEnd = 0,
+  eRemoved = 1,
+  eAdded = 2,
+  eChanged = 3,
+};
+
+static CX_INLINE uint32_t EncodeZigzag(int32_t v) {
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static CX_INLINE int32_t DecodeZigzag(uint32_t v) {
+  return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static uint32_t BitsFor(uint32_t max_value) {
+  uint32_t bits = 1;
+  while (bits < 32 && (max_value >> bits) != 0) {
+    ++bits;
+  }
+  return bits;
+}
+
+uint32_t SnapshotSchema::add_component(float min, float max, float precision) {
+  Component component;
+  component.min = min;
+  component.precision = precision;
+  component.max_value = (uint32_t)std::lround((max - min) / precision);
+  component.bits = BitsFor(component.max_value);
+  m_components.push_back(component);
+  m_full_bits += component.bits;
+  return (uint32_t)m_components.size() - 1;
+}
+
+uint32_t SnapshotSchema::add_integer(const std::string& name, uint32_t bits) {
+  bits = std::clamp(bits, 1u, 32u);
+  Component component;
+  component.bits = bits;
+  component.min = 0;
+  component.precision = 1;
+  component.max_value = bits == 32 ? 0xffffffff : (1u << bits) - 1;
+  m_components.push_back(component);
+  m_full_bits += bits;
+  m_fields.push_back(
+      Field{name, FieldType::eInteger, (uint32_t)m_components.size() - 1, 1});
+  return (uint32_t)m_fields.size() - 1;
+}
+
+uint32_t SnapshotSchema::add_float(const std::string& name, float min,
+                                   float max, float precision) {
+  uint32_t component = add_component(min, max, precision);
+  m_fields.push_back(Field{name, FieldType::eFloat, component, 1});
+  return (uint32_t)m_fields.size() - 1;
+}
+
+uint32_t SnapshotSchema::add_vector2(const std::string& name,
+                                     const Vector2f& min, const Vector2f& max,
+                                     float precision) {
+  uint32_t component = add_component(min.x, max.x, precision);
+  add_component(min.y, max.y, precision);
+  m_fields.push_back(Field{name, FieldType::eVector2, component, 2});
+  return (uint32_t)m_fields.size() - 1;
+}
+
+uint32_t SnapshotSchema::quantize(uint32_t component, float value) const {
+  const Component& c = m_components[component];
+  float q = std::round((value - c.min) / c.precision);
+  if (!(q > 0)) {
+    return 0;
+  }
+  return q >= (float)c.max_value ? c.max_value : (uint32_t)q;
+}
+
+float SnapshotSchema::dequantize(uint32_t component, uint32_t value) const {
+  const Component& c = m_components[component];
+  return c.min + (float)value * c.precision;
+}
+
+Snapshot::Snapshot(SnapshotSchema::ptr schema, uint32_t tick)
+    : m_schema(schema),
+      m_tick(tick),
+      m_stride((uint32_t)schema->components().size()) {}
+
+void Snapshot::reserve(size_t entities) {
+  m_ids.reserve(entities);
+  m_values.reserve(entities * m_stride);
+}
+
+size_t Snapshot::add(uint32_t id) {
+  m_ids.push_back(id);
+  m_values.resize(m_values.size() + m_stride);
+  return m_ids.size() - 1;
+}
+
+size_t Snapshot::find(uint32_t id) const {
+  auto it = std::lower_bound(m_ids.begin(), m_ids.end(), id);
+  if (it == m_ids.end() || *it != id) {
+    return npos;
+  }
+  return it - m_ids.begin();
+}
+
+void Snapshot::set_integer(size_t index, uint32_t field, uint32_t value) {
+  uint32_t component = m_schema->fields()[field].component;
+  values(index)[component] =
+      value & m_schema->components()[component].max_value;
+}
+
+void Snapshot::set_float(size_t index, uint32_t field, float value) {
+  uint32_t component = m_schema->fields()[field].component;
+  values(index)[component] = m_schema->quantize(component, value);
+}
+
+void Snapshot::set_vector2(size_t index, uint32_t field,
+                           const Vector2f& value) {
+  uint32_t component = m_schema->fields()[field].component;
+  uint32_t* v = values(index);
+  v[component] = m_schema->quantize(component, value.x);
+  v[component + 1] = m_schema->quantize(component + 1, value.y);
+}
+
+uint32_t Snapshot::get_integer(size_t index, uint32_t field) const {
+  return values(index)[m_schema->fields()[field].component];
+}
+
+float Snapshot::get_float(size_t index, uint32_t field) const {
+  uint32_t component = m_schema->fields()[field].component;
+  return m_schema->dequantize(component, values(index)[component]);
+}
+
+Vector2f Snapshot::get_vector2(size_t index, uint32_t field) const {
+  uint32_t component = m_schema->fields()[field].component;
+  const uint32_t* v = values(index);
+  return Vector2f(m_schema->dequantize(component, v[component]),
+                  m_schema->dequantize(component + 1, v[component + 1]));
+}
+
+bool Snapshot::same_state(const Snapshot& other) const {
+  return m_ids == other.m_ids && m_values == other.m_values;
+}
+
+/**
+ * @brief 编码相对上一个实体的id间隔,id连续时只占1位
+ */
+static CX_INLINE void WriteGap(BitWriter& writer, uint32_t gap) {
+  if (gap == 1) {
+    writer.write(1, 1);
+  } else {
+    writer.write(0, 1);
+    writer.write_varint(gap);
+  }
+}
+
+static CX_INLINE uint32_t ReadGap(BitReader& reader) {
+  return reader.read_bool() ? 1 : reader.read_varint();
+}
+
+/**
+ * @brief 全量编码实体的所有分量
+ */
+static void WriteFull(BitWriter& writer, const SnapshotSchema& schema,
+                      const uint32_t* values) {
+  const auto& components = schema.components();
+  for (size_t i = 0; i < components.size(); ++i) {
+    writer.write(values[i], components[i].bits);
+  }
+}
+
+static void ReadFull(BitReader& reader, const SnapshotSchema& schema,
+                     uint32_t* values) {
+  const auto& components = schema.components();
+  for (size_t i = 0; i < components.size(); ++i) {
+    values[i] = reader.read(components[i].bits);
+  }
+}
+
+/**
+ * @brief 逐字段编码实体相对基准的变化
+ */
+static void WriteDelta(BitWriter& writer, const SnapshotSchema& schema,
+                       const uint32_t* values, const uint32_t* base) {
+  const auto& components = schema.components();
+  for (auto& field : schema.fields()) {
+    uint32_t begin = field.component;
+    uint32_t end = begin + field.count;
+    if (memcmp(values + begin, base + begin, field.count * sizeof(uint32_t)) ==
+        0) {
+      writer.write(0, 1);
+      continue;
+    }
+    writer.write(1, 1);
+    for (uint32_t i = begin; i < end; ++i) {
+      uint32_t bits = components[i].bits;
+      if (bits <= SMALL_DELTA_BITS + 1) {
+        writer.write(values[i], bits);
+        continue;
+      }
+      uint32_t delta = EncodeZigzag((int32_t)(values[i] - base[i]));
+      if (delta < (1u << SMALL_DELTA_BITS)) {
+        writer.write(delta, 1 + SMALL_DELTA_BITS);
+      } else {
+        writer.write(1, 1);
+        writer.write(values[i], bits);
+      }
+    }
+  }
+}
+
+static void ReadDelta(BitReader& reader, const SnapshotSchema& schema,
+                      uint32_t* values) {
+  const auto& components = schema.components();
+  for (auto& field : schema.fields()) {
+    if (!reader.read_bool()) {
+      continue;
+    }
+    uint32_t end = field.component + field.count;
+    for (uint32_t i = field.component; i < end; ++i) {
+      uint32_t bits = components[i].bits;
+      if (bits <= SMALL_DELTA_BITS + 1 || reader.read_bool()) {
+        values[i] = reader.read(bits);
+      } else {
+        values[i] += (uint32_t)DecodeZigzag(reader.read(SMALL_DELTA_BITS));
+      }
+    }
+  }
+}
+
+void SnapshotCodec::Encode(const Snapshot& current, const Snapshot* baseline,
+                           ByteArray& out) {
+  out.write_fuint32(current.tick());
+  out.write_fuint8(baseline ? 1 : 0);
+  if (baseline) {
+    out.write_fuint32(baseline->tick());
+  }
+
+  const SnapshotSchema& schema = *current.schema();
+  size_t stride = schema.components().size();
+  size_t count = current.size();
+  size_t base_count = baseline ? baseline->size() : 0;
+  BitWriter writer(out);
+  uint32_t last_id = 0;
+
+  // 两个快照都按id升序,归并得到新增,删除与变化的实体
+  size_t i = 0;
+  size_t j = 0;
+  while (i < count || j < base_count) {
+    uint64_t id = i < count ? current.id(i) : UINT64_MAX;
+    uint64_t base_id = j < base_count ? baseline->id(j) : UINT64_MAX;
+    if (base_id < id) {
+      writer.write(eRemoved, 2);
+      WriteGap(writer, (uint32_t)base_id - last_id);
+      last_id = (uint32_t)base_id;
+      ++j;
+    } else if (id < base_id) {
+      writer.write(eAdded, 2);
+      WriteGap(writer, (uint32_t)id - last_id);
+      last_id = (uint32_t)id;
+      WriteFull(writer, schema, current.values(i));
+      ++i;
+    } else {
+      const uint32_t* values = current.values(i);
+      const uint32_t* base = baseline->values(j);
+      if (memcmp(values, base, stride * sizeof(uint32_t)) != 0) {
+        writer.write(eChanged, 2);
+        WriteGap(writer, (uint32_t)id - last_id);
+        last_id = (uint32_t)id;
+        WriteDelta(writer, schema, values, base);
+      }
+      ++i;
+      ++j;
+    }
+  }
+  writer.write(eEnd, 2);
+  writer.flush();
+}
+
+bool SnapshotCodec::PeekHeader(ByteArray& in, uint32_t& tick,
+                               uint32_t& baseline) {
+  char header[9];
+  size_t position = in.position();
+  size_t len = std::min(in.read_size(), sizeof(header));
+  if (len < 5) {
+    return false;
+  }
+  in.read(header, len, position);
+  uint32_t value;
+  memcpy(&value, header, sizeof(value));
+  tick = byteswapOnLittleEndian(value);
+  if (header[4] == 0 || len < sizeof(header)) {
+    return false;
+  }
+  memcpy(&value, header + 5, sizeof(value));
+  baseline = byteswapOnLittleEndian(value);
+  return true;
+}
+
+Snapshot::ptr SnapshotCodec::Decode(const SnapshotSchema::ptr& schema,
+                                    ByteArray& in, size_t len,
+                                    const Snapshot* baseline) {
+  if (len < 5 || in.read_size() < len) {
+    return nullptr;
+  }
+  size_t end_position = in.position() + len;
+  uint32_t tick = in.read_fuint32();
+  bool has_baseline = in.read_fuint8() != 0;
+  size_t header = 5;
+  if (has_baseline) {
+    if (len < 9) {
+      in.set_position(end_position);
+      return nullptr;
+    }
+    uint32_t base_tick = in.read_fuint32();
+    header = 9;
+    if (!baseline || baseline->tick() != base_tick) {
+      in.set_position(end_position);
+      return nullptr;
+    }
+  } else {
+    baseline = nullptr;
+  }
+
+  Snapshot::ptr snapshot(new Snapshot(schema, tick));
+  size_t stride = schema->components().size();
+  size_t base_count = baseline ? baseline->size() : 0;
+  snapshot->reserve(base_count);
+  BitReader reader(in, len - header);
+  size_t j = 0;
+  uint32_t last_id = 0;
+  bool first = true;
+
+  auto copy_until = [&](uint64_t id) {
+    while (j < base_count && baseline->id(j) < id) {
+      size_t index = snapshot->add(baseline->id(j));
+      memcpy(snapshot->values(index), baseline->values(j),
+             stride * sizeof(uint32_t));
+      ++j;
+    }
+  };
+
+  while (true) {
+    uint32_t op = reader.read(2);
+    if (reader.error()) {
+      break;
+    }
+    if (op == eEnd) {
+      copy_until(UINT64_MAX);
+      in.set_position(end_position);
+      return snapshot;
+    }
+
+    uint32_t gap = ReadGap(reader);
+    if (!first && gap == 0) {
+      break;
+    }
+    uint32_t id = last_id + gap;
+    last_id = id;
+    first = false;
+    copy_until(id);
+
+    bool in_baseline = j < base_count && baseline->id(j) == id;
+    if (op == eRemoved) {
+      if (!in_baseline) {
+        break;
+      }
+      ++j;
+    } else if (op == eAdded) {
+      if (in_baseline) {
+        break;
+      }
+      size_t index = snapshot->add(id);
+      ReadFull(reader, *schema, snapshot->values(index));
+    } else {
+      if (!in_baseline) {
+        break;
+      }
+      size_t index = snapshot->add(id);
+      uint32_t* values = snapshot->values(index);
+      memcpy(values, baseline->values(j), stride * sizeof(uint32_t));
+      ReadDelta(reader, *schema, values);
+      ++j;
+    }
+  }
+
+  LOG_DEBUG(log::Loggers::engine) << "invalid snapshot data, tick: " << tick;
+  in.set_position(end_position);
+  return nullptr;
+}
+
+SnapshotReplicator::SnapshotReplicator(SnapshotSchema::ptr schema)
+    : SnapshotReplicator(schema, Options()) {}
+
+SnapshotReplicator::SnapshotReplicator(SnapshotSchema::ptr schema,
+                                       const Options& options)
+    : m_schema(schema), m_options(options), m_next_client(1) {
+  m_options.history = std::max(1u, m_options.history);
+  m_history.resize(m_options.history);
+}
+
+void SnapshotReplicator::push(Snapshot::ptr snapshot) {
+  m_history[snapshot->tick() % m_options.history] = snapshot;
+  m_current = snapshot;
+  m_encoded.clear();
+}
+
+uint32_t SnapshotReplicator::add_client() {
+  uint32_t client = m_next_client++;
+  m_clients[client] = -1;
+  return client;
+}
+
+void SnapshotReplicator::remove_client(uint32_t client) {
+  m_clients.erase(client);
+}
+
+void SnapshotReplicator::ack(uint32_t client, uint32_t tick) {
+  auto it = m_clients.find(client);
+  if (it == m_clients.end() || !find(tick)) {
+    return;
+  }
+  // 确认可能乱序到达,只前进
+  if (it->second < 0 || (int32_t)(tick - (uint32_t)it->second) > 0) {
+    it->second = tick;
+  }
+}
+
+const Snapshot* SnapshotReplicator::find(uint32_t tick) const {
+  const Snapshot::ptr& snapshot = m_history[tick % m_options.history];
+  return snapshot && snapshot->tick() == tick ? snapshot.get() : nullptr;
+}
+
+WriteQueue::buffer_t SnapshotReplicator::encode(uint32_t client) {
+  auto it = m_clients.find(client);
+  if (!m_current || it == m_clients.end()) {
+    return nullptr;
+  }
+
+  const Snapshot* baseline = it->second < 0 ? nullptr : find(it->second);
+  int64_t key = baseline ? it->second : -1;
+  auto cached = m_encoded.find(key);
+  if (cached != m_encoded.end()) {
+    ++m_stats.shared_encodes;
+    m_stats.bytes += cached->second->size();
+    return cached->second;
+  }
+
+  m_buffer.clear();
+  SnapshotCodec::Encode(*m_current, baseline, m_buffer);
+  WriteQueue::buffer_t buffer =
+      std::make_shared<const std::string>(m_buffer.to_string());
+  m_encoded[key] = buffer;
+  ++(baseline ? m_stats.delta_encodes : m_stats.full_encodes);
+  m_stats.bytes += buffer->size();
+  return buffer;
+}
+
+SnapshotDecoder::SnapshotDecoder(SnapshotSchema::ptr schema, uint32_t history)
+    : m_schema(schema) {
+  m_history.resize(std::max(1u, history));
+}
+
+Snapshot::ptr SnapshotDecoder::decode(const void* data, size_t len) {
+  ByteArray in;
+  in.write(data, len);
+  in.set_position(0);
+  return decode(in, len);
+}
+
+Snapshot::ptr SnapshotDecoder::decode(ByteArray& in, size_t len) {
+  uint32_t tick = 0;
+  uint32_t base_tick = 0;
+  const Snapshot* baseline = nullptr;
+  if (SnapshotCodec::PeekHeader(in, tick, base_tick)) {
+    const Snapshot::ptr& snapshot = m_history[base_tick % m_history.size()];
+    if (!snapshot || snapshot->tick() != base_tick) {
+      in.set_position(in.position() + std::min(len, in.read_size()));
+      return nullptr;
+    }
+    baseline = snapshot.get();
+  }
+
+  Snapshot::ptr snapshot = SnapshotCodec::Decode(m_schema, in, len, baseline);
+  if (!snapshot) {
+    return nullptr;
+  }
+  m_history[snapshot->tick() % m_history.size()] = snapshot;
+  if (!m_latest || (int32_t)(snapshot->tick() - m_latest->tick()) > 0) {
+    m_latest = snapshot;
+  }
+  return snapshot;
+}
+
+}  // namespace cx::net
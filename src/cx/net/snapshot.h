@@ -0,0 +1,334 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cx/common/internal.h"
+#include "cx/common/noncopyable.h"
+#include "cx/maths/vector2.h"
+#include "cx/net/byte_array.h"
+#include "cx/net/write_queue.h"
+
+namespace cx::net {
+
+/**
+ * @brief 快照中实体的字段定义
+ *
+ * 所有字段都量化为无符号整数分量:浮点数按精度映射到[min, max]区间,
+ * Vector2的两个轴各占一个分量
+ */
+class SnapshotSchema {
+ public:
+  typedef std::shared_ptr<SnapshotSchema> ptr;
+
+  enum class FieldType : uint8_t { eInteger, eFloat, eVector2 };
+
+  /**
+   * @brief 量化后的分量
+   */
+  struct Component {
+    uint32_t bits;
+    float min;
+    float precision;
+    uint32_t max_value;
+  };
+
+  /**
+   * @brief 字段
+   */
+  struct Field {
+    std::string name;
+    FieldType type;
+    uint32_t component;  // 第一个分量的下标
+    uint32_t count;      // 分量数量
+  };
+
+  /**
+   * @brief 添加整数字段
+   *
+   * @param[in] name 名称
+   * @param[in] bits 位数,1到32
+   *
+   * @return 字段下标
+   */
+  uint32_t add_integer(const std::string& name, uint32_t bits);
+
+  /**
+   * @brief 添加量化的浮点数字段
+   *
+   * @param[in] name      名称
+   * @param[in] min       最小值
+   * @param[in] max       最大值,超出范围的值会被截断
+   * @param[in] precision 精度
+   *
+   * @return 字段下标
+   */
+  uint32_t add_float(const std::string& name, float min, float max,
+                     float precision);
+
+  /**
+   * @brief 添加量化的二维向量字段,如位置
+   *
+   * @param[in] name      名称
+   * @param[in] min       每个轴的最小值
+   * @param[in] max       每个轴的最大值
+   * @param[in] precision 精度
+   *
+   * @return 字段下标
+   */
+  uint32_t add_vector2(const std::string& name, const Vector2f& min,
+                       const Vector2f& max, float precision);
+
+  const std::vector<Field>& fields() const { return m_fields; }
+
+  const std::vector<Component>& components() const { return m_components; }
+
+  /**
+   * @brief 全量编码一个实体的位数
+   */
+  uint32_t full_bits() const { return m_full_bits; }
+
+  uint32_t quantize(uint32_t component, float value) const;
+  float dequantize(uint32_t component, uint32_t value) const;
+
+ private:
+  uint32_t add_component(float min, float max, float precision);
+
+ private:
+  std::vector<Field> m_fields;
+  std::vector<Component> m_components;
+  uint32_t m_full_bits = 0;
+};
+
+/**
+ * @brief 某一帧所有实体的量化状态,实体按id升序排列
+ */
+class Snapshot {
+ public:
+  typedef std::shared_ptr<Snapshot> ptr;
+
+  static const size_t npos = (size_t)-1;
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] schema 字段定义
+   * @param[in] tick   帧号
+   */
+  Snapshot(SnapshotSchema::ptr schema, uint32_t tick);
+
+  uint32_t tick() const { return m_tick; }
+
+  const SnapshotSchema::ptr& schema() const { return m_schema; }
+
+  /**
+   * @brief 实体数量
+   */
+  size_t size() const { return m_ids.size(); }
+
+  /**
+   * @brief 预留实体的空间
+   */
+  void reserve(size_t entities);
+
+  /**
+   * @brief 添加实体,id必须大于已有实体的id
+   *
+   * @return 实体下标
+   */
+  size_t add(uint32_t id);
+
+  uint32_t id(size_t index) const { return m_ids[index]; }
+
+  /**
+   * @brief 按id查找实体
+   *
+   * @return 实体下标,不存在时返回npos
+   */
+  size_t find(uint32_t id) const;
+
+  void set_integer(size_t index, uint32_t field, uint32_t value);
+  void set_float(size_t index, uint32_t field, float value);
+  void set_vector2(size_t index, uint32_t field, const Vector2f& value);
+
+  uint32_t get_integer(size_t index, uint32_t field) const;
+  float get_float(size_t index, uint32_t field) const;
+  Vector2f get_vector2(size_t index, uint32_t field) const;
+
+  /**
+   * @brief 实体量化后的分量
+   */
+  const uint32_t* values(size_t index) const {
+    return &m_values[index * m_stride];
+  }
+  uint32_t* values(size_t index) { return &m_values[index * m_stride]; }
+
+  /**
+   * @brief 量化后的状态是否相同,不比较帧号
+   */
+  bool same_state(const Snapshot& other) const;
+
+ private:
+  SnapshotSchema::ptr m_schema;
+  uint32_t m_tick;
+  uint32_t m_stride;
+  std::vector<uint32_t> m_ids;
+  std::vector<uint32_t> m_values;
+};
+
+/**
+ * @brief 快照的增量编码
+ *
+ * 以客户端已确认的快照为基准,只编码新增,删除与发生变化的实体,
+ * 变化的实体再逐字段编码:未变化的字段占1位,变化较小的分量编码差值,
+ * 否则编码完整的量化值;客户端没有可用的基准时编码完整快照
+ */
+class SnapshotCodec {
+ public:
+  /**
+   * @brief 编码快照
+   *
+   * @param[in]  current  当前快照
+   * @param[in]  baseline 基准快照,为nullptr时全量编码
+   * @param[out] out      输出
+   */
+  CX_STATIC void Encode(const Snapshot& current, const Snapshot* baseline,
+                        ByteArray& out);
+
+  /**
+   * @brief 读取编码数据头部中的基准帧号
+   *
+   * @param[in]  in       输入,读位置不变
+   * @param[out] tick     帧号
+   * @param[out] baseline 基准帧号
+   *
+   * @return 是否有基准
+   */
+  CX_STATIC bool PeekHeader(ByteArray& in, uint32_t& tick, uint32_t& baseline);
+
+  /**
+   * @brief 解码快照
+   *
+   * @param[in] schema   字段定义
+   * @param[in] in       输入,从读位置读取len字节
+   * @param[in] len      数据长度
+   * @param[in] baseline 编码时使用的基准快照
+   *
+   * @return 数据无效或缺少基准时返回nullptr
+   */
+  CX_STATIC Snapshot::ptr Decode(const SnapshotSchema::ptr& schema,
+                                 ByteArray& in, size_t len,
+                                 const Snapshot* baseline);
+};
+
+/**
+ * @brief 服务端的快照复制:保存最近的快照作为基准,记录每个客户端确认的帧
+ *
+ * 同一帧内基准相同的客户端共享同一份编码结果,编码的开销与不同基准的
+ * 数量成正比,而不是客户端数量
+ */
+class SnapshotReplicator : public Noncopyable {
+ public:
+  /**
+   * @brief 参数
+   */
+  struct Options {
+    uint32_t history = 32;  // 保留的快照数量,客户端确认的帧更旧时全量编码
+  };
+
+  /**
+   * @brief 统计信息
+   */
+  struct Stats {
+    uint64_t full_encodes = 0;
+    uint64_t delta_encodes = 0;
+    uint64_t shared_encodes = 0;  // 复用同一帧同一基准的编码结果
+    uint64_t bytes = 0;           // 发给所有客户端的字节数
+  };
+
+  SnapshotReplicator(SnapshotSchema::ptr schema);
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] schema  字段定义
+   * @param[in] options 参数
+   */
+  SnapshotReplicator(SnapshotSchema::ptr schema, const Options& options);
+
+  /**
+   * @brief 设置当前帧的快照,帧号必须递增
+   */
+  void push(Snapshot::ptr snapshot);
+
+  /**
+   * @brief 添加客户端
+   *
+   * @return 客户端id
+   */
+  uint32_t add_client();
+
+  void remove_client(uint32_t client);
+
+  /**
+   * @brief 客户端确认收到了某一帧,之后以该帧为基准
+   */
+  void ack(uint32_t client, uint32_t tick);
+
+  /**
+   * @brief 为客户端编码当前帧,可以直接交给TcpConnection::send广播
+   *
+   * @return 没有快照或客户端不存在时返回nullptr
+   */
+  WriteQueue::buffer_t encode(uint32_t client);
+
+  const Stats& stats() const { return m_stats; }
+
+ private:
+  /**
+   * @brief 按帧号查找保存的快照
+   */
+  const Snapshot* find(uint32_t tick) const;
+
+ private:
+  SnapshotSchema::ptr m_schema;
+  Options m_options;
+  Stats m_stats;
+  std::vector<Snapshot::ptr> m_history;  // 以帧号对history取模为下标
+  Snapshot::ptr m_current;
+  std::unordered_map<uint32_t, int64_t> m_clients;  // 客户端确认的帧,-1为没有
+  uint32_t m_next_client;
+  ByteArray m_buffer;
+  // 当前帧按基准缓存的编码结果,-1为全量
+  std::unordered_map<int64_t, WriteQueue::buffer_t> m_encoded;
+};
+
+/**
+ * @brief 客户端的快照解码:保存最近解码的快照,用于解码之后的增量
+ */
+class SnapshotDecoder : public Noncopyable {
+ public:
+  SnapshotDecoder(SnapshotSchema::ptr schema, uint32_t history = 32);
+
+  /**
+   * @brief 解码收到的数据
+   *
+   * @return 数据无效或基准已经丢弃时返回nullptr,应继续确认最后解码的帧
+   */
+  Snapshot::ptr decode(const void* data, size_t len);
+  Snapshot::ptr decode(ByteArray& in, size_t len);
+
+  /**
+   * @brief 最后解码的快照,应把它的帧号确认给服务端
+   */
+  const Snapshot::ptr& latest() const { return m_latest; }
+
+ private:
+  SnapshotSchema::ptr m_schema;
+  std::vector<Snapshot::ptr> m_history;
+  Snapshot::ptr m_latest;
+};
+
+}  // namespace cx::net
@@ -0,0 +1,226 @@
+#include "sock_addr.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <sstream>
+
+namespace cx::net {
+
+static const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+static const uint64_t FNV_PRIME = 0x100000001b3ull;
+
+static uint64_t Fnv1a(uint64_t hash, const void* data, size_t len) {
+  const uint8_t* ptr = (const uint8_t*)data;
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= ptr[i];
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+SockAddr::SockAddr(const sockaddr* addr, socklen_t addrlen) : SockAddr() {
+  if (addr == nullptr) {
+    return;
+  }
+  m_len = std::min(addrlen, (socklen_t)sizeof(m_addr));
+  memcpy(&m_addr, addr, m_len);
+}
+
+SockAddr SockAddr::IPv4(uint32_t address, uint16_t port) {
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = byteswapOnLittleEndian(port);
+  addr.sin_addr.s_addr = byteswapOnLittleEndian(address);
+  return SockAddr(addr);
+}
+
+SockAddr SockAddr::IPv6(const uint8_t address[16], uint16_t port) {
+  sockaddr_in6 addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin6_family = AF_INET6;
+  addr.sin6_port = byteswapOnLittleEndian(port);
+  memcpy(&addr.sin6_addr, address, 16);
+  return SockAddr(addr);
+}
+
+SockAddr SockAddr::Unix(const std::string& path) {
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+
+  size_t len = path.size() + 1;
+  if (!path.empty() && path[0] == '\0') {
+    --len;
+  }
+  if (len > sizeof(addr.sun_path)) {
+    return SockAddr();
+  }
+  memcpy(addr.sun_path, path.c_str(), len);
+  return SockAddr((const sockaddr*)&addr,
+                  (socklen_t)(offsetof(sockaddr_un, sun_path) + len));
+}
+
+bool SockAddr::Parse(const std::string& text, SockAddr& result) {
+  std::string host;
+  std::string service;
+
+  if (!text.empty() && text[0] == '[') {
+    size_t end = text.find(']');
+    if (end == std::string::npos) {
+      return false;
+    }
+    host = text.substr(1, end - 1);
+    if (end + 1 < text.size()) {
+      if (text[end + 1] != ':') {
+        return false;
+      }
+      service = text.substr(end + 2);
+    }
+  } else {
+    size_t colon = text.find(':');
+    if (colon != std::string::npos && text.find(':', colon + 1) == std::string::npos) {
+      host = text.substr(0, colon);
+      service = text.substr(colon + 1);
+    } else {
+      // 没有冒号,或者是不带端口的IPv6地址
+      host = text;
+    }
+  }
+
+  uint16_t port = 0;
+  if (!service.empty()) {
+    char* end = nullptr;
+    unsigned long value = strtoul(service.c_str(), &end, 10);
+    if (*end != '\0' || value > 0xffff) {
+      return false;
+    }
+    port = (uint16_t)value;
+  }
+
+  sockaddr_in addr4;
+  memset(&addr4, 0, sizeof(addr4));
+  if (inet_pton(AF_INET, host.c_str(), &addr4.sin_addr) == 1) {
+    addr4.sin_family = AF_INET;
+    addr4.sin_port = byteswapOnLittleEndian(port);
+    result = SockAddr(addr4);
+    return true;
+  }
+
+  sockaddr_in6 addr6;
+  memset(&addr6, 0, sizeof(addr6));
+  if (inet_pton(AF_INET6, host.c_str(), &addr6.sin6_addr) == 1) {
+    addr6.sin6_family = AF_INET6;
+    addr6.sin6_port = byteswapOnLittleEndian(port);
+    result = SockAddr(addr6);
+    return true;
+  }
+  return false;
+}
+
+SockAddr SockAddr::FromAddress(const Address& address) {
+  return SockAddr(address.address(), address.address_len());
+}
+
+Address::ptr SockAddr::to_address() const {
+  if (!valid()) {
+    return nullptr;
+  }
+  return Address::Generate(address(), m_len);
+}
+
+std::string SockAddr::path() const {
+  const size_t offset = offsetof(sockaddr_un, sun_path);
+  if (!is_unix() || m_len <= offset) {
+    return "";
+  }
+  const sockaddr_un& addr = unix_addr();
+  size_t len = m_len - offset;
+  if (addr.sun_path[0] == '\0') {
+    return std::string(addr.sun_path, len);
+  }
+  return std::string(addr.sun_path, strnlen(addr.sun_path, len));
+}
+
+std::string SockAddr::to_string() const {
+  char buf[INET6_ADDRSTRLEN];
+  std::stringstream ss;
+  switch (m_addr.ss_family) {
+    case AF_INET:
+      inet_ntop(AF_INET, &ipv4().sin_addr, buf, sizeof(buf));
+      ss << buf << ":" << port();
+      break;
+    case AF_INET6:
+      inet_ntop(AF_INET6, &ipv6().sin6_addr, buf, sizeof(buf));
+      ss << "[" << buf << "]:" << port();
+      break;
+    case AF_UNIX: {
+      std::string str = path();
+      if (!str.empty() && str[0] == '\0') {
+        ss << "\\0" << str.substr(1);
+      } else {
+        ss << str;
+      }
+    } break;
+    default:
+      ss << "[UnknownAddress family=" << m_addr.ss_family << "]";
+      break;
+  }
+  return ss.str();
+}
+
+size_t SockAddr::hash() const {
+  uint64_t hash = Fnv1a(FNV_OFFSET_BASIS, &m_addr.ss_family,
+                        sizeof(m_addr.ss_family));
+  switch (m_addr.ss_family) {
+    case AF_INET:
+      hash = Fnv1a(hash, &ipv4().sin_addr, sizeof(ipv4().sin_addr));
+      hash = Fnv1a(hash, &ipv4().sin_port, sizeof(ipv4().sin_port));
+      break;
+    case AF_INET6:
+      hash = Fnv1a(hash, &ipv6().sin6_addr, sizeof(ipv6().sin6_addr));
+      hash = Fnv1a(hash, &ipv6().sin6_port, sizeof(ipv6().sin6_port));
+      hash = Fnv1a(hash, &ipv6().sin6_scope_id, sizeof(ipv6().sin6_scope_id));
+      break;
+    default:
+      hash = Fnv1a(hash, &m_addr, m_len);
+      break;
+  }
+  return (size_t)hash;
+}
+
+int SockAddr::compare(const SockAddr& rhs) const {
+  if (m_addr.ss_family != rhs.m_addr.ss_family) {
+    return m_addr.ss_family < rhs.m_addr.ss_family ? -1 : 1;
+  }
+
+  int result = 0;
+  switch (m_addr.ss_family) {
+    case AF_INET:
+      result = memcmp(&ipv4().sin_addr, &rhs.ipv4().sin_addr,
+                      sizeof(ipv4().sin_addr));
+      if (result == 0) {
+        result = (int)port() - (int)rhs.port();
+      }
+      return result;
+    case AF_INET6:
+      result = memcmp(&ipv6().sin6_addr, &rhs.ipv6().sin6_addr,
+                      sizeof(ipv6().sin6_addr));
+      if (result == 0) {
+        result = (int)port() - (int)rhs.port();
+      }
+      if (result == 0 && ipv6().sin6_scope_id != rhs.ipv6().sin6_scope_id) {
+        result = ipv6().sin6_scope_id < rhs.ipv6().sin6_scope_id ? -1 : 1;
+      }
+      return result;
+    default:
+      result = memcmp(&m_addr, &rhs.m_addr, std::min(m_len, rhs.m_len));
+      if (result == 0 && m_len != rhs.m_len) {
+        result = m_len < rhs.m_len ? -1 : 1;
+      }
+      return result;
+  }
+}
+
+}  // namespace cx::net
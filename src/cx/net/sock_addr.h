@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+
+#include "cx/common/internal.h"
+#include "cx/net/address.h"
+#include "cx/net/endian.h"
+#include "cx/net/enums.h"
+
+namespace cx::net {
+
+/**
+ * @brief 值类型的socket地址,内部为sockaddr_storage,不需要堆分配
+ *
+ * 可以直接作为哈希表的key,并与Address互相转换
+ */
+class SockAddr {
+ public:
+  /**
+   * @brief 构造空地址(AF_UNSPEC)
+   */
+  SockAddr() : m_len(0) {
+    memset(&m_addr, 0, sizeof(m_addr));
+    m_addr.ss_family = AF_UNSPEC;
+  }
+
+  /**
+   * @brief 通过sockaddr构造
+   *
+   * @param[in] addr    sockaddr指针
+   * @param[in] addrlen sockaddr的长度
+   */
+  SockAddr(const sockaddr* addr, socklen_t addrlen);
+
+  explicit SockAddr(const sockaddr_in& addr)
+      : SockAddr((const sockaddr*)&addr, sizeof(addr)) {}
+
+  explicit SockAddr(const sockaddr_in6& addr)
+      : SockAddr((const sockaddr*)&addr, sizeof(addr)) {}
+
+  /**
+   * @brief 创建IPv4地址
+   *
+   * @param[in] address 主机字节序的二进制地址
+   * @param[in] port    端口号
+   */
+  CX_STATIC SockAddr IPv4(uint32_t address = INADDR_ANY, uint16_t port = 0);
+
+  /**
+   * @brief 创建IPv6地址
+   *
+   * @param[in] address 二进制地址
+   * @param[in] port    端口号
+   */
+  CX_STATIC SockAddr IPv6(const uint8_t address[16], uint16_t port = 0);
+
+  /**
+   * @brief 创建Unix地址,路径以'\0'开头时为抽象地址
+   *
+   * @param[in] path 路径
+   *
+   * @return 路径过长时返回空地址
+   */
+  CX_STATIC SockAddr Unix(const std::string& path);
+
+  /**
+   * @brief 解析数字形式的地址,如"127.0.0.1:80","[::1]:80",不会进行域名解析
+   *
+   * @param[in]  text   地址字符串
+   * @param[out] result 结果
+   *
+   * @return 是否解析成功
+   */
+  CX_STATIC bool Parse(const std::string& text, SockAddr& result);
+
+  /**
+   * @brief 从Address转换
+   */
+  CX_STATIC SockAddr FromAddress(const Address& address);
+
+  /**
+   * @brief 转换为Address
+   *
+   * @return 空地址返回nullptr
+   */
+  Address::ptr to_address() const;
+
+  AddressFamily family() const {
+    return static_cast<AddressFamily>(m_addr.ss_family);
+  }
+
+  bool valid() const { return m_len > 0 && m_addr.ss_family != AF_UNSPEC; }
+
+  bool is_ipv4() const { return m_addr.ss_family == AF_INET; }
+
+  bool is_ipv6() const { return m_addr.ss_family == AF_INET6; }
+
+  bool is_unix() const { return m_addr.ss_family == AF_UNIX; }
+
+  const sockaddr* address() const { return (const sockaddr*)&m_addr; }
+
+  /**
+   * @brief 可写的sockaddr指针,配合capacity/set_address_len用于accept,recvfrom等
+   */
+  sockaddr* address() { return (sockaddr*)&m_addr; }
+
+  socklen_t address_len() const { return m_len; }
+
+  void set_address_len(socklen_t len) { m_len = len; }
+
+  /**
+   * @brief 可容纳的最大地址长度
+   */
+  CX_CONSTEXPR socklen_t capacity() const { return sizeof(m_addr); }
+
+  const sockaddr_in& ipv4() const { return *(const sockaddr_in*)&m_addr; }
+
+  const sockaddr_in6& ipv6() const { return *(const sockaddr_in6*)&m_addr; }
+
+  const sockaddr_un& unix_addr() const {
+    return *(const sockaddr_un*)&m_addr;
+  }
+
+  /**
+   * @brief 主机字节序的IPv4地址
+   */
+  uint32_t ipv4_address() const {
+    return byteswapOnLittleEndian((uint32_t)ipv4().sin_addr.s_addr);
+  }
+
+  /**
+   * @brief 获取端口号,非IP地址返回0
+   */
+  uint16_t port() const {
+    switch (m_addr.ss_family) {
+      case AF_INET:
+        return byteswapOnLittleEndian((uint16_t)ipv4().sin_port);
+      case AF_INET6:
+        return byteswapOnLittleEndian((uint16_t)ipv6().sin6_port);
+      default:
+        return 0;
+    }
+  }
+
+  /**
+   * @brief 设置端口号,非IP地址不做任何事
+   */
+  void set_port(uint16_t port) {
+    switch (m_addr.ss_family) {
+      case AF_INET:
+        ((sockaddr_in*)&m_addr)->sin_port = byteswapOnLittleEndian(port);
+        break;
+      case AF_INET6:
+        ((sockaddr_in6*)&m_addr)->sin6_port = byteswapOnLittleEndian(port);
+        break;
+      default:
+        break;
+    }
+  }
+
+  /**
+   * @brief Unix地址的路径,抽象地址包含开头的'\0'
+   */
+  std::string path() const;
+
+  std::string to_string() const;
+
+  /**
+   * @brief 哈希值,只计算协议簇,地址与端口
+   */
+  size_t hash() const;
+
+  /**
+   * @brief 比较,IPv6忽略flowinfo
+   */
+  int compare(const SockAddr& rhs) const;
+
+  bool operator==(const SockAddr& rhs) const { return compare(rhs) == 0; }
+  bool operator!=(const SockAddr& rhs) const { return compare(rhs) != 0; }
+  bool operator<(const SockAddr& rhs) const { return compare(rhs) < 0; }
+
+ private:
+  sockaddr_storage m_addr;
+  socklen_t m_len;
+};
+
+CX_INLINE std::ostream& operator<<(std::ostream& os, const SockAddr& addr) {
+  return os << addr.to_string();
+}
+
+}  // namespace cx::net
+
+namespace std {
+
+template <>
+struct hash<cx::net::SockAddr> {
+  size_t operator()(const cx::net::SockAddr& addr) const { return addr.hash(); }
+};
+
+}  // namespace std
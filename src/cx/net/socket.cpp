@@ -1,9 +1,18 @@
 #include "socket.h"
 
+#include <fcntl.h>
+
+#include <atomic>
 #include <cstring>
+#include <vector>
 
 #include "cx/net/address.h"
 
+#if defined(CX_PLATFORM_LINUX)
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#endif
+
 #if defined(CX_PLATFORM_WINDOWS)
 struct __SockIniter {
   __SockIniter() {
@@ -58,14 +67,30 @@ Socket::ptr Socket::GenerateUnixUDPSocket() {
   return sock;
 }
 
+static std::atomic<uint64_t> s_next_id(1);
+
 Socket::Socket(AddressFamily family, SocketType type, IpProtocol protocol)
-    : m_sock(-1),
+    : m_id(s_next_id.fetch_add(1, std::memory_order_relaxed)),
+      m_sock(-1),
       m_family(family),
       m_type(type),
       m_protocol(protocol),
-      m_is_connected(false) {}
+      m_is_connected(false),
+      m_reuse_port(false),
+      m_timestamping(0),
+      m_recv_timestamp(0),
+      m_registry(SocketRegistry::Self()) {
+  if (m_registry) {
+    m_registry->add(&m_stats);
+  }
+}
 
-Socket::~Socket() { close(); }
+Socket::~Socket() {
+  close();
+  if (m_registry) {
+    m_registry->remove(&m_stats);
+  }
+}
 
 int64_t Socket::get_send_timeout() {
   struct timeval tv;
@@ -111,57 +136,101 @@ bool Socket::set_option(int level, int opt, const void* result, socklen_t len) {
   return true;
 }
 
+bool Socket::set_non_blocking(bool enable) {
+  int flags = fcntl(m_sock, F_GETFL, 0);
+  if (flags == -1) {
+    return false;
+  }
+  flags = enable ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+  return fcntl(m_sock, F_SETFL, flags) == 0;
+}
+
+void Socket::set_reuse_port(bool enable) {
+  m_reuse_port = enable;
+  if (is_valid()) {
+    int val = enable ? 1 : 0;
+    set_option(SOL_SOCKET, SO_REUSEPORT, val);
+  }
+}
+
 Socket::ptr Socket::accept() {
-  Socket::ptr sock(new Socket(m_family, m_type, m_protocol));
-  int newsock = ::accept(m_sock, nullptr, nullptr);
+  SockAddr remote;
+  socklen_t len = remote.capacity();
+  int newsock = ::accept(m_sock, remote.address(), &len);
   if (newsock == -1) {
     return nullptr;
   }
-  if (sock->init(newsock)) {
+  remote.set_address_len(len);
+
+  Socket::ptr sock(new Socket(m_family, m_type, m_protocol));
+  if (sock->init(newsock, remote)) {
     return sock;
   }
   return nullptr;
 }
 
 bool Socket::bind(const Address::ptr addr) {
+  if (addr->family() != m_family) {
+    return false;
+  }
+  return bind(SockAddr::FromAddress(*addr));
+}
+
+bool Socket::bind(const SockAddr& addr) {
   if (!is_valid()) {
     new_sock();
     if (!is_valid()) {
       return false;
     }
   }
-  if (addr->family() != m_family) {
+  if (addr.family() != m_family) {
     return false;
   }
 
-  if (::bind(m_sock, addr->address(), addr->address_len())) {
+  if (::bind(m_sock, addr.address(), addr.address_len())) {
     return false;
   }
-  local_address();
+  m_local = SockAddr();
+  m_local_address.reset();
+  local_sockaddr();
   return true;
 }
 
 bool Socket::connect(const Address::ptr addr, uint64_t timeout_ms) {
+  if (!connect(SockAddr::FromAddress(*addr), timeout_ms)) {
+    return false;
+  }
   m_remote_address = addr;
+  return true;
+}
+
+bool Socket::connect(const SockAddr& addr, uint64_t timeout_ms) {
+  m_remote = addr;
+  m_remote_address.reset();
   if (!is_valid()) {
     new_sock();
     if (!is_valid()) {
       return false;
     }
   }
-  if (addr->family() != m_family) {
+  if (addr.family() != m_family) {
     return false;
   }
 
   if (timeout_ms == (uint64_t)-1) {
-    if (::connect(m_sock, addr->address(), addr->address_len())) {
+    if (::connect(m_sock, addr.address(), addr.address_len())) {
       close();
       return false;
     }
   }
   m_is_connected = true;
-  remote_address();
-  local_address();
+  m_local = SockAddr();
+  m_local_address.reset();
+  local_sockaddr();
+  if (m_timestamping & eSendTimestamp) {
+    // 连接建立后才能为TCP开启发送序号
+    apply_timestamping();
+  }
   return true;
 }
 
@@ -182,6 +251,9 @@ bool Socket::close() {
 
   m_is_connected = false;
   if (m_sock != -1) {
+    if (CX_UNLICKLY(TrafficCapture::IsActive())) {
+      TrafficCapture::RecordClose(*this);
+    }
     ::close(m_sock);
     m_sock = -1;
   }
@@ -190,7 +262,9 @@ bool Socket::close() {
 
 int Socket::send(const void* buffer, size_t len, int flags) {
   if (is_connected()) {
-    return ::send(m_sock, buffer, len, flags);
+    int rt = ::send(m_sock, buffer, len, flags);
+    after_send(rt, buffer);
+    return rt;
   }
   return -1;
 }
@@ -201,37 +275,84 @@ int Socket::send(const iovec* buffers, size_t len, int flags) {
     memset(&msg, 0, sizeof(msg));
     msg.msg_iov = (iovec*)buffers;
     msg.msg_iovlen = len;
-    return ::sendmsg(m_sock, &msg, flags);
+    int rt = ::sendmsg(m_sock, &msg, flags);
+    after_send(rt, msg);
+    return rt;
   }
   return -1;
 }
 
 int Socket::send_to(const void* buffer, size_t len, const Address::ptr to,
                     int flags) {
-  if (is_connected()) {
-    return ::sendto(m_sock, buffer, len, flags, to->address(),
-                    to->address_len());
+  if (is_valid()) {
+    int rt = ::sendto(m_sock, buffer, len, flags, to->address(),
+                      to->address_len());
+    after_send(rt, buffer);
+    return rt;
   }
   return -1;
 }
 
 int Socket::send_to(const iovec* buffers, size_t len, const Address::ptr to,
                     int flags) {
-  if (is_connected()) {
+  if (is_valid()) {
     msghdr msg;
     memset(&msg, 0, sizeof(msg));
     msg.msg_iov = (iovec*)buffers;
     msg.msg_iovlen = len;
     msg.msg_name = (void*)to->address();
     msg.msg_namelen = to->address_len();
-    return ::sendmsg(m_sock, &msg, flags);
+    int rt = ::sendmsg(m_sock, &msg, flags);
+    after_send(rt, msg);
+    return rt;
+  }
+  return -1;
+}
+
+int Socket::send_to(const void* buffer, size_t len, const SockAddr& to,
+                    int flags) {
+  if (!is_valid()) {
+    // 未绑定的UDP socket在第一次发送时创建
+    new_sock();
+  }
+  if (is_valid()) {
+    int rt = ::sendto(m_sock, buffer, len, flags, to.address(),
+                      to.address_len());
+    after_send(rt, buffer);
+    return rt;
+  }
+  return -1;
+}
+
+int Socket::send_to(const iovec* buffers, size_t len, const SockAddr& to,
+                    int flags) {
+  if (!is_valid()) {
+    // 未绑定的UDP socket在第一次发送时创建
+    new_sock();
+  }
+  if (is_valid()) {
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = (iovec*)buffers;
+    msg.msg_iovlen = len;
+    msg.msg_name = (void*)to.address();
+    msg.msg_namelen = to.address_len();
+    int rt = ::sendmsg(m_sock, &msg, flags);
+    after_send(rt, msg);
+    return rt;
   }
   return -1;
 }
 
 int Socket::recv(void* buffer, size_t len, int flags) {
+  if (m_timestamping & eRecvTimestamp) {
+    iovec iov{buffer, len};
+    return recv(&iov, 1, flags);
+  }
   if (is_connected()) {
-    return ::recv(m_sock, buffer, len, flags);
+    int rt = ::recv(m_sock, buffer, len, flags);
+    after_recv(rt, buffer, flags);
+    return rt;
   }
   return -1;
 }
@@ -242,64 +363,144 @@ int Socket::recv(iovec* buffers, size_t len, int flags) {
     memset(&msg, 0, sizeof(msg));
     msg.msg_iov = (iovec*)buffers;
     msg.msg_iovlen = len;
-    return ::recvmsg(m_sock, &msg, flags);
+    return recv_msg(msg, flags);
   }
   return -1;
 }
 
 int Socket::recv_from(void* buffer, size_t len, Address::ptr from, int flags) {
-  if (is_connected()) {
-    socklen_t len = from->address_len();
-    return ::recvfrom(m_sock, buffer, len, flags,
-                      const_cast<sockaddr*>(from->address()), &len);
+  if (m_timestamping & eRecvTimestamp) {
+    iovec iov{buffer, len};
+    return recv_from(&iov, 1, from, flags);
+  }
+  if (is_valid()) {
+    socklen_t addrlen = from->address_len();
+    int rt = ::recvfrom(m_sock, buffer, len, flags,
+                        const_cast<sockaddr*>(from->address()), &addrlen);
+    after_recv(rt, buffer, flags);
+    return rt;
   }
   return -1;
 }
 
 int Socket::recv_from(iovec* buffers, size_t len, Address::ptr from,
                       int flags) {
-  if (is_connected()) {
+  if (is_valid()) {
     msghdr msg;
     memset(&msg, 0, sizeof(msg));
     msg.msg_iov = (iovec*)buffers;
     msg.msg_iovlen = len;
     msg.msg_name = (sockaddr*)from->address();
     msg.msg_namelen = from->address_len();
-    return ::recvmsg(m_sock, &msg, flags);
+    return recv_msg(msg, flags);
+  }
+  return -1;
+}
+
+int Socket::recv_from(void* buffer, size_t len, SockAddr& from, int flags) {
+  if (m_timestamping & eRecvTimestamp) {
+    iovec iov{buffer, len};
+    return recv_from(&iov, 1, from, flags);
+  }
+  if (is_valid()) {
+    socklen_t addrlen = from.capacity();
+    int rt = ::recvfrom(m_sock, buffer, len, flags, from.address(), &addrlen);
+    after_recv(rt, buffer, flags);
+    from.set_address_len(rt >= 0 ? addrlen : 0);
+    return rt;
+  }
+  return -1;
+}
+
+int Socket::recv_from(iovec* buffers, size_t len, SockAddr& from, int flags) {
+  if (is_valid()) {
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = buffers;
+    msg.msg_iovlen = len;
+    msg.msg_name = from.address();
+    msg.msg_namelen = from.capacity();
+    int rt = recv_msg(msg, flags);
+    from.set_address_len(rt >= 0 ? msg.msg_namelen : 0);
+    return rt;
   }
   return -1;
 }
 
+int Socket::send_fds(const int* fds, size_t count, const void* data,
+                     size_t len) {
+  if (!is_connected() || m_family != AddressFamily::eUnix) {
+    return -1;
+  }
+
+  std::vector<char> control(CMSG_SPACE(sizeof(int) * count));
+  iovec iov{(void*)data, len};
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.data();
+  msg.msg_controllen = control.size();
+
+  cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * count);
+  int rt = ::sendmsg(m_sock, &msg, 0);
+  after_send(rt, msg);
+  return rt;
+}
+
+int Socket::recv_fds(int* fds, size_t& count, void* data, size_t len) {
+  if (!is_connected() || m_family != AddressFamily::eUnix) {
+    return -1;
+  }
+
+  std::vector<char> control(CMSG_SPACE(sizeof(int) * count));
+  iovec iov{data, len};
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.data();
+  msg.msg_controllen = control.size();
+
+  int rt = ::recvmsg(m_sock, &msg, 0);
+  after_recv(rt, msg, 0);
+  size_t received = 0;
+  if (rt >= 0) {
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        continue;
+      }
+      size_t n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      for (size_t i = 0; i < n; ++i) {
+        int fd;
+        memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+        if (received < count) {
+          fds[received++] = fd;
+        } else {
+          ::close(fd);
+        }
+      }
+    }
+  }
+  count = received;
+  return rt;
+}
+
 Address::ptr Socket::remote_address() {
   if (m_remote_address) {
     return m_remote_address;
   }
 
-  Address::ptr result;
-  switch (m_family) {
-    case AddressFamily::eIPv4:
-      result.reset(new IPv4Address);
-      break;
-    case AddressFamily::eIPv6:
-      result.reset(new IPv6Address);
-      break;
-    case AddressFamily::eUnix:
-      result.reset(new UnixAddress);
-      break;
-    default:
-      result.reset(new UnkonwAddress(m_family));
-      break;
-  }
-
-  socklen_t addrlen = result->address_len();
-  if (getpeername(m_sock, const_cast<sockaddr*>(result->address()), &addrlen)) {
+  const SockAddr& addr = remote_sockaddr();
+  if (!addr.valid()) {
     return Address::ptr(new UnkonwAddress(m_family));
   }
-  if (m_family == AddressFamily::eUnix) {
-    UnixAddress::ptr addr = std::dynamic_pointer_cast<UnixAddress>(result);
-    addr->set_address_len(addrlen);
-  }
-  m_remote_address = result;
+  m_remote_address = addr.to_address();
   return m_remote_address;
 }
 
@@ -308,34 +509,34 @@ Address::ptr Socket::local_address() {
     return m_local_address;
   }
 
-  Address::ptr result;
-  switch (m_family) {
-    case AddressFamily::eIPv4:
-      result.reset(new IPv4Address);
-      break;
-    case AddressFamily::eIPv6:
-      result.reset(new IPv6Address);
-      break;
-    case AddressFamily::eUnix:
-      result.reset(new UnixAddress);
-      break;
-    default:
-      result.reset(new UnkonwAddress(m_family));
-      break;
-  }
-
-  socklen_t addrlen = result->address_len();
-  if (getsockname(m_sock, const_cast<sockaddr*>(result->address()), &addrlen)) {
+  const SockAddr& addr = local_sockaddr();
+  if (!addr.valid()) {
     return Address::ptr(new UnkonwAddress(m_family));
   }
-  if (m_family == AddressFamily::eUnix) {
-    UnixAddress::ptr addr = std::dynamic_pointer_cast<UnixAddress>(result);
-    addr->set_address_len(addrlen);
-  }
-  m_local_address = result;
+  m_local_address = addr.to_address();
   return m_local_address;
 }
 
+const SockAddr& Socket::remote_sockaddr() {
+  if (!m_remote.valid() && is_valid()) {
+    socklen_t addrlen = m_remote.capacity();
+    if (getpeername(m_sock, m_remote.address(), &addrlen) == 0) {
+      m_remote.set_address_len(addrlen);
+    }
+  }
+  return m_remote;
+}
+
+const SockAddr& Socket::local_sockaddr() {
+  if (!m_local.valid() && is_valid()) {
+    socklen_t addrlen = m_local.capacity();
+    if (getsockname(m_sock, m_local.address(), &addrlen) == 0) {
+      m_local.set_address_len(addrlen);
+    }
+  }
+  return m_local;
+}
+
 bool Socket::is_valid() const { return m_sock != -1; }
 
 int Socket::get_error() {
@@ -347,12 +548,151 @@ int Socket::get_error() {
   return error;
 }
 
+bool Socket::tcp_info(TcpInfo& info) {
+#if defined(CX_PLATFORM_LINUX)
+  if (!is_valid() || m_type != SocketType::eTcp) {
+    return false;
+  }
+  struct tcp_info raw;
+  memset(&raw, 0, sizeof(raw));
+  if (!get_option(IPPROTO_TCP, TCP_INFO, raw)) {
+    return false;
+  }
+  info.state = raw.tcpi_state;
+  info.rtt_us = raw.tcpi_rtt;
+  info.rtt_var_us = raw.tcpi_rttvar;
+  info.rto_us = raw.tcpi_rto;
+  info.retransmits = raw.tcpi_retransmits;
+  info.total_retrans = raw.tcpi_total_retrans;
+  info.send_cwnd = raw.tcpi_snd_cwnd;
+  info.send_ssthresh = raw.tcpi_snd_ssthresh;
+  info.send_mss = raw.tcpi_snd_mss;
+  info.unacked = raw.tcpi_unacked;
+  info.lost = raw.tcpi_lost;
+  info.reordering = raw.tcpi_reordering;
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool Socket::set_timestamping(bool recv, bool send) {
+#if defined(CX_PLATFORM_LINUX)
+  m_timestamping = (recv ? eRecvTimestamp : 0) | (send ? eSendTimestamp : 0);
+  m_recv_timestamp = 0;
+  return !is_valid() || apply_timestamping();
+#else
+  return false;
+#endif
+}
+
+bool Socket::apply_timestamping() {
+#if defined(CX_PLATFORM_LINUX)
+  int flags = 0;
+  if (m_timestamping & eRecvTimestamp) {
+    flags |= SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+  }
+  if (m_timestamping & eSendTimestamp) {
+    flags |= SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+             SOF_TIMESTAMPING_OPT_TSONLY;
+    // 未连接的TCP socket不能开启OPT_ID,此时只记录时间
+    if (set_option(SOL_SOCKET, SO_TIMESTAMPING,
+                   flags | SOF_TIMESTAMPING_OPT_ID)) {
+      return true;
+    }
+  }
+  return set_option(SOL_SOCKET, SO_TIMESTAMPING, flags);
+#else
+  return false;
+#endif
+}
+
+bool Socket::read_send_timestamp(uint64_t& timestamp_ns, uint32_t& id) {
+#if defined(CX_PLATFORM_LINUX)
+  if (!is_valid() || !(m_timestamping & eSendTimestamp)) {
+    return false;
+  }
+  char control[CMSG_SPACE(sizeof(scm_timestamping)) +
+               CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_in6))];
+  char data[1];
+  iovec iov{data, sizeof(data)};
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  if (::recvmsg(m_sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+    return false;
+  }
+
+  bool found = false;
+  id = 0;
+  for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET &&
+        cmsg->cmsg_type == SCM_TIMESTAMPING) {
+      scm_timestamping ts;
+      memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+      timestamp_ns = ts.ts[0].tv_sec * 1000000000ull + ts.ts[0].tv_nsec;
+      found = true;
+    } else if ((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+               (cmsg->cmsg_level == SOL_IPV6 &&
+                cmsg->cmsg_type == IPV6_RECVERR)) {
+      sock_extended_err err;
+      memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+      if (err.ee_origin == SO_EE_ORIGIN_TIMESTAMPING) {
+        id = err.ee_data;
+      }
+    }
+  }
+  return found;
+#else
+  return false;
+#endif
+}
+
+int Socket::recv_msg(msghdr& msg, int flags) {
+#if defined(CX_PLATFORM_LINUX)
+  if (m_timestamping & eRecvTimestamp) {
+    char control[CMSG_SPACE(sizeof(scm_timestamping))];
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    int rt = ::recvmsg(m_sock, &msg, flags);
+    after_recv(rt, msg, flags);
+    if (rt >= 0) {
+      for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+           cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET &&
+            cmsg->cmsg_type == SCM_TIMESTAMPING) {
+          scm_timestamping ts;
+          memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+          m_recv_timestamp = ts.ts[0].tv_sec * 1000000000ull + ts.ts[0].tv_nsec;
+        }
+      }
+      msg.msg_control = nullptr;
+      msg.msg_controllen = 0;
+    }
+    return rt;
+  }
+#endif
+  int rt = ::recvmsg(m_sock, &msg, flags);
+  after_recv(rt, msg, flags);
+  return rt;
+}
+
 void Socket::init_sock() {
   int val = 1;
   set_option(SOL_SOCKET, SO_REUSEADDR, val);
+  if (m_reuse_port) {
+    set_option(SOL_SOCKET, SO_REUSEPORT, val);
+  }
   if (m_type == SocketType::eTcp) {
     set_option(IPPROTO_TCP, TCP_NODELAY, val);
   }
+  if (m_timestamping) {
+    apply_timestamping();
+  }
 }
 
 void Socket::new_sock() {
@@ -363,14 +703,14 @@ void Socket::new_sock() {
   }
 }
 
-bool Socket::init(socket_type sock) {
+bool Socket::init(socket_type sock, const SockAddr& remote) {
   if (!sock) return false;
 
   m_sock = sock;
   m_is_connected = true;
+  m_remote = remote;
   init_sock();
-  local_address();
-  remote_address();
+  // 本地地址在第一次使用时再获取,避免每次accept都调用getsockname
   return true;
 }
 
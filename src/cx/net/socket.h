@@ -6,6 +6,10 @@
 #include "cx/common/noncopyable.h"
 #include "cx/net/address.h"
 #include "cx/net/enums.h"
+#include "cx/net/sock_addr.h"
+#include "cx/net/socket_stats.h"
+#include "cx/net/traffic_capture.h"
+
 namespace cx::net {
 
 class Socket : public std::enable_shared_from_this<Socket>, Noncopyable {
@@ -48,9 +52,45 @@ class Socket : public std::enable_shared_from_this<Socket>, Noncopyable {
     return set_option(level, opt, &value, sizeof(T));
   }
 
+  /**
+   * @brief 设置是否为非阻塞模式
+   *
+   * @param[in] enable 是否非阻塞
+   *
+   * @return 是否成功
+   */
+  bool set_non_blocking(bool enable);
+
+  /**
+   * @brief 设置SO_REUSEPORT,socket尚未创建时在创建后(bind前)生效
+   *
+   * @param[in] enable 是否开启
+   */
+  void set_reuse_port(bool enable);
+
   virtual Socket::ptr accept();
   virtual bool bind(const Address::ptr addr);
   virtual bool connect(const Address::ptr addr, uint64_t timeout_ms = -1);
+
+  /**
+   * @brief 绑定地址
+   *
+   * @param[in] addr 地址
+   *
+   * @return 是否成功
+   */
+  bool bind(const SockAddr& addr);
+
+  /**
+   * @brief 连接地址
+   *
+   * @param[in] addr       地址
+   * @param[in] timeout_ms 超时时间
+   *
+   * @return 是否成功
+   */
+  bool connect(const SockAddr& addr, uint64_t timeout_ms = -1);
+
   virtual bool listen(int backlog = SOMAXCONN);
   virtual bool close();
 
@@ -68,9 +108,61 @@ class Socket : public std::enable_shared_from_this<Socket>, Noncopyable {
   virtual int recv_from(iovec* buffers, size_t len, Address::ptr from,
                         int flags = 0);
 
+  int send_to(const void* buffer, size_t len, const SockAddr& to,
+              int flags = 0);
+  int send_to(const iovec* buffers, size_t len, const SockAddr& to,
+              int flags = 0);
+
+  /**
+   * @brief 接收数据报,来源地址写入from,不产生堆分配
+   *
+   * @param[in]  buffer 缓存
+   * @param[in]  len    缓存长度
+   * @param[out] from   来源地址
+   * @param[in]  flags  标志
+   *
+   * @return 接收的字节数,失败返回-1
+   */
+  int recv_from(void* buffer, size_t len, SockAddr& from, int flags = 0);
+  int recv_from(iovec* buffers, size_t len, SockAddr& from, int flags = 0);
+
+  /**
+   * @brief 通过Unix域socket发送文件描述符(SCM_RIGHTS)
+   *
+   * @param[in] fds   文件描述符
+   * @param[in] count 文件描述符数量
+   * @param[in] data  同时发送的数据,不能为空
+   * @param[in] len   数据长度,至少为1
+   *
+   * @return 发送的字节数,失败返回-1
+   */
+  int send_fds(const int* fds, size_t count, const void* data, size_t len);
+
+  /**
+   * @brief 接收文件描述符(SCM_RIGHTS)
+   *
+   * @param[out]    fds   文件描述符
+   * @param[in,out] count 传入最多接收的数量,返回实际接收的数量
+   * @param[out]    data  数据缓冲
+   * @param[in]     len   缓冲长度
+   *
+   * @return 接收的字节数,失败返回-1
+   */
+  int recv_fds(int* fds, size_t& count, void* data, size_t len);
+
   Address::ptr remote_address();
   Address::ptr local_address();
 
+  /**
+   * @brief 对端地址,值类型,不产生堆分配
+   */
+  const SockAddr& remote_sockaddr();
+
+  /**
+   * @brief 本地地址,值类型,不产生堆分配
+   */
+  const SockAddr& local_sockaddr();
+
   AddressFamily family() const { return m_family; };
 
   SocketType type() const { return m_type; };
@@ -84,18 +176,121 @@ class Socket : public std::enable_shared_from_this<Socket>, Noncopyable {
 
   int get_error();
 
+  /**
+   * @brief 进程内唯一的socket编号,用于流量录制等区分连接
+   */
+  uint64_t id() const { return m_id; }
+
+  /**
+   * @brief 本socket的IO计数,同时汇总到SocketRegistry
+   */
+  const SocketStats& stats() const { return m_stats; }
+
+  /**
+   * @brief 读取内核的TCP连接统计(TCP_INFO),只支持Linux上的TCP socket
+   *
+   * @param[out] info 统计信息
+   *
+   * @return 是否成功
+   */
+  bool tcp_info(TcpInfo& info);
+
+  /**
+   * @brief 开启SO_TIMESTAMPING软件时间戳,socket尚未创建时在创建后生效,只支持Linux
+   *
+   * 接收时间戳在每次接收后通过last_recv_timestamp()取得;发送时间戳由内核放入
+   * 错误队列,开启后必须通过read_send_timestamp()及时取出,否则错误队列非空会使
+   * epoll持续报告错误事件。TCP socket的发送时间戳只有在连接建立后开启才带有
+   * 字节序号
+   *
+   * @param[in] recv 是否记录接收时间戳
+   * @param[in] send 是否记录发送时间戳
+   *
+   * @return 是否成功
+   */
+  bool set_timestamping(bool recv, bool send = false);
+
+  /**
+   * @brief 最近一次接收的内核时间戳(CLOCK_REALTIME,纳秒),没有时返回0
+   */
+  uint64_t last_recv_timestamp() const { return m_recv_timestamp; }
+
+  /**
+   * @brief 从错误队列取出一个发送时间戳,不阻塞
+   *
+   * @param[out] timestamp_ns 数据离开协议栈的时间(CLOCK_REALTIME,纳秒)
+   * @param[out] id           UDP为发送的序号,TCP为最后一个字节的序号
+   *
+   * @return 是否取得
+   */
+  bool read_send_timestamp(uint64_t& timestamp_ns, uint32_t& id);
+
  private:
+  enum Timestamping : uint8_t { eRecvTimestamp = 1, eSendTimestamp = 2 };
+
   void init_sock();
   void new_sock();
-  bool init(socket_type sock);
+  bool init(socket_type sock, const SockAddr& remote);
+  bool apply_timestamping();
+
+  /**
+   * @brief 所有iovec形式的接收都经过这里,开启时间戳时附带控制缓冲
+   */
+  int recv_msg(msghdr& msg, int flags);
+
+  /**
+   * @brief 每次收发的系统调用之后更新计数,录制流量时记录实际收发的数据,
+   * MSG_PEEK的接收不消耗数据,不记录
+   */
+  void after_send(int rt, const void* buffer) {
+    m_stats.on_send(rt);
+    if (CX_UNLICKLY(TrafficCapture::IsActive()) && rt > 0) {
+      iovec iov{(void*)buffer, (size_t)rt};
+      TrafficCapture::Record(*this, TrafficCapture::Kind::eSend, &iov, 1, rt);
+    }
+  }
+
+  void after_send(int rt, const msghdr& msg) {
+    m_stats.on_send(rt);
+    if (CX_UNLICKLY(TrafficCapture::IsActive()) && rt > 0) {
+      TrafficCapture::Record(*this, TrafficCapture::Kind::eSend, msg.msg_iov,
+                             msg.msg_iovlen, rt);
+    }
+  }
+
+  void after_recv(int rt, const void* buffer, int flags) {
+    m_stats.on_recv(rt);
+    if (CX_UNLICKLY(TrafficCapture::IsActive()) && rt > 0 &&
+        !(flags & MSG_PEEK)) {
+      iovec iov{(void*)buffer, (size_t)rt};
+      TrafficCapture::Record(*this, TrafficCapture::Kind::eRecv, &iov, 1, rt);
+    }
+  }
+
+  void after_recv(int rt, const msghdr& msg, int flags) {
+    m_stats.on_recv(rt);
+    if (CX_UNLICKLY(TrafficCapture::IsActive()) && rt > 0 &&
+        !(flags & MSG_PEEK)) {
+      TrafficCapture::Record(*this, TrafficCapture::Kind::eRecv, msg.msg_iov,
+                             msg.msg_iovlen, rt);
+    }
+  }
 
  private:
+  uint64_t m_id;
   socket_type m_sock;
   AddressFamily m_family;
   SocketType m_type;
   IpProtocol m_protocol;
   bool m_is_connected;
+  bool m_reuse_port;
+  uint8_t m_timestamping;
+  uint64_t m_recv_timestamp;
+  SocketStats m_stats;
+  SocketRegistry::ptr m_registry;  // 持有引用,保证静态对象析构时仍可注销
 
+  SockAddr m_local;
+  SockAddr m_remote;
   Address::ptr m_local_address;
   Address::ptr m_remote_address;
 };
@@ -0,0 +1,141 @@
+#include "socket_stats.h"
+
+#include <chrono>
+
+#include "cx/utils/metrics/metrics.h"
+
+namespace cx::net {
+
+SocketCounters& SocketCounters::operator+=(const SocketCounters& other) {
+  bytes_sent += other.bytes_sent;
+  bytes_received += other.bytes_received;
+  send_calls += other.send_calls;
+  recv_calls += other.recv_calls;
+  send_again += other.send_again;
+  recv_again += other.recv_again;
+  errors += other.errors;
+  return *this;
+}
+
+SocketCounters SocketStats::snapshot() const {
+  SocketCounters counters;
+  counters.bytes_sent = m_bytes_sent.load(std::memory_order_relaxed);
+  counters.bytes_received = m_bytes_received.load(std::memory_order_relaxed);
+  counters.send_calls = m_send_calls.load(std::memory_order_relaxed);
+  counters.recv_calls = m_recv_calls.load(std::memory_order_relaxed);
+  counters.send_again = m_send_again.load(std::memory_order_relaxed);
+  counters.recv_again = m_recv_again.load(std::memory_order_relaxed);
+  counters.errors = m_errors.load(std::memory_order_relaxed);
+  return counters;
+}
+
+void SocketRegistry::add(SocketStats* stats) {
+  // 每个线程固定使用一个分片,线程数不超过分片数时互不竞争
+  thread_local uint32_t t_shard = UINT32_MAX;
+  if (t_shard == UINT32_MAX) {
+    t_shard = m_next_shard.fetch_add(1, std::memory_order_relaxed) %
+              SHARD_COUNT;
+  }
+  stats->m_shard = t_shard;
+  Shard& shard = m_shards[t_shard];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  shard.live.insert(stats);
+}
+
+void SocketRegistry::remove(const SocketStats* stats) {
+  SocketCounters counters = stats->snapshot();
+  Shard& shard = m_shards[stats->m_shard];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  if (shard.live.erase(stats)) {
+    shard.closed += counters;
+  }
+}
+
+SocketCounters SocketRegistry::total() const {
+  SocketCounters counters;
+  for (auto& shard : m_shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    counters += shard.closed;
+    for (auto stats : shard.live) {
+      counters += stats->snapshot();
+    }
+  }
+  return counters;
+}
+
+size_t SocketRegistry::live() const {
+  size_t count = 0;
+  for (auto& shard : m_shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    count += shard.live.size();
+  }
+  return count;
+}
+
+void SocketRegistry::cached(SocketCounters& counters, size_t& live) {
+  uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now().time_since_epoch())
+                     .count();
+  std::lock_guard<std::mutex> lock(m_cache_mutex);
+  if (m_cache_time == 0 || now - m_cache_time >= CACHE_NS) {
+    m_cache_counters = SocketCounters();
+    m_cache_live = 0;
+    for (auto& shard : m_shards) {
+      std::lock_guard<std::mutex> shard_lock(shard.mutex);
+      m_cache_counters += shard.closed;
+      m_cache_live += shard.live.size();
+      for (auto stats : shard.live) {
+        m_cache_counters += stats->snapshot();
+      }
+    }
+    m_cache_time = now;
+  }
+  counters = m_cache_counters;
+  live = m_cache_live;
+}
+
+void SocketRegistry::RegisterMetrics() {
+  struct Field {
+    const char* name;
+    const char* help;
+    uint64_t SocketCounters::*member;
+  };
+  static const Field fields[] = {
+      {"cx_socket_sent_bytes_total", "Bytes sent by all sockets",
+       &SocketCounters::bytes_sent},
+      {"cx_socket_received_bytes_total", "Bytes received by all sockets",
+       &SocketCounters::bytes_received},
+      {"cx_socket_send_calls_total", "Send system calls",
+       &SocketCounters::send_calls},
+      {"cx_socket_recv_calls_total", "Receive system calls",
+       &SocketCounters::recv_calls},
+      {"cx_socket_send_again_total", "Send calls that returned EAGAIN",
+       &SocketCounters::send_again},
+      {"cx_socket_recv_again_total", "Receive calls that returned EAGAIN",
+       &SocketCounters::recv_again},
+      {"cx_socket_errors_total", "Send and receive calls that failed",
+       &SocketCounters::errors},
+  };
+
+  auto metrics = metrics::Registry::Self();
+  SocketRegistry::ptr self = Self();
+  for (const Field& field : fields) {
+    auto member = field.member;
+    metrics->callback(field.name, field.help, metrics::Type::eCounter,
+                      [self, member]() {
+                        SocketCounters counters;
+                        size_t live;
+                        self->cached(counters, live);
+                        return (double)(counters.*member);
+                      });
+  }
+  metrics->callback("cx_sockets", "Open socket objects", metrics::Type::eGauge,
+                    [self]() {
+                      SocketCounters counters;
+                      size_t live;
+                      self->cached(counters, live);
+                      return (double)live;
+                    });
+}
+
+}  // namespace cx::net
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+
+#include "cx/common/internal.h"
+#include "cx/common/noncopyable.h"
+#include "cx/common/singleton.h"
+
+namespace cx::net {
+
+/**
+ * @brief socket计数的快照
+ */
+struct SocketCounters {
+  uint64_t bytes_sent = 0;      // 发送的字节数
+  uint64_t bytes_received = 0;  // 接收的字节数
+  uint64_t send_calls = 0;      // 发送的系统调用次数
+  uint64_t recv_calls = 0;      // 接收的系统调用次数
+  uint64_t send_again = 0;      // 发送返回EAGAIN的次数
+  uint64_t recv_again = 0;      // 接收返回EAGAIN的次数
+  uint64_t errors = 0;          // 其他错误的次数
+
+  SocketCounters& operator+=(const SocketCounters& other);
+};
+
+/**
+ * @brief 单个socket的IO计数
+ *
+ * 由Socket在每次发送/接收的系统调用后更新,只使用relaxed原子操作,
+ * 读取的快照各字段之间不保证一致
+ */
+class SocketStats : public Noncopyable {
+ public:
+  /**
+   * @brief 记录一次发送
+   *
+   * @param[in] rt 系统调用的返回值,失败时根据errno区分EAGAIN与其他错误
+   */
+  void on_send(int rt) {
+    m_send_calls.fetch_add(1, std::memory_order_relaxed);
+    if (rt >= 0) {
+      m_bytes_sent.fetch_add(rt, std::memory_order_relaxed);
+    } else {
+      on_error(m_send_again);
+    }
+  }
+
+  /**
+   * @brief 记录一次接收
+   */
+  void on_recv(int rt) {
+    m_recv_calls.fetch_add(1, std::memory_order_relaxed);
+    if (rt >= 0) {
+      m_bytes_received.fetch_add(rt, std::memory_order_relaxed);
+    } else {
+      on_error(m_recv_again);
+    }
+  }
+
+  SocketCounters snapshot() const;
+
+ private:
+  friend class SocketRegistry;
+
+  void on_error(std::atomic<uint64_t>& again) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      again.fetch_add(1, std::memory_order_relaxed);
+    } else if (errno != EINTR) {
+      m_errors.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  std::atomic<uint64_t> m_bytes_sent{0};
+  std::atomic<uint64_t> m_bytes_received{0};
+  std::atomic<uint64_t> m_send_calls{0};
+  std::atomic<uint64_t> m_recv_calls{0};
+  std::atomic<uint64_t> m_send_again{0};
+  std::atomic<uint64_t> m_recv_again{0};
+  std::atomic<uint64_t> m_errors{0};
+  uint32_t m_shard = 0;  // 登记所在的SocketRegistry分片
+};
+
+/**
+ * @brief 汇总所有socket的IO计数
+ *
+ * Socket在构造时登记、析构时注销,注销时计数并入已关闭socket的累计值,
+ * 因此total()包含进程启动以来的全部IO。IO路径不加锁;登记按线程分散到多个
+ * 分片,各自加锁,每个核心一个accept线程时互不竞争,socket在其他线程析构时
+ * 从登记时的分片注销。汇总依次遍历所有分片
+ */
+class SocketRegistry : public Noncopyable, public SingletonPtr<SocketRegistry> {
+  friend SingletonPtr<SocketRegistry>;
+
+ public:
+  typedef std::shared_ptr<SocketRegistry> ptr;
+
+  void add(SocketStats* stats);
+
+  void remove(const SocketStats* stats);
+
+  /**
+   * @brief 所有socket(包括已关闭的)的计数之和
+   */
+  SocketCounters total() const;
+
+  /**
+   * @brief 当前存活的socket数量
+   */
+  size_t live() const;
+
+  /**
+   * @brief 把汇总计数注册到metrics::Registry,重复调用会覆盖之前的注册
+   *
+   * 一次采集中的各项指标共用一次汇总的结果
+   */
+  CX_STATIC void RegisterMetrics();
+
+ private:
+  CX_STATIC_CONSTEXPR size_t SHARD_COUNT = 32;
+  CX_STATIC_CONSTEXPR uint64_t CACHE_NS = 100 * 1000 * 1000;
+
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    std::unordered_set<const SocketStats*> live;
+    SocketCounters closed;
+  };
+
+  SocketRegistry() = default;
+
+  /**
+   * @brief 汇总结果,CACHE_NS内重复调用时直接返回上一次的结果
+   */
+  void cached(SocketCounters& counters, size_t& live);
+
+ private:
+  mutable Shard m_shards[SHARD_COUNT];
+  std::atomic<uint32_t> m_next_shard{0};
+
+  std::mutex m_cache_mutex;
+  uint64_t m_cache_time = 0;
+  SocketCounters m_cache_counters;
+  size_t m_cache_live = 0;
+};
+
+/**
+ * @brief 内核维护的TCP连接统计,来自TCP_INFO
+ */
+struct TcpInfo {
+  uint8_t state = 0;           // 连接状态,即TCP_ESTABLISHED等
+  uint32_t rtt_us = 0;         // 平滑RTT
+  uint32_t rtt_var_us = 0;     // RTT的平均偏差
+  uint32_t rto_us = 0;         // 重传超时
+  uint32_t retransmits = 0;    // 当前未确认段的重传次数
+  uint32_t total_retrans = 0;  // 累计重传的段数
+  uint32_t send_cwnd = 0;      // 拥塞窗口,单位为段
+  uint32_t send_ssthresh = 0;  // 慢启动阈值
+  uint32_t send_mss = 0;       // 发送的最大段长度
+  uint32_t unacked = 0;        // 已发送未确认的段数
+  uint32_t lost = 0;           // 判定丢失的段数
+  uint32_t reordering = 0;     // 乱序的程度
+};
+
+}  // namespace cx::net
@@ -0,0 +1,276 @@
+#include "tcp_connection.h"
+
+#include <cerrno>
+
+#include "cx/common/logger.h"
+
+namespace cx::net {
+
+using namespace time;
+
+#if defined(MSG_NOSIGNAL)
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+// 每次读取时预留的缓存长度
+static const size_t READ_RESERVE = 64 * 1024;
+
+TcpConnection::TcpConnection(EventLoop* loop, Socket::ptr sock, uint64_t id)
+    : m_loop(loop),
+      m_socket(sock),
+      m_id(id),
+      m_state(State::eConnecting),
+      m_events(EventLoop::eNone),
+      m_last_active(TimePoint::Now()),
+      m_flush_queued(false) {
+  m_socket->set_non_blocking(true);
+  m_output.set_high_watermark_callback([this](size_t queued) {
+    if (m_high_watermark_callback) {
+      m_high_watermark_callback(shared_from_this(), queued);
+    }
+  });
+  m_output.set_low_watermark_callback([this](size_t queued) {
+    if (m_low_watermark_callback) {
+      m_low_watermark_callback(shared_from_this(), queued);
+    }
+  });
+#if defined(SO_NOSIGPIPE)
+  int val = 1;
+  m_socket->set_option(SOL_SOCKET, SO_NOSIGPIPE, val);
+#endif
+}
+
+TcpConnection::~TcpConnection() { m_socket->close(); }
+
+void TcpConnection::send(const void* data, size_t len) {
+  if (m_state != State::eConnected) {
+    return;
+  }
+  if (m_loop->is_in_loop_thread()) {
+    send_in_loop(data, len);
+    return;
+  }
+
+  std::string buf((const char*)data, len);
+  TcpConnection::ptr self = shared_from_this();
+  m_loop->queue_in_loop([self, buf]() { self->send_in_loop(buf.data(), buf.size()); });
+}
+
+void TcpConnection::send(const std::string& data) {
+  send(data.data(), data.size());
+}
+
+void TcpConnection::send(ByteArray& buf) {
+  std::vector<iovec> buffers;
+  buf.get_read_iovecs(buffers);
+  for (auto& iov : buffers) {
+    send_in_loop(iov.iov_base, iov.iov_len);
+  }
+  buf.set_position(buf.size());
+}
+
+void TcpConnection::send(const WriteQueue::buffer_t& buffer) {
+  if (m_state != State::eConnected) {
+    return;
+  }
+  if (m_loop->is_in_loop_thread()) {
+    send_in_loop(buffer);
+    return;
+  }
+
+  TcpConnection::ptr self = shared_from_this();
+  m_loop->queue_in_loop([self, buffer]() { self->send_in_loop(buffer); });
+}
+
+void TcpConnection::set_reading(bool enable) {
+  TcpConnection::ptr self = shared_from_this();
+  m_loop->run_in_loop([self, enable]() {
+    if (self->m_state == State::eDisconnected) {
+      return;
+    }
+    if (enable) {
+      self->m_events |= EventLoop::eRead;
+    } else {
+      self->m_events &= ~EventLoop::eRead;
+    }
+    self->update_events();
+  });
+}
+
+void TcpConnection::shutdown() {
+  TcpConnection::ptr self = shared_from_this();
+  m_loop->run_in_loop([self]() { self->shutdown_in_loop(); });
+}
+
+void TcpConnection::force_close() {
+  TcpConnection::ptr self = shared_from_this();
+  m_loop->run_in_loop([self]() {
+    if (self->m_state != State::eDisconnected) {
+      self->handle_close();
+    }
+  });
+}
+
+void TcpConnection::establish() {
+  m_state = State::eConnected;
+  m_events = EventLoop::eRead;
+
+  std::weak_ptr<TcpConnection> weak = shared_from_this();
+  m_loop->update_event(m_socket->socket(), m_events, [weak](uint32_t events) {
+    TcpConnection::ptr self = weak.lock();
+    if (self) {
+      self->handle_event(events);
+    }
+  });
+
+  if (m_connection_callback) {
+    m_connection_callback(shared_from_this());
+  }
+}
+
+void TcpConnection::handle_event(uint32_t events) {
+  TcpConnection::ptr self = shared_from_this();
+  if (events & EventLoop::eRead) {
+    handle_read();
+  }
+  if ((events & EventLoop::eWrite) && m_state != State::eDisconnected) {
+    handle_write();
+  }
+}
+
+void TcpConnection::handle_read() {
+  std::vector<iovec> buffers;
+  m_input.get_write_iovecs(buffers, READ_RESERVE);
+
+  int n = m_socket->recv(buffers.data(), buffers.size());
+  if (n > 0) {
+    m_input.commit_write(n);
+    m_last_active = TimePoint::Now();
+    if (m_message_callback) {
+      m_message_callback(shared_from_this(), m_input);
+    } else {
+      m_input.set_position(m_input.size());
+    }
+
+    if (m_input.read_size() == 0) {
+      m_input.clear();
+    } else {
+      m_input.compact();
+    }
+  } else if (n == 0) {
+    handle_close();
+  } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+    LOG_DEBUG(log::Loggers::engine)
+        << "connection " << m_id << " recv error, errno: " << errno;
+    handle_close();
+  }
+}
+
+void TcpConnection::handle_write() { flush(); }
+
+void TcpConnection::handle_close() {
+  if (m_state == State::eDisconnected) {
+    return;
+  }
+  TcpConnection::ptr self = shared_from_this();
+  m_state = State::eDisconnected;
+  m_events = EventLoop::eNone;
+  m_loop->remove_event(m_socket->socket());
+
+  if (m_connection_callback) {
+    m_connection_callback(self);
+  }
+  if (m_close_callback) {
+    m_close_callback(self);
+  }
+  m_socket->close();
+}
+
+void TcpConnection::send_in_loop(const void* data, size_t len) {
+  if (m_state != State::eConnected) {
+    return;
+  }
+  if (!m_output.append(data, len)) {
+    LOG_WARN(log::Loggers::engine)
+        << "connection " << m_id << " output overflow, queued: "
+        << m_output.size();
+    handle_close();
+    return;
+  }
+  queue_flush();
+}
+
+void TcpConnection::send_in_loop(const WriteQueue::buffer_t& buffer) {
+  if (m_state != State::eConnected) {
+    return;
+  }
+  if (!m_output.append(buffer)) {
+    LOG_WARN(log::Loggers::engine)
+        << "connection " << m_id << " output overflow, queued: "
+        << m_output.size();
+    handle_close();
+    return;
+  }
+  queue_flush();
+}
+
+void TcpConnection::queue_flush() {
+  // 等待可写事件时由handle_write发送
+  if (m_flush_queued || (m_events & EventLoop::eWrite)) {
+    return;
+  }
+  m_flush_queued = true;
+  TcpConnection::ptr self = shared_from_this();
+  m_loop->queue_in_loop([self]() {
+    self->m_flush_queued = false;
+    self->flush();
+  });
+}
+
+void TcpConnection::flush() {
+  if (m_state == State::eDisconnected) {
+    return;
+  }
+
+  int64_t n = m_output.flush(*m_socket, SEND_FLAGS);
+  if (n < 0) {
+    LOG_DEBUG(log::Loggers::engine)
+        << "connection " << m_id << " send error, errno: " << errno;
+    handle_close();
+    return;
+  }
+  if (n > 0) {
+    m_last_active = TimePoint::Now();
+  }
+
+  if (m_output.empty()) {
+    if (m_events & EventLoop::eWrite) {
+      m_events &= ~EventLoop::eWrite;
+      update_events();
+    }
+    if (m_state == State::eDisconnecting) {
+      shutdown_in_loop();
+    }
+  } else if (!(m_events & EventLoop::eWrite)) {
+    m_events |= EventLoop::eWrite;
+    update_events();
+  }
+}
+
+void TcpConnection::shutdown_in_loop() {
+  if (m_state == State::eConnected) {
+    m_state = State::eDisconnecting;
+  }
+  if (m_state == State::eDisconnecting && m_output.empty() &&
+      !m_flush_queued) {
+    ::shutdown(m_socket->socket(), SHUT_WR);
+  }
+}
+
+void TcpConnection::update_events() {
+  m_loop->update_event(m_socket->socket(), m_events);
+}
+
+}  // namespace cx::net
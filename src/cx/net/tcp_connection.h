@@ -0,0 +1,207 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "cx/common/internal.h"
+#include "cx/common/noncopyable.h"
+#include "cx/net/byte_array.h"
+#include "cx/net/event_loop.h"
+#include "cx/net/socket.h"
+#include "cx/net/write_queue.h"
+#include "cx/utils/time/time.h"
+
+namespace cx::net {
+
+/**
+ * @brief 非阻塞TCP连接,归属于一个事件循环,所有回调都在该事件循环线程中执行
+ */
+class TcpConnection : public std::enable_shared_from_this<TcpConnection>,
+                      Noncopyable {
+ public:
+  typedef std::shared_ptr<TcpConnection> ptr;
+  typedef std::function<void(const TcpConnection::ptr&)> connection_callback_t;
+  typedef std::function<void(const TcpConnection::ptr&, ByteArray&)>
+      message_callback_t;
+  typedef std::function<void(const TcpConnection::ptr&)> close_callback_t;
+  typedef std::function<void(const TcpConnection::ptr&, size_t queued)>
+      watermark_callback_t;
+
+  /**
+   * @brief 连接状态
+   */
+  enum class State : uint8_t {
+    eConnecting,
+    eConnected,
+    eDisconnecting,
+    eDisconnected
+  };
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] loop 所属的事件循环
+   * @param[in] sock 已连接的socket
+   * @param[in] id   连接id
+   */
+  TcpConnection(EventLoop* loop, Socket::ptr sock, uint64_t id);
+
+  /**
+   * @brief 析构函数
+   */
+  ~TcpConnection();
+
+  uint64_t id() const { return m_id; }
+
+  EventLoop* loop() const { return m_loop; }
+
+  Socket::ptr socket() const { return m_socket; }
+
+  State state() const { return m_state; }
+
+  bool connected() const { return m_state == State::eConnected; }
+
+  Address::ptr local_address() const { return m_socket->local_address(); }
+
+  Address::ptr remote_address() const { return m_socket->remote_address(); }
+
+  /**
+   * @brief 最后一次收发数据的时间
+   */
+  const time::TimePoint& last_active() const { return m_last_active; }
+
+  /**
+   * @brief 发送数据,可在任意线程调用;发送不完的数据缓存在连接中
+   *
+   * @param[in] data 数据
+   * @param[in] len  数据长度
+   */
+  void send(const void* data, size_t len);
+
+  /**
+   * @brief 发送字符串
+   *
+   * @param[in] data 字符串
+   */
+  void send(const std::string& data);
+
+  /**
+   * @brief 发送ByteArray中的全部可读数据,只能在事件循环线程中调用
+   *
+   * @param[in] buf 数据,发送后读位置移动到末尾
+   */
+  void send(ByteArray& buf);
+
+  /**
+   * @brief 发送共享缓冲,可在任意线程调用,向多个连接广播时不会复制数据
+   *
+   * @param[in] buffer 缓冲
+   */
+  void send(const WriteQueue::buffer_t& buffer);
+
+  /**
+   * @brief 开始/停止读取数据,用于对端发送过快时的流控
+   *
+   * @param[in] enable 是否读取
+   */
+  void set_reading(bool enable);
+
+  /**
+   * @brief 发送队列中等待发送的字节数
+   */
+  size_t output_size() const { return m_output.size(); }
+
+  /**
+   * @brief 设置发送队列的水位,只能在事件循环线程中或establish之前调用
+   *
+   * @param[in] low  低水位
+   * @param[in] high 高水位
+   */
+  void set_write_watermark(size_t low, size_t high) {
+    m_output.set_watermark(low, high);
+  }
+
+  /**
+   * @brief 设置发送队列的上限,超过时关闭连接
+   */
+  void set_max_output(size_t max_size) { m_output.set_max_size(max_size); }
+
+  /**
+   * @brief 发送完缓存数据后关闭写端
+   */
+  void shutdown();
+
+  /**
+   * @brief 立即关闭连接,丢弃未发送的数据
+   */
+  void force_close();
+
+  void set_connection_callback(connection_callback_t cb) {
+    m_connection_callback = std::move(cb);
+  }
+
+  void set_message_callback(message_callback_t cb) {
+    m_message_callback = std::move(cb);
+  }
+
+  void set_close_callback(close_callback_t cb) {
+    m_close_callback = std::move(cb);
+  }
+
+  /**
+   * @brief 发送队列超过高水位时回调,应暂停向该连接发送
+   */
+  void set_high_watermark_callback(watermark_callback_t cb) {
+    m_high_watermark_callback = std::move(cb);
+  }
+
+  /**
+   * @brief 发送队列降到低水位以下时回调,可以恢复发送
+   */
+  void set_low_watermark_callback(watermark_callback_t cb) {
+    m_low_watermark_callback = std::move(cb);
+  }
+
+  /**
+   * @brief 连接建立,注册到事件循环,由TcpServer在事件循环线程中调用
+   */
+  void establish();
+
+ private:
+  void handle_event(uint32_t events);
+  void handle_read();
+  void handle_write();
+  void handle_close();
+
+  void send_in_loop(const void* data, size_t len);
+  void send_in_loop(const WriteQueue::buffer_t& buffer);
+
+  /**
+   * @brief 数据加入队列后,在本轮循环结束时统一发送,合并多次send
+   */
+  void queue_flush();
+  void flush();
+  void shutdown_in_loop();
+  void update_events();
+
+ private:
+  EventLoop* m_loop;
+  Socket::ptr m_socket;
+  uint64_t m_id;
+  State m_state;
+  uint32_t m_events;
+  time::TimePoint m_last_active;
+
+  ByteArray m_input;
+  WriteQueue m_output;
+  bool m_flush_queued;
+
+  connection_callback_t m_connection_callback;
+  message_callback_t m_message_callback;
+  close_callback_t m_close_callback;
+  watermark_callback_t m_high_watermark_callback;
+  watermark_callback_t m_low_watermark_callback;
+};
+
+}  // namespace cx::net
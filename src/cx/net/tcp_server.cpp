@@ -0,0 +1,283 @@
+#include "tcp_server.h"
+
+#include <chrono>
+#include <thread>
+
+#include "cx/common/logger.h"
+
+namespace cx::net {
+
+using namespace time;
+
+// 每次可读事件最多accept的连接数量,避免单个监听socket占满事件循环
+static const int MAX_ACCEPT_PER_EVENT = 64;
+
+TcpServer::TcpServer() : TcpServer(Options()) {}
+
+TcpServer::TcpServer(const Options& options)
+    : m_options(options),
+      m_running(false),
+      m_connection_count(0),
+      m_accepted_count(0),
+      m_next_conn_id(1),
+      m_next_worker(0) {
+  if (m_options.threads == 0) {
+    m_options.threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+#if !defined(CX_PLATFORM_LINUX)
+  // 其他平台的SO_REUSEPORT不会在监听socket间均衡分发连接
+  m_options.reuse_port = false;
+#endif
+}
+
+TcpServer::~TcpServer() { stop(); }
+
+bool TcpServer::bind(Address::ptr address) {
+  if (m_running) {
+    LOG_ERROR(log::Loggers::engine)
+        << m_options.name << " bind after start: " << address->to_string();
+    return false;
+  }
+
+  Socket::ptr sock = generate_listener(address);
+  if (!sock) {
+    return false;
+  }
+
+  // 端口为0时,其余线程需要绑定到实际分配的端口
+  m_addresses.push_back(sock->local_address());
+  if (m_workers.empty()) {
+    m_workers.emplace_back(new Worker);
+  }
+  m_workers[0]->listeners.push_back(sock);
+
+  LOG_INFO(log::Loggers::engine)
+      << m_options.name << " bind successful, address: "
+      << m_addresses.back()->to_string();
+  return true;
+}
+
+bool TcpServer::start() {
+  if (m_running || m_addresses.empty()) {
+    return false;
+  }
+
+  uint32_t hardware = std::max(1u, std::thread::hardware_concurrency());
+  for (uint32_t i = 0; i < m_options.threads; ++i) {
+    if (i >= m_workers.size()) {
+      m_workers.emplace_back(new Worker);
+    }
+    Worker* worker = m_workers[i].get();
+
+    if (i > 0 && m_options.reuse_port) {
+      for (auto& address : m_addresses) {
+        Socket::ptr sock = generate_listener(address);
+        if (!sock) {
+          m_workers.resize(1);
+          return false;
+        }
+        worker->listeners.push_back(sock);
+      }
+    }
+
+    int cpu = -1;
+    if (m_options.pin_cpu) {
+      cpu = m_options.cpus.empty() ? (int)(i % hardware)
+                                   : m_options.cpus[i % m_options.cpus.size()];
+    }
+    worker->thread.reset(new EventLoopThread(
+        m_options.name + "_" + std::to_string(i), cpu));
+  }
+
+  metrics::Registry::labels_t labels = {{"server", m_options.name}};
+  m_connections_gauge = metrics::Registry::Self()->gauge(
+      "cx_tcp_connections", "Open TCP server connections", labels);
+  m_accepted_counter = metrics::Registry::Self()->counter(
+      "cx_tcp_accepted_total", "Accepted TCP server connections", labels);
+
+  m_running = true;
+  for (auto& ptr : m_workers) {
+    Worker* worker = ptr.get();
+    worker->loop = worker->thread->start();
+    worker->loop->run_in_loop([this, worker]() {
+      for (auto& listener : worker->listeners) {
+        worker->loop->update_event(
+            listener->socket(), EventLoop::eRead,
+            [this, worker, listener](uint32_t) {
+              handle_accept(worker, listener);
+            });
+      }
+
+      if (m_options.idle_timeout.AsMicroseconds() > 0) {
+        TimePoint interval =
+            std::min(m_options.idle_timeout / (int64_t)2, TimePoint::Seconds(1));
+        worker->idle_timer =
+            worker->loop->run_every(interval, [this, worker]() {
+              check_idle(worker);
+            });
+      }
+    });
+  }
+
+  LOG_INFO(log::Loggers::engine)
+      << m_options.name << " started, threads: " << m_workers.size()
+      << ", reuse_port: " << m_options.reuse_port;
+  return true;
+}
+
+void TcpServer::stop() {
+  if (!m_running.exchange(false)) {
+    return;
+  }
+
+  // 停止accept,通知所有连接在发送完缓存的数据后关闭写端
+  for (auto& ptr : m_workers) {
+    Worker* worker = ptr.get();
+    worker->loop->run_in_loop([this, worker]() {
+      for (auto& listener : worker->listeners) {
+        worker->loop->remove_event(listener->socket());
+        listener->close();
+      }
+      worker->listeners.clear();
+
+      auto connections = worker->connections;
+      for (auto& [id, conn] : connections) {
+        if (m_drain_callback) {
+          m_drain_callback(conn);
+        }
+        conn->shutdown();
+      }
+    });
+  }
+
+  // 等待对端读到EOF后关闭连接
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::microseconds(
+                      m_options.drain_timeout.AsMicroseconds());
+  while (m_connection_count > 0 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  // 强制关闭剩余的连接
+  for (auto& ptr : m_workers) {
+    Worker* worker = ptr.get();
+    worker->loop->run_in_loop([worker]() {
+      if (worker->idle_timer) {
+        worker->loop->cancel(worker->idle_timer);
+      }
+      auto connections = worker->connections;
+      for (auto& [id, conn] : connections) {
+        conn->force_close();
+      }
+    });
+  }
+
+  for (auto& ptr : m_workers) {
+    ptr->thread->stop();
+  }
+  m_workers.clear();
+  m_addresses.clear();
+
+  metrics::Registry::labels_t labels = {{"server", m_options.name}};
+  metrics::Registry::Self()->remove("cx_tcp_connections", labels);
+  metrics::Registry::Self()->remove("cx_tcp_accepted_total", labels);
+
+  LOG_INFO(log::Loggers::engine) << m_options.name << " stopped";
+}
+
+std::vector<Address::ptr> TcpServer::listen_addresses() const {
+  return m_addresses;
+}
+
+void TcpServer::handle_accept(Worker* worker, Socket::ptr listener) {
+  for (int i = 0; i < MAX_ACCEPT_PER_EVENT; ++i) {
+    Socket::ptr sock = listener->accept();
+    if (!sock) {
+      break;
+    }
+    ++m_accepted_count;
+    if (m_accepted_counter) {
+      m_accepted_counter->inc();
+    }
+
+    if (m_options.reuse_port || m_workers.size() == 1) {
+      new_connection(worker, sock);
+      continue;
+    }
+
+    Worker* target = m_workers[m_next_worker++ % m_workers.size()].get();
+    target->loop->run_in_loop(
+        [this, target, sock]() { new_connection(target, sock); });
+  }
+}
+
+void TcpServer::new_connection(Worker* worker, Socket::ptr sock) {
+  if (!m_running) {
+    return;
+  }
+
+  TcpConnection::ptr conn(
+      new TcpConnection(worker->loop, sock, m_next_conn_id++));
+  conn->set_connection_callback(m_connection_callback);
+  conn->set_message_callback(m_message_callback);
+  conn->set_high_watermark_callback(m_high_watermark_callback);
+  conn->set_low_watermark_callback(m_low_watermark_callback);
+  conn->set_write_watermark(m_options.low_watermark, m_options.high_watermark);
+  conn->set_max_output(m_options.max_output);
+  conn->set_close_callback([this, worker](const TcpConnection::ptr& conn) {
+    remove_connection(worker, conn);
+  });
+
+  worker->connections[conn->id()] = conn;
+  ++m_connection_count;
+  if (m_connections_gauge) {
+    m_connections_gauge->add(1);
+  }
+  conn->establish();
+}
+
+void TcpServer::remove_connection(Worker* worker,
+                                  const TcpConnection::ptr& conn) {
+  if (worker->connections.erase(conn->id())) {
+    --m_connection_count;
+    if (m_connections_gauge) {
+      m_connections_gauge->add(-1);
+    }
+  }
+}
+
+void TcpServer::check_idle(Worker* worker) {
+  TimePoint now = TimePoint::Now();
+  std::vector<TcpConnection::ptr> idle;
+  for (auto& [id, conn] : worker->connections) {
+    if (now - conn->last_active() >= m_options.idle_timeout) {
+      idle.push_back(conn);
+    }
+  }
+  for (auto& conn : idle) {
+    LOG_DEBUG(log::Loggers::engine)
+        << m_options.name << " close idle connection " << conn->id();
+    conn->force_close();
+  }
+}
+
+Socket::ptr TcpServer::generate_listener(Address::ptr address) {
+  Socket::ptr sock = Socket::GenerateTCP(address);
+  sock->set_reuse_port(m_options.reuse_port);
+  if (!sock->bind(address)) {
+    LOG_ERROR(log::Loggers::engine)
+        << m_options.name << " bind failed: " << address->to_string()
+        << ", errno: " << errno;
+    return nullptr;
+  }
+  if (!sock->listen(m_options.backlog)) {
+    LOG_ERROR(log::Loggers::engine)
+        << m_options.name << " listen failed: " << address->to_string()
+        << ", errno: " << errno;
+    return nullptr;
+  }
+  sock->set_non_blocking(true);
+  return sock;
+}
+
+}  // namespace cx::net
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cx/common/internal.h"
+#include "cx/common/noncopyable.h"
+#include "cx/net/event_loop.h"
+#include "cx/net/socket.h"
+#include "cx/net/tcp_connection.h"
+#include "cx/utils/metrics/metrics.h"
+#include "cx/utils/time/time.h"
+
+namespace cx::net {
+
+/**
+ * @brief 多reactor的TCP服务器
+ *
+ * 每个IO线程运行一个事件循环;开启reuse_port时(仅Linux),每个线程拥有
+ * 自己的SO_REUSEPORT监听socket,由内核分发连接,否则由第一个线程accept后
+ * 轮询分发到各个线程
+ */
+class TcpServer : public Noncopyable {
+ public:
+  typedef std::shared_ptr<TcpServer> ptr;
+
+  /**
+   * @brief 服务器参数
+   */
+  struct Options {
+    std::string name = "tcp_server";  // 服务器名称,用作线程名前缀
+    uint32_t threads = 0;             // IO线程数,0为cpu核心数
+    bool reuse_port = true;           // 每个线程独立监听
+    bool pin_cpu = false;             // IO线程绑定cpu
+    std::vector<int> cpus;            // 绑定的cpu列表,为空时依次绑定
+    int backlog = SOMAXCONN;          // 监听队列长度
+    time::TimePoint idle_timeout;     // 空闲超时,0为不检查
+    time::TimePoint drain_timeout = time::TimePoint::Seconds(5);  // 停止时等待连接关闭的时间
+    size_t low_watermark = 64 * 1024;        // 发送队列低水位
+    size_t high_watermark = 1024 * 1024;     // 发送队列高水位
+    size_t max_output = 16 * 1024 * 1024;    // 发送队列上限,超过时关闭连接
+  };
+
+  /**
+   * @brief 使用默认参数构造
+   */
+  TcpServer();
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] options 服务器参数
+   */
+  TcpServer(const Options& options);
+
+  /**
+   * @brief 析构函数,未停止时会先停止
+   */
+  ~TcpServer();
+
+  /**
+   * @brief 绑定地址,可多次调用以监听多个地址
+   *
+   * @param[in] address 地址
+   *
+   * @return 是否成功
+   */
+  bool bind(Address::ptr address);
+
+  /**
+   * @brief 启动IO线程并开始accept
+   *
+   * @return 是否成功
+   */
+  bool start();
+
+  /**
+   * @brief 停止服务器:停止accept,通知每个连接即将关闭并在发送完缓存的数据后
+   * 关闭写端,等待对端关闭连接,超过drain_timeout后强制关闭剩余的连接
+   *
+   * 不能在IO线程中调用
+   */
+  void stop();
+
+  bool is_running() const { return m_running; }
+
+  const Options& options() const { return m_options; }
+
+  /**
+   * @brief 当前连接数量
+   */
+  size_t connection_count() const { return m_connection_count; }
+
+  /**
+   * @brief 累计accept的连接数量
+   */
+  uint64_t accepted_count() const { return m_accepted_count; }
+
+  /**
+   * @brief 获取监听的地址(端口为0时可以获取实际端口)
+   */
+  std::vector<Address::ptr> listen_addresses() const;
+
+  /**
+   * @brief 连接建立/断开时回调,通过TcpConnection::connected区分
+   */
+  void set_connection_callback(TcpConnection::connection_callback_t cb) {
+    m_connection_callback = std::move(cb);
+  }
+
+  /**
+   * @brief 收到数据时回调
+   */
+  void set_message_callback(TcpConnection::message_callback_t cb) {
+    m_message_callback = std::move(cb);
+  }
+
+  /**
+   * @brief 停止服务器时对每个连接回调,在关闭写端之前,可以发送最后的数据
+   */
+  void set_drain_callback(TcpConnection::connection_callback_t cb) {
+    m_drain_callback = std::move(cb);
+  }
+
+  /**
+   * @brief 连接的发送队列超过高水位时回调
+   */
+  void set_high_watermark_callback(TcpConnection::watermark_callback_t cb) {
+    m_high_watermark_callback = std::move(cb);
+  }
+
+  /**
+   * @brief 连接的发送队列降到低水位以下时回调
+   */
+  void set_low_watermark_callback(TcpConnection::watermark_callback_t cb) {
+    m_low_watermark_callback = std::move(cb);
+  }
+
+ private:
+  /**
+   * @brief 每个IO线程的状态,只在对应的事件循环线程中访问
+   */
+  struct Worker {
+    EventLoopThread::ptr thread;
+    EventLoop* loop = nullptr;
+    std::vector<Socket::ptr> listeners;
+    std::unordered_map<uint64_t, TcpConnection::ptr> connections;
+    uint64_t idle_timer = 0;
+  };
+
+  void handle_accept(Worker* worker, Socket::ptr listener);
+  void new_connection(Worker* worker, Socket::ptr sock);
+  void remove_connection(Worker* worker, const TcpConnection::ptr& conn);
+  void check_idle(Worker* worker);
+  Socket::ptr generate_listener(Address::ptr address);
+
+ private:
+  Options m_options;
+  std::vector<Address::ptr> m_addresses;
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  std::atomic<bool> m_running;
+  std::atomic<size_t> m_connection_count;
+  std::atomic<uint64_t> m_accepted_count;
+  std::atomic<uint64_t> m_next_conn_id;
+  std::atomic<uint64_t> m_next_worker;
+
+  // 运行期间注册到指标注册表,标签为服务器名称
+  metrics::Gauge::ptr m_connections_gauge;
+  metrics::Counter::ptr m_accepted_counter;
+
+  TcpConnection::connection_callback_t m_connection_callback;
+  TcpConnection::message_callback_t m_message_callback;
+  TcpConnection::connection_callback_t m_drain_callback;
+  TcpConnection::watermark_callback_t m_high_watermark_callback;
+  TcpConnection::watermark_callback_t m_low_watermark_callback;
+};
+
+}  // namespace cx::net
@@ -0,0 +1,329 @@
+#include "traffic_capture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "cx/net/socket.h"
+
+namespace cx::net {
+
+static const char MAGIC[6] = {'C', 'X', 'C', 'A', 'P', '\0'};
+static const uint16_t VERSION = 1;
+static const size_t HEADER_SIZE = 16;
+
+static uint64_t MonotonicNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static void PutVarint(std::string& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back((char)(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back((char)value);
+}
+
+static void PutLE(char* p, uint64_t value, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    p[i] = (char)(value >> (i * 8));
+  }
+}
+
+static uint64_t GetLE(const unsigned char* p, size_t size) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < size; ++i) {
+    value |= (uint64_t)p[i] << (i * 8);
+  }
+  return value;
+}
+
+//---------------------------------------------------------------- TrafficCapture
+
+bool TrafficCapture::Start(const Options& options) {
+  std::lock_guard<std::mutex> lock(s_mutex);
+  if (s_current) {
+    return false;
+  }
+  FILE* file = fopen(options.path.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+
+  char header[HEADER_SIZE];
+  memcpy(header, MAGIC, sizeof(MAGIC));
+  PutLE(header + 6, VERSION, 2);
+  uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::system_clock::now().time_since_epoch())
+                     .count();
+  PutLE(header + 8, now, 8);
+  if (fwrite(header, 1, sizeof(header), file) != sizeof(header)) {
+    fclose(file);
+    return false;
+  }
+
+  s_current.reset(new TrafficCapture(options, file));
+  s_active.store(true, std::memory_order_relaxed);
+  return true;
+}
+
+uint64_t TrafficCapture::Stop() {
+  std::unique_ptr<TrafficCapture> current;
+  {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_active.store(false, std::memory_order_relaxed);
+    current.swap(s_current);
+  }
+  if (!current) {
+    return 0;
+  }
+  // 取出会话后IO线程不会再访问它,在锁外等待写线程
+  current->close();
+  return current->m_written;
+}
+
+void TrafficCapture::Record(Socket& sock, Kind kind, const iovec* buffers,
+                            size_t count, size_t bytes) {
+  std::lock_guard<std::mutex> lock(s_mutex);
+  if (!s_current || !s_current->accept(sock)) {
+    return;
+  }
+  s_current->append(kind, sock.id(), buffers, count, bytes);
+}
+
+void TrafficCapture::RecordClose(Socket& sock) {
+  std::lock_guard<std::mutex> lock(s_mutex);
+  if (!s_current) {
+    return;
+  }
+  auto it = s_current->m_connections.find(sock.id());
+  if (it == s_current->m_connections.end()) {
+    return;
+  }
+  if (it->second) {
+    s_current->append(Kind::eClose, sock.id(), nullptr, 0, 0);
+  }
+  s_current->m_connections.erase(it);
+}
+
+TrafficCapture::TrafficCapture(const Options& options, FILE* file)
+    : m_options(options),
+      m_file(file),
+      m_recorded(HEADER_SIZE),
+      m_start(MonotonicNs()),
+      m_last(m_start),
+      m_stopping(false),
+      m_written(HEADER_SIZE) {
+  m_buffer.reserve(m_options.buffer_size + 64 * 1024);
+  m_writer = std::thread(&TrafficCapture::run, this);
+}
+
+TrafficCapture::~TrafficCapture() {
+  close();
+  if (m_file) {
+    fclose(m_file);
+  }
+}
+
+void TrafficCapture::close() {
+  if (!m_writer.joinable()) {
+    return;
+  }
+  submit();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_cond.notify_one();
+  m_writer.join();
+}
+
+bool TrafficCapture::accept(Socket& sock) {
+  auto it = m_connections.find(sock.id());
+  if (it != m_connections.end()) {
+    return it->second;
+  }
+
+  uint16_t local = sock.local_sockaddr().port();
+  uint16_t remote = sock.remote_sockaddr().port();
+  bool capture = m_options.port == 0 || local == m_options.port ||
+                 remote == m_options.port;
+  m_connections.emplace(sock.id(), capture);
+  if (capture) {
+    char meta[5];
+    meta[0] = (char)sock.type();
+    PutLE(meta + 1, local, 2);
+    PutLE(meta + 3, remote, 2);
+    iovec iov{meta, sizeof(meta)};
+    append(Kind::eOpen, sock.id(), &iov, 1, sizeof(meta));
+  }
+  return capture;
+}
+
+void TrafficCapture::append(Kind kind, uint64_t connection,
+                            const iovec* buffers, size_t count, size_t bytes) {
+  if (m_recorded >= m_options.max_bytes) {
+    // 达到上限后不再记录,IO路径也不再进入这里
+    s_active.store(false, std::memory_order_relaxed);
+    return;
+  }
+
+  uint64_t now = MonotonicNs();
+  size_t size = m_buffer.size();
+  m_buffer.push_back((char)kind);
+  PutVarint(m_buffer, connection);
+  PutVarint(m_buffer, now - m_last);
+  PutVarint(m_buffer, bytes);
+  m_last = now;
+  for (size_t i = 0; i < count && bytes > 0; ++i) {
+    size_t n = std::min(bytes, (size_t)buffers[i].iov_len);
+    m_buffer.append((const char*)buffers[i].iov_base, n);
+    bytes -= n;
+  }
+  m_recorded += m_buffer.size() - size;
+
+  if (m_buffer.size() >= m_options.buffer_size) {
+    submit();
+  }
+}
+
+void TrafficCapture::submit() {
+  if (m_buffer.empty()) {
+    return;
+  }
+  std::string next;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.push_back(std::move(m_buffer));
+    if (!m_free.empty()) {
+      next.swap(m_free.back());
+      m_free.pop_back();
+    }
+  }
+  m_cond.notify_one();
+  if (next.capacity() == 0) {
+    next.reserve(m_options.buffer_size + 64 * 1024);
+  }
+  m_buffer.swap(next);
+}
+
+void TrafficCapture::run() {
+  std::vector<std::string> batch;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cond.wait(lock, [this]() { return m_stopping || !m_pending.empty(); });
+      if (m_pending.empty()) {
+        return;
+      }
+      batch.swap(m_pending);
+    }
+
+    for (auto& buffer : batch) {
+      m_written += fwrite(buffer.data(), 1, buffer.size(), m_file);
+      buffer.clear();
+    }
+    fflush(m_file);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& buffer : batch) {
+      m_free.push_back(std::move(buffer));
+    }
+    batch.clear();
+  }
+}
+
+//---------------------------------------------------------------- TrafficReader
+
+TrafficReader::TrafficReader()
+    : m_file(nullptr), m_error(false), m_start_time(0), m_time(0) {}
+
+TrafficReader::~TrafficReader() {
+  if (m_file) {
+    fclose(m_file);
+  }
+}
+
+bool TrafficReader::open(const std::string& path) {
+  if (m_file) {
+    fclose(m_file);
+  }
+  m_error = false;
+  m_time = 0;
+  m_file = fopen(path.c_str(), "rb");
+  if (!m_file) {
+    return false;
+  }
+
+  unsigned char header[HEADER_SIZE];
+  if (fread(header, 1, sizeof(header), m_file) != sizeof(header) ||
+      memcmp(header, MAGIC, sizeof(MAGIC)) != 0 ||
+      GetLE(header + 6, 2) != VERSION) {
+    m_error = true;
+    return false;
+  }
+  m_start_time = GetLE(header + 8, 8);
+  return true;
+}
+
+bool TrafficReader::next(Record& record) {
+  if (!m_file || m_error) {
+    return false;
+  }
+  int kind = fgetc(m_file);
+  if (kind == EOF) {
+    return false;
+  }
+
+  uint64_t delta, length;
+  if (kind > (int)TrafficCapture::Kind::eClose ||
+      !read_varint(record.connection) || !read_varint(delta) ||
+      !read_varint(length) || length > (1u << 30)) {
+    m_error = true;
+    return false;
+  }
+  m_time += delta;
+  record.kind = (TrafficCapture::Kind)kind;
+  record.time_ns = m_time;
+  record.data.resize(length);
+  if (length > 0 && fread(&record.data[0], 1, length, m_file) != length) {
+    m_error = true;
+    return false;
+  }
+
+  if (record.kind == TrafficCapture::Kind::eOpen) {
+    if (length < 5) {
+      m_error = true;
+      return false;
+    }
+    const unsigned char* p = (const unsigned char*)record.data.data();
+    record.type = p[0];
+    record.local_port = (uint16_t)GetLE(p + 1, 2);
+    record.remote_port = (uint16_t)GetLE(p + 3, 2);
+    record.data.clear();
+  } else {
+    record.type = 0;
+    record.local_port = 0;
+    record.remote_port = 0;
+  }
+  return true;
+}
+
+bool TrafficReader::read_varint(uint64_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int c = fgetc(m_file);
+    if (c == EOF) {
+      return false;
+    }
+    value |= (uint64_t)(c & 0x7f) << shift;
+    if (c < 0x80) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace cx::net
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cx/common/internal.h"
+#include "cx/common/noncopyable.h"
+#include "cx/net/platform.h"
+
+namespace cx::net {
+
+class Socket;
+
+/**
+ * @brief 流量录制,记录Socket的收发数据到二进制文件,供回放工具使用
+ *
+ * 全局只有一个录制会话。开启后所有Socket的send/recv系列调用都会把实际收发的
+ * 数据连同时间戳记录下来,MSG_PEEK的接收不消耗数据,不记录;未开启时IO路径上
+ * 只有一次relaxed原子读取。记录在锁内追加到内存缓冲,缓冲满后交给单独的写线程
+ * 写入文件,IO线程不会因磁盘阻塞。
+ *
+ * 文件格式:6字节魔数"CXCAP\0",2字节版本(小端),8字节开始时的系统时间
+ * (纳秒,小端),之后是连续的记录:
+ *   1字节类型 | varint连接id | varint距上一条记录的时间(纳秒) | varint长度 | 数据
+ * 连接第一次出现时先写一条eOpen记录,数据为1字节socket类型、2字节本地端口、
+ * 2字节对端端口(小端)
+ */
+class TrafficCapture : public Noncopyable {
+ public:
+  typedef std::shared_ptr<TrafficCapture> ptr;
+
+  /**
+   * @brief 记录类型
+   */
+  enum class Kind : uint8_t {
+    eOpen = 0,   // 连接第一次出现
+    eSend = 1,   // 发送的数据
+    eRecv = 2,   // 接收的数据
+    eClose = 3,  // 连接关闭
+  };
+
+  /**
+   * @brief 录制参数
+   */
+  struct Options {
+    std::string path;                     // 文件路径
+    uint16_t port = 0;                    // 只录制本地或对端端口匹配的连接,0为全部
+    uint64_t max_bytes = 1ull << 30;      // 文件的最大长度,达到后停止记录
+    size_t buffer_size = 1024 * 1024;     // 写文件的缓冲大小
+  };
+
+  /**
+   * @brief 开始录制,已经在录制时失败
+   *
+   * @param[in] options 录制参数
+   *
+   * @return 是否成功
+   */
+  CX_STATIC bool Start(const Options& options);
+
+  /**
+   * @brief 停止录制并关闭文件
+   *
+   * @return 写入文件的字节数
+   */
+  CX_STATIC uint64_t Stop();
+
+  /**
+   * @brief 是否正在录制,Socket在每次IO后检查
+   */
+  CX_STATIC bool IsActive() {
+    return s_active.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief 记录一次收发,由Socket调用
+   *
+   * @param[in] sock    socket
+   * @param[in] kind    eSend或eRecv
+   * @param[in] buffers 数据
+   * @param[in] count   iovec数量
+   * @param[in] bytes   实际收发的字节数,可能小于buffers的总长度
+   */
+  CX_STATIC void Record(Socket& sock, Kind kind, const iovec* buffers,
+                        size_t count, size_t bytes);
+
+  /**
+   * @brief 记录连接关闭,由Socket调用
+   */
+  CX_STATIC void RecordClose(Socket& sock);
+
+  ~TrafficCapture();
+
+ private:
+  TrafficCapture(const Options& options, FILE* file);
+
+  /**
+   * @brief 提交剩余的缓冲,等待写线程写完后退出
+   */
+  void close();
+
+  /**
+   * @brief 连接第一次出现时判断是否录制并写入eOpen记录
+   *
+   * @return 是否录制该连接
+   */
+  bool accept(Socket& sock);
+  void append(Kind kind, uint64_t connection, const iovec* buffers,
+              size_t count, size_t bytes);
+
+  /**
+   * @brief 当前缓冲交给写线程,换一个空缓冲继续记录
+   */
+  void submit();
+
+  /**
+   * @brief 写线程的主循环
+   */
+  void run();
+
+ private:
+  CX_INLINE static std::atomic<bool> s_active{false};
+  CX_INLINE static std::mutex s_mutex;  // 保护s_current与会话的全部状态
+  CX_INLINE static std::unique_ptr<TrafficCapture> s_current;
+
+  Options m_options;
+  FILE* m_file;
+  std::string m_buffer;    // 正在记录的缓冲
+  uint64_t m_recorded;     // 已记录的字节数,含头部
+  uint64_t m_start;        // 开始时的单调时钟
+  uint64_t m_last;         // 上一条记录的单调时钟
+  std::unordered_map<uint64_t, bool> m_connections;  // socket id -> 是否录制
+
+  std::mutex m_mutex;  // 保护m_pending、m_free与m_stopping
+  std::condition_variable m_cond;
+  std::vector<std::string> m_pending;  // 等待写入文件的缓冲
+  std::vector<std::string> m_free;     // 写完后回收的缓冲
+  bool m_stopping;
+  uint64_t m_written;  // 已写入文件的字节数,只由写线程修改
+  std::thread m_writer;
+};
+
+/**
+ * @brief 读取TrafficCapture录制的文件
+ */
+class TrafficReader : public Noncopyable {
+ public:
+  /**
+   * @brief 一条记录
+   */
+  struct Record {
+    TrafficCapture::Kind kind;
+    uint64_t connection;
+    uint64_t time_ns;       // 距录制开始的时间
+    uint8_t type;           // socket类型,只对eOpen有效
+    uint16_t local_port;    // 只对eOpen有效
+    uint16_t remote_port;   // 只对eOpen有效
+    std::string data;       // eSend/eRecv的数据
+  };
+
+  TrafficReader();
+  ~TrafficReader();
+
+  /**
+   * @brief 打开文件并校验头部
+   */
+  bool open(const std::string& path);
+
+  /**
+   * @brief 读取下一条记录
+   *
+   * @return 文件结束或格式错误时返回false,通过error()区分
+   */
+  bool next(Record& record);
+
+  bool error() const { return m_error; }
+
+  /**
+   * @brief 录制开始时的系统时间,纳秒
+   */
+  uint64_t start_time() const { return m_start_time; }
+
+ private:
+  bool read_varint(uint64_t& value);
+
+ private:
+  FILE* m_file;
+  bool m_error;
+  uint64_t m_start_time;
+  uint64_t m_time;
+};
+
+}  // namespace cx::net
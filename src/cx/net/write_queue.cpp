@@ -0,0 +1,154 @@
+#include "write_queue.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <vector>
+
+namespace cx::net {
+
+// 合并小数据时,队尾缓冲最多增长到的长度
+static const size_t MAX_COALESCED_SEGMENT = 64 * 1024;
+
+WriteQueue::WriteQueue() : WriteQueue(Options()) {}
+
+WriteQueue::WriteQueue(const Options& options)
+    : m_options(options), m_size(0), m_paused(false), m_send_calls(0) {}
+
+bool WriteQueue::append(const void* data, size_t len) {
+  if (len == 0) {
+    return true;
+  }
+  if (!reserve(len)) {
+    return false;
+  }
+
+  if (len < m_options.coalesce_size && !m_segments.empty()) {
+    Segment& tail = m_segments.back();
+    if (!tail.shared && tail.owned.size() + len <= MAX_COALESCED_SEGMENT) {
+      tail.owned.append((const char*)data, len);
+      appended(len);
+      return true;
+    }
+  }
+
+  m_segments.emplace_back();
+  m_segments.back().owned.assign((const char*)data, len);
+  appended(len);
+  return true;
+}
+
+bool WriteQueue::append(std::string&& data) {
+  if (data.size() < m_options.coalesce_size) {
+    return append(data.data(), data.size());
+  }
+  if (!reserve(data.size())) {
+    return false;
+  }
+
+  size_t len = data.size();
+  m_segments.emplace_back();
+  m_segments.back().owned = std::move(data);
+  appended(len);
+  return true;
+}
+
+bool WriteQueue::append(const buffer_t& buffer) {
+  if (!buffer || buffer->empty()) {
+    return true;
+  }
+  if (buffer->size() < m_options.coalesce_size) {
+    return append(buffer->data(), buffer->size());
+  }
+  if (!reserve(buffer->size())) {
+    return false;
+  }
+
+  m_segments.emplace_back();
+  m_segments.back().shared = buffer;
+  appended(buffer->size());
+  return true;
+}
+
+int64_t WriteQueue::flush(Socket& sock, int flags) {
+  std::vector<iovec> buffers;
+  buffers.reserve(std::min(m_options.max_iovecs, m_segments.size()));
+
+  int64_t total = 0;
+  while (!m_segments.empty()) {
+    buffers.clear();
+    size_t bytes = 0;
+    for (auto& segment : m_segments) {
+      if (buffers.size() >= m_options.max_iovecs ||
+          bytes >= m_options.max_bytes_per_send) {
+        break;
+      }
+      size_t len =
+          std::min(segment.size(), m_options.max_bytes_per_send - bytes);
+      buffers.push_back({(void*)segment.data(), len});
+      bytes += len;
+    }
+
+    int n = sock.send(buffers.data(), buffers.size(), flags);
+    ++m_send_calls;
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+      return -1;
+    }
+
+    consume(n);
+    total += n;
+    if ((size_t)n < bytes) {
+      // socket缓冲区已满
+      break;
+    }
+  }
+  return total;
+}
+
+void WriteQueue::clear() {
+  m_segments.clear();
+  m_size = 0;
+  m_paused = false;
+}
+
+bool WriteQueue::reserve(size_t len) {
+  return m_options.max_size == 0 || m_size + len <= m_options.max_size;
+}
+
+void WriteQueue::appended(size_t len) {
+  m_size += len;
+  if (!m_paused && m_size >= m_options.high_watermark) {
+    m_paused = true;
+    if (m_high_watermark_callback) {
+      m_high_watermark_callback(m_size);
+    }
+  }
+}
+
+void WriteQueue::consume(size_t len) {
+  m_size -= len;
+  while (len > 0) {
+    Segment& front = m_segments.front();
+    size_t size = front.size();
+    if (len < size) {
+      front.offset += len;
+      break;
+    }
+    len -= size;
+    m_segments.pop_front();
+  }
+
+  if (m_paused && m_size <= m_options.low_watermark) {
+    m_paused = false;
+    if (m_low_watermark_callback) {
+      m_low_watermark_callback(m_size);
+    }
+  }
+}
+
+}  // namespace cx::net
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "cx/common/internal.h"
+#include "cx/common/noncopyable.h"
+#include "cx/net/socket.h"
+
+namespace cx::net {
+
+/**
+ * @brief 发送队列
+ *
+ * 缓存待发送的数据,每次flush把多个缓冲合并为一次sendmsg;较小的数据会被复制
+ * 合并到队尾的缓冲中,共享缓冲(buffer_t)则不复制,适合向多个连接广播同一条
+ * 消息。队列长度超过高水位时回调暂停,降到低水位以下时回调恢复,超过上限的
+ * 数据会被拒绝,保证慢速的对端不会无限占用内存
+ */
+class WriteQueue : public Noncopyable {
+ public:
+  typedef std::shared_ptr<const std::string> buffer_t;
+  typedef std::function<void(size_t queued)> watermark_callback_t;
+
+  /**
+   * @brief 队列参数
+   */
+  struct Options {
+    size_t max_iovecs = 64;                   // 每次sendmsg最多的缓冲数量
+    size_t max_bytes_per_send = 256 * 1024;  // 每次sendmsg最多发送的字节数
+    size_t coalesce_size = 1024;              // 小于该长度的数据复制合并
+    size_t low_watermark = 64 * 1024;         // 低水位
+    size_t high_watermark = 1024 * 1024;      // 高水位
+    size_t max_size = 16 * 1024 * 1024;       // 队列上限,0为不限制
+  };
+
+  /**
+   * @brief 使用默认参数构造
+   */
+  WriteQueue();
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] options 队列参数
+   */
+  WriteQueue(const Options& options);
+
+  /**
+   * @brief 复制数据到队列
+   *
+   * @param[in] data 数据
+   * @param[in] len  长度
+   *
+   * @return 超过队列上限时返回false
+   */
+  bool append(const void* data, size_t len);
+
+  /**
+   * @brief 转移字符串到队列,不复制
+   */
+  bool append(std::string&& data);
+
+  /**
+   * @brief 将共享缓冲加入队列,不复制
+   */
+  bool append(const buffer_t& buffer);
+
+  /**
+   * @brief 尽可能多地发送队列中的数据,直到发送完毕或socket缓冲区已满
+   *
+   * @param[in] sock  socket
+   * @param[in] flags send的标志
+   *
+   * @return 发送的字节数,出错时返回-1(errno不是EAGAIN/EWOULDBLOCK)
+   */
+  int64_t flush(Socket& sock, int flags = 0);
+
+  /**
+   * @brief 清空队列
+   */
+  void clear();
+
+  /**
+   * @brief 队列中的字节数
+   */
+  size_t size() const { return m_size; }
+
+  bool empty() const { return m_size == 0; }
+
+  /**
+   * @brief 是否处于高水位(已回调暂停,尚未回调恢复)
+   */
+  bool paused() const { return m_paused; }
+
+  /**
+   * @brief 调用sendmsg的次数
+   */
+  uint64_t send_calls() const { return m_send_calls; }
+
+  const Options& options() const { return m_options; }
+
+  void set_watermark(size_t low, size_t high) {
+    m_options.low_watermark = low;
+    m_options.high_watermark = high;
+  }
+
+  void set_max_size(size_t max_size) { m_options.max_size = max_size; }
+
+  /**
+   * @brief 超过高水位时回调,调用者应暂停产生数据
+   */
+  void set_high_watermark_callback(watermark_callback_t cb) {
+    m_high_watermark_callback = std::move(cb);
+  }
+
+  /**
+   * @brief 从高水位降到低水位以下时回调,调用者可以恢复产生数据
+   */
+  void set_low_watermark_callback(watermark_callback_t cb) {
+    m_low_watermark_callback = std::move(cb);
+  }
+
+ private:
+  struct Segment {
+    buffer_t shared;
+    std::string owned;
+    size_t offset = 0;
+
+    const char* data() const {
+      return (shared ? shared->data() : owned.data()) + offset;
+    }
+
+    size_t size() const {
+      return (shared ? shared->size() : owned.size()) - offset;
+    }
+  };
+
+  bool reserve(size_t len);
+  void appended(size_t len);
+  void consume(size_t len);
+
+ private:
+  Options m_options;
+  std::deque<Segment> m_segments;
+  size_t m_size;
+  bool m_paused;
+  uint64_t m_send_calls;
+
+  watermark_callback_t m_high_watermark_callback;
+  watermark_callback_t m_low_watermark_callback;
+};
+
+}  // namespace cx::net
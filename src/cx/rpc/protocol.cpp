@@ -0,0 +1,125 @@
+#include "protocol.h"
+
+#include <string>
+
+namespace cx::rpc {
+
+static void PutU8(char*& p, uint8_t value) { *p++ = (char)value; }
+
+static void PutU32(char*& p, uint32_t value) {
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    *p++ = (char)(value >> shift);
+  }
+}
+
+static void PutU64(char*& p, uint64_t value) {
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    *p++ = (char)(value >> shift);
+  }
+}
+
+/**
+ * @brief 头部之后追加payload的全部数据
+ */
+static WriteQueue::buffer_t Finish(std::string& frame, char* p,
+                                   const ByteArray& payload) {
+  if (payload.size() > 0) {
+    payload.read(p, payload.size(), 0);
+  }
+  return std::make_shared<const std::string>(std::move(frame));
+}
+
+const char* ToString(Status status) {
+  switch (status) {
+    case Status::eOk:
+      return "ok";
+    case Status::eNotFound:
+      return "not found";
+    case Status::eBadRequest:
+      return "bad request";
+    case Status::eBadResponse:
+      return "bad response";
+    case Status::eDeadlineExceeded:
+      return "deadline exceeded";
+    case Status::eInternal:
+      return "internal error";
+    case Status::eOverloaded:
+      return "overloaded";
+    case Status::eDisconnected:
+      return "disconnected";
+  }
+  return "unknown";
+}
+
+WriteQueue::buffer_t Protocol::EncodeRequest(uint64_t id, uint32_t method,
+                                             uint32_t timeout_ms,
+                                             const ByteArray& payload) {
+  std::string frame(REQUEST_HEADER + payload.size(), '\0');
+  char* p = &frame[0];
+  PutU32(p, (uint32_t)(frame.size() - 4));
+  PutU8(p, (uint8_t)Type::eRequest);
+  PutU64(p, id);
+  PutU32(p, method);
+  PutU32(p, timeout_ms);
+  return Finish(frame, p, payload);
+}
+
+WriteQueue::buffer_t Protocol::EncodeResponse(uint64_t id, Status status,
+                                              const ByteArray& payload) {
+  std::string frame(RESPONSE_HEADER + payload.size(), '\0');
+  char* p = &frame[0];
+  PutU32(p, (uint32_t)(frame.size() - 4));
+  PutU8(p, (uint8_t)Type::eResponse);
+  PutU64(p, id);
+  PutU8(p, (uint8_t)status);
+  return Finish(frame, p, payload);
+}
+
+int Protocol::Decode(ByteArray& in, Frame& frame, size_t max_frame) {
+  if (in.read_size() < 4) {
+    return 0;
+  }
+  uint8_t prefix[4];
+  in.read(prefix, sizeof(prefix), in.position());
+  size_t len = ((uint32_t)prefix[0] << 24) | ((uint32_t)prefix[1] << 16) |
+               ((uint32_t)prefix[2] << 8) | prefix[3];
+  if (len < RESPONSE_HEADER - 4 || len > max_frame) {
+    return -1;
+  }
+  if (in.read_size() < 4 + len) {
+    return 0;
+  }
+
+  frame.end = in.position() + 4 + len;
+  in.read_fuint32();
+  frame.type = (Type)in.read_fuint8();
+  frame.id = in.read_fuint64();
+  if (frame.type == Type::eRequest) {
+    if (len < REQUEST_HEADER - 4) {
+      return -1;
+    }
+    frame.method = in.read_fuint32();
+    frame.timeout_ms = in.read_fuint32();
+    frame.status = Status::eOk;
+    frame.payload = len - (REQUEST_HEADER - 4);
+  } else if (frame.type == Type::eResponse) {
+    frame.method = 0;
+    frame.timeout_ms = 0;
+    frame.status = (Status)in.read_fuint8();
+    frame.payload = len - (RESPONSE_HEADER - 4);
+  } else {
+    return -1;
+  }
+  return 1;
+}
+
+void Protocol::Payload(ByteArray& in, const Frame& frame, ByteArray& out) {
+  std::vector<iovec> buffers;
+  in.get_read_iovecs(buffers, frame.payload);
+  for (auto& buffer : buffers) {
+    out.write(buffer.iov_base, buffer.iov_len);
+  }
+  in.set_position(frame.end);
+}
+
+}  // namespace cx::rpc
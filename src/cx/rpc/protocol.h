@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+
+#include "cx/common/internal.h"
+#include "cx/net/byte_array.h"
+#include "cx/net/write_queue.h"
+
+namespace cx::rpc {
+
+using net::ByteArray;
+using net::WriteQueue;
+
+/**
+ * @brief 调用结果
+ */
+enum class Status : uint8_t {
+  eOk = 0,
+  eNotFound,          // 服务端没有该方法
+  eBadRequest,        // 服务端无法解析参数
+  eBadResponse,       // 客户端无法解析返回值
+  eDeadlineExceeded,  // 超过截止时间
+  eInternal,          // 处理函数抛出异常
+  eOverloaded,        // 排队的请求过多
+  eDisconnected,      // 连接断开
+};
+
+/**
+ * @brief 状态的文本
+ */
+const char* ToString(Status status);
+
+/**
+ * @brief 方法的描述,由CX_RPC_METHOD在服务接口中生成
+ *
+ * id是"服务名.方法名"的FNV-1a哈希,编译期计算;签名Sig在调用与注册时
+ * 检查参数与返回值的类型
+ */
+template <class Sig>
+struct Method;
+
+template <class R, class... A>
+struct Method<R(A...)> {
+  typedef R result_t;
+
+  const char* service;
+  const char* name;
+  uint32_t id;
+
+  constexpr Method(const char* service, const char* name)
+      : service(service), name(name), id(Hash(service, name)) {}
+
+ private:
+  CX_STATIC constexpr uint32_t Hash(const char* service, const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const char* p = service; *p; ++p) {
+      hash = (hash ^ (uint8_t)*p) * 16777619u;
+    }
+    hash = (hash ^ (uint8_t)'.') * 16777619u;
+    for (const char* p = name; *p; ++p) {
+      hash = (hash ^ (uint8_t)*p) * 16777619u;
+    }
+    return hash;
+  }
+};
+
+/**
+ * @brief 在服务接口中声明服务名,必须在所有方法之前
+ */
+#define CX_RPC_SERVICE(name) \
+  static constexpr const char* rpc_service = #name
+
+/**
+ * @brief 在服务接口中声明方法
+ *
+ * struct Calculator {
+ *   CX_RPC_SERVICE(Calculator);
+ *   CX_RPC_METHOD(add, int32_t(int32_t, int32_t));
+ *   CX_RPC_METHOD(echo, std::string(std::string));
+ * };
+ *
+ * 客户端通过client.call(Calculator::add, result, 1, 2)调用,服务端通过
+ * server.handle(Calculator::add, handler)注册,两端的类型都在编译期检查
+ */
+#define CX_RPC_METHOD(name, signature)                                  \
+  static constexpr ::cx::rpc::Method<signature> name {                  \
+    rpc_service, #name                                                  \
+  }
+
+/**
+ * @brief 帧格式
+ *
+ * 所有整数都是大端序,长度不含长度字段本身:
+ *   请求: len(4) type(1) id(8) method(4) timeout_ms(4) 参数
+ *   响应: len(4) type(1) id(8) status(1) 返回值
+ * 同一连接上可以有任意多个未完成的请求,响应通过id匹配,顺序不保证与请求相同
+ */
+class Protocol {
+ public:
+  enum class Type : uint8_t { eRequest = 1, eResponse = 2 };
+
+  static const size_t REQUEST_HEADER = 21;
+  static const size_t RESPONSE_HEADER = 14;
+
+  /**
+   * @brief 解码出的帧头部
+   */
+  struct Frame {
+    Type type;
+    uint64_t id;
+    uint32_t method;      // 请求
+    uint32_t timeout_ms;  // 请求,0为不限制
+    Status status;        // 响应
+    size_t payload;       // 参数或返回值的长度
+    size_t end;           // 帧在输入中的结束位置
+  };
+
+  /**
+   * @brief 编码请求帧
+   *
+   * @param[in] payload 参数,从位置0开始的全部数据
+   */
+  CX_STATIC WriteQueue::buffer_t EncodeRequest(uint64_t id, uint32_t method,
+                                               uint32_t timeout_ms,
+                                               const ByteArray& payload);
+
+  /**
+   * @brief 编码响应帧
+   *
+   * @param[in] payload 返回值,从位置0开始的全部数据
+   */
+  CX_STATIC WriteQueue::buffer_t EncodeResponse(uint64_t id, Status status,
+                                                const ByteArray& payload);
+
+  /**
+   * @brief 从输入中解码一帧的头部,成功时读位置移动到参数或返回值的开头
+   *
+   * @param[in]  in        输入
+   * @param[out] frame     帧头部
+   * @param[in]  max_frame 帧的最大长度
+   *
+   * @return 1为成功,0为数据不完整,-1为数据无效,应关闭连接
+   */
+  CX_STATIC int Decode(ByteArray& in, Frame& frame, size_t max_frame);
+
+  /**
+   * @brief 把帧的参数或返回值复制到独立的ByteArray中,输入的读位置移动到帧尾
+   *
+   * 解码只在复制出的数据上进行,长度不足的帧不会读到下一帧的数据
+   *
+   * @param[in]  in    输入,读位置在参数或返回值的开头
+   * @param[in]  frame Decode得到的帧头部
+   * @param[out] out   参数或返回值追加到末尾
+   */
+  CX_STATIC void Payload(ByteArray& in, const Frame& frame, ByteArray& out);
+};
+
+}  // namespace cx::rpc
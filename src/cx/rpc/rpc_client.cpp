@@ -0,0 +1,138 @@
+#include "rpc_client.h"
+
+#include <algorithm>
+
+#include "cx/common/logger.h"
+
+namespace cx::rpc {
+
+using namespace net;
+using namespace time;
+
+RpcClient::RpcClient() : RpcClient(Options()) {}
+
+RpcClient::RpcClient(const Options& options)
+    : m_options(options),
+      m_loop(nullptr),
+      m_connected(false),
+      m_next_id(1),
+      m_pending_count(0) {}
+
+RpcClient::~RpcClient() { close(); }
+
+bool RpcClient::connect(Address::ptr address) {
+  if (m_thread) {
+    return false;
+  }
+
+  Socket::ptr sock = Socket::GenerateTCP(address);
+  if (!sock->connect(address)) {
+    LOG_ERROR(log::Loggers::engine)
+        << m_options.name << " connect failed: " << address->to_string()
+        << ", errno: " << errno;
+    return false;
+  }
+
+  m_thread.reset(new EventLoopThread(m_options.name));
+  m_loop = m_thread->start();
+  m_conn.reset(new TcpConnection(m_loop, sock, 0));
+  m_conn->set_message_callback(
+      [this](const TcpConnection::ptr&, ByteArray& in) { on_message(in); });
+  m_conn->set_close_callback([this](const TcpConnection::ptr&) { on_close(); });
+  m_connected = true;
+
+  TcpConnection::ptr conn = m_conn;
+  m_loop->run_in_loop([conn]() { conn->establish(); });
+  return true;
+}
+
+void RpcClient::close() {
+  if (!m_thread) {
+    return;
+  }
+
+  TcpConnection::ptr conn = m_conn;
+  m_loop->run_in_loop([conn]() { conn->force_close(); });
+  m_thread->stop();
+  m_thread.reset();
+  m_conn.reset();
+  m_loop = nullptr;
+  m_connected = false;
+}
+
+void RpcClient::send_request(uint32_t method, const TimePoint& timeout,
+                             const ByteArray& payload, done_t done) {
+  // 无法发送时在调用线程中立即回调
+  if (!m_connected) {
+    done(Status::eDisconnected, nullptr);
+    return;
+  }
+  if (m_pending_count >= m_options.max_pending) {
+    done(Status::eOverloaded, nullptr);
+    return;
+  }
+
+  uint64_t id = m_next_id++;
+  uint32_t timeout_ms =
+      (uint32_t)std::max<int64_t>(1, timeout.AsMicroseconds() / 1000);
+  WriteQueue::buffer_t frame =
+      Protocol::EncodeRequest(id, method, timeout_ms, payload);
+
+  ++m_pending_count;
+  m_loop->run_in_loop([this, id, frame, timeout, done]() {
+    if (!m_conn->connected()) {
+      --m_pending_count;
+      done(Status::eDisconnected, nullptr);
+      return;
+    }
+    uint64_t timer = m_loop->run_after(timeout, [this, id]() {
+      finish(id, Status::eDeadlineExceeded, nullptr);
+    });
+    m_pending.emplace(id, Pending{done, timer});
+    m_conn->send(frame);
+  });
+}
+
+void RpcClient::on_message(ByteArray& in) {
+  Protocol::Frame frame;
+  for (;;) {
+    int rt = Protocol::Decode(in, frame, m_options.max_frame);
+    if (rt == 0) {
+      break;
+    }
+    if (rt < 0 || frame.type != Protocol::Type::eResponse) {
+      LOG_WARN(log::Loggers::engine)
+          << m_options.name << " invalid frame, close";
+      m_conn->force_close();
+      return;
+    }
+    ByteArray result;
+    Protocol::Payload(in, frame, result);
+    finish(frame.id, frame.status, &result);
+  }
+}
+
+void RpcClient::on_close() {
+  m_connected = false;
+  std::unordered_map<uint64_t, Pending> pending;
+  pending.swap(m_pending);
+  for (auto& [id, request] : pending) {
+    m_loop->cancel(request.timer);
+    --m_pending_count;
+    request.done(Status::eDisconnected, nullptr);
+  }
+}
+
+void RpcClient::finish(uint64_t id, Status status, ByteArray* in) {
+  auto it = m_pending.find(id);
+  if (it == m_pending.end()) {
+    return;
+  }
+  Pending request = std::move(it->second);
+  m_pending.erase(it);
+  --m_pending_count;
+  m_loop->cancel(request.timer);
+  request.done(status, in);
+}
+
+}  // namespace cx::rpc
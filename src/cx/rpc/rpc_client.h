@@ -0,0 +1,183 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+#include "cx/common/internal.h"
+#include "cx/common/noncopyable.h"
+#include "cx/net/event_loop.h"
+#include "cx/net/tcp_connection.h"
+#include "cx/rpc/protocol.h"
+#include "cx/rpc/serializer.h"
+#include "cx/utils/time/time.h"
+
+namespace cx::rpc {
+
+/**
+ * @brief RPC客户端,一个客户端对应一个连接
+ *
+ * 请求可以在任意线程发起,编码在调用线程完成,之后交给客户端的事件循环线程
+ * 发送;同一连接上可以同时有任意多个未完成的请求,响应按id分发。每个请求都有
+ * 截止时间,超时后回调eDeadlineExceeded,之后到达的响应被丢弃。回调在事件
+ * 循环线程中执行,不能阻塞;未连接或请求过多时在调用线程中立即回调。
+ * connect与close不能与调用并发
+ */
+class RpcClient : public Noncopyable {
+ public:
+  typedef std::shared_ptr<RpcClient> ptr;
+
+  /**
+   * @brief 客户端参数
+   */
+  struct Options {
+    std::string name = "rpc_client";                         // 线程名称
+    time::TimePoint timeout = time::TimePoint::Seconds(5);  // 默认超时
+    size_t max_pending = 64 * 1024;       // 未完成请求的上限,超过时返回eOverloaded
+    size_t max_frame = 16 * 1024 * 1024;  // 帧的最大长度
+  };
+
+  /**
+   * @brief 使用默认参数构造
+   */
+  RpcClient();
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] options 客户端参数
+   */
+  RpcClient(const Options& options);
+
+  /**
+   * @brief 析构函数,未完成的请求回调eDisconnected
+   */
+  ~RpcClient();
+
+  /**
+   * @brief 连接服务端,阻塞直到连接成功或失败
+   *
+   * @param[in] address 地址
+   *
+   * @return 是否成功
+   */
+  bool connect(net::Address::ptr address);
+
+  /**
+   * @brief 关闭连接,未完成的请求回调eDisconnected
+   */
+  void close();
+
+  bool connected() const { return m_connected; }
+
+  /**
+   * @brief 未完成的请求数量
+   */
+  size_t pending() const { return m_pending_count; }
+
+  /**
+   * @brief 异步调用,使用默认超时
+   *
+   * @param[in] method 方法
+   * @param[in] done   完成回调void(Status, R&&),在事件循环线程中执行
+   * @param[in] args   参数,类型必须能转换为方法声明的参数类型
+   */
+  template <class R, class... A, class F, class... Args,
+            std::enable_if_t<std::is_invocable_v<F&, Status, R&&>, int> = 0>
+  void async_call(const Method<R(A...)>& method, F done, Args&&... args) {
+    async_call(method, m_options.timeout, std::move(done),
+               std::forward<Args>(args)...);
+  }
+
+  /**
+   * @brief 异步调用
+   *
+   * @param[in] method  方法
+   * @param[in] timeout 超时时间,同时告知服务端,线程池中排队超时的请求不会执行
+   * @param[in] done    完成回调,在事件循环线程中执行
+   * @param[in] args    参数
+   */
+  template <class R, class... A, class F, class... Args,
+            std::enable_if_t<std::is_invocable_v<F&, Status, R&&>, int> = 0>
+  void async_call(const Method<R(A...)>& method, const time::TimePoint& timeout,
+                  F done, Args&&... args) {
+    static_assert(sizeof...(A) == sizeof...(Args),
+                  "argument count does not match the method signature");
+    ByteArray payload;
+    (EncodeArg<std::decay_t<A>>(payload, std::forward<Args>(args)), ...);
+    send_request(method.id, timeout, payload,
+                 [done = std::move(done)](Status status, ByteArray* in) {
+                   R result{};
+                   if (status == Status::eOk &&
+                       (!Decode(*in, result) || in->read_size() != 0)) {
+                     status = Status::eBadResponse;
+                   }
+                   done(status, std::move(result));
+                 });
+  }
+
+  /**
+   * @brief 同步调用,阻塞直到完成或超时,不能在回调中调用
+   *
+   * @param[in]  method 方法
+   * @param[out] result 返回值,成功时有效
+   * @param[in]  args   参数
+   *
+   * @return 调用结果
+   */
+  template <class R, class... A, class... Args>
+  Status call(const Method<R(A...)>& method, R& result, Args&&... args) {
+    if (m_loop && m_loop->is_in_loop_thread()) {
+      return Status::eInternal;
+    }
+    std::promise<Status> promise;
+    std::future<Status> future = promise.get_future();
+    async_call(
+        method,
+        [&promise, &result](Status status, R&& value) {
+          if (status == Status::eOk) {
+            result = std::move(value);
+          }
+          promise.set_value(status);
+        },
+        std::forward<Args>(args)...);
+    return future.get();
+  }
+
+ private:
+  typedef std::function<void(Status status, ByteArray* in)> done_t;
+
+  /**
+   * @brief 未完成的请求,只在事件循环线程中访问
+   */
+  struct Pending {
+    done_t done;
+    uint64_t timer;
+  };
+
+  void send_request(uint32_t method, const time::TimePoint& timeout,
+                    const ByteArray& payload, done_t done);
+  void on_message(ByteArray& in);
+  void on_close();
+
+  /**
+   * @brief 完成请求并回调,请求不存在时忽略
+   */
+  void finish(uint64_t id, Status status, ByteArray* in);
+
+ private:
+  Options m_options;
+  net::EventLoopThread::ptr m_thread;
+  net::EventLoop* m_loop;
+  net::TcpConnection::ptr m_conn;
+  std::unordered_map<uint64_t, Pending> m_pending;
+  std::atomic<bool> m_connected;
+  std::atomic<uint64_t> m_next_id;
+  std::atomic<size_t> m_pending_count;
+};
+
+}  // namespace cx::rpc
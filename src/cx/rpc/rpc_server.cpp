@@ -0,0 +1,130 @@
+#include "rpc_server.h"
+
+#include <exception>
+#include <vector>
+
+#include "cx/common/logger.h"
+
+namespace cx::rpc {
+
+using namespace net;
+using namespace time;
+
+RpcServer::RpcServer() : RpcServer(Options()) {}
+
+RpcServer::RpcServer(const Options& options)
+    : m_options(options),
+      m_server(options.tcp),
+      m_request_count(0),
+      m_error_count(0) {
+  m_server.set_message_callback(
+      [this](const TcpConnection::ptr& conn, ByteArray& in) {
+        on_message(conn, in);
+      });
+}
+
+RpcServer::~RpcServer() { stop(); }
+
+bool RpcServer::start() { return m_server.start(); }
+
+void RpcServer::stop() { m_server.stop(); }
+
+void RpcServer::add_invoker(const char* service, const char* name,
+                            uint32_t id, invoker_t invoker) {
+  std::string full_name = std::string(service) + "." + name;
+  if (m_server.is_running()) {
+    LOG_ERROR(log::Loggers::engine)
+        << m_options.tcp.name << " handle after start: " << full_name;
+    return;
+  }
+  auto it = m_names.find(id);
+  if (it != m_names.end() && it->second != full_name) {
+    LOG_ERROR(log::Loggers::engine)
+        << m_options.tcp.name << " method id conflict: " << full_name
+        << " and " << it->second;
+    return;
+  }
+  m_names[id] = full_name;
+  m_invokers[id] = std::move(invoker);
+}
+
+void RpcServer::on_message(const TcpConnection::ptr& conn, ByteArray& in) {
+  TimePoint arrival;
+  Protocol::Frame frame;
+  for (;;) {
+    int rt = Protocol::Decode(in, frame, m_options.max_frame);
+    if (rt == 0) {
+      break;
+    }
+    if (rt < 0 || frame.type != Protocol::Type::eRequest) {
+      LOG_WARN(log::Loggers::engine)
+          << m_options.tcp.name << " invalid frame from connection "
+          << conn->id() << ", close";
+      conn->force_close();
+      return;
+    }
+    ++m_request_count;
+
+    auto it = m_invokers.find(frame.method);
+    const invoker_t* invoker = it == m_invokers.end() ? nullptr : &it->second;
+
+    if (!m_options.executor || !invoker) {
+      ByteArray args;
+      Protocol::Payload(in, frame, args);
+      conn->send(invoke(frame.id, invoker, args));
+      continue;
+    }
+
+    // 参数复制到独立的ByteArray中交给线程池
+    std::shared_ptr<ByteArray> args(new ByteArray);
+    Protocol::Payload(in, frame, *args);
+
+    if (arrival.AsMicroseconds() == 0) {
+      arrival = TimePoint::Now();
+    }
+    TimePoint deadline =
+        frame.timeout_ms ? arrival + TimePoint::Milliseconds(frame.timeout_ms)
+                         : TimePoint();
+    uint64_t id = frame.id;
+    bool submitted = m_options.executor->submit(
+        [this, conn, id, invoker, args, deadline]() {
+          if (deadline.AsMicroseconds() > 0 && TimePoint::Now() > deadline) {
+            ++m_error_count;
+            ByteArray empty;
+            conn->send(Protocol::EncodeResponse(
+                id, Status::eDeadlineExceeded, empty));
+            return;
+          }
+          conn->send(invoke(id, invoker, *args));
+        });
+    if (!submitted) {
+      ++m_error_count;
+      ByteArray empty;
+      conn->send(Protocol::EncodeResponse(id, Status::eOverloaded, empty));
+    }
+  }
+}
+
+WriteQueue::buffer_t RpcServer::invoke(uint64_t id, const invoker_t* invoker,
+                                       ByteArray& in) {
+  ByteArray out;
+  Status status = Status::eNotFound;
+  if (invoker) {
+    try {
+      status = (*invoker)(in, out);
+    } catch (const std::exception& e) {
+      LOG_WARN(log::Loggers::engine)
+          << m_options.tcp.name << " handler of request " << id
+          << " threw: " << e.what();
+      status = Status::eInternal;
+    }
+  }
+
+  if (status != Status::eOk) {
+    ++m_error_count;
+    out.clear();
+  }
+  return Protocol::EncodeResponse(id, status, out);
+}
+
+}  // namespace cx::rpc
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+#include "cx/common/internal.h"
+#include "cx/common/noncopyable.h"
+#include "cx/net/tcp_server.h"
+#include "cx/rpc/protocol.h"
+#include "cx/rpc/serializer.h"
+#include "cx/utils/thread/thread_pool.h"
+
+namespace cx::rpc {
+
+/**
+ * @brief RPC服务端
+ *
+ * 基于TcpServer,同一连接上的请求按到达顺序依次处理,响应在本轮事件循环
+ * 结束时合并发送。默认处理函数在IO线程中执行;设置executor后在线程池中执行,
+ * 执行前检查请求的截止时间,已经超时的请求直接返回eDeadlineExceeded
+ */
+class RpcServer : public Noncopyable {
+ public:
+  typedef std::shared_ptr<RpcServer> ptr;
+
+  /**
+   * @brief 服务端参数
+   */
+  struct Options {
+    net::TcpServer::Options tcp;          // TCP服务器参数
+    size_t max_frame = 16 * 1024 * 1024;  // 帧的最大长度,超过时关闭连接
+    // 执行处理函数的线程池,为空时在IO线程中执行;需要在服务端销毁前停止
+    thread::ThreadPool::ptr executor;
+
+    Options() { tcp.name = "rpc_server"; }
+  };
+
+  /**
+   * @brief 使用默认参数构造
+   */
+  RpcServer();
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] options 服务端参数
+   */
+  RpcServer(const Options& options);
+
+  ~RpcServer();
+
+  /**
+   * @brief 注册方法的处理函数,只能在启动前调用
+   *
+   * @param[in] method  方法
+   * @param[in] handler 处理函数,参数与返回值必须与方法的签名一致
+   */
+  template <class R, class... A, class F>
+  void handle(const Method<R(A...)>& method, F handler) {
+    static_assert(std::is_invocable_r_v<R, F, std::decay_t<A>...>,
+                  "handler does not match the method signature");
+    add_invoker(method.service, method.name, method.id,
+                [handler = std::move(handler)](ByteArray& in, ByteArray& out) {
+                  std::tuple<std::decay_t<A>...> args;
+                  // 参数不完整或有多余的数据都是无效请求
+                  if (!Decode(in, args) || in.read_size() != 0) {
+                    return Status::eBadRequest;
+                  }
+                  R result = std::apply(handler, std::move(args));
+                  Serializer<R>::Write(out, result);
+                  return Status::eOk;
+                });
+  }
+
+  /**
+   * @brief 注册对象的成员函数作为处理函数,对象必须比服务端存活更久
+   */
+  template <class R, class... A, class T, class... P>
+  void handle(const Method<R(A...)>& method, T* object, R (T::*fn)(P...)) {
+    handle(method, [object, fn](std::decay_t<A>... args) {
+      return (object->*fn)(std::move(args)...);
+    });
+  }
+
+  /**
+   * @brief 绑定地址
+   */
+  bool bind(net::Address::ptr address) { return m_server.bind(address); }
+
+  bool start();
+
+  void stop();
+
+  net::TcpServer& tcp() { return m_server; }
+
+  /**
+   * @brief 累计处理的请求数量
+   */
+  uint64_t request_count() const { return m_request_count; }
+
+  /**
+   * @brief 累计失败的请求数量
+   */
+  uint64_t error_count() const { return m_error_count; }
+
+ private:
+  typedef std::function<Status(ByteArray& in, ByteArray& out)> invoker_t;
+
+  void add_invoker(const char* service, const char* name, uint32_t id,
+                   invoker_t invoker);
+  void on_message(const net::TcpConnection::ptr& conn, ByteArray& in);
+
+  /**
+   * @brief 执行请求并生成响应帧
+   */
+  WriteQueue::buffer_t invoke(uint64_t id, const invoker_t* invoker,
+                              ByteArray& in);
+
+ private:
+  Options m_options;
+  net::TcpServer m_server;
+  std::unordered_map<uint32_t, invoker_t> m_invokers;
+  std::unordered_map<uint32_t, std::string> m_names;
+  std::atomic<uint64_t> m_request_count;
+  std::atomic<uint64_t> m_error_count;
+};
+
+}  // namespace cx::rpc
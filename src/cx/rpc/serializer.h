@@ -0,0 +1,389 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cx/common/internal.h"
+#include "cx/net/byte_array.h"
+#include "cx/net/endian.h"
+
+namespace cx::rpc {
+
+using net::ByteArray;
+
+/**
+ * @brief 没有返回值的方法使用Void作为返回类型,不占用任何字节
+ */
+struct Void {};
+
+/**
+ * @brief 在结构体中声明需要序列化的成员,按声明的顺序编码
+ *
+ * struct Position {
+ *   float x, y;
+ *   CX_RPC_FIELDS(x, y)
+ * };
+ */
+#define CX_RPC_FIELDS(...)                                   \
+  auto rpc_fields() { return std::tie(__VA_ARGS__); }        \
+  auto rpc_fields() const { return std::tie(__VA_ARGS__); }
+
+/**
+ * @brief 类型的序列化,没有特化的类型无法编译
+ *
+ * Write追加到ByteArray末尾,Read从读位置读取;数据不足或无效时Read返回false。
+ * 长度与数量都是32位,容器的数量在分配内存前与剩余数据比较,避免恶意的长度
+ */
+template <class T, class Enable = void>
+struct Serializer;
+
+template <class T, class Enable = void>
+struct HasFields : std::false_type {};
+
+template <class T>
+struct HasFields<T, std::void_t<decltype(std::declval<T&>().rpc_fields())>>
+    : std::true_type {};
+
+template <>
+struct Serializer<Void> {
+  static void Write(ByteArray&, const Void&) {}
+  static bool Read(ByteArray&, Void&) { return true; }
+};
+
+template <>
+struct Serializer<bool> {
+  static void Write(ByteArray& out, bool value) {
+    out.write_fuint8(value ? 1 : 0);
+  }
+  static bool Read(ByteArray& in, bool& value) {
+    if (in.read_size() < 1) {
+      return false;
+    }
+    value = in.read_fuint8() != 0;
+    return true;
+  }
+};
+
+template <class T>
+struct Serializer<T, std::enable_if_t<std::is_integral_v<T> &&
+                                      !std::is_same_v<T, bool>>> {
+  typedef std::conditional_t<
+      sizeof(T) == 1, uint8_t,
+      std::conditional_t<sizeof(T) == 2, uint16_t,
+                         std::conditional_t<sizeof(T) == 4, uint32_t,
+                                            uint64_t>>>
+      wire_t;
+
+  static void Write(ByteArray& out, T value) {
+    wire_t wire = (wire_t)value;
+    if constexpr (sizeof(T) == 1) {
+      out.write_fuint8(wire);
+    } else if constexpr (sizeof(T) == 2) {
+      out.write_fuint16(wire);
+    } else if constexpr (sizeof(T) == 4) {
+      out.write_fuint32(wire);
+    } else {
+      out.write_fuint64(wire);
+    }
+  }
+
+  static bool Read(ByteArray& in, T& value) {
+    if (in.read_size() < sizeof(T)) {
+      return false;
+    }
+    if constexpr (sizeof(T) == 1) {
+      value = (T)in.read_fuint8();
+    } else if constexpr (sizeof(T) == 2) {
+      value = (T)in.read_fuint16();
+    } else if constexpr (sizeof(T) == 4) {
+      value = (T)in.read_fuint32();
+    } else {
+      value = (T)in.read_fuint64();
+    }
+    return true;
+  }
+};
+
+template <class T>
+struct Serializer<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+  static void Write(ByteArray& out, T value) {
+    if constexpr (sizeof(T) == sizeof(float)) {
+      out.write_float(value);
+    } else {
+      out.write_double((double)value);
+    }
+  }
+
+  static bool Read(ByteArray& in, T& value) {
+    if constexpr (sizeof(T) == sizeof(float)) {
+      if (in.read_size() < sizeof(float)) {
+        return false;
+      }
+      value = in.read_float();
+    } else {
+      if (in.read_size() < sizeof(double)) {
+        return false;
+      }
+      value = (T)in.read_double();
+    }
+    return true;
+  }
+};
+
+template <class T>
+struct Serializer<T, std::enable_if_t<std::is_enum_v<T>>> {
+  typedef std::underlying_type_t<T> underlying_t;
+
+  static void Write(ByteArray& out, T value) {
+    Serializer<underlying_t>::Write(out, (underlying_t)value);
+  }
+
+  static bool Read(ByteArray& in, T& value) {
+    underlying_t raw;
+    if (!Serializer<underlying_t>::Read(in, raw)) {
+      return false;
+    }
+    value = (T)raw;
+    return true;
+  }
+};
+
+template <>
+struct Serializer<std::string> {
+  static void Write(ByteArray& out, const std::string& value) {
+    out.write_fuint32((uint32_t)value.size());
+    out.write(value.data(), value.size());
+  }
+
+  static bool Read(ByteArray& in, std::string& value) {
+    if (in.read_size() < 4) {
+      return false;
+    }
+    uint32_t len = in.read_fuint32();
+    if (len > in.read_size()) {
+      return false;
+    }
+    value.resize(len);
+    in.read(&value[0], len);
+    return true;
+  }
+};
+
+template <class T>
+struct Serializer<std::vector<T>> {
+  // 数值数组整块转换字节序,不逐个元素编码
+  static constexpr bool bulk = std::is_arithmetic_v<T> &&
+                               !std::is_same_v<T, bool> &&
+                               (sizeof(T) == 1 || is_byteswappable<T>::value);
+
+  static void Write(ByteArray& out, const std::vector<T>& value) {
+    out.write_fuint32((uint32_t)value.size());
+    if constexpr (bulk) {
+      if (sizeof(T) == 1 || out.is_little_endian() ==
+                                (CX_BYTE_ORDER == CX_LITTLE_ENDIAN)) {
+        out.write(value.data(), value.size() * sizeof(T));
+        return;
+      }
+      char buffer[4096];
+      const size_t step = sizeof(buffer) / sizeof(T);
+      for (size_t i = 0; i < value.size(); i += step) {
+        size_t n = std::min(step, value.size() - i);
+        byteswap_n(buffer, value.data() + i, n, sizeof(T));
+        out.write(buffer, n * sizeof(T));
+      }
+    } else {
+      for (auto& item : value) {
+        Serializer<T>::Write(out, item);
+      }
+    }
+  }
+
+  static bool Read(ByteArray& in, std::vector<T>& value) {
+    if (in.read_size() < 4) {
+      return false;
+    }
+    uint32_t count = in.read_fuint32();
+    if constexpr (bulk) {
+      if ((uint64_t)count * sizeof(T) > in.read_size()) {
+        return false;
+      }
+      value.resize(count);
+      in.read(value.data(), count * sizeof(T));
+      if constexpr (sizeof(T) > 1) {
+        if (in.is_little_endian() != (CX_BYTE_ORDER == CX_LITTLE_ENDIAN)) {
+          byteswap_n(value.data(), value.data(), count);
+        }
+      }
+      return true;
+    } else {
+      if (count > in.read_size() && !std::is_empty_v<T>) {
+        return false;
+      }
+      value.clear();
+      value.resize(count);
+      for (auto& item : value) {
+        if (!Serializer<T>::Read(in, item)) {
+          return false;
+        }
+      }
+      return true;
+    }
+  }
+};
+
+/**
+ * @brief map与unordered_map共用的编码:数量加键值对
+ */
+template <class M>
+struct MapSerializer {
+  typedef typename M::key_type key_t;
+  typedef typename M::mapped_type value_t;
+
+  static void Write(ByteArray& out, const M& value) {
+    out.write_fuint32((uint32_t)value.size());
+    for (auto& [k, v] : value) {
+      Serializer<key_t>::Write(out, k);
+      Serializer<value_t>::Write(out, v);
+    }
+  }
+
+  static bool Read(ByteArray& in, M& value) {
+    if (in.read_size() < 4) {
+      return false;
+    }
+    uint32_t count = in.read_fuint32();
+    if (count > in.read_size()) {
+      return false;
+    }
+    value.clear();
+    for (uint32_t i = 0; i < count; ++i) {
+      key_t k;
+      value_t v;
+      if (!Serializer<key_t>::Read(in, k) || !Serializer<value_t>::Read(in, v)) {
+        return false;
+      }
+      value.emplace(std::move(k), std::move(v));
+    }
+    return true;
+  }
+};
+
+template <class K, class V>
+struct Serializer<std::map<K, V>> : MapSerializer<std::map<K, V>> {};
+
+template <class K, class V>
+struct Serializer<std::unordered_map<K, V>>
+    : MapSerializer<std::unordered_map<K, V>> {};
+
+template <class T>
+struct Serializer<std::optional<T>> {
+  static void Write(ByteArray& out, const std::optional<T>& value) {
+    out.write_fuint8(value ? 1 : 0);
+    if (value) {
+      Serializer<T>::Write(out, *value);
+    }
+  }
+
+  static bool Read(ByteArray& in, std::optional<T>& value) {
+    bool has = false;
+    if (!Serializer<bool>::Read(in, has)) {
+      return false;
+    }
+    if (!has) {
+      value.reset();
+      return true;
+    }
+    value.emplace();
+    return Serializer<T>::Read(in, *value);
+  }
+};
+
+/**
+ * @brief 元组逐个元素编码,也用于CX_RPC_FIELDS返回的引用元组
+ */
+template <class... Ts>
+struct Serializer<std::tuple<Ts...>> {
+  static void Write(ByteArray& out, const std::tuple<Ts...>& value) {
+    std::apply(
+        [&out](const Ts&... items) {
+          (Serializer<std::decay_t<Ts>>::Write(out, items), ...);
+        },
+        value);
+  }
+
+  static bool Read(ByteArray& in, std::tuple<Ts...>& value) {
+    return std::apply(
+        [&in](Ts&... items) {
+          return (Serializer<std::decay_t<Ts>>::Read(in, items) && ...);
+        },
+        value);
+  }
+};
+
+template <class A, class B>
+struct Serializer<std::pair<A, B>> {
+  static void Write(ByteArray& out, const std::pair<A, B>& value) {
+    Serializer<A>::Write(out, value.first);
+    Serializer<B>::Write(out, value.second);
+  }
+
+  static bool Read(ByteArray& in, std::pair<A, B>& value) {
+    return Serializer<A>::Read(in, value.first) &&
+           Serializer<B>::Read(in, value.second);
+  }
+};
+
+template <class T>
+struct Serializer<T, std::enable_if_t<HasFields<T>::value>> {
+  static void Write(ByteArray& out, const T& value) {
+    std::apply(
+        [&out](const auto&... items) {
+          (Serializer<std::decay_t<decltype(items)>>::Write(out, items), ...);
+        },
+        value.rpc_fields());
+  }
+
+  static bool Read(ByteArray& in, T& value) {
+    return std::apply(
+        [&in](auto&... items) {
+          return (Serializer<std::decay_t<decltype(items)>>::Read(in, items) &&
+                  ...);
+        },
+        value.rpc_fields());
+  }
+};
+
+/**
+ * @brief 读取一个值,ByteArray读取越界时抛出的异常也视为数据无效
+ */
+template <class T>
+CX_INLINE bool Decode(ByteArray& in, T& value) {
+  try {
+    return Serializer<T>::Read(in, value);
+  } catch (const std::out_of_range&) {
+    return false;
+  }
+}
+
+/**
+ * @brief 按声明的参数类型T编码实参,类型相同时不产生临时对象
+ */
+template <class T, class U>
+CX_INLINE void EncodeArg(ByteArray& out, U&& value) {
+  if constexpr (std::is_same_v<std::decay_t<U>, T>) {
+    Serializer<T>::Write(out, value);
+  } else {
+    Serializer<T>::Write(out, T(std::forward<U>(value)));
+  }
+}
+
+}  // namespace cx::rpc
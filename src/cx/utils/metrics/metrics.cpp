@@ -0,0 +1,300 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace cx::metrics {
+
+static bool ValidName(const std::string& name) {
+  if (name.empty() || (name[0] >= '0' && name[0] <= '9')) {
+    return false;
+  }
+  for (char c : name) {
+    if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+          (c >= '0' && c <= '9') || c == '_' || c == ':')) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief 转义字符串,Prometheus的标签值与JSON字符串都转义反斜杠,引号与换行
+ *
+ * Prometheus只定义了这三种转义,其余字符原样输出;JSON中所有小于0x20的
+ * 控制字符都必须转义,没有简写的使用\uXXXX
+ */
+static void AppendEscaped(std::string& out, const std::string& value,
+                          bool json) {
+  for (char c : value) {
+    switch (c) {
+      case '\\':
+        out += "\\\\";
+        break;
+      case '"':
+        out += "\\\"";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += json ? "\\r" : "\r";
+        break;
+      case '\t':
+        out += json ? "\\t" : "\t";
+        break;
+      default:
+        if (json && (unsigned char)c < 0x20) {
+          char buf[8];
+          snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)c);
+          out += buf;
+        } else {
+          out += c;
+        }
+        break;
+    }
+  }
+}
+
+static void AppendNumber(std::string& out, double value, bool json) {
+  if (std::isnan(value)) {
+    out += json ? "null" : "NaN";
+    return;
+  }
+  if (std::isinf(value)) {
+    out += json ? "null" : (value > 0 ? "+Inf" : "-Inf");
+    return;
+  }
+  char buf[32];
+  int n = snprintf(buf, sizeof(buf), "%.15g", value);
+  out.append(buf, n);
+}
+
+static void AppendInteger(std::string& out, uint64_t value) {
+  char buf[24];
+  int n = snprintf(buf, sizeof(buf), "%llu", (unsigned long long)value);
+  out.append(buf, n);
+}
+
+/**
+ * @brief 生成标签的Prometheus与JSON格式,没有标签时Prometheus格式为空
+ */
+static bool FormatLabels(const Registry::labels_t& labels, std::string& text,
+                         std::string& json) {
+  json = "{";
+  if (!labels.empty()) {
+    text = "{";
+    for (size_t i = 0; i < labels.size(); ++i) {
+      if (!ValidName(labels[i].first)) {
+        return false;
+      }
+      if (i > 0) {
+        text += ',';
+        json += ',';
+      }
+      text += labels[i].first + "=\"";
+      AppendEscaped(text, labels[i].second, false);
+      text += '"';
+      json += '"' + labels[i].first + "\":\"";
+      AppendEscaped(json, labels[i].second, true);
+      json += '"';
+    }
+    text += '}';
+  }
+  json += '}';
+  return true;
+}
+
+double Registry::Entry::value() const {
+  if (counter) {
+    return (double)counter->value();
+  }
+  if (gauge) {
+    return gauge->value();
+  }
+  return callback ? callback() : 0.0;
+}
+
+Registry::Registry() : m_entries(std::make_shared<std::vector<Entry>>()) {}
+
+Counter::ptr Registry::counter(const std::string& name, const std::string& help,
+                               const labels_t& labels) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto entries = std::make_shared<std::vector<Entry>>(*m_entries);
+  int64_t index = insert(*entries, name, help, Type::eCounter, labels);
+  if (index < 0) {
+    return nullptr;
+  }
+
+  Entry& entry = (*entries)[index];
+  if (entry.counter) {
+    return entry.counter;
+  }
+  if (entry.callback) {
+    return nullptr;
+  }
+  entry.counter.reset(new Counter);
+  Counter::ptr result = entry.counter;
+  std::atomic_store(&m_entries, entries_t(std::move(entries)));
+  return result;
+}
+
+Gauge::ptr Registry::gauge(const std::string& name, const std::string& help,
+                           const labels_t& labels) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto entries = std::make_shared<std::vector<Entry>>(*m_entries);
+  int64_t index = insert(*entries, name, help, Type::eGauge, labels);
+  if (index < 0) {
+    return nullptr;
+  }
+
+  Entry& entry = (*entries)[index];
+  if (entry.gauge) {
+    return entry.gauge;
+  }
+  if (entry.callback) {
+    return nullptr;
+  }
+  entry.gauge.reset(new Gauge);
+  Gauge::ptr result = entry.gauge;
+  std::atomic_store(&m_entries, entries_t(std::move(entries)));
+  return result;
+}
+
+bool Registry::callback(const std::string& name, const std::string& help,
+                        Type type, callback_t callback,
+                        const labels_t& labels) {
+  if (!callback) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto entries = std::make_shared<std::vector<Entry>>(*m_entries);
+  int64_t index = insert(*entries, name, help, type, labels);
+  if (index < 0) {
+    return false;
+  }
+
+  Entry& entry = (*entries)[index];
+  if (entry.counter || entry.gauge) {
+    return false;
+  }
+  entry.callback = std::move(callback);
+  std::atomic_store(&m_entries, entries_t(std::move(entries)));
+  return true;
+}
+
+void Registry::remove(const std::string& name, const labels_t& labels) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto entries = std::make_shared<std::vector<Entry>>(*m_entries);
+
+  std::string text, json;
+  if (!FormatLabels(labels, text, json)) {
+    return;
+  }
+  auto it = std::find_if(entries->begin(), entries->end(),
+                         [&](const Entry& entry) {
+                           return entry.name == name && entry.labels == text;
+                         });
+  if (it == entries->end()) {
+    return;
+  }
+  entries->erase(it);
+  std::atomic_store(&m_entries, entries_t(std::move(entries)));
+}
+
+size_t Registry::size() const { return load()->size(); }
+
+int64_t Registry::insert(std::vector<Entry>& entries, const std::string& name,
+                         const std::string& help, Type type,
+                         const labels_t& labels) {
+  if (!ValidName(name)) {
+    return -1;
+  }
+
+  Entry entry;
+  entry.name = name;
+  entry.help = help;
+  entry.type = type;
+  if (!FormatLabels(labels, entry.labels, entry.json_labels)) {
+    return -1;
+  }
+
+  auto less = [](const Entry& a, const Entry& b) {
+    return a.name != b.name ? a.name < b.name : a.labels < b.labels;
+  };
+  auto it = std::lower_bound(entries.begin(), entries.end(), entry, less);
+  if (it != entries.end() && it->name == name && it->labels == entry.labels) {
+    return it->type == type ? it - entries.begin() : -1;
+  }
+
+  // 同名的指标类型必须相同
+  if ((it != entries.end() && it->name == name && it->type != type) ||
+      (it != entries.begin() && (it - 1)->name == name &&
+       (it - 1)->type != type)) {
+    return -1;
+  }
+  int64_t index = it - entries.begin();
+  entries.insert(it, std::move(entry));
+  return index;
+}
+
+void Registry::write_prometheus(std::string& out) const {
+  entries_t entries = load();
+  const std::string* family = nullptr;
+  for (auto& entry : *entries) {
+    if (!family || *family != entry.name) {
+      family = &entry.name;
+      if (!entry.help.empty()) {
+        out += "# HELP ";
+        out += entry.name;
+        out += ' ';
+        for (char c : entry.help) {
+          out += c == '\n' ? ' ' : c;
+        }
+        out += '\n';
+      }
+      out += "# TYPE ";
+      out += entry.name;
+      out += entry.type == Type::eCounter ? " counter\n" : " gauge\n";
+    }
+    out += entry.name;
+    out += entry.labels;
+    out += ' ';
+    if (entry.counter) {
+      AppendInteger(out, entry.counter->value());
+    } else {
+      AppendNumber(out, entry.value(), false);
+    }
+    out += '\n';
+  }
+}
+
+void Registry::write_json(std::string& out) const {
+  entries_t entries = load();
+  out += "{\"metrics\":[";
+  bool first = true;
+  for (auto& entry : *entries) {
+    if (!first) {
+      out += ',';
+    }
+    first = false;
+    out += "{\"name\":\"";
+    out += entry.name;
+    out += "\",\"type\":\"";
+    out += entry.type == Type::eCounter ? "counter" : "gauge";
+    out += "\",\"labels\":";
+    out += entry.json_labels;
+    out += ",\"value\":";
+    if (entry.counter) {
+      AppendInteger(out, entry.counter->value());
+    } else {
+      AppendNumber(out, entry.value(), true);
+    }
+    out += '}';
+  }
+  out += "]}";
+}
+
+}  // namespace cx::metrics
@@ -0,0 +1,173 @@
+/**
+ * @file metrics.h
+ * @brief 运行时指标:计数器,仪表与注册表
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cx/common/internal.h"
+#include "cx/common/noncopyable.h"
+#include "cx/common/singleton.h"
+
+namespace cx::metrics {
+
+/**
+ * @brief 指标类型
+ */
+enum class Type : uint8_t { eCounter, eGauge };
+
+/**
+ * @brief 单调递增的计数器,更新只是一次relaxed原子加法
+ */
+class Counter : public Noncopyable {
+ public:
+  typedef std::shared_ptr<Counter> ptr;
+
+  Counter() : m_value(0) {}
+
+  CX_INLINE void inc(uint64_t n = 1) {
+    m_value.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  uint64_t value() const { return m_value.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<uint64_t> m_value;
+};
+
+/**
+ * @brief 可增可减的仪表,如帧率,连接数
+ */
+class Gauge : public Noncopyable {
+ public:
+  typedef std::shared_ptr<Gauge> ptr;
+
+  Gauge() : m_value(0.0) {}
+
+  CX_INLINE void set(double value) {
+    m_value.store(value, std::memory_order_relaxed);
+  }
+
+  CX_INLINE void add(double delta) {
+    double value = m_value.load(std::memory_order_relaxed);
+    while (!m_value.compare_exchange_weak(value, value + delta,
+                                          std::memory_order_relaxed)) {
+    }
+  }
+
+  double value() const { return m_value.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<double> m_value;
+};
+
+/**
+ * @brief 指标注册表
+ *
+ * 注册与删除加锁并复制一份新的指标列表,采集时只原子地取得当前列表的引用,
+ * 再逐个读取原子变量,不会阻塞更新指标的线程(如帧循环)。列表按名称与标签
+ * 排序,同名的指标在输出中相邻
+ */
+class Registry : public Noncopyable, public SingletonPtr<Registry> {
+  friend SingletonPtr<Registry>;
+
+ public:
+  typedef std::function<double()> callback_t;
+  typedef std::vector<std::pair<std::string, std::string>> labels_t;
+
+  /**
+   * @brief 获取或创建计数器
+   *
+   * @param[in] name   名称,只能包含字母,数字,下划线与冒号
+   * @param[in] help   说明
+   * @param[in] labels 标签
+   *
+   * @return 名称无效或同名指标类型不同时返回nullptr
+   */
+  Counter::ptr counter(const std::string& name, const std::string& help,
+                       const labels_t& labels = {});
+
+  /**
+   * @brief 获取或创建仪表
+   *
+   * @return 名称无效或同名指标类型不同时返回nullptr
+   */
+  Gauge::ptr gauge(const std::string& name, const std::string& help,
+                   const labels_t& labels = {});
+
+  /**
+   * @brief 注册采集时计算的指标,已存在时替换
+   *
+   * 回调在采集线程中执行,必须是线程安全的,且在删除前保持有效
+   *
+   * @return 是否成功
+   */
+  bool callback(const std::string& name, const std::string& help, Type type,
+                callback_t callback, const labels_t& labels = {});
+
+  /**
+   * @brief 删除指标,已取得的Counter/Gauge仍可以继续使用
+   */
+  void remove(const std::string& name, const labels_t& labels = {});
+
+  /**
+   * @brief 指标数量
+   */
+  size_t size() const;
+
+  /**
+   * @brief 以Prometheus文本格式输出所有指标
+   *
+   * @param[out] out 输出,追加到末尾
+   */
+  void write_prometheus(std::string& out) const;
+
+  /**
+   * @brief 以JSON格式输出所有指标
+   *
+   * @param[out] out 输出,追加到末尾
+   */
+  void write_json(std::string& out) const;
+
+ private:
+  struct Entry {
+    std::string name;
+    std::string labels;       // Prometheus格式,如{a="1"}
+    std::string json_labels;  // JSON对象
+    std::string help;
+    Type type;
+    Counter::ptr counter;
+    Gauge::ptr gauge;
+    callback_t callback;
+
+    double value() const;
+  };
+
+  typedef std::shared_ptr<const std::vector<Entry>> entries_t;
+
+  Registry();
+
+  /**
+   * @brief 查找或插入指标,调用时必须持有m_mutex
+   *
+   * @return 指标的下标,名称无效或类型冲突时返回-1
+   */
+  int64_t insert(std::vector<Entry>& entries, const std::string& name,
+                 const std::string& help, Type type, const labels_t& labels);
+
+  entries_t load() const { return std::atomic_load(&m_entries); }
+
+ private:
+  std::mutex m_mutex;
+  entries_t m_entries;
+};
+
+}  // namespace cx::metrics
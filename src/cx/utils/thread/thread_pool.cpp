@@ -0,0 +1,88 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+#if defined(CX_PLATFORM_LINUX)
+#include <pthread.h>
+#endif
+
+namespace cx::thread {
+
+ThreadPool::ThreadPool(const std::string& name, size_t threads,
+                       size_t max_tasks)
+    : m_name(name),
+      m_thread_count(threads),
+      m_max_tasks(max_tasks),
+      m_running(false) {
+  if (m_thread_count == 0) {
+    m_thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+}
+
+ThreadPool::~ThreadPool() { stop(); }
+
+void ThreadPool::start() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_running) {
+    return;
+  }
+  m_running = true;
+  for (size_t i = 0; i < m_thread_count; ++i) {
+    m_threads.emplace_back(&ThreadPool::run, this, i);
+  }
+}
+
+void ThreadPool::stop() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_running) {
+      return;
+    }
+    m_running = false;
+  }
+  m_cond.notify_all();
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+  m_threads.clear();
+}
+
+bool ThreadPool::submit(task_t task) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_running || (m_max_tasks && m_tasks.size() >= m_max_tasks)) {
+      return false;
+    }
+    m_tasks.push_back(std::move(task));
+  }
+  m_cond.notify_one();
+  return true;
+}
+
+size_t ThreadPool::pending() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_tasks.size();
+}
+
+void ThreadPool::run(size_t index) {
+#if defined(CX_PLATFORM_LINUX)
+  std::string name = m_name + "_" + std::to_string(index);
+  pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#endif
+
+  while (true) {
+    task_t task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cond.wait(lock, [this]() { return !m_running || !m_tasks.empty(); });
+      if (m_tasks.empty()) {
+        return;
+      }
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+    task();
+  }
+}
+
+}  // namespace cx::thread
@@ -0,0 +1,86 @@
+/**
+ * @file thread_pool.h
+ * @brief 固定线程数,任务队列有界的线程池
+ */
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cx/common/internal.h"
+#include "cx/common/noncopyable.h"
+
+namespace cx::thread {
+
+/**
+ * @brief 线程池
+ *
+ */
+class ThreadPool : public Noncopyable {
+ public:
+  typedef std::shared_ptr<ThreadPool> ptr;
+  typedef std::function<void()> task_t;
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] name      线程名称前缀
+   * @param[in] threads   线程数量,0为cpu核心数
+   * @param[in] max_tasks 最多排队的任务数量,0为不限制
+   */
+  ThreadPool(const std::string& name, size_t threads, size_t max_tasks = 0);
+
+  /**
+   * @brief 析构函数,执行完已排队的任务后退出
+   */
+  ~ThreadPool();
+
+  /**
+   * @brief 启动线程
+   */
+  void start();
+
+  /**
+   * @brief 停止接收新任务,等待已排队的任务执行完毕
+   */
+  void stop();
+
+  /**
+   * @brief 提交任务
+   *
+   * @param[in] task 任务
+   *
+   * @return 队列已满或线程池已停止时返回false
+   */
+  bool submit(task_t task);
+
+  /**
+   * @brief 排队中的任务数量
+   */
+  size_t pending() const;
+
+  size_t threads() const { return m_thread_count; }
+
+  const std::string& name() const { return m_name; }
+
+ private:
+  void run(size_t index);
+
+ private:
+  std::string m_name;
+  size_t m_thread_count;
+  size_t m_max_tasks;
+  bool m_running;
+  std::vector<std::thread> m_threads;
+  std::deque<task_t> m_tasks;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cond;
+};
+
+}  // namespace cx::thread
@@ -0,0 +1,124 @@
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace cx::time {
+
+// 睡眠超出时间与抖动的移动平均的权重
+static const float SMOOTHING = 0.125f;
+
+FramePacer::FramePacer(const TimePoint& step, uint32_t max_steps)
+    : m_step(step),
+      m_max_steps(std::max<uint32_t>(max_steps, 1)),
+      m_render_interval(TimePoint::Seconds(-1)),
+      m_min_spin(TimePoint::Microseconds(100)),
+      m_max_spin(TimePoint::Milliseconds(2)),
+      m_oversleep(TimePoint::Milliseconds(1)) {}
+
+void FramePacer::reset(const TimePoint& now) {
+  m_started = true;
+  m_last = now;
+  m_accumulator = TimePoint();
+  m_next_render = now;
+  m_last_render = TimePoint();
+  m_window_start = now;
+  m_window_max = TimePoint();
+}
+
+void FramePacer::set_step(const TimePoint& step) {
+  if (step.AsMicroseconds() <= 0) return;
+  m_step = step;
+  m_accumulator = TimePoint();
+}
+
+void FramePacer::set_max_steps(uint32_t max_steps) {
+  m_max_steps = std::max<uint32_t>(max_steps, 1);
+}
+
+void FramePacer::set_render_interval(const TimePoint& interval) {
+  m_render_interval = interval;
+  m_next_render = m_last;
+}
+
+uint32_t FramePacer::advance(const TimePoint& now) {
+  if (!m_started) {
+    reset(now);
+    return 0;
+  }
+  if (now > m_last) {
+    m_accumulator += now - m_last;
+    m_last = now;
+  }
+
+  int64_t steps =
+      m_accumulator.AsMicroseconds() / m_step.AsMicroseconds();
+  m_accumulator -= m_step * steps;
+  // 卡顿后只追赶max_steps步,其余的时间丢弃
+  if (steps > m_max_steps) {
+    m_stats.dropped_steps += steps - m_max_steps;
+    steps = m_max_steps;
+  }
+  return (uint32_t)steps;
+}
+
+bool FramePacer::render(const TimePoint& now, bool stepped) {
+  if (m_render_interval.AsMicroseconds() <= 0) {
+    if (!stepped) return false;
+  } else {
+    if (now < m_next_render) return false;
+    m_next_render += m_render_interval;
+    // 落后超过一个间隔时从现在重新对齐,不连续渲染补帧
+    if (m_next_render <= now) m_next_render = now + m_render_interval;
+  }
+  record(now);
+  return true;
+}
+
+TimePoint FramePacer::deadline() const {
+  TimePoint next_step = m_last + m_step - m_accumulator;
+  if (m_render_interval.AsMicroseconds() <= 0) return next_step;
+  return std::min(next_step, m_next_render);
+}
+
+void FramePacer::wait() {
+  TimePoint target = deadline();
+  TimePoint now = TimePoint::Now();
+  if (target <= now) return;
+
+  // 预留比通常的睡眠超出时间稍多的一段用于自旋
+  TimePoint spin = std::clamp(m_oversleep + m_oversleep / (int64_t)2,
+                              m_min_spin, m_max_spin);
+  if (target - now > spin) {
+    TimePoint request = target - now - spin;
+    std::this_thread::sleep_for(
+        std::chrono::microseconds(request.AsMicroseconds()));
+    TimePoint woke = TimePoint::Now();
+    TimePoint over = std::max(woke - now - request, TimePoint());
+    m_oversleep += (over - m_oversleep) * SMOOTHING;
+  }
+  while (TimePoint::Now() < target) {
+    std::this_thread::yield();
+  }
+}
+
+void FramePacer::record(const TimePoint& now) {
+  if (m_last_render.AsMicroseconds() > 0) {
+    TimePoint target =
+        m_render_interval.AsMicroseconds() > 0 ? m_render_interval : m_step;
+    m_stats.interval = now - m_last_render;
+    m_stats.jitter = m_stats.interval > target ? m_stats.interval - target
+                                               : target - m_stats.interval;
+    m_stats.mean_jitter += (m_stats.jitter - m_stats.mean_jitter) * SMOOTHING;
+
+    if (now - m_window_start >= TimePoint::Seconds(1)) {
+      m_stats.max_jitter = m_window_max;
+      m_window_max = TimePoint();
+      m_window_start = now;
+    }
+    m_window_max = std::max(m_window_max, m_stats.jitter);
+  }
+  m_last_render = now;
+}
+
+}  // namespace cx::time
@@ -0,0 +1,139 @@
+/**
+ * @file frame_pacer.h
+ * @brief 固定步长的帧调度
+ */
+#pragma once
+
+#include <cstdint>
+
+#include "cx/common/internal.h"
+#include "cx/utils/time/time.h"
+
+namespace cx::time {
+
+/**
+ * @brief 帧调度器
+ *
+ * 模拟按固定步长推进:经过的时间累积起来,每帧执行累积时间中完整步长的个数,
+ * 一帧最多追赶max_steps步,超出的时间直接丢弃,避免卡顿后越追越慢。渲染与模拟
+ * 解耦,按单独的间隔执行,间隔不大于0时每次模拟推进后渲染一次。两帧之间先睡眠
+ * 再自旋等待到下一个期限:睡眠醒来的延迟通过统计得到,只在最后这一小段自旋,
+ * 期限准确而CPU占用低
+ *
+ * 不是线程安全的,由帧循环所在的线程调用
+ *
+ */
+class FramePacer {
+ public:
+  /**
+   * @brief 帧时间的统计
+   *
+   */
+  struct Stats {
+    TimePoint interval;     // 最近一次渲染与上一次的间隔
+    TimePoint jitter;       // 最近一次渲染间隔与目标间隔之差的绝对值
+    TimePoint mean_jitter;  // 抖动的指数移动平均
+    TimePoint max_jitter;   // 上一个完整的一秒内的最大抖动
+    uint64_t dropped_steps = 0;  // 超过追赶上限而丢弃的步数
+  };
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] step      模拟的固定步长
+   * @param[in] max_steps 一帧最多执行的步数
+   */
+  explicit FramePacer(const TimePoint& step, uint32_t max_steps = 5);
+
+  /**
+   * @brief 从now开始计时,清空累积的时间
+   *
+   */
+  void reset(const TimePoint& now);
+
+  const TimePoint& step() const { return m_step; }
+  void set_step(const TimePoint& step);
+
+  uint32_t max_steps() const { return m_max_steps; }
+  void set_max_steps(uint32_t max_steps);
+
+  const TimePoint& render_interval() const { return m_render_interval; }
+
+  /**
+   * @brief 设置渲染间隔
+   *
+   * @param[in] interval 间隔,不大于0时跟随模拟,每次推进后渲染一次
+   */
+  void set_render_interval(const TimePoint& interval);
+
+  /**
+   * @brief 睡眠醒来后的自旋时间的上下限
+   *
+   */
+  void set_spin_limit(const TimePoint& min, const TimePoint& max) {
+    m_min_spin = min;
+    m_max_spin = max;
+  }
+
+  /**
+   * @brief 推进到now,返回本帧应执行的模拟步数
+   *
+   * @param[in] now 当前时间
+   * @return uint32_t 步数,不超过max_steps
+   */
+  uint32_t advance(const TimePoint& now);
+
+  /**
+   * @brief 本帧是否渲染,渲染时同时记录帧时间
+   *
+   * @param[in] now     当前时间
+   * @param[in] stepped 本帧是否执行了模拟
+   * @return bool 是否渲染
+   */
+  bool render(const TimePoint& now, bool stepped);
+
+  /**
+   * @brief 累积的时间中不足一步的比例,渲染时用于在两次模拟状态之间插值
+   *
+   * @return float 0~1
+   */
+  float alpha() const { return (float)(m_accumulator / m_step); }
+
+  /**
+   * @brief 下一次模拟或渲染的期限
+   *
+   */
+  TimePoint deadline() const;
+
+  /**
+   * @brief 等待到下一个期限,先睡眠,最后一小段自旋
+   *
+   */
+  void wait();
+
+  const Stats& stats() const { return m_stats; }
+
+ private:
+  void record(const TimePoint& now);
+
+ private:
+  TimePoint m_step;
+  uint32_t m_max_steps;
+  bool m_started = false;
+  TimePoint m_last;         // 上一次advance的时间
+  TimePoint m_accumulator;  // 尚未模拟的时间
+
+  TimePoint m_render_interval;
+  TimePoint m_next_render;
+  TimePoint m_last_render;  // 为0时还没有渲染过
+
+  TimePoint m_min_spin;
+  TimePoint m_max_spin;
+  TimePoint m_oversleep;  // 睡眠超出请求时间的移动平均
+
+  Stats m_stats;
+  TimePoint m_window_start;  // 统计最大抖动的一秒窗口
+  TimePoint m_window_max;
+};
+
+}  // namespace cx::time
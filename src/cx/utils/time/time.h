@@ -23,7 +23,7 @@ class TimePoint {
 
   template <typename Rep = int32_t>
   static constexpr TimePoint Milliseconds(const Rep &milliseconds) {
-    return TimePoint(std::chrono::duration<Rep, std::micro>(milliseconds));
+    return TimePoint(std::chrono::duration<Rep, std::milli>(milliseconds));
   }
 
   template <typename Rep = int64_t>
@@ -0,0 +1,277 @@
+#include "timing_wheel.h"
+
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace cx::time {
+
+static CX_INLINE uint32_t CountTrailingZero(uint64_t value) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, value);
+  return index;
+#else
+  return __builtin_ctzll(value);
+#endif
+}
+
+// 时间轮能表示的最大延迟(tick数)
+static const uint64_t MAX_TICKS =
+    (1ull << (TimingWheel::SLOT_BITS * TimingWheel::LEVELS)) - 1;
+
+TimingWheel::TimingWheel(const TimePoint& tick, const TimePoint& start)
+    : m_tick(tick),
+      m_start(start),
+      m_current(0),
+      m_size(0),
+      m_free(NIL),
+      m_occupied{},
+      m_running(NIL),
+      m_running_cancelled(false) {
+  if (m_tick.AsMicroseconds() <= 0) {
+    m_tick = TimePoint::Microseconds(1);
+  }
+}
+
+uint64_t TimingWheel::add(const TimePoint& delay, task_t task) {
+  return add_timer(ticks(delay), 0, std::move(task));
+}
+
+uint64_t TimingWheel::add_every(const TimePoint& interval, task_t task) {
+  uint64_t n = ticks(interval);
+  return add_timer(n, n, std::move(task));
+}
+
+bool TimingWheel::cancel(uint64_t id) {
+  uint32_t index = (uint32_t)id;
+  uint32_t generation = (uint32_t)(id >> 32);
+  if (index >= m_nodes.size() ||
+      m_nodes[index].generation != generation) {
+    return false;
+  }
+
+  if (index == m_running) {
+    // 在自己的任务中取消,执行完后释放
+    if (m_running_cancelled) {
+      return false;
+    }
+    m_running_cancelled = true;
+    return true;
+  }
+
+  if (m_nodes[index].slot == NO_SLOT) {
+    return false;
+  }
+  unlink(index);
+  free_node(index);
+  --m_size;
+  return true;
+}
+
+size_t TimingWheel::advance(const TimePoint& now) {
+  int64_t elapsed = (now - m_start).AsMicroseconds();
+  if (elapsed < 0) {
+    return 0;
+  }
+  uint64_t target = (uint64_t)elapsed / (uint64_t)m_tick.AsMicroseconds();
+
+  size_t count = 0;
+  while (m_current < target) {
+    if (m_size == 0) {
+      m_current = target;
+      break;
+    }
+
+    // 跳到第0层下一个非空的槽,或者下一次降层的时间
+    uint32_t index = m_current & (SLOTS - 1);
+    uint64_t mask = index == SLOTS - 1 ? 0 : m_occupied[0] & (~0ull << (index + 1));
+    uint64_t next = mask ? (m_current & ~(uint64_t)(SLOTS - 1)) + CountTrailingZero(mask)
+                         : (m_current | (SLOTS - 1)) + 1;
+    if (next > target) {
+      m_current = target;
+      break;
+    }
+    m_current = next;
+
+    if ((m_current & (SLOTS - 1)) == 0) {
+      for (uint32_t level = 1; level < LEVELS; ++level) {
+        uint32_t slot = (m_current >> (SLOT_BITS * level)) & (SLOTS - 1);
+        cascade(level, slot);
+        if (slot != 0) {
+          break;
+        }
+      }
+    }
+
+    // 将当前槽整体移入到期的槽
+    uint32_t slot = m_current & (SLOTS - 1);
+    for (uint32_t index : m_slots[slot]) {
+      m_nodes[index].slot = EXPIRED;
+      m_nodes[index].pos = (uint32_t)m_slots[EXPIRED].size();
+      m_slots[EXPIRED].push_back(index);
+    }
+    m_slots[slot].clear();
+    m_occupied[0] &= ~(1ull << slot);
+    count += run_expired();
+  }
+  return count;
+}
+
+TimePoint TimingWheel::next_expiry() const {
+  if (m_size == 0) {
+    return TimePoint::Microseconds(-1);
+  }
+  if (!m_slots[EXPIRED].empty()) {
+    return now();
+  }
+
+  uint32_t index = m_current & (SLOTS - 1);
+  uint64_t mask = index == SLOTS - 1 ? 0 : m_occupied[0] & (~0ull << (index + 1));
+  uint64_t next = mask ? (m_current & ~(uint64_t)(SLOTS - 1)) + CountTrailingZero(mask)
+                       : (m_current | (SLOTS - 1)) + 1;
+  return m_start + m_tick * (int64_t)next;
+}
+
+uint64_t TimingWheel::add_timer(uint64_t delay, uint64_t interval,
+                                task_t task) {
+  uint32_t index = alloc_node();
+  Node& node = m_nodes[index];
+  node.expire = m_current + delay;
+  node.interval = interval;
+  node.task = std::move(task);
+  place(index);
+  ++m_size;
+  return (uint64_t)node.generation << 32 | index;
+}
+
+uint32_t TimingWheel::alloc_node() {
+  if (m_free != NIL) {
+    uint32_t index = m_free;
+    m_free = m_nodes[index].pos;
+    return index;
+  }
+  m_nodes.emplace_back();
+  return (uint32_t)(m_nodes.size() - 1);
+}
+
+void TimingWheel::free_node(uint32_t index) {
+  Node& node = m_nodes[index];
+  node.task = nullptr;
+  ++node.generation;
+  node.slot = NO_SLOT;
+  node.pos = m_free;
+  m_free = index;
+}
+
+void TimingWheel::place(uint32_t index) {
+  uint64_t expire = m_nodes[index].expire;
+  if (expire <= m_current) {
+    link(EXPIRED, index);
+    return;
+  }
+
+  uint64_t delta = expire - m_current;
+  if (delta > MAX_TICKS) {
+    // 超出范围的放在最高层的最远处,降层时重新计算
+    expire = m_current + MAX_TICKS;
+    delta = MAX_TICKS;
+  }
+
+  uint32_t level = 0;
+  while (level < LEVELS - 1 && delta >= (1ull << (SLOT_BITS * (level + 1)))) {
+    ++level;
+  }
+  uint32_t slot = (expire >> (SLOT_BITS * level)) & (SLOTS - 1);
+  link(level * SLOTS + slot, index);
+}
+
+void TimingWheel::link(uint32_t slot, uint32_t index) {
+  Node& node = m_nodes[index];
+  node.slot = (uint16_t)slot;
+  node.pos = (uint32_t)m_slots[slot].size();
+  m_slots[slot].push_back(index);
+  if (slot < EXPIRED) {
+    m_occupied[slot / SLOTS] |= 1ull << (slot % SLOTS);
+  }
+}
+
+void TimingWheel::unlink(uint32_t index) {
+  Node& node = m_nodes[index];
+  std::vector<uint32_t>& slot = m_slots[node.slot];
+  // 用最后一个元素填补空位
+  uint32_t last = slot.back();
+  slot[node.pos] = last;
+  m_nodes[last].pos = node.pos;
+  slot.pop_back();
+  if (slot.empty() && node.slot < EXPIRED) {
+    m_occupied[node.slot / SLOTS] &= ~(1ull << (node.slot % SLOTS));
+  }
+  node.slot = NO_SLOT;
+}
+
+void TimingWheel::cascade(uint32_t level, uint32_t slot) {
+  std::vector<uint32_t>& nodes = m_slots[level * SLOTS + slot];
+  if (nodes.empty()) {
+    return;
+  }
+
+  // 先整体取出,超出范围的定时器可能会被放回同一个槽
+  m_cascading.swap(nodes);
+  m_occupied[level] &= ~(1ull << slot);
+  for (uint32_t index : m_cascading) {
+    place(index);
+  }
+  m_cascading.clear();
+}
+
+size_t TimingWheel::run_expired() {
+  size_t count = 0;
+  std::vector<uint32_t>& expired = m_slots[EXPIRED];
+  while (!expired.empty()) {
+    // 从尾部取出,任务中取消其他到期的定时器不会打乱遍历
+    uint32_t index = expired.back();
+    expired.pop_back();
+    m_nodes[index].slot = NO_SLOT;
+    ++count;
+
+    // 任务中可能添加定时器导致m_nodes扩容,执行期间不能持有节点的引用
+    task_t task = std::move(m_nodes[index].task);
+    if (m_nodes[index].interval == 0) {
+      free_node(index);
+      --m_size;
+      task();
+      continue;
+    }
+
+    m_running = index;
+    m_running_cancelled = false;
+    task();
+    m_running = NIL;
+
+    if (m_running_cancelled) {
+      free_node(index);
+      --m_size;
+      continue;
+    }
+    Node& node = m_nodes[index];
+    node.task = std::move(task);
+    // 落后太多时不补执行
+    node.expire = std::max(node.expire + node.interval, m_current + 1);
+    place(index);
+  }
+  return count;
+}
+
+uint64_t TimingWheel::ticks(const TimePoint& delay) const {
+  int64_t us = delay.AsMicroseconds();
+  int64_t tick = m_tick.AsMicroseconds();
+  if (us <= 0) {
+    return 1;
+  }
+  return std::max<uint64_t>(1, (us + tick - 1) / tick);
+}
+
+}  // namespace cx::time
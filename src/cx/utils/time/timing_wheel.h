@@ -0,0 +1,158 @@
+/**
+ * @file timing_wheel.h
+ * @brief 分层时间轮
+ */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "cx/common/internal.h"
+#include "cx/common/noncopyable.h"
+#include "cx/utils/time/time.h"
+
+namespace cx::time {
+
+/**
+ * @brief 分层时间轮
+ *
+ * 共LEVELS层,每层SLOTS个槽,添加与取消都是O(1);到期的定时器按槽批量取出后
+ * 依次执行。定时器节点分配在连续的数组中,通过空闲链表复用,id中带有版本号,
+ * 取消已经执行或释放的定时器是安全的。槽中保存的是节点下标数组而不是链表,
+ * 降层与到期时可以顺序遍历,避免大量定时器时逐个等待缓存未命中。
+ *
+ * 时间轮不是线程安全的,由驱动它的线程(事件循环或Engine的帧循环)调用advance
+ */
+class TimingWheel : public Noncopyable {
+ public:
+  typedef std::function<void()> task_t;
+
+  CX_STATIC_CONSTEXPR uint32_t SLOT_BITS = 6;
+  CX_STATIC_CONSTEXPR uint32_t SLOTS = 1u << SLOT_BITS;
+  CX_STATIC_CONSTEXPR uint32_t LEVELS = 5;
+
+  /**
+   * @brief 构造函数
+   *
+   * @param[in] tick  每个槽的时间精度
+   * @param[in] start 起始时间
+   */
+  TimingWheel(const TimePoint& tick = TimePoint::Milliseconds(1),
+              const TimePoint& start = TimePoint::Now());
+
+  /**
+   * @brief 添加只执行一次的定时器
+   *
+   * @param[in] delay 相对于时间轮当前时间(最近一次advance)的延迟,精度为tick
+   * @param[in] task  任务
+   *
+   * @return 定时器id,不会为0
+   */
+  uint64_t add(const TimePoint& delay, task_t task);
+
+  /**
+   * @brief 添加重复执行的定时器
+   *
+   * @param[in] interval 间隔
+   * @param[in] task     任务
+   *
+   * @return 定时器id,不会为0
+   */
+  uint64_t add_every(const TimePoint& interval, task_t task);
+
+  /**
+   * @brief 取消定时器,可以在定时器的任务中调用
+   *
+   * @param[in] id 定时器id
+   *
+   * @return 定时器存在且尚未执行时返回true
+   */
+  bool cancel(uint64_t id);
+
+  /**
+   * @brief 推进时间轮并执行所有到期的定时器
+   *
+   * @param[in] now 当前时间
+   *
+   * @return 执行的定时器数量
+   */
+  size_t advance(const TimePoint& now);
+
+  /**
+   * @brief 下一次需要调用advance的时间,可用于计算poll的超时
+   *
+   * 高层的定时器只在降层时才能确定到期时间,此时返回降层的时间
+   *
+   * @return 没有定时器时返回负数
+   */
+  TimePoint next_expiry() const;
+
+  /**
+   * @brief 时间轮当前的时间
+   */
+  TimePoint now() const { return m_start + m_tick * (int64_t)m_current; }
+
+  const TimePoint& tick() const { return m_tick; }
+
+  size_t size() const { return m_size; }
+
+  bool empty() const { return m_size == 0; }
+
+ private:
+  CX_STATIC_CONSTEXPR uint32_t NIL = ~0u;
+  CX_STATIC_CONSTEXPR uint16_t NO_SLOT = 0xffff;
+  // 最后一个槽为本次到期的定时器
+  CX_STATIC_CONSTEXPR uint32_t EXPIRED = LEVELS * SLOTS;
+
+  struct Node {
+    uint32_t pos = NIL;  // 在槽中的位置,空闲时为下一个空闲节点
+    uint32_t generation = 1;
+    uint16_t slot = NO_SLOT;
+    uint64_t expire = 0;
+    uint64_t interval = 0;
+    task_t task;
+  };
+
+  uint64_t add_timer(uint64_t delay, uint64_t interval, task_t task);
+  uint32_t alloc_node();
+  void free_node(uint32_t index);
+
+  /**
+   * @brief 按到期时间放入对应层的槽中
+   */
+  void place(uint32_t index);
+  void link(uint32_t slot, uint32_t index);
+  void unlink(uint32_t index);
+
+  /**
+   * @brief 将第level层的槽中的定时器重新放入更低的层
+   */
+  void cascade(uint32_t level, uint32_t slot);
+
+  /**
+   * @brief 执行到期的定时器
+   */
+  size_t run_expired();
+
+  uint64_t ticks(const TimePoint& delay) const;
+
+ private:
+  TimePoint m_tick;
+  TimePoint m_start;
+  uint64_t m_current;
+  size_t m_size;
+
+  std::vector<Node> m_nodes;
+  std::vector<uint32_t> m_slots[EXPIRED + 1];
+  std::vector<uint32_t> m_cascading;
+  uint32_t m_free;
+  // 每层非空槽的位图,用于跳过空槽
+  uint64_t m_occupied[LEVELS];
+
+  // 正在执行的定时器及其是否在执行中被取消
+  uint32_t m_running;
+  bool m_running_cancelled;
+};
+
+}  // namespace cx::time
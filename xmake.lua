@@ -26,6 +26,7 @@ add_rpathdirs("src/cx/vendor/lib")
 add_includedirs("src")
 
 includes("example")
+includes("benchmark")
 includes("src/cx")
 includes("src/sandbox")
 